@@ -1,10 +1,314 @@
-#include <Python.h>
+#define PYOPTRIS_MAIN_MODULE
+#include "_pyoptris.h"
 
-#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
-#include <numpy/arrayobject.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
 
 #include <direct_binding.h>
 
+using pyoptris::Capture;
+using pyoptris::FrameInfo;
+using pyoptris::FramePool;
+using pyoptris::FrameSource;
+
+// Backs every array handed out by the get_*_image accessors, see frame_array()
+static std::shared_ptr<FramePool> framePool;
+
+static const char *FRAME_CAPSULE_NAME = "pyoptris.frame";
+
+std::shared_ptr<FramePool> &frame_pool() {
+    return framePool;
+}
+
+static void release_frame_capsule(PyObject *capsule) {
+    FramePool::release((FramePool::Buffer *) PyCapsule_GetPointer(capsule, FRAME_CAPSULE_NAME));
+}
+
+static size_t itemsize_of(int typenum) {
+    switch(typenum) {
+        case NPY_UINT8:
+            return 1;
+
+        case NPY_UINT16:
+        case NPY_FLOAT16:
+            return 2;
+
+        case NPY_FLOAT32:
+        case NPY_INT32:
+        case NPY_UINT32:
+            return 4;
+
+        default:
+            return 8;
+    }
+}
+
+PyObject *wrap_pooled_buffer(FramePool::Buffer *buffer, int nd, npy_intp *dimensions, int typenum) {
+    // The capsule set as the array base hands the buffer back to the pool once the array is collected
+    PyObject *capsule = PyCapsule_New(buffer, FRAME_CAPSULE_NAME, release_frame_capsule);
+    if (capsule == NULL) {
+        FramePool::release(buffer);
+        return NULL;
+    }
+    PyObject *array = PyArray_SimpleNewFromData(nd, dimensions, typenum, buffer->data);
+    if (array == NULL) {
+        Py_DECREF(capsule);
+        return NULL;
+    }
+    // Steals the capsule reference
+    if (PyArray_SetBaseObject((PyArrayObject *) array, capsule) < 0) {
+        Py_DECREF(array);
+        return NULL;
+    }
+    return array;
+}
+
+PyObject *new_pooled_array(const std::shared_ptr<FramePool> &pool, int nd, npy_intp *dimensions, int typenum) {
+    size_t size = itemsize_of(typenum);
+    for (int i = 0; i < nd; i++) {
+        size *= dimensions[i];
+    }
+
+    FramePool::Buffer *buffer = pool->acquire(size);
+    if (buffer == nullptr) {
+        return PyErr_NoMemory();
+    }
+    return wrap_pooled_buffer(buffer, nd, dimensions, typenum);
+}
+
+/**
+ * @brief Checks that a caller supplied out= array can receive a frame without conversion
+ * @return 0 if usable, -1 with an exception set otherwise
+ */
+static int check_out_array(PyObject *out, int nd, npy_intp *dimensions, int typenum) {
+    if (!PyArray_Check(out)) {
+        PyErr_SetString(PyExc_TypeError, "out must be a numpy.ndarray");
+        return -1;
+    }
+    PyArrayObject *array = (PyArrayObject *) out;
+    if (PyArray_TYPE(array) != typenum) {
+        PyErr_SetString(PyExc_TypeError, "out has the wrong dtype");
+        return -1;
+    }
+    if (!PyArray_ISCARRAY(array)) {
+        PyErr_SetString(PyExc_ValueError, "out must be C-contiguous, aligned and writeable");
+        return -1;
+    }
+    bool sameShape = PyArray_NDIM(array) == nd;
+    for (int i = 0; sameShape && i < nd; i++) {
+        sameShape = PyArray_DIM(array, i) == dimensions[i];
+    }
+    if (!sameShape) {
+        PyErr_SetString(PyExc_ValueError, "out does not match the image size");
+        return -1;
+    }
+    return 0;
+}
+
+PyObject *frame_array(PyObject *out, int nd, npy_intp *dimensions, int typenum) {
+    if (out == Py_None) {
+        return new_pooled_array(framePool, nd, dimensions, typenum);
+    }
+    if (check_out_array(out, nd, dimensions, typenum) < 0) {
+        return NULL;
+    }
+    Py_INCREF(out);
+    return out;
+}
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Thermal frame of the usb_init/tcp_init camera with the flag state and chip temperature the SDK reports
+ * @param[out] info sequence is the camera frame counter
+ */
+static int fetch_direct_thermal(int width, int height, uint16_t *data, FrameInfo &info) {
+    EvoIRFrameMetadata metadata;
+    int ok = evo_irimager_get_thermal_image_metadata(&width, &height, data, &metadata);
+    info.timestamp = now_ns();
+    if (ok == 0) {
+        info.sequence = metadata.counter;
+        info.flag = (int) metadata.flagState;
+        info.chipTemperature = metadata.tempChip;
+    }
+    return ok;
+}
+
+/**
+ * @brief Counts a direct_binding call of the module level accessors in the capture statistics, safe without the GIL
+ * @param[in,out] info stamped with the acquisition time unless the fetch did, for the delivery statistics
+ */
+static void record_direct_fetch(int64_t before, int ok, FrameInfo &info) {
+    pyoptris::PipelineStatistics &statistics = pyoptris::pipeline_statistics();
+    if (ok == 0) {
+        if (info.timestamp == 0) {
+            info.timestamp = now_ns();
+        }
+        statistics.capture.record(pyoptris::steady_now_ns() - before);
+        statistics.captured.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        statistics.errors.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Longest a module level accessor fetches over invalid frames before it hands one out tagged, a flag cycle takes well under a second
+static const int64_t DIRECT_GATE_MAX_NS = 2000000000;
+
+/**
+ * @brief Flag gate of the module level thermal accessors, which fetch without a capture thread.
+ * Accessors run without the GIL and may overlap, the mutex serializes them so frames are classified in order.
+ */
+struct DirectGate {
+    std::mutex mutex;
+    pyoptris::FlagGate gate;                // configured by set_flag_gate() together with the direct captures
+    std::vector<uint16_t> previous;         // last fetched frame of a source without flag state, for frozen detection
+    std::vector<uint16_t> lastValid;        // last valid frame, handed out in place of invalid ones under FLAG_POLICY_HOLD
+    std::vector<unsigned char> lastValidPalette;
+    bool havePrevious = false;
+    bool haveLastValid = false;
+    bool haveLastValidPalette = false;
+};
+
+static DirectGate directGate;
+
+/**
+ * @brief Fetches a thermal frame through the module flag gate, safe without the GIL.
+ * FLAG_POLICY_TAG only sets info.validity, FLAG_POLICY_DROP fetches again until a valid frame arrives and
+ * FLAG_POLICY_HOLD hands out the last valid frame with info.held set, fetching again before there is one.
+ * After DIRECT_GATE_MAX_NS of invalid frames the last one is handed out tagged.
+ * @param palette nullptr, or a paletteWidth x paletteHeight RGB image fetched from the same frame. That fetch
+ * reports no flag state, so its frames are classified by frozen frame detection.
+ * @return SDK error code of the last fetch
+ */
+static int fetch_gated(int width, int height, uint16_t *data, int paletteWidth, int paletteHeight, unsigned char *palette, FrameInfo &info) {
+    std::lock_guard<std::mutex> lock(directGate.mutex);
+    size_t pixels = (size_t) width * height;
+    size_t paletteBytes = palette != nullptr ? (size_t) paletteWidth * paletteHeight * 3 : 0;
+    if (directGate.previous.size() != pixels) {
+        // The image format changed, nothing fetched before compares with the new frames
+        directGate.previous.resize(pixels);
+        directGate.lastValid.resize(pixels);
+        directGate.havePrevious = false;
+        directGate.haveLastValid = false;
+        directGate.haveLastValidPalette = false;
+    }
+    if (palette != nullptr && directGate.lastValidPalette.size() != paletteBytes) {
+        directGate.lastValidPalette.resize(paletteBytes);
+        directGate.haveLastValidPalette = false;
+    }
+
+    pyoptris::FlagGate &gate = directGate.gate;
+    int64_t start = pyoptris::steady_now_ns();
+    for (;;) {
+        info = FrameInfo();
+        int64_t before = pyoptris::steady_now_ns();
+        int ok = palette == nullptr
+            ? fetch_direct_thermal(width, height, data, info)
+            : evo_irimager_get_thermal_palette_image(width, height, data, paletteWidth, paletteHeight, palette);
+        int64_t after = pyoptris::steady_now_ns();
+        info.fetchNs = after - before;
+        record_direct_fetch(before, ok, info);
+        if (ok != 0) {
+            return ok;
+        }
+
+        pyoptris::FlagPolicy policy = gate.policy();
+        gate.classify(data, directGate.havePrevious ? directGate.previous.data() : nullptr, pixels, info, after);
+        if (info.flag == pyoptris::FLAG_UNKNOWN && gate.detect_frozen()) {
+            std::memcpy(directGate.previous.data(), data, pixels * sizeof(uint16_t));
+            directGate.havePrevious = true;
+        }
+        if (info.validity == pyoptris::FRAME_VALID) {
+            if (policy == pyoptris::FLAG_POLICY_HOLD) {
+                std::memcpy(directGate.lastValid.data(), data, pixels * sizeof(uint16_t));
+                directGate.haveLastValid = true;
+                if (palette != nullptr) {
+                    std::memcpy(directGate.lastValidPalette.data(), palette, paletteBytes);
+                }
+                directGate.haveLastValidPalette = palette != nullptr;
+            }
+            return 0;
+        }
+        if (policy == pyoptris::FLAG_POLICY_TAG || after - start >= DIRECT_GATE_MAX_NS) {
+            return 0;
+        }
+        if (policy == pyoptris::FLAG_POLICY_HOLD && directGate.haveLastValid && (palette == nullptr || directGate.haveLastValidPalette)) {
+            std::memcpy(data, directGate.lastValid.data(), pixels * sizeof(uint16_t));
+            if (palette != nullptr) {
+                std::memcpy(palette, directGate.lastValidPalette.data(), paletteBytes);
+            }
+            info.held = true;
+            return 0;
+        }
+        // FLAG_POLICY_DROP, or FLAG_POLICY_HOLD before the first valid frame
+    }
+}
+
+/**
+ * @brief Feeds a Capture from the camera opened through usb_init/tcp_init
+ */
+class DirectBindingSource : public FrameSource {
+public:
+    int thermal_size(int &width, int &height) override {
+        return evo_irimager_get_thermal_image_size(&width, &height);
+    }
+
+    int fetch_thermal(uint16_t *data, int width, int height, FrameInfo &info) override {
+        return fetch_direct_thermal(width, height, data, info);
+    }
+};
+
+std::shared_ptr<FrameSource> direct_binding_source() {
+    return std::make_shared<DirectBindingSource>();
+}
+
+// Captures reading through the direct_binding functions, only touched while holding the GIL
+static std::vector<std::weak_ptr<Capture>> directCaptures;
+
+// Ring budget of the capture behind a get_thermal_frames call, the reader copies out as frames arrive,
+// so the ring only covers stalls of the reader, not the whole batch
+static const size_t BATCH_RING_BYTES = 32u << 20;
+
+// Flag gate set with set_flag_gate(), applied to every capture on the direct_binding camera, only touched while holding the GIL
+static pyoptris::FlagPolicy directFlagPolicy = pyoptris::FLAG_POLICY_TAG;
+static int64_t directSettleNs = 100000000;
+static bool directDetectFrozen = true;
+
+void register_direct_capture(const std::shared_ptr<Capture> &capture) {
+    capture->flag_gate().configure(directFlagPolicy, directSettleNs, directDetectFrozen);
+    // Drop captures that are gone, e.g. those of earlier get_thermal_frames calls
+    directCaptures.erase(std::remove_if(directCaptures.begin(), directCaptures.end(),
+                                        [](const std::weak_ptr<Capture> &weak) { return weak.expired(); }),
+                         directCaptures.end());
+    directCaptures.push_back(capture);
+}
+
+/**
+ * @brief Stops every capture thread still calling into the direct_binding camera
+ * Must be called with the GIL held, it is released while the threads are joined.
+ */
+static void stop_direct_captures() {
+    std::vector<std::shared_ptr<Capture>> captures;
+    for (auto &weak : directCaptures) {
+        if (auto capture = weak.lock()) {
+            captures.push_back(capture);
+        }
+    }
+    directCaptures.clear();
+
+    Py_BEGIN_ALLOW_THREADS
+    for (auto &capture : captures) {
+        capture->stop();
+    }
+    Py_END_ALLOW_THREADS
+}
+
 
 
 /**
@@ -83,6 +387,7 @@ PyObject * tcp_init(PyObject *, PyObject *args) {
  * 
  */
 PyObject * terminate(PyObject *, PyObject *) {
+    stop_direct_captures();
     int ok = evo_irimager_terminate();
     switch(ok) {
         case 0:
@@ -154,6 +459,11 @@ PyObject * get_palette_image_size(PyObject *, PyObject *) {
  * @brief Accessor to thermal image by reference
  * Conversion to temperature values are to be performed as follows:
  * t = ((double)data[x] - 1000.0) / 10.0;
+ * Python: get_thermal_image(out=None, metadata=False, crop=None, binning=1, binning_mode=BINNING_MEAN, levels=0), out may be a
+ * preallocated (h, w) uint16 array that is filled in place.
+ * metadata=True returns (frame, pyoptris.FrameMetadata) read through evo_irimager_get_thermal_image_metadata.
+ * crop=(x, y, width, height), binning=2 or 4 and levels > 0 return the frame cropped, binned and with its thumbnail
+ * pyramid as bin_frame() does, built while the fetched frame is still in cache; out then receives the first level.
  * @param[in] w image width
  * @param[in] h image height
  * @param[out] data pointer to unsigned short array allocate by the user (size of w * h)
@@ -162,43 +472,258 @@ PyObject * get_palette_image_size(PyObject *, PyObject *) {
  * __IRDIRECTSDK_API__ int evo_irimager_get_thermal_image(int* w, int* h, unsigned short* data);
  * 
  */
-PyObject * get_thermal_image(PyObject *, PyObject *) {
-    PyObject * result;
+PyObject * get_thermal_image(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "out", "metadata", "crop", "binning", "binning_mode", "levels", nullptr };
+    PyObject *out = Py_None;
+    int metadata = 0;
+    PyObject *crop = Py_None;
+    int binning = 1, mode = pyoptris::BINNING_MEAN, levels = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OpOiii", (char **) keywords, &out, &metadata, &crop, &binning, &mode, &levels)) {
+        PyErr_SetString(PyExc_RuntimeError, "Bad argument(s)");
+        return NULL;
+    }
     int width, height;
     int ok = evo_irimager_get_thermal_image_size(&width, &height);
-    unsigned short *data;
-    npy_intp dimensions[2] = {height, width};
-    if (ok == 0) {
-        data = (unsigned short *) PyMem_RawMalloc(width * height * sizeof(unsigned short));
-        ok = evo_irimager_get_thermal_image(&width, &height, data);
+    pyoptris::BinningOptions options;
+    if (ok == 0 && parse_binning(crop, binning, mode, levels, width, height, options) < 0) {
+        return NULL;
+    }
+    if (ok == 0 && binning_changes_frame(options, width, height)) {
+        std::vector<uint16_t *> outputs;
+        PyObject *result = binned_arrays(out, framePool, options, outputs);
+        if (result == NULL) {
+            return NULL;
+        }
+        // The frame and the scratch of the mean share one pool buffer, the scratch starting 16 byte aligned
+        size_t frameBytes = ((size_t) width * height * sizeof(unsigned short) + 15) & ~(size_t) 15;
+        FramePool::Buffer *scratch = framePool->acquire(frameBytes + pyoptris::binning_scratch_bytes(options));
+        if (scratch == nullptr) {
+            Py_DECREF(result);
+            return PyErr_NoMemory();
+        }
+        uint16_t *frame = (uint16_t *) scratch->data;
+        FrameInfo info;
+        Py_BEGIN_ALLOW_THREADS
+        ok = fetch_gated(width, height, frame, 0, 0, nullptr, info);
+        if (ok == 0) {
+            pyoptris::bin_frame(frame, width, options, outputs.data(), (char *) scratch->data + frameBytes);
+        }
+        Py_END_ALLOW_THREADS
+        FramePool::release(scratch);
+        if (ok == 0) {
+            record_delivery(info, 0);
+            return with_frame_metadata(result, info, metadata);
+        }
+        Py_DECREF(result);
+    } else if (ok == 0) {
+        npy_intp dimensions[2] = {height, width};
+        PyObject *result = frame_array(out, 2, dimensions, NPY_UINT16);
+        if (result == NULL) {
+            return NULL;
+        }
+        unsigned short *data = (unsigned short *) PyArray_DATA((PyArrayObject *) result);
+        FrameInfo info;
+        Py_BEGIN_ALLOW_THREADS
+        ok = fetch_gated(width, height, data, 0, 0, nullptr, info);
+        Py_END_ALLOW_THREADS
+        if (ok == 0) {
+            record_delivery(info, 0);
+            return with_frame_metadata(result, info, metadata);
+        }
+        Py_DECREF(result);
+    }
+    switch(ok) {
+        case -1:
+            PyErr_SetString(PyExc_RuntimeError, "Error");
+            break;
 
+        case -2:
+            PyErr_SetString(PyExc_RuntimeError, "Fatal error");
+            break;
+
+        default:
+            abort();
+    }
+    return NULL;
+}
+
+/**
+ * @brief Thermal frame as a pyoptris.Frame, with its metadata
+ * Python: get_frame() -> pyoptris.Frame
+ * The frame owns the pooled raw buffer and hands it to numpy/torch without a copy; temperatures, palette
+ * images and statistics are only computed when asked for, at the decimals set when the frame was taken.
+ */
+PyObject * get_frame(PyObject *, PyObject *) {
+    int width, height;
+    int ok = evo_irimager_get_thermal_image_size(&width, &height);
+    if (ok == 0) {
+        FramePool::Buffer *raw = framePool->acquire((size_t) width * height * sizeof(unsigned short));
+        if (raw == nullptr) {
+            return PyErr_NoMemory();
+        }
+        FrameInfo info;
+        Py_BEGIN_ALLOW_THREADS
+        ok = fetch_gated(width, height, (uint16_t *) raw->data, 0, 0, nullptr, info);
+        Py_END_ALLOW_THREADS
         if (ok == 0) {
-            result = PyArray_SimpleNewFromData(2, dimensions, NPY_UINT16, (void *) data);
-        } else if (ok == -1) {
+            record_delivery(info, 0);
+            return new_frame(raw, width, height, &info, current_temperature_scale());
+        }
+        FramePool::release(raw);
+    }
+    switch(ok) {
+        case -1:
             PyErr_SetString(PyExc_RuntimeError, "Error");
-            result = NULL;
-        } else if(ok == -2) {
+            break;
+
+        case -2:
             PyErr_SetString(PyExc_RuntimeError, "Fatal error");
-            result = NULL;
-        } else {
+            break;
+
+        default:
             abort();
+    }
+    return NULL;
+}
+
+/**
+ * @brief Batch accessor for the kilohertz formats, e.g. 72x56 @ 1000Hz
+ * Python: get_thermal_frames(n, timeout=None) -> (frames, timestamps, sequences)
+ * Starts a native reader thread for the call that copies the next n frames into an (n, h, w) uint16 array
+ * with the GIL released, and stops it before returning. timestamps holds the acquisition times in ns since
+ * the epoch and sequences the frame counters of the call, starting at 0, gaps in them are dropped frames.
+ * Frames between calls are not kept, read a pyoptris.Capture with next_batch() for a gapless stream.
+ * Fewer than n frames are returned if timeout seconds pass first.
+ */
+PyObject * get_thermal_frames(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "n", "timeout", nullptr };
+    Py_ssize_t count;
+    PyObject *timeout = Py_None;
+    int64_t timeoutNs;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n|O", (char **) keywords, &count, &timeout) || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+    if (count < 1) {
+        PyErr_SetString(PyExc_ValueError, "n must be positive");
+        return NULL;
+    }
+
+    std::shared_ptr<FrameSource> source = direct_binding_source();
+    std::shared_ptr<Capture> capture;
+    int width, height;
+    int ok = source->thermal_size(width, height);
+    if (ok == 0) {
+        size_t frameSize = (size_t) width * height * sizeof(uint16_t);
+        size_t capacity = std::min<size_t>((size_t) count, std::max<size_t>(BATCH_RING_BYTES / std::max<size_t>(frameSize, 1), 2));
+        capture = std::make_shared<Capture>(source, capacity);
+        register_direct_capture(capture);
+        try {
+            ok = capture->start();
+        } catch (const std::bad_alloc &) {
+            return PyErr_NoMemory();
         }
-    } else if (ok == -1) {
-        PyErr_SetString(PyExc_RuntimeError, "Error");
-        result = NULL;
-    } else if(ok == -2) {
-        PyErr_SetString(PyExc_RuntimeError, "Fatal error");
-        result = NULL;
-    } else {
-        abort();
+    }
+    switch(ok) {
+        case 0:
+            break;
+
+        case -1:
+            PyErr_SetString(PyExc_RuntimeError, "Error");
+            return NULL;
+
+        case -2:
+            PyErr_SetString(PyExc_RuntimeError, "Fatal error");
+            return NULL;
+
+        default:
+            abort();
     }
 
+    PyObject *reader = new_capture_reader(capture, framePool);
+    PyObject *result = reader != NULL ? capture_reader_batch(reader, count, timeoutNs) : NULL;
+    Py_XDECREF(reader);
+    Py_BEGIN_ALLOW_THREADS
+    capture->stop();
+    Py_END_ALLOW_THREADS
     return result;
 }
 
+/**
+ * @brief Thermal image converted to degrees Celsius
+ * Python: get_temperature_image(out=None, dtype=None, profile=None), dtype float32 (default) or float16.
+ * The raw frame lands in a pooled scratch buffer and is converted with the SIMD kernels,
+ * honouring the decimals set with set_temperature_decimals(). profile is a correction profile name or a
+ * pyoptris.Correction, None applies the profile set with set_correction_profile() if any. Corrections are
+ * applied here rather than by the SDK, so they work over TCP as well.
+ */
+PyObject * get_temperature_image(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "out", "dtype", "profile", nullptr };
+    PyObject *out = Py_None;
+    PyObject *dtype = Py_None;
+    PyObject *profile = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OOO", (char **) keywords, &out, &dtype, &profile)) {
+        PyErr_SetString(PyExc_RuntimeError, "Bad argument(s)");
+        return NULL;
+    }
+    int typenum;
+    if (parse_float_dtype(dtype, out, typenum) < 0) {
+        return NULL;
+    }
+    int width, height;
+    int ok = evo_irimager_get_thermal_image_size(&width, &height);
+    if (ok == 0) {
+        std::shared_ptr<const pyoptris::RadiometricCorrection> correction;
+        if (resolve_correction(profile, width, height, typenum, correction) < 0) {
+            return NULL;
+        }
+        npy_intp dimensions[2] = {height, width};
+        PyObject *result = frame_array(out, 2, dimensions, typenum);
+        if (result == NULL) {
+            return NULL;
+        }
+        size_t n = (size_t) width * height;
+        FramePool::Buffer *raw = framePool->acquire(n * sizeof(unsigned short));
+        if (raw == nullptr) {
+            Py_DECREF(result);
+            return PyErr_NoMemory();
+        }
+        void *data = PyArray_DATA((PyArrayObject *) result);
+        pyoptris::TemperatureScale scale = current_temperature_scale();
+        FrameInfo info;
+        Py_BEGIN_ALLOW_THREADS
+        ok = fetch_gated(width, height, (uint16_t *) raw->data, 0, 0, nullptr, info);
+        if (ok == 0) {
+            correct_to_celsius((const uint16_t *) raw->data, data, n, typenum, scale, correction);
+        }
+        Py_END_ALLOW_THREADS
+        FramePool::release(raw);
+        if (ok == 0) {
+            record_delivery(info, 0);
+            return result;
+        }
+        Py_DECREF(result);
+    }
+    switch(ok) {
+        case -1:
+            PyErr_SetString(PyExc_RuntimeError, "Error");
+            break;
+
+        case -2:
+            PyErr_SetString(PyExc_RuntimeError, "Fatal error");
+            break;
+
+        default:
+            abort();
+    }
+    return NULL;
+}
+
 /**
  * @brief Accessor to an RGB palette image by reference
  * data format: unsigned char array (size 3 * w * h) r,g,b
+ * Python: get_palette_image(out=None, crop=None), out may be a preallocated (h, w, 3) uint8 array that is filled in place.
+ * crop=(x, y, width, height) returns only that rectangle. Binned previews are rendered with render_palette() from
+ * get_thermal_image(binning=...), which colours the fewer pixels instead of averaging colours.
  * @param[in] w image width
  * @param[in] h image height
  * @param[out] data pointer to unsigned char array allocate by the user (size of 3 * w * h)
@@ -207,42 +732,85 @@ PyObject * get_thermal_image(PyObject *, PyObject *) {
  * __IRDIRECTSDK_API__ int evo_irimager_get_palette_image(int* w, int* h, unsigned char* data);
  * 
  */
-PyObject * get_palette_image(PyObject *, PyObject *) {
-    PyObject *result;
+PyObject * get_palette_image(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "out", "crop", nullptr };
+    PyObject *out = Py_None;
+    PyObject *crop = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OO", (char **) keywords, &out, &crop)) {
+        PyErr_SetString(PyExc_RuntimeError, "Bad argument(s)");
+        return NULL;
+    }
     int width, height;
     int ok = evo_irimager_get_palette_image_size(&width, &height);
-    unsigned char *data;
-    npy_intp dimensions[3] = {height, width, 3};    
-    if (ok == 0) {
-        data = (unsigned char *) PyMem_RawMalloc(width * height * 3 * sizeof(unsigned char));
+    pyoptris::BinningOptions options;
+    if (ok == 0 && parse_binning(crop, 1, pyoptris::BINNING_MEAN, 0, width, height, options) < 0) {
+        return NULL;
+    }
+    if (ok == 0 && binning_changes_frame(options, width, height)) {
+        npy_intp dimensions[3] = {options.height, options.width, 3};
+        PyObject *result = frame_array(out, 3, dimensions, NPY_UINT8);
+        if (result == NULL) {
+            return NULL;
+        }
+        FramePool::Buffer *scratch = framePool->acquire((size_t) width * height * 3);
+        if (scratch == nullptr) {
+            Py_DECREF(result);
+            return PyErr_NoMemory();
+        }
+        const unsigned char *image = (const unsigned char *) scratch->data;
+        unsigned char *data = (unsigned char *) PyArray_DATA((PyArrayObject *) result);
+        FrameInfo info;
+        Py_BEGIN_ALLOW_THREADS
+        int64_t before = pyoptris::steady_now_ns();
+        ok = evo_irimager_get_palette_image(&width, &height, (unsigned char *) scratch->data);
+        record_direct_fetch(before, ok, info);
+        if (ok == 0) {
+            size_t rowBytes = (size_t) options.width * 3;
+            for (int y = 0; y < options.height; y++) {
+                std::memcpy(data + y * rowBytes, image + ((size_t) (options.y + y) * width + options.x) * 3, rowBytes);
+            }
+        }
+        Py_END_ALLOW_THREADS
+        FramePool::release(scratch);
+        if (ok == 0) {
+            record_delivery(info, 0);
+            return result;
+        }
+        Py_DECREF(result);
+    } else if (ok == 0) {
+        npy_intp dimensions[3] = {height, width, 3};
+        PyObject *result = frame_array(out, 3, dimensions, NPY_UINT8);
+        if (result == NULL) {
+            return NULL;
+        }
+        unsigned char *data = (unsigned char *) PyArray_DATA((PyArrayObject *) result);
+        FrameInfo info;
+        Py_BEGIN_ALLOW_THREADS
+        int64_t before = pyoptris::steady_now_ns();
         ok = evo_irimager_get_palette_image(&width, &height, data);
-
+        record_direct_fetch(before, ok, info);
+        Py_END_ALLOW_THREADS
         if (ok == 0) {
-            result = PyArray_SimpleNewFromData(3, dimensions, NPY_UINT8, (void *) data);
-        } else if (ok == -1) {
+            record_delivery(info, 0);
+            return result;
+        }
+        Py_DECREF(result);
+    }
+    switch(ok) {
+        case -1:
             PyErr_SetString(PyExc_RuntimeError, "Error");
-            result = NULL;
-        } else if(ok == -2) {
+            break;
+
+        case -2:
             PyErr_SetString(PyExc_RuntimeError, "Fatal error");
-            result = NULL;
-        } else {
-            printf("Something went horribly wrong");
+            break;
+
+        default:
             abort();
-        }
-    } else if (ok == -1) {
-        PyErr_SetString(PyExc_RuntimeError, "Error");
-        result = NULL;
-    } else if(ok == -2) {
-        PyErr_SetString(PyExc_RuntimeError, "Fatal error");
-        result = NULL;
-    } else {
-        abort();
     }
-
-    return result;
+    return NULL;
 }
 
-
 /**
  * @brief Accessor to an RGB palette image and a thermal image by reference
  * @param[in] w_t width of thermal image
@@ -252,49 +820,60 @@ PyObject * get_palette_image(PyObject *, PyObject *) {
  * @param[in] h_p height of palette image (can differ from thermal image height due to striding)
  * @param[out] data_p data pointer to unsigned char array allocate by the user (size of 3 * w * h)
  * @return error code: 0 on success, -1 on error, -2 on fatal error (only TCP connection)
+ * Python: get_thermal_palette_image(thermal_out=None, palette_out=None) -> (thermal, palette)
+ * Both images come from the same frame. The out arrays are (h_t, w_t) uint16 and (h_p, w_p, 3) uint8.
  * 
  * __IRDIRECTSDK_API__ int evo_irimager_get_thermal_palette_image(int w_t, int h_t, unsigned short* data_t, int w_p, int h_p, unsigned char* data_p );
  * 
  */
-PyObject * get_thermal_palette_image(PyObject *, PyObject *) {
-    int ok = 0;// = evo_irimager_get_thermal_image_size(&width, &height);
-    double result = 8;
+PyObject * get_thermal_palette_image(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "thermal_out", "palette_out", nullptr };
+    PyObject *thermalOut = Py_None;
+    PyObject *paletteOut = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OO", (char **) keywords, &thermalOut, &paletteOut)) {
+        PyErr_SetString(PyExc_RuntimeError, "Bad argument(s)");
+        return NULL;
+    }
+    int thermalWidth, thermalHeight, paletteWidth, paletteHeight;
+    int ok = evo_irimager_get_thermal_image_size(&thermalWidth, &thermalHeight);
+    if (ok == 0) {
+        ok = evo_irimager_get_palette_image_size(&paletteWidth, &paletteHeight);
+    }
+    if (ok == 0) {
+        npy_intp thermalDimensions[2] = {thermalHeight, thermalWidth};
+        npy_intp paletteDimensions[3] = {paletteHeight, paletteWidth, 3};
+        PyObject *thermal = frame_array(thermalOut, 2, thermalDimensions, NPY_UINT16);
+        if (thermal == NULL) {
+            return NULL;
+        }
+        PyObject *palette = frame_array(paletteOut, 3, paletteDimensions, NPY_UINT8);
+        if (palette == NULL) {
+            Py_DECREF(thermal);
+            return NULL;
+        }
+
+        unsigned short *thermalData = (unsigned short *) PyArray_DATA((PyArrayObject *) thermal);
+        unsigned char *paletteData = (unsigned char *) PyArray_DATA((PyArrayObject *) palette);
+        FrameInfo info;
+        Py_BEGIN_ALLOW_THREADS
+        ok = fetch_gated(thermalWidth, thermalHeight, thermalData, paletteWidth, paletteHeight, paletteData, info);
+        Py_END_ALLOW_THREADS
+        if (ok == 0) {
+            record_delivery(info, 0);
+            return Py_BuildValue("NN", thermal, palette);
+        }
+        Py_DECREF(thermal);
+        Py_DECREF(palette);
+    }
     switch(ok) {
-        case 0:
-            return PyFloat_FromDouble(result);
-        
         case -1:
             PyErr_SetString(PyExc_RuntimeError, "Error");
             break;
-        
+
         case -2:
             PyErr_SetString(PyExc_RuntimeError, "Fatal error");
             break;
-        
-        default:
-            abort();
-    }
-    return NULL;
-}
 
-/**
- * @brief 
- * @return error code: 0 on success, -1 on error
- *
- * __IRDIRECTSDK_API__ int evo_irimager_to_palette_save_png(unsigned short* thermal_data, int w, int h, const char* path, int palette, int palette_scale);
- *
- */
-PyObject * save_palette_to_png(PyObject *, PyObject *args) {
-    int ok = 0;// = evo_irimager_get_thermal_image_size(&width, &height);
-    double result = 6;
-    switch(ok) {
-        case 0:
-            return PyFloat_FromDouble(result);
-        
-        case -1:
-            PyErr_SetString(PyExc_RuntimeError, "Error");
-            break;
-        
         default:
             abort();
     }
@@ -644,16 +1223,50 @@ PyObject * daemon_kill(PyObject *, PyObject *) {
     return NULL;
 }
 
+/**
+ * @brief set_flag_gate(policy, settle=0.1, detect_frozen=True)
+ * Capture.set_flag_gate() for every capture on the usb_init/tcp_init camera, running ones and those started
+ * later, get_thermal_frames included, and for the module level get_thermal_image, get_frame, get_temperature_image
+ * and get_thermal_palette_image. get_palette_image has no thermal frame to classify and is not gated.
+ */
+PyObject * set_flag_gate(PyObject *, PyObject *args, PyObject *kwargs) {
+    if (parse_flag_gate(args, kwargs, directFlagPolicy, directSettleNs, directDetectFrozen) < 0) {
+        return NULL;
+    }
+    for (auto &weak : directCaptures) {
+        if (auto capture = weak.lock()) {
+            capture->flag_gate().configure(directFlagPolicy, directSettleNs, directDetectFrozen);
+        }
+    }
+    directGate.gate.configure(directFlagPolicy, directSettleNs, directDetectFrozen);
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Counters of the frame buffer pool backing the image accessors
+ * @return dict with allocations, reuses, outstanding and cached_bytes
+ */
+PyObject * pool_stats(PyObject *, PyObject *) {
+    FramePool::Stats stats = framePool->stats();
+    return Py_BuildValue("{s:K,s:K,s:K,s:K}",
+        "allocations", (unsigned long long) stats.allocations,
+        "reuses", (unsigned long long) stats.reuses,
+        "outstanding", (unsigned long long) stats.outstanding,
+        "cached_bytes", (unsigned long long) stats.cachedBytes);
+}
+
 static PyMethodDef pyoptris_methods[] = {
     { "usb_init",                   (PyCFunction) usb_init,                     METH_VARARGS, nullptr },
     { "tcp_init",                   (PyCFunction) tcp_init,                     METH_VARARGS, nullptr },
     { "terminate",                  (PyCFunction) terminate,                    METH_NOARGS, nullptr },
     { "get_thermal_image_size",     (PyCFunction) get_thermal_image_size,       METH_NOARGS, nullptr },
     { "get_palette_image_size",     (PyCFunction) get_palette_image_size,       METH_NOARGS, nullptr },
-    { "get_thermal_image",          (PyCFunction) get_thermal_image,            METH_NOARGS, nullptr },
-    { "get_palette_image",          (PyCFunction) get_palette_image,            METH_NOARGS, nullptr },
-    { "get_thermal_palette_image",  (PyCFunction) get_thermal_palette_image,    METH_NOARGS, nullptr },
-    { "save_palette_to_png",        (PyCFunction) save_palette_to_png,          METH_VARARGS, nullptr },
+    { "get_thermal_image",          (PyCFunction) get_thermal_image,            METH_VARARGS | METH_KEYWORDS, nullptr },
+    { "get_frame",                  (PyCFunction) get_frame,                    METH_NOARGS, nullptr },
+    { "get_thermal_frames",         (PyCFunction) get_thermal_frames,           METH_VARARGS | METH_KEYWORDS, nullptr },
+    { "get_temperature_image",      (PyCFunction) get_temperature_image,        METH_VARARGS | METH_KEYWORDS, nullptr },
+    { "get_palette_image",          (PyCFunction) get_palette_image,            METH_VARARGS | METH_KEYWORDS, nullptr },
+    { "get_thermal_palette_image",  (PyCFunction) get_thermal_palette_image,    METH_VARARGS | METH_KEYWORDS, nullptr },
     { "set_palette",                (PyCFunction) set_palette,                  METH_VARARGS, nullptr },
     { "set_palette_scale",          (PyCFunction) set_palette_scale,            METH_VARARGS, nullptr },
     { "trigger_shutter_flag",       (PyCFunction) trigger_shutter_flag,         METH_NOARGS, nullptr },
@@ -664,12 +1277,15 @@ static PyMethodDef pyoptris_methods[] = {
     { "daemon_launch",              (PyCFunction) daemon_launch,                METH_NOARGS, nullptr },
     { "daemon_is_running",          (PyCFunction) daemon_is_running,            METH_NOARGS, nullptr },
     { "daemon_kill",                (PyCFunction) daemon_kill,                  METH_NOARGS, nullptr },
+    { "set_flag_gate",              (PyCFunction) set_flag_gate,                METH_VARARGS | METH_KEYWORDS, nullptr },
+    { "pool_stats",                 (PyCFunction) pool_stats,                   METH_NOARGS, nullptr },
 
     // Terminate the array with an object containing nulls.
     { nullptr, nullptr, 0, nullptr }
 };
 
 void _pyoptris_free(void *p) {
+    stop_direct_captures();
     evo_irimager_terminate();
 }
 
@@ -688,5 +1304,28 @@ static PyModuleDef pyoptris_module = {
 
 PyMODINIT_FUNC PyInit_pyoptris() {
     import_array();
-    return PyModule_Create(&pyoptris_module);
+    framePool = FramePool::create();
+    PyObject *module = PyModule_Create(&pyoptris_module);
+    if (module == NULL) {
+        return NULL;
+    }
+    if (add_capture_type(module) < 0
+            || add_convert_functions(module) < 0
+            || add_palette_functions(module) < 0
+            || add_camera_type(module) < 0
+            || add_recording_types(module) < 0
+            || add_codec_types(module) < 0
+            || add_roi_types(module) < 0
+            || add_linescan_type(module) < 0
+            || add_stream_type(module) < 0
+            || add_shared_types(module) < 0
+            || add_correction_types(module) < 0
+            || add_stats_functions(module) < 0 || add_temporal_type(module) < 0
+            || add_spatial_type(module) < 0 || add_export_types(module) < 0
+            || add_formats_type(module) < 0 || add_blob_type(module) < 0
+            || add_frame_type(module) < 0 || add_binning_functions(module) < 0) {
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
 }
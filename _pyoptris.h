@@ -0,0 +1,255 @@
+#ifndef PYOPTRIS_BINDING_H
+#define PYOPTRIS_BINDING_H
+
+#include <Python.h>
+
+// The numpy C API table is imported once in _pyoptris.cpp and shared by every binding translation unit
+#define PY_ARRAY_UNIQUE_SYMBOL pyoptris_ARRAY_API
+#ifndef PYOPTRIS_MAIN_MODULE
+#define NO_IMPORT_ARRAY
+#endif
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "binning.h"
+#include "capture.h"
+#include "convert.h"
+#include "framepool.h"
+#include "palette.h"
+#include "radiometry.h"
+
+/**
+ * @brief Pool backing every array handed out by the module
+ */
+std::shared_ptr<pyoptris::FramePool> &frame_pool();
+
+/**
+ * @brief Wraps a pool buffer into an ndarray, the array takes ownership of the buffer
+ * @return new reference, NULL with an exception set on failure (the buffer is released)
+ */
+PyObject *wrap_pooled_buffer(pyoptris::FramePool::Buffer *buffer, int nd, npy_intp *dimensions, int typenum);
+
+/**
+ * @brief Creates an ndarray whose storage is borrowed from the pool
+ * @return new reference, NULL with an exception set on failure
+ */
+PyObject *new_pooled_array(const std::shared_ptr<pyoptris::FramePool> &pool, int nd, npy_intp *dimensions, int typenum);
+
+/**
+ * @brief Resolves the destination of a frame accessor
+ * @param out Py_None for a pooled array, otherwise an ndarray the frame is written into
+ * @return new reference, NULL with an exception set on failure
+ */
+PyObject *frame_array(PyObject *out, int nd, npy_intp *dimensions, int typenum);
+
+/**
+ * @brief Frame source reading through the direct_binding functions, i.e. the camera opened by usb_init/tcp_init
+ */
+std::shared_ptr<pyoptris::FrameSource> direct_binding_source();
+
+/**
+ * @brief Tracks a capture on the direct_binding camera so terminate() can stop it first
+ */
+void register_direct_capture(const std::shared_ptr<pyoptris::Capture> &capture);
+
+/**
+ * @brief Scale matching the decimals set with set_temperature_decimals()
+ */
+pyoptris::TemperatureScale current_temperature_scale();
+
+int current_temperature_decimals();
+
+/**
+ * @brief Scale of a decimals argument, current_temperature_scale() for Py_None
+ * @return 0 on success, -1 with an exception set if decimals is not an integer between 0 and 4
+ */
+int parse_temperature_scale(PyObject *decimals, pyoptris::TemperatureScale &scale);
+
+/**
+ * @brief Resolves the dtype of a temperature output, float32 unless dtype or out say otherwise
+ * @return 0 on success, -1 with an exception set if the dtype is not float32/float16
+ */
+int parse_float_dtype(PyObject *dtype, PyObject *out, int &typenum);
+
+/**
+ * @brief Runs the float32 or float16 conversion kernel picked by typenum, safe without the GIL
+ */
+void convert_to_celsius(const uint16_t *raw, void *out, size_t n, int typenum, pyoptris::TemperatureScale scale);
+
+/**
+ * @brief Range of SCALING_MANUAL from t_min/t_max in degrees Celsius, at the decimals set with set_temperature_decimals()
+ * @param[out] manual { 0, 0 } for the other scaling methods
+ * @return 0 on success, -1 with an exception set if manual scaling lacks t_min or t_max
+ */
+int parse_manual_range(int scaling, PyObject *tMin, PyObject *tMax, pyoptris::PaletteRange &manual);
+
+/**
+ * @brief Resolves the radiometric correction of a temperature accessor
+ * @param profile Py_None for the profile set with set_correction_profile(), a profile name or a pyoptris.Correction
+ * @param[out] correction nullptr if no correction applies
+ * @return 0 on success, -1 with an exception set for unknown names, a size mismatch or non float32 output
+ */
+int resolve_correction(PyObject *profile, int width, int height, int typenum, std::shared_ptr<const pyoptris::RadiometricCorrection> &correction);
+
+/**
+ * @brief convert_to_celsius() with correction applied if it is set, safe without the GIL
+ */
+void correct_to_celsius(const uint16_t *raw, void *out, size_t n, int typenum, pyoptris::TemperatureScale scale,
+                        const std::shared_ptr<const pyoptris::RadiometricCorrection> &correction);
+
+/**
+ * @brief New pyoptris.FrameMetadata of a frame
+ * @return new reference, NULL with an exception set on failure
+ */
+PyObject *new_frame_metadata(const pyoptris::FrameInfo &info);
+
+/**
+ * @brief (frame, pyoptris.FrameMetadata) if metadata is set, frame otherwise
+ * @param frame reference stolen
+ * @return new reference, NULL with an exception set on failure
+ */
+PyObject *with_frame_metadata(PyObject *frame, const pyoptris::FrameInfo &info, int metadata);
+
+/**
+ * @brief New pyoptris.Frame owning a raw (height, width) uint16 frame
+ * @param raw pool buffer, ownership taken, released on failure
+ * @param info nullptr if the frame has no acquisition record
+ * @return new reference, NULL with an exception set on failure
+ */
+PyObject *new_frame(pyoptris::FramePool::Buffer *raw, int width, int height, const pyoptris::FrameInfo *info, pyoptris::TemperatureScale scale);
+
+/**
+ * @brief Parses the crop=None, binning=1, binning_mode=BINNING_MEAN, levels=0 fetch options of a width x height frame
+ * @param crop Py_None for the whole frame or an (x, y, width, height) tuple
+ * @return 0 on success, -1 with an exception set if the options do not fit the frame
+ */
+int parse_binning(PyObject *crop, int binning, int mode, int levels, int width, int height, pyoptris::BinningOptions &options);
+
+/**
+ * @brief Whether options crop, bin or add levels to a width x height frame, i.e. the frame cannot be fetched in place
+ */
+bool binning_changes_frame(const pyoptris::BinningOptions &options, int width, int height);
+
+/**
+ * @brief Arrays receiving pyoptris::bin_frame(), the first level resolved against out, the others drawn from pool
+ * @param[out] outputs data of each level
+ * @return new reference, the binned frame or a list of the levels largest first if options.levels > 0; NULL with an exception set on failure
+ */
+PyObject *binned_arrays(PyObject *out, const std::shared_ptr<pyoptris::FramePool> &pool, const pyoptris::BinningOptions &options,
+                        std::vector<uint16_t *> &outputs);
+
+/**
+ * @brief Counts a frame handed to Python in the delivery statistics, safe without the GIL
+ * @param dropped frames the reader lost to ring overwrites before this one
+ */
+void record_delivery(const pyoptris::FrameInfo &info, uint64_t dropped);
+
+/**
+ * @brief count, mean/percentiles/max in us and the non-empty (upper bound in us, count) buckets of a histogram
+ * @return new reference, NULL with an exception set on failure
+ */
+PyObject *latency_dict(const pyoptris::LatencyHistogram &histogram);
+
+/**
+ * @brief Parses the (policy, settle=0.1, detect_frozen=True) arguments of set_flag_gate
+ * @return 0 on success, -1 with an exception set otherwise
+ */
+int parse_flag_gate(PyObject *args, PyObject *kwargs, pyoptris::FlagPolicy &policy, int64_t &settleNs, bool &detectFrozen);
+
+/**
+ * @brief Parses a timeout argument in seconds
+ * @param[out] timeoutNs negative for None (wait forever)
+ * @return 0 on success, -1 with an exception set otherwise
+ */
+int parse_timeout(PyObject *timeout, int64_t &timeoutNs);
+
+/**
+ * @brief Runs a blocking wait in slices with the GIL released, checking for signals in between
+ * @param wait called without the GIL with the timeout of one slice in ns
+ * @return Capture::WAIT_* result, -1 with an exception set if interrupted by a signal
+ */
+int wait_released(const std::function<pyoptris::Capture::WaitResult(int64_t)> &wait, int64_t timeoutNs);
+
+/**
+ * @brief New pyoptris.Capture reader on an existing capture, arrays are drawn from pool
+ */
+PyObject *new_capture_reader(const std::shared_ptr<pyoptris::Capture> &capture, const std::shared_ptr<pyoptris::FramePool> &pool);
+
+/**
+ * @brief Waits for the next frame of a pyoptris.Capture reader with the GIL released
+ * @return Capture::WAIT_FRAME or WAIT_TIMEOUT, -1 with an exception set on signals or a closed capture
+ */
+int capture_reader_next(PyObject *reader, void *data, pyoptris::FrameInfo *info, int64_t timeoutNs);
+
+/**
+ * @brief Reads the next count frames of a pyoptris.Capture reader with the GIL released
+ * @return new (frames, timestamps, sequences) tuple, fewer frames on timeout, NULL with an exception set on failure
+ */
+PyObject *capture_reader_batch(PyObject *reader, Py_ssize_t count, int64_t timeoutNs);
+
+/**
+ * @brief Frames a pyoptris.Capture reader can read without waiting
+ */
+uint64_t capture_reader_pending(PyObject *reader);
+
+/**
+ * @brief New pyoptris.FrameStream on a new reader of capture, yielding single frames or batches of batch frames
+ * @return new reference, NULL with an exception set on failure
+ */
+PyObject *new_reader_stream(const std::shared_ptr<pyoptris::Capture> &capture, const std::shared_ptr<pyoptris::FramePool> &pool, Py_ssize_t batch);
+
+/**
+ * @brief New pyoptris.FrameStream reading through reader, which must not be shared with other consumers
+ * @return new reference, NULL with an exception set on failure
+ */
+PyObject *new_frame_stream(PyObject *reader, Py_ssize_t batch);
+
+/**
+ * @brief Capture behind a pyoptris.Capture reader, or behind the capture attribute of e.g. a pyoptris.Camera
+ * @return capture, nullptr with a TypeError set otherwise
+ */
+std::shared_ptr<pyoptris::Capture> capture_of(PyObject *object);
+
+int add_capture_type(PyObject *module);
+
+int add_camera_type(PyObject *module);
+
+int add_recording_types(PyObject *module);
+
+int add_codec_types(PyObject *module);
+
+int add_roi_types(PyObject *module);
+
+int add_linescan_type(PyObject *module);
+
+int add_stream_type(PyObject *module);
+
+int add_shared_types(PyObject *module);
+
+int add_correction_types(PyObject *module);
+
+int add_stats_functions(PyObject *module);
+
+int add_temporal_type(PyObject *module);
+
+int add_spatial_type(PyObject *module);
+
+int add_export_types(PyObject *module);
+
+int add_formats_type(PyObject *module);
+
+int add_blob_type(PyObject *module);
+
+int add_frame_type(PyObject *module);
+
+int add_binning_functions(PyObject *module);
+
+int add_convert_functions(PyObject *module);
+
+int add_palette_functions(PyObject *module);
+
+#endif
@@ -0,0 +1,116 @@
+#include "_pyoptris.h"
+
+#include "binning.h"
+
+#include <string>
+#include <vector>
+
+using pyoptris::BinningOptions;
+using pyoptris::FramePool;
+
+int parse_binning(PyObject *crop, int binning, int mode, int levels, int width, int height, BinningOptions &options) {
+    options = { 0, 0, width, height, binning, (pyoptris::BinningMode) mode, levels };
+    if (crop != Py_None && !PyArg_ParseTuple(crop, "iiii;crop must be an (x, y, width, height) tuple", &options.x, &options.y,
+                                             &options.width, &options.height)) {
+        return -1;
+    }
+    std::string error;
+    if (!pyoptris::check_binning(width, height, options, error)) {
+        PyErr_SetString(PyExc_ValueError, error.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+bool binning_changes_frame(const BinningOptions &options, int width, int height) {
+    return options.factor != 1 || options.levels != 0 || options.width != width || options.height != height;
+}
+
+PyObject *binned_arrays(PyObject *out, const std::shared_ptr<FramePool> &pool, const BinningOptions &options, std::vector<uint16_t *> &outputs) {
+    outputs.clear();
+    PyObject *levels = options.levels > 0 ? PyList_New(options.levels + 1) : NULL;
+    if (options.levels > 0 && levels == NULL) {
+        return NULL;
+    }
+    for (int level = 0; level <= options.levels; level++) {
+        npy_intp dimensions[2] = { pyoptris::binned_height(options, level), pyoptris::binned_width(options, level) };
+        PyObject *array = level == 0 && out != Py_None
+            ? frame_array(out, 2, dimensions, NPY_UINT16)
+            : new_pooled_array(pool, 2, dimensions, NPY_UINT16);
+        if (array == NULL) {
+            Py_XDECREF(levels);
+            return NULL;
+        }
+        outputs.push_back((uint16_t *) PyArray_DATA((PyArrayObject *) array));
+        if (levels == NULL) {
+            return array;
+        }
+        PyList_SET_ITEM(levels, level, array);
+    }
+    return levels;
+}
+
+/**
+ * @brief bin_frame(raw, crop=None, binning=1, binning_mode=BINNING_MEAN, levels=0, out=None)
+ * Crops a raw frame to crop = (x, y, width, height) and bins it into binning x binning pixels, the rounded
+ * mean or the hottest of each bin. levels > 0 adds a thumbnail pyramid, each level binned 2x2 from the one
+ * before, returned as a list largest first; everything is built in one pass over the frame with the GIL
+ * released. Rows and columns of the crop that do not fill a bin are left out. out receives the first level.
+ */
+static PyObject *bin_frame(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "raw", "crop", "binning", "binning_mode", "levels", "out", nullptr };
+    PyObject *rawObject;
+    PyObject *crop = Py_None;
+    int binning = 1, mode = pyoptris::BINNING_MEAN, levels = 0;
+    PyObject *out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OiiiO", (char **) keywords, &rawObject, &crop, &binning, &mode, &levels, &out)) {
+        return NULL;
+    }
+    PyArrayObject *raw = (PyArrayObject *) PyArray_FROM_OTF(rawObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (raw == NULL) {
+        return NULL;
+    }
+    if (PyArray_NDIM(raw) != 2) {
+        Py_DECREF(raw);
+        PyErr_SetString(PyExc_ValueError, "raw must be a 2-D thermal image");
+        return NULL;
+    }
+    int width = (int) PyArray_DIM(raw, 1), height = (int) PyArray_DIM(raw, 0);
+    BinningOptions options;
+    std::vector<uint16_t *> outputs;
+    PyObject *result;
+    if (parse_binning(crop, binning, mode, levels, width, height, options) < 0
+            || (result = binned_arrays(out, frame_pool(), options, outputs)) == NULL) {
+        Py_DECREF(raw);
+        return NULL;
+    }
+    FramePool::Buffer *scratch = frame_pool()->acquire(pyoptris::binning_scratch_bytes(options));
+    if (scratch == nullptr) {
+        Py_DECREF(raw);
+        Py_DECREF(result);
+        return PyErr_NoMemory();
+    }
+    const uint16_t *data = (const uint16_t *) PyArray_DATA(raw);
+    Py_BEGIN_ALLOW_THREADS
+    pyoptris::bin_frame(data, width, options, outputs.data(), scratch->data);
+    Py_END_ALLOW_THREADS
+    FramePool::release(scratch);
+    Py_DECREF(raw);
+    return result;
+}
+
+static PyMethodDef binning_methods[] = {
+    { "bin_frame",  (PyCFunction) bin_frame,    METH_VARARGS | METH_KEYWORDS, "bin_frame(raw, crop=None, binning=1, binning_mode=BINNING_MEAN, levels=0, out=None) -> binned frame, or its pyramid" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+int add_binning_functions(PyObject *module) {
+    if (PyModule_AddFunctions(module, binning_methods) < 0) {
+        return -1;
+    }
+    if (PyModule_AddIntConstant(module, "BINNING_MEAN", pyoptris::BINNING_MEAN) < 0
+            || PyModule_AddIntConstant(module, "BINNING_MAX", pyoptris::BINNING_MAX) < 0) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,234 @@
+#include "_pyoptris.h"
+
+#include "blobs.h"
+
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+using pyoptris::Blob;
+using pyoptris::BlobDetector;
+using pyoptris::BlobOptions;
+using pyoptris::TemperatureScale;
+
+// Structured dtype mirroring Blob
+static PyArray_Descr *blobDtype = NULL;
+
+struct BlobDetectorState {
+    std::mutex mutex;   // runs, components and tracks, detect() runs without the GIL
+    BlobDetector detector;
+    double threshold;   // degrees Celsius, only touched with the GIL held
+
+    BlobDetectorState(int width, int height, const BlobOptions &options, double threshold)
+        : detector(width, height, options), threshold(threshold) {}
+};
+
+typedef struct {
+    PyObject_HEAD
+    BlobDetectorState *state;
+} BlobDetectorObject;
+
+static PyTypeObject BlobDetectorType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+/**
+ * @brief Smallest raw value at or above celsius, clamped to the uint16 range
+ */
+static uint16_t raw_threshold(double celsius, TemperatureScale scale) {
+    double raw = std::ceil(celsius / scale.scale + scale.rawOffset - 1e-6);
+    return raw <= 0.0 ? 0 : raw >= 65535.0 ? 65535 : (uint16_t) raw;
+}
+
+/**
+ * @brief BlobDetector(width, height, threshold, min_area=1, connectivity=8, max_blobs=64, max_distance=16.0, max_missed=5)
+ * Finds blobs of connected pixels at or above threshold degrees Celsius and tracks them across frames.
+ * A tracked blob keeps its id while its centroid stays within max_distance pixels of where its last
+ * movement predicts it; a track without its blob survives max_missed frames.
+ */
+static PyObject *BlobDetector_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "width", "height", "threshold", "min_area", "connectivity", "max_blobs", "max_distance", "max_missed", nullptr };
+    int width, height, connectivity = 8, maxMissed = 5;
+    double threshold;
+    unsigned int minArea = 1;
+    Py_ssize_t maxBlobs = 64;
+    float maxDistance = 16.0f;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "iid|Iinfi", (char **) keywords, &width, &height, &threshold, &minArea,
+                                     &connectivity, &maxBlobs, &maxDistance, &maxMissed)) {
+        return NULL;
+    }
+    if (width <= 0 || height <= 0 || width > 65535 || height > 65535) {
+        PyErr_SetString(PyExc_ValueError, "width and height must be between 1 and 65535");
+        return NULL;
+    }
+    if (connectivity != 4 && connectivity != 8) {
+        PyErr_SetString(PyExc_ValueError, "connectivity must be 4 or 8");
+        return NULL;
+    }
+    if (maxBlobs < 1 || !(maxDistance >= 0.0f) || maxMissed < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_blobs must be positive, max_distance and max_missed not negative");
+        return NULL;
+    }
+    BlobOptions options = { connectivity, minArea, (size_t) maxBlobs, maxDistance, (uint32_t) maxMissed };
+    BlobDetectorObject *self = (BlobDetectorObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->state = new BlobDetectorState(width, height, options, threshold);
+    return (PyObject *) self;
+}
+
+static void BlobDetector_dealloc(BlobDetectorObject *self) {
+    delete self->state;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief detect(frame, decimals=None) -> blobs
+ * Blobs of a raw frame, largest first, as a structured array with the fields id, age (frames tracked),
+ * area (pixels), peak and mean (degrees Celsius), x and y (centroid), peak_x, peak_y and the inclusive
+ * bounding box left, top, right, bottom. The frame is read once with the GIL released.
+ */
+static PyObject *BlobDetector_detect(BlobDetectorObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "frame", "decimals", nullptr };
+    PyObject *frameObject;
+    PyObject *decimals = Py_None;
+    TemperatureScale scale;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", (char **) keywords, &frameObject, &decimals)
+            || parse_temperature_scale(decimals, scale) < 0) {
+        return NULL;
+    }
+    BlobDetectorState *state = self->state;
+    PyArrayObject *frame = (PyArrayObject *) PyArray_FROM_OTF(frameObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (frame == NULL) {
+        return NULL;
+    }
+    int width = state->detector.width(), height = state->detector.height();
+    if (PyArray_NDIM(frame) != 2 || PyArray_DIM(frame, 0) != height || PyArray_DIM(frame, 1) != width) {
+        Py_DECREF(frame);
+        PyErr_Format(PyExc_ValueError, "frame must have shape (%d, %d)", height, width);
+        return NULL;
+    }
+
+    // The result is copied out under the lock, at most max_blobs records
+    uint16_t threshold = raw_threshold(state->threshold, scale);
+    const uint16_t *data = (const uint16_t *) PyArray_DATA(frame);
+    std::vector<Blob> blobs;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        blobs = state->detector.detect(data, threshold, scale);
+    }
+    Py_END_ALLOW_THREADS
+    Py_DECREF(frame);
+
+    npy_intp count = (npy_intp) blobs.size();
+    Py_INCREF(blobDtype);
+    PyObject *result = PyArray_NewFromDescr(&PyArray_Type, blobDtype, 1, &count, NULL, NULL, 0, NULL);
+    if (result == NULL) {
+        return NULL;
+    }
+    if (count > 0) {
+        std::memcpy(PyArray_DATA((PyArrayObject *) result), blobs.data(), blobs.size() * sizeof(Blob));
+    }
+    return result;
+}
+
+static PyObject *BlobDetector_reset(BlobDetectorObject *self, PyObject *) {
+    BlobDetectorState *state = self->state;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->detector.reset();
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *BlobDetector_get_threshold(BlobDetectorObject *self, void *) {
+    return PyFloat_FromDouble(self->state->threshold);
+}
+
+static int BlobDetector_set_threshold(BlobDetectorObject *self, PyObject *value, void *) {
+    if (value == NULL) {
+        PyErr_SetString(PyExc_AttributeError, "threshold cannot be deleted");
+        return -1;
+    }
+    double threshold = PyFloat_AsDouble(value);
+    if (threshold == -1.0 && PyErr_Occurred()) {
+        return -1;
+    }
+    self->state->threshold = threshold;
+    return 0;
+}
+
+static PyObject *BlobDetector_get_tracks(BlobDetectorObject *self, void *) {
+    BlobDetectorState *state = self->state;
+    size_t tracks;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        tracks = state->detector.tracks();
+    }
+    Py_END_ALLOW_THREADS
+    return PyLong_FromSize_t(tracks);
+}
+
+static PyObject *BlobDetector_get_size(BlobDetectorObject *self, void *) {
+    return Py_BuildValue("ii", self->state->detector.width(), self->state->detector.height());
+}
+
+static PyObject *BlobDetector_get_dtype(BlobDetectorObject *, void *) {
+    Py_INCREF(blobDtype);
+    return (PyObject *) blobDtype;
+}
+
+static PyMethodDef BlobDetector_methods[] = {
+    { "detect", (PyCFunction) BlobDetector_detect,  METH_VARARGS | METH_KEYWORDS, "detect(frame, decimals=None) -> blobs of the frame, largest first" },
+    { "reset",  (PyCFunction) BlobDetector_reset,   METH_NOARGS, "Forgets the tracks, the next blobs get new ids" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef BlobDetector_getset[] = {
+    { "threshold",  (getter) BlobDetector_get_threshold,    (setter) BlobDetector_set_threshold, "Degrees Celsius a pixel needs to be hot", nullptr },
+    { "tracks",     (getter) BlobDetector_get_tracks,       nullptr, "Blobs being tracked, including those missed lately", nullptr },
+    { "size",       (getter) BlobDetector_get_size,         nullptr, "(width, height) of the frames", nullptr },
+    { "dtype",      (getter) BlobDetector_get_dtype,        nullptr, "Structured dtype of the blobs", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+static int create_blob_dtype() {
+    PyObject *fields = Py_BuildValue("[(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)]",
+        "id", "<u4", "age", "<u4", "area", "<u4", "peak", "<f4", "mean", "<f4", "x", "<f4", "y", "<f4",
+        "peak_x", "<u2", "peak_y", "<u2", "left", "<u2", "top", "<u2", "right", "<u2", "bottom", "<u2");
+    if (fields == NULL) {
+        return -1;
+    }
+    // Packed like Blob, whose fields need no padding
+    int ok = PyArray_DescrConverter(fields, &blobDtype);
+    Py_DECREF(fields);
+    return ok ? 0 : -1;
+}
+
+int add_blob_type(PyObject *module) {
+    if (create_blob_dtype() < 0) {
+        return -1;
+    }
+
+    BlobDetectorType.tp_name = "pyoptris.BlobDetector";
+    BlobDetectorType.tp_basicsize = sizeof(BlobDetectorObject);
+    BlobDetectorType.tp_flags = Py_TPFLAGS_DEFAULT;
+    BlobDetectorType.tp_doc = "BlobDetector(width, height, threshold, ...): hot blobs of raw frames, tracked from frame to frame";
+    BlobDetectorType.tp_new = BlobDetector_new;
+    BlobDetectorType.tp_dealloc = (destructor) BlobDetector_dealloc;
+    BlobDetectorType.tp_methods = BlobDetector_methods;
+    BlobDetectorType.tp_getset = BlobDetector_getset;
+
+    if (PyType_Ready(&BlobDetectorType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&BlobDetectorType);
+    if (PyModule_AddObject(module, "BlobDetector", (PyObject *) &BlobDetectorType) < 0) {
+        Py_DECREF(&BlobDetectorType);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,555 @@
+#include "_pyoptris.h"
+
+#include "device.h"
+
+#include <mutex>
+#include <new>
+#include <string>
+
+using pyoptris::Capture;
+using pyoptris::Device;
+using pyoptris::FrameInfo;
+using pyoptris::FramePool;
+
+/**
+ * Everything a camera owns. Nothing in here is shared with other cameras or with the module level
+ * direct binding, so cameras never wait for each other.
+ */
+struct CameraState {
+    std::mutex mutex;   // device and closing, never held together with the GIL
+    std::shared_ptr<Device> device;
+    std::shared_ptr<Capture> capture;
+    std::shared_ptr<FramePool> pool;
+};
+
+typedef struct {
+    PyObject_HEAD
+    CameraState *state;
+    PyObject *reader;   // default pyoptris.Capture reader used by the frame accessors
+} CameraObject;
+
+static PyTypeObject CameraType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+static PyObject *sdk_result(int ok) {
+    switch(ok) {
+        case 0:
+            Py_RETURN_NONE;
+
+        case -1:
+            PyErr_SetString(PyExc_RuntimeError, "Error");
+            return NULL;
+
+        case -2:
+            PyErr_SetString(PyExc_RuntimeError, "Fatal error");
+            return NULL;
+
+        default:
+            abort();
+    }
+}
+
+/**
+ * @brief The open device, nullptr with RuntimeError set once the camera is closed
+ */
+static std::shared_ptr<Device> camera_device(CameraObject *self) {
+    CameraState *state = self->state;
+    std::shared_ptr<Device> device;
+    Py_BEGIN_ALLOW_THREADS
+    std::lock_guard<std::mutex> lock(state->mutex);
+    device = state->device;
+    Py_END_ALLOW_THREADS
+    if (device == nullptr) {
+        PyErr_SetString(PyExc_RuntimeError, "Camera is closed");
+    }
+    return device;
+}
+
+static int check_open(CameraObject *self) {
+    return camera_device(self) != nullptr ? 0 : -1;
+}
+
+/**
+ * @brief Stops the capture thread before the device goes away, the thread is the only other user of it.
+ * Safe without the GIL, concurrent calls wait for the first one and find the camera closed.
+ */
+static void close_camera(CameraState *state) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->capture != nullptr) {
+        state->capture->stop();
+    }
+    if (state->device != nullptr) {
+        state->device->close();
+        state->device = nullptr;
+    }
+}
+
+/**
+ * @brief Camera(xml_config, formats_def=None, log_file=None, serial=0, capacity=16)
+ * Opens one camera with its own SDK instance, capture thread and frame pool. serial overrides the
+ * serial number of the xml config, so one config can be shared by several cameras of the same model.
+ */
+static PyObject *Camera_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "xml_config", "formats_def", "log_file", "serial", "capacity", nullptr };
+    const char *xmlConfig;
+    const char *formatsDef = nullptr;
+    const char *logFile = nullptr;
+    unsigned long serial = 0;
+    Py_ssize_t capacity = 16;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|zzkn", (char **) keywords, &xmlConfig, &formatsDef, &logFile, &serial, &capacity)) {
+        return NULL;
+    }
+    if (capacity < 2) {
+        PyErr_SetString(PyExc_ValueError, "capacity must be at least 2");
+        return NULL;
+    }
+
+    std::shared_ptr<Device> device;
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    device = pyoptris::open_device(xmlConfig, formatsDef, logFile, serial, error);
+    Py_END_ALLOW_THREADS
+    if (device == nullptr) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return NULL;
+    }
+
+    CameraObject *self = (CameraObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        device->close();
+        Py_END_ALLOW_THREADS
+        return NULL;
+    }
+    self->state = new CameraState();
+    self->state->device = device;
+    self->state->pool = FramePool::create();
+    self->state->capture = std::make_shared<Capture>(device, (size_t) capacity);
+
+    int ok = 0;
+    bool allocated = true;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        ok = self->state->capture->start();
+    } catch (const std::bad_alloc &) {
+        allocated = false;
+    }
+    Py_END_ALLOW_THREADS
+    if (!allocated) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    if (ok != 0) {
+        Py_DECREF(self);
+        return sdk_result(ok);
+    }
+    self->reader = new_capture_reader(self->state->capture, self->state->pool);
+    if (self->reader == NULL) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject *) self;
+}
+
+static void Camera_dealloc(CameraObject *self) {
+    Py_XDECREF(self->reader);
+    if (self->state != nullptr) {
+        CameraState *state = self->state;
+        Py_BEGIN_ALLOW_THREADS
+        close_camera(state);
+        Py_END_ALLOW_THREADS
+        delete state;
+    }
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject *forward_to_reader(CameraObject *self, const char *name, PyObject *args, PyObject *kwargs) {
+    PyObject *method = PyObject_GetAttrString(self->reader, name);
+    if (method == NULL) {
+        return NULL;
+    }
+    // METH_NOARGS methods get no args tuple
+    PyObject *result = args != NULL ? PyObject_Call(method, args, kwargs) : PyObject_CallObject(method, NULL);
+    Py_DECREF(method);
+    return result;
+}
+
+static PyObject *Camera_latest(CameraObject *self, PyObject *args, PyObject *kwargs) {
+    return forward_to_reader(self, "latest", args, kwargs);
+}
+
+static PyObject *Camera_next(CameraObject *self, PyObject *args, PyObject *kwargs) {
+    return forward_to_reader(self, "next", args, kwargs);
+}
+
+static PyObject *Camera_latest_frame(CameraObject *self, PyObject *args) {
+    return forward_to_reader(self, "latest_frame", args, NULL);
+}
+
+static PyObject *Camera_next_frame(CameraObject *self, PyObject *args, PyObject *kwargs) {
+    return forward_to_reader(self, "next_frame", args, kwargs);
+}
+
+static PyObject *Camera_drain(CameraObject *self, PyObject *args) {
+    return forward_to_reader(self, "drain", args, NULL);
+}
+
+static PyObject *Camera_stats(CameraObject *self, PyObject *args) {
+    return forward_to_reader(self, "stats", args, NULL);
+}
+
+static PyObject *Camera_set_flag_gate(CameraObject *self, PyObject *args, PyObject *kwargs) {
+    return forward_to_reader(self, "set_flag_gate", args, kwargs);
+}
+
+/**
+ * @brief Independent reader on this camera's capture thread
+ */
+static PyObject *Camera_reader(CameraObject *self, PyObject *) {
+    return new_capture_reader(self->state->capture, self->state->pool);
+}
+
+/**
+ * @brief frames(batch=1) -> pyoptris.FrameStream for async for, with a reader of its own
+ */
+static PyObject *Camera_frames(CameraObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "batch", nullptr };
+    Py_ssize_t batch = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|n", (char **) keywords, &batch) || check_open(self) < 0) {
+        return NULL;
+    }
+    return new_reader_stream(self->state->capture, self->state->pool, batch);
+}
+
+/**
+ * @brief Next frame of the default reader cropped and binned by options, None on timeout
+ */
+static PyObject *binned_thermal_image(CameraObject *self, PyObject *out, const pyoptris::BinningOptions &options, int metadata, int64_t timeoutNs) {
+    CameraState *state = self->state;
+    std::vector<uint16_t *> outputs;
+    PyObject *result = binned_arrays(out, state->pool, options, outputs);
+    if (result == NULL) {
+        return NULL;
+    }
+    // The frame and the scratch of the mean share one pool buffer, the scratch starting 16 byte aligned
+    size_t frameBytes = (state->capture->frame_size() + 15) & ~(size_t) 15;
+    FramePool::Buffer *scratch = state->pool->acquire(frameBytes + pyoptris::binning_scratch_bytes(options));
+    if (scratch == nullptr) {
+        Py_DECREF(result);
+        return PyErr_NoMemory();
+    }
+    FrameInfo info;
+    int wait = capture_reader_next(self->reader, scratch->data, &info, timeoutNs);
+    if (wait == Capture::WAIT_FRAME) {
+        const uint16_t *frame = (const uint16_t *) scratch->data;
+        int width = state->capture->width();
+        Py_BEGIN_ALLOW_THREADS
+        pyoptris::bin_frame(frame, width, options, outputs.data(), (char *) scratch->data + frameBytes);
+        Py_END_ALLOW_THREADS
+    }
+    FramePool::release(scratch);
+    switch(wait) {
+        case Capture::WAIT_FRAME:
+            return with_frame_metadata(result, info, metadata);
+
+        case Capture::WAIT_TIMEOUT:
+            Py_DECREF(result);
+            Py_RETURN_NONE;
+
+        default:
+            Py_DECREF(result);
+            return NULL;
+    }
+}
+
+/**
+ * @brief get_thermal_image(out=None, timeout=None, metadata=False, crop=None, binning=1, binning_mode=BINNING_MEAN, levels=0)
+ * Next thermal frame of the default reader, None on timeout, (frame, pyoptris.FrameMetadata) with metadata=True.
+ * crop, binning and levels crop, bin and build the thumbnail pyramid of the frame like the module level get_thermal_image().
+ */
+static PyObject *Camera_get_thermal_image(CameraObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "out", "timeout", "metadata", "crop", "binning", "binning_mode", "levels", nullptr };
+    PyObject *out = Py_None;
+    PyObject *timeout = Py_None;
+    int metadata = 0;
+    PyObject *crop = Py_None;
+    int binning = 1, mode = pyoptris::BINNING_MEAN, levels = 0;
+    int64_t timeoutNs;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OOpOiii", (char **) keywords, &out, &timeout, &metadata, &crop, &binning, &mode, &levels)
+            || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+    CameraState *state = self->state;
+    int width = state->capture->width(), height = state->capture->height();
+    pyoptris::BinningOptions options;
+    if (parse_binning(crop, binning, mode, levels, width, height, options) < 0) {
+        return NULL;
+    }
+    if (binning_changes_frame(options, width, height)) {
+        return binned_thermal_image(self, out, options, metadata, timeoutNs);
+    }
+    npy_intp dimensions[2] = { height, width };
+    PyObject *result = out == Py_None
+        ? new_pooled_array(self->state->pool, 2, dimensions, NPY_UINT16)
+        : frame_array(out, 2, dimensions, NPY_UINT16);
+    if (result == NULL) {
+        return NULL;
+    }
+    FrameInfo info;
+    switch(capture_reader_next(self->reader, PyArray_DATA((PyArrayObject *) result), &info, timeoutNs)) {
+        case Capture::WAIT_FRAME:
+            return with_frame_metadata(result, info, metadata);
+
+        case Capture::WAIT_TIMEOUT:
+            Py_DECREF(result);
+            Py_RETURN_NONE;
+
+        default:
+            Py_DECREF(result);
+            return NULL;
+    }
+}
+
+/**
+ * @brief get_temperature_image(out=None, dtype=None, timeout=None, profile=None, metadata=False)
+ * Next frame of the default reader in degrees Celsius, None on timeout. profile selects a radiometric
+ * correction like for the module level get_temperature_image().
+ */
+static PyObject *Camera_get_temperature_image(CameraObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "out", "dtype", "timeout", "profile", "metadata", nullptr };
+    PyObject *out = Py_None;
+    PyObject *dtype = Py_None;
+    PyObject *timeout = Py_None;
+    PyObject *profile = Py_None;
+    int metadata = 0;
+    int64_t timeoutNs;
+    int typenum;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OOOOp", (char **) keywords, &out, &dtype, &timeout, &profile, &metadata)
+            || parse_timeout(timeout, timeoutNs) < 0 || parse_float_dtype(dtype, out, typenum) < 0) {
+        return NULL;
+    }
+    CameraState *state = self->state;
+    std::shared_ptr<const pyoptris::RadiometricCorrection> correction;
+    if (resolve_correction(profile, state->capture->width(), state->capture->height(), typenum, correction) < 0) {
+        return NULL;
+    }
+    npy_intp dimensions[2] = { state->capture->height(), state->capture->width() };
+    PyObject *result = out == Py_None
+        ? new_pooled_array(state->pool, 2, dimensions, typenum)
+        : frame_array(out, 2, dimensions, typenum);
+    if (result == NULL) {
+        return NULL;
+    }
+    FramePool::Buffer *scratch = state->pool->acquire(state->capture->frame_size());
+    if (scratch == nullptr) {
+        Py_DECREF(result);
+        return PyErr_NoMemory();
+    }
+
+    FrameInfo info;
+    int wait = capture_reader_next(self->reader, scratch->data, &info, timeoutNs);
+    if (wait == Capture::WAIT_FRAME) {
+        pyoptris::TemperatureScale scale = current_temperature_scale();
+        void *data = PyArray_DATA((PyArrayObject *) result);
+        size_t n = (size_t) dimensions[0] * dimensions[1];
+        Py_BEGIN_ALLOW_THREADS
+        correct_to_celsius((const uint16_t *) scratch->data, data, n, typenum, scale, correction);
+        Py_END_ALLOW_THREADS
+    }
+    FramePool::release(scratch);
+
+    switch(wait) {
+        case Capture::WAIT_FRAME:
+            return with_frame_metadata(result, info, metadata);
+
+        case Capture::WAIT_TIMEOUT:
+            Py_DECREF(result);
+            Py_RETURN_NONE;
+
+        default:
+            Py_DECREF(result);
+            return NULL;
+    }
+}
+
+/**
+ * @brief get_thermal_image_size() -> (width, height)
+ */
+static PyObject *Camera_get_thermal_image_size(CameraObject *self, PyObject *) {
+    return Py_BuildValue("ii", self->state->capture->width(), self->state->capture->height());
+}
+
+static PyObject *Camera_set_temperature_range(CameraObject *self, PyObject *args) {
+    int minimum, maximum;
+    if (!PyArg_ParseTuple(args, "ii", &minimum, &maximum)) {
+        return NULL;
+    }
+    std::shared_ptr<Device> device = camera_device(self);
+    if (device == nullptr) {
+        return NULL;
+    }
+    int ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = device->set_temperature_range(minimum, maximum);
+    Py_END_ALLOW_THREADS
+    return sdk_result(ok);
+}
+
+static PyObject *Camera_set_radiation_parameters(CameraObject *self, PyObject *args) {
+    float emissivity, transmissivity, ambientTemperature;
+    if (!PyArg_ParseTuple(args, "fff", &emissivity, &transmissivity, &ambientTemperature)) {
+        return NULL;
+    }
+    std::shared_ptr<Device> device = camera_device(self);
+    if (device == nullptr) {
+        return NULL;
+    }
+    int ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = device->set_radiation_parameters(emissivity, transmissivity, ambientTemperature);
+    Py_END_ALLOW_THREADS
+    return sdk_result(ok);
+}
+
+static PyObject *Camera_set_shutter_mode(CameraObject *self, PyObject *args) {
+    int mode;
+    if (!PyArg_ParseTuple(args, "i", &mode)) {
+        return NULL;
+    }
+    std::shared_ptr<Device> device = camera_device(self);
+    if (device == nullptr) {
+        return NULL;
+    }
+    int ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = device->set_shutter_mode(mode);
+    Py_END_ALLOW_THREADS
+    return sdk_result(ok);
+}
+
+static PyObject *Camera_trigger_shutter_flag(CameraObject *self, PyObject *) {
+    std::shared_ptr<Device> device = camera_device(self);
+    if (device == nullptr) {
+        return NULL;
+    }
+    int ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = device->trigger_shutter_flag();
+    Py_END_ALLOW_THREADS
+    return sdk_result(ok);
+}
+
+static PyObject *Camera_set_focus_motor_position(CameraObject *self, PyObject *args) {
+    float position;
+    if (!PyArg_ParseTuple(args, "f", &position)) {
+        return NULL;
+    }
+    std::shared_ptr<Device> device = camera_device(self);
+    if (device == nullptr) {
+        return NULL;
+    }
+    int ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = device->set_focus_motor_position(position);
+    Py_END_ALLOW_THREADS
+    return sdk_result(ok);
+}
+
+static PyObject *Camera_get_focus_motor_position(CameraObject *self, PyObject *) {
+    std::shared_ptr<Device> device = camera_device(self);
+    if (device == nullptr) {
+        return NULL;
+    }
+    int ok;
+    float position;
+    Py_BEGIN_ALLOW_THREADS
+    ok = device->get_focus_motor_position(position);
+    Py_END_ALLOW_THREADS
+    if (ok != 0) {
+        return sdk_result(ok);
+    }
+    return PyFloat_FromDouble(position);
+}
+
+/**
+ * @brief Stops the capture thread and releases the camera, frames already captured can still be read
+ */
+static PyObject *Camera_close(CameraObject *self, PyObject *) {
+    CameraState *state = self->state;
+    Py_BEGIN_ALLOW_THREADS
+    close_camera(state);
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *Camera_enter(CameraObject *self, PyObject *) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject *Camera_exit(CameraObject *self, PyObject *) {
+    return Camera_close(self, NULL);
+}
+
+static PyObject *Camera_get_serial(CameraObject *self, void *) {
+    std::shared_ptr<Device> device = camera_device(self);
+    if (device == nullptr) {
+        return NULL;
+    }
+    return PyUnicode_FromString(device->serial().c_str());
+}
+
+static PyObject *Camera_get_capture(CameraObject *self, void *) {
+    Py_INCREF(self->reader);
+    return self->reader;
+}
+
+static PyMethodDef Camera_methods[] = {
+    { "latest",                     (PyCFunction) Camera_latest,                    METH_VARARGS | METH_KEYWORDS, "latest(metadata=False): most recent frame, None if nothing was captured yet" },
+    { "next",                       (PyCFunction) Camera_next,                      METH_VARARGS | METH_KEYWORDS, "next(timeout=None, metadata=False): next frame of the default reader, None on timeout" },
+    { "latest_frame",               (PyCFunction) Camera_latest_frame,              METH_NOARGS, "latest_frame(): most recent frame as a pyoptris.Frame, None if nothing was captured yet" },
+    { "next_frame",                 (PyCFunction) Camera_next_frame,                METH_VARARGS | METH_KEYWORDS, "next_frame(timeout=None): next frame of the default reader as a pyoptris.Frame, None on timeout" },
+    { "drain",                      (PyCFunction) Camera_drain,                     METH_NOARGS, "All unread frames of the default reader as an (n, h, w) array" },
+    { "stats",                      (PyCFunction) Camera_stats,                     METH_NOARGS, "Counters and fetch latency histogram of this camera" },
+    { "set_flag_gate",              (PyCFunction) Camera_set_flag_gate,             METH_VARARGS | METH_KEYWORDS, "set_flag_gate(policy, settle=0.1, detect_frozen=True): handling of flag cycle frames" },
+    { "reader",                     (PyCFunction) Camera_reader,                    METH_NOARGS, "Independent reader on this camera's capture thread" },
+    { "frames",                     (PyCFunction) Camera_frames,                    METH_VARARGS | METH_KEYWORDS, "frames(batch=1): async iterator over frames or batches of frames" },
+    { "get_thermal_image",          (PyCFunction) Camera_get_thermal_image,         METH_VARARGS | METH_KEYWORDS, nullptr },
+    { "get_temperature_image",      (PyCFunction) Camera_get_temperature_image,     METH_VARARGS | METH_KEYWORDS, nullptr },
+    { "get_thermal_image_size",     (PyCFunction) Camera_get_thermal_image_size,    METH_NOARGS, nullptr },
+    { "set_temperature_range",      (PyCFunction) Camera_set_temperature_range,     METH_VARARGS, nullptr },
+    { "set_radiation_parameters",   (PyCFunction) Camera_set_radiation_parameters,  METH_VARARGS, nullptr },
+    { "set_shutter_mode",           (PyCFunction) Camera_set_shutter_mode,          METH_VARARGS, nullptr },
+    { "trigger_shutter_flag",       (PyCFunction) Camera_trigger_shutter_flag,      METH_NOARGS, nullptr },
+    { "set_focus_motor_position",   (PyCFunction) Camera_set_focus_motor_position,  METH_VARARGS, nullptr },
+    { "get_focus_motor_position",   (PyCFunction) Camera_get_focus_motor_position,  METH_NOARGS, nullptr },
+    { "close",                      (PyCFunction) Camera_close,                     METH_NOARGS, "Stops capturing and releases the camera" },
+    { "__enter__",                  (PyCFunction) Camera_enter,                     METH_NOARGS, nullptr },
+    { "__exit__",                   (PyCFunction) Camera_exit,                      METH_VARARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Camera_getset[] = {
+    { "serial",     (getter) Camera_get_serial,     nullptr, "Serial number of the camera", nullptr },
+    { "capture",    (getter) Camera_get_capture,    nullptr, "Default reader, exposes frames/errors/dropped/pending", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+int add_camera_type(PyObject *module) {
+    CameraType.tp_name = "pyoptris.Camera";
+    CameraType.tp_basicsize = sizeof(CameraObject);
+    CameraType.tp_flags = Py_TPFLAGS_DEFAULT;
+    CameraType.tp_doc = "Camera(xml_config, formats_def=None, log_file=None, serial=0, capacity=16): one of several cameras, each with its own capture thread";
+    CameraType.tp_new = Camera_new;
+    CameraType.tp_dealloc = (destructor) Camera_dealloc;
+    CameraType.tp_methods = Camera_methods;
+    CameraType.tp_getset = Camera_getset;
+    if (PyType_Ready(&CameraType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&CameraType);
+    if (PyModule_AddObject(module, "Camera", (PyObject *) &CameraType) < 0) {
+        Py_DECREF(&CameraType);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,651 @@
+#include "_pyoptris.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <vector>
+
+using pyoptris::Capture;
+using pyoptris::FrameInfo;
+using pyoptris::FramePool;
+
+// Blocking waits are sliced so Ctrl-C is noticed while a consumer waits for frames
+static const int64_t WAIT_SLICE_NS = 100000000;
+
+struct CaptureState {
+    std::shared_ptr<Capture> capture;
+    std::shared_ptr<FramePool> pool;    // storage of the arrays this reader hands out
+    Capture::Cursor cursor;
+    std::mutex mutex;   // serializes threads sharing this reader, never held together with the GIL
+};
+
+typedef struct {
+    PyObject_HEAD
+    CaptureState *state;
+} CaptureObject;
+
+static PyTypeObject CaptureType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+static int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int parse_timeout(PyObject *timeout, int64_t &timeoutNs) {
+    if (timeout == Py_None) {
+        timeoutNs = -1;
+        return 0;
+    }
+    double seconds = PyFloat_AsDouble(timeout);
+    if (seconds == -1.0 && PyErr_Occurred()) {
+        return -1;
+    }
+    timeoutNs = seconds <= 0 ? 0 : (int64_t) (seconds * 1e9);
+    return 0;
+}
+
+static PyObject *new_capture_object(PyTypeObject *type, const std::shared_ptr<Capture> &capture, const std::shared_ptr<FramePool> &pool) {
+    CaptureObject *self = (CaptureObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->state = new CaptureState();
+    self->state->capture = capture;
+    self->state->pool = pool;
+    self->state->cursor = capture->cursor();
+    return (PyObject *) self;
+}
+
+PyObject *new_capture_reader(const std::shared_ptr<Capture> &capture, const std::shared_ptr<FramePool> &pool) {
+    return new_capture_object(&CaptureType, capture, pool);
+}
+
+std::shared_ptr<Capture> capture_of(PyObject *object) {
+    if (PyObject_TypeCheck(object, &CaptureType)) {
+        return ((CaptureObject *) object)->state->capture;
+    }
+    PyObject *attribute = PyObject_GetAttrString(object, "capture");
+    if (attribute == NULL) {
+        PyErr_Clear();
+    } else {
+        std::shared_ptr<Capture> capture;
+        if (PyObject_TypeCheck(attribute, &CaptureType)) {
+            capture = ((CaptureObject *) attribute)->state->capture;
+        }
+        Py_DECREF(attribute);
+        if (capture != nullptr) {
+            return capture;
+        }
+    }
+    PyErr_SetString(PyExc_TypeError, "Expected a pyoptris.Capture or an object with a capture attribute");
+    return nullptr;
+}
+
+PyObject *new_reader_stream(const std::shared_ptr<Capture> &capture, const std::shared_ptr<FramePool> &pool, Py_ssize_t batch) {
+    if (batch < 1) {
+        PyErr_SetString(PyExc_ValueError, "batch must be positive");
+        return NULL;
+    }
+    if ((size_t) batch > capture->capacity()) {
+        // The ring never holds more than capacity unread frames, a larger batch would never complete
+        PyErr_SetString(PyExc_ValueError, "batch must not exceed the capacity of the capture");
+        return NULL;
+    }
+    PyObject *reader = new_capture_object(&CaptureType, capture, pool);
+    if (reader == NULL) {
+        return NULL;
+    }
+    PyObject *stream = new_frame_stream(reader, batch);
+    Py_DECREF(reader);
+    return stream;
+}
+
+/**
+ * @brief Capture(capacity=16)
+ * Starts a native thread that pulls thermal frames from the camera opened through usb_init/tcp_init
+ * into a ring of capacity frames.
+ */
+static PyObject *Capture_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "capacity", nullptr };
+    Py_ssize_t capacity = 16;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|n", (char **) keywords, &capacity)) {
+        return NULL;
+    }
+    if (capacity < 2) {
+        PyErr_SetString(PyExc_ValueError, "capacity must be at least 2");
+        return NULL;
+    }
+
+    std::shared_ptr<Capture> capture = std::make_shared<Capture>(direct_binding_source(), (size_t) capacity);
+    register_direct_capture(capture);
+    int ok;
+    try {
+        ok = capture->start();
+    } catch (const std::bad_alloc &) {
+        return PyErr_NoMemory();
+    }
+    switch(ok) {
+        case 0:
+            break;
+
+        case -1:
+            PyErr_SetString(PyExc_RuntimeError, "Error");
+            return NULL;
+
+        case -2:
+            PyErr_SetString(PyExc_RuntimeError, "Fatal error");
+            return NULL;
+
+        default:
+            abort();
+    }
+    return new_capture_object(type, capture, frame_pool());
+}
+
+static void Capture_dealloc(CaptureObject *self) {
+    delete self->state;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+int wait_released(const std::function<Capture::WaitResult(int64_t)> &wait, int64_t timeoutNs) {
+    int64_t deadline = timeoutNs < 0 ? -1 : steady_ns() + timeoutNs;
+    for (;;) {
+        int64_t slice = WAIT_SLICE_NS;
+        if (deadline >= 0) {
+            slice = std::min(slice, std::max<int64_t>(deadline - steady_ns(), 0));
+        }
+
+        Capture::WaitResult result;
+        Py_BEGIN_ALLOW_THREADS
+        result = wait(slice);
+        Py_END_ALLOW_THREADS
+
+        if (result != Capture::WAIT_TIMEOUT) {
+            return result;
+        }
+        if (deadline >= 0 && steady_ns() >= deadline) {
+            return Capture::WAIT_TIMEOUT;
+        }
+        if (PyErr_CheckSignals() < 0) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Copy of the cursor of this reader, taken with the GIL released since next() holds the mutex while it waits
+ */
+static Capture::Cursor cursor_snapshot(CaptureState *state) {
+    Capture::Cursor cursor;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        cursor = state->cursor;
+    }
+    Py_END_ALLOW_THREADS
+    return cursor;
+}
+
+/**
+ * @brief Waits for the next frame of this reader with the GIL released
+ * @param info may be nullptr
+ * @return WAIT_* result, -1 with an exception set if interrupted by a signal
+ */
+static int capture_wait(CaptureState *state, void *data, FrameInfo *info, int64_t timeoutNs) {
+    FrameInfo local;
+    FrameInfo *frameInfo = info != nullptr ? info : &local;
+    return wait_released([&](int64_t slice) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        uint64_t dropped = state->cursor.dropped;
+        Capture::WaitResult result = state->capture->next(state->cursor, data, frameInfo, slice);
+        if (result == Capture::WAIT_FRAME) {
+            record_delivery(*frameInfo, state->cursor.dropped - dropped);
+        }
+        return result;
+    }, timeoutNs);
+}
+
+static void set_closed_error(CaptureState *state) {
+    if (state->capture->failed()) {
+        PyErr_SetString(PyExc_RuntimeError, "Fatal error");
+    } else {
+        PyErr_SetString(PyExc_RuntimeError, "Capture stopped");
+    }
+}
+
+int capture_reader_next(PyObject *reader, void *data, FrameInfo *info, int64_t timeoutNs) {
+    CaptureState *state = ((CaptureObject *) reader)->state;
+    int result = capture_wait(state, data, info, timeoutNs);
+    if (result == Capture::WAIT_CLOSED) {
+        set_closed_error(state);
+    }
+    return result;
+}
+
+static PyObject *new_frame_array(CaptureState *state) {
+    npy_intp dimensions[2] = { state->capture->height(), state->capture->width() };
+    return new_pooled_array(state->pool, 2, dimensions, NPY_UINT16);
+}
+
+/**
+ * @brief latest(metadata=False)
+ * Most recent frame, None if nothing has been captured yet. Does not move the reader.
+ */
+static PyObject *Capture_latest(CaptureObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "metadata", nullptr };
+    int metadata = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", (char **) keywords, &metadata)) {
+        return NULL;
+    }
+    PyObject *result = new_frame_array(self->state);
+    if (result == NULL) {
+        return NULL;
+    }
+    void *data = PyArray_DATA((PyArrayObject *) result);
+    FrameInfo info;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = self->state->capture->latest(data, &info);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        Py_DECREF(result);
+        Py_RETURN_NONE;
+    }
+    record_delivery(info, 0);
+    return with_frame_metadata(result, info, metadata);
+}
+
+/**
+ * @brief next(timeout=None, metadata=False)
+ * Next frame of this reader, None if no frame arrived within timeout seconds.
+ * Frames overwritten before the reader got to them are skipped and counted in dropped.
+ * With metadata=True the frame comes as (frame, pyoptris.FrameMetadata).
+ */
+static PyObject *Capture_next(CaptureObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "timeout", "metadata", nullptr };
+    PyObject *timeout = Py_None;
+    int metadata = 0;
+    int64_t timeoutNs;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|Op", (char **) keywords, &timeout, &metadata) || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+
+    PyObject *result = new_frame_array(self->state);
+    if (result == NULL) {
+        return NULL;
+    }
+    FrameInfo info;
+    switch(capture_wait(self->state, PyArray_DATA((PyArrayObject *) result), &info, timeoutNs)) {
+        case Capture::WAIT_FRAME:
+            return with_frame_metadata(result, info, metadata);
+
+        case Capture::WAIT_TIMEOUT:
+            Py_DECREF(result);
+            Py_RETURN_NONE;
+
+        case Capture::WAIT_CLOSED:
+            set_closed_error(self->state);
+            break;
+
+        default:
+            break;
+    }
+    Py_DECREF(result);
+    return NULL;
+}
+
+static FramePool::Buffer *acquire_frame_buffer(CaptureState *state) {
+    return state->pool->acquire((size_t) state->capture->width() * state->capture->height() * sizeof(uint16_t));
+}
+
+/**
+ * @brief latest_frame() -> pyoptris.Frame of the most recent frame, None if nothing has been captured yet
+ */
+static PyObject *Capture_latest_frame(CaptureObject *self, PyObject *) {
+    CaptureState *state = self->state;
+    FramePool::Buffer *raw = acquire_frame_buffer(state);
+    if (raw == nullptr) {
+        return PyErr_NoMemory();
+    }
+    FrameInfo info;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = state->capture->latest(raw->data, &info);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        FramePool::release(raw);
+        Py_RETURN_NONE;
+    }
+    record_delivery(info, 0);
+    return new_frame(raw, state->capture->width(), state->capture->height(), &info, current_temperature_scale());
+}
+
+/**
+ * @brief next_frame(timeout=None) -> pyoptris.Frame of the next frame of this reader, None on timeout
+ */
+static PyObject *Capture_next_frame(CaptureObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "timeout", nullptr };
+    PyObject *timeout = Py_None;
+    int64_t timeoutNs;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", (char **) keywords, &timeout) || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+    CaptureState *state = self->state;
+    FramePool::Buffer *raw = acquire_frame_buffer(state);
+    if (raw == nullptr) {
+        return PyErr_NoMemory();
+    }
+    FrameInfo info;
+    switch(capture_wait(state, raw->data, &info, timeoutNs)) {
+        case Capture::WAIT_FRAME:
+            return new_frame(raw, state->capture->width(), state->capture->height(), &info, current_temperature_scale());
+
+        case Capture::WAIT_TIMEOUT:
+            FramePool::release(raw);
+            Py_RETURN_NONE;
+
+        case Capture::WAIT_CLOSED:
+            set_closed_error(state);
+            break;
+
+        default:
+            break;
+    }
+    FramePool::release(raw);
+    return NULL;
+}
+
+/**
+ * @brief All frames this reader has not consumed yet as one (n, h, w) array, n may be 0
+ */
+static PyObject *Capture_drain(CaptureObject *self, PyObject *) {
+    CaptureState *state = self->state;
+    uint64_t count = state->capture->pending(cursor_snapshot(state));
+    size_t frameSize = state->capture->frame_size();
+
+    // The batch size varies from call to call, so this is not worth caching in the frame pool
+    npy_intp dimensions[3] = { (npy_intp) count, state->capture->height(), state->capture->width() };
+    PyObject *result = PyArray_SimpleNew(3, dimensions, NPY_UINT16);
+    if (result == NULL) {
+        return NULL;
+    }
+    unsigned char *data = (unsigned char *) PyArray_DATA((PyArrayObject *) result);
+    uint64_t read = 0;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        uint64_t dropped = state->cursor.dropped;
+        FrameInfo info;
+        while (read < count && state->capture->next(state->cursor, data + read * frameSize, &info, 0) == Capture::WAIT_FRAME) {
+            record_delivery(info, state->cursor.dropped - dropped);
+            dropped = state->cursor.dropped;
+            read++;
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    if (read < count) {
+        // Frames overwritten while copying are skipped, hand out only what was read
+        PyObject *head = PySequence_GetSlice(result, 0, (Py_ssize_t) read);
+        Py_DECREF(result);
+        return head;
+    }
+    return result;
+}
+
+uint64_t capture_reader_pending(PyObject *reader) {
+    CaptureState *state = ((CaptureObject *) reader)->state;
+    return state->capture->pending(cursor_snapshot(state));
+}
+
+PyObject *capture_reader_batch(PyObject *reader, Py_ssize_t count, int64_t timeoutNs) {
+    CaptureState *state = ((CaptureObject *) reader)->state;
+    npy_intp dimensions[3] = { (npy_intp) count, state->capture->height(), state->capture->width() };
+    PyObject *frames = new_pooled_array(state->pool, 3, dimensions, NPY_UINT16);
+    if (frames == NULL) {
+        return NULL;
+    }
+    unsigned char *data = (unsigned char *) PyArray_DATA((PyArrayObject *) frames);
+    std::vector<FrameInfo> infos((size_t) count);
+    size_t read = 0;
+    int result = wait_released([&](int64_t slice) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        uint64_t dropped = state->cursor.dropped;
+        size_t first = read;
+        Capture::WaitResult waited = state->capture->next_batch(state->cursor, data, infos.data(), (size_t) count, read, slice);
+        for (size_t i = first; i < read; i++) {
+            record_delivery(infos[i], i == first ? state->cursor.dropped - dropped : 0);
+        }
+        return waited;
+    }, timeoutNs);
+    if (result < 0 || (result == Capture::WAIT_CLOSED && read == 0)) {
+        if (result == Capture::WAIT_CLOSED) {
+            set_closed_error(state);
+        }
+        Py_DECREF(frames);
+        return NULL;
+    }
+
+    if (read < (size_t) count) {
+        // Timed out or stopped part way, hand out only what was read
+        PyObject *head = PySequence_GetSlice(frames, 0, (Py_ssize_t) read);
+        Py_DECREF(frames);
+        if (head == NULL) {
+            return NULL;
+        }
+        frames = head;
+    }
+    npy_intp length = (npy_intp) read;
+    PyObject *timestamps = PyArray_SimpleNew(1, &length, NPY_INT64);
+    PyObject *sequences = PyArray_SimpleNew(1, &length, NPY_UINT64);
+    if (timestamps == NULL || sequences == NULL) {
+        Py_DECREF(frames);
+        Py_XDECREF(timestamps);
+        Py_XDECREF(sequences);
+        return NULL;
+    }
+    int64_t *timestamp = (int64_t *) PyArray_DATA((PyArrayObject *) timestamps);
+    uint64_t *sequence = (uint64_t *) PyArray_DATA((PyArrayObject *) sequences);
+    for (size_t i = 0; i < read; i++) {
+        timestamp[i] = infos[i].timestamp;
+        sequence[i] = infos[i].sequence;
+    }
+    return Py_BuildValue("NNN", frames, timestamps, sequences);
+}
+
+/**
+ * @brief next_batch(n, timeout=None) -> (frames, timestamps, sequences)
+ * The next n frames of this reader in one (n, h, w) array, filled with the GIL released. timestamps are the
+ * acquisition times in ns since the epoch, sequences the capture counters, a gap means frames were dropped.
+ * Fewer than n frames are returned if timeout seconds pass first.
+ */
+static PyObject *Capture_next_batch(CaptureObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "n", "timeout", nullptr };
+    Py_ssize_t count;
+    PyObject *timeout = Py_None;
+    int64_t timeoutNs;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n|O", (char **) keywords, &count, &timeout) || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+    if (count < 1) {
+        PyErr_SetString(PyExc_ValueError, "n must be positive");
+        return NULL;
+    }
+    return capture_reader_batch((PyObject *) self, count, timeoutNs);
+}
+
+/**
+ * @brief stats() -> dict with the frames, errors, dropped and flag gate counters and the fetch latency histogram of this capture
+ */
+static PyObject *Capture_stats(CaptureObject *self, PyObject *) {
+    const std::shared_ptr<Capture> &capture = self->state->capture;
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K,s:K,s:N}",
+        "frames", (unsigned long long) capture->frames(),
+        "errors", (unsigned long long) capture->errors(),
+        "dropped", (unsigned long long) cursor_snapshot(self->state).dropped,
+        "gated", (unsigned long long) capture->gated(),
+        "suppressed", (unsigned long long) capture->suppressed(),
+        "held", (unsigned long long) capture->held(),
+        "fetch", latency_dict(capture->fetch_latency()));
+}
+
+int parse_flag_gate(PyObject *args, PyObject *kwargs, pyoptris::FlagPolicy &policy, int64_t &settleNs, bool &detectFrozen) {
+    static const char *keywords[] = { "policy", "settle", "detect_frozen", nullptr };
+    int policyValue;
+    double settle = 0.1;
+    int frozen = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i|dp", (char **) keywords, &policyValue, &settle, &frozen)) {
+        return -1;
+    }
+    if (policyValue < pyoptris::FLAG_POLICY_TAG || policyValue > pyoptris::FLAG_POLICY_HOLD) {
+        PyErr_SetString(PyExc_ValueError, "policy must be FLAG_POLICY_TAG, FLAG_POLICY_DROP or FLAG_POLICY_HOLD");
+        return -1;
+    }
+    if (!(settle >= 0)) {
+        PyErr_SetString(PyExc_ValueError, "settle must not be negative");
+        return -1;
+    }
+    policy = (pyoptris::FlagPolicy) policyValue;
+    settleNs = (int64_t) (settle * 1e9);
+    detectFrozen = frozen != 0;
+    return 0;
+}
+
+/**
+ * @brief set_flag_gate(policy, settle=0.1, detect_frozen=True)
+ * Configures the capture thread, and so every reader of it: frames taken while the shutter flag is not open and
+ * for settle seconds after it opened are tagged (FLAG_POLICY_TAG), left out (FLAG_POLICY_DROP) or replaced by
+ * the last valid frame (FLAG_POLICY_HOLD). detect_frozen treats repeated frames as flag periods for sources
+ * that do not report the flag state.
+ */
+static PyObject *Capture_set_flag_gate(CaptureObject *self, PyObject *args, PyObject *kwargs) {
+    pyoptris::FlagPolicy policy;
+    int64_t settleNs;
+    bool detectFrozen;
+    if (parse_flag_gate(args, kwargs, policy, settleNs, detectFrozen) < 0) {
+        return NULL;
+    }
+    self->state->capture->flag_gate().configure(policy, settleNs, detectFrozen);
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Independent reader on the same capture thread, positioned at the next frame to be captured
+ */
+static PyObject *Capture_reader(CaptureObject *self, PyObject *) {
+    return new_capture_object(Py_TYPE(self), self->state->capture, self->state->pool);
+}
+
+/**
+ * @brief stream(batch=1) -> pyoptris.FrameStream over a new reader of this capture, for async for
+ */
+static PyObject *Capture_stream(CaptureObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "batch", nullptr };
+    Py_ssize_t batch = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|n", (char **) keywords, &batch)) {
+        return NULL;
+    }
+    return new_reader_stream(self->state->capture, self->state->pool, batch);
+}
+
+/**
+ * @brief Stops the capture thread, pending frames can still be read
+ */
+static PyObject *Capture_stop(CaptureObject *self, PyObject *) {
+    std::shared_ptr<Capture> capture = self->state->capture;
+    Py_BEGIN_ALLOW_THREADS
+    capture->stop();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *Capture_enter(CaptureObject *self, PyObject *) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject *Capture_exit(CaptureObject *self, PyObject *) {
+    return Capture_stop(self, NULL);
+}
+
+static PyObject *Capture_get_frames(CaptureObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->capture->frames());
+}
+
+static PyObject *Capture_get_errors(CaptureObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->capture->errors());
+}
+
+static PyObject *Capture_get_dropped(CaptureObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(cursor_snapshot(self->state).dropped);
+}
+
+static PyObject *Capture_get_pending(CaptureObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->capture->pending(cursor_snapshot(self->state)));
+}
+
+static PyObject *Capture_get_capacity(CaptureObject *self, void *) {
+    return PyLong_FromSize_t(self->state->capture->capacity());
+}
+
+static PyObject *Capture_get_size(CaptureObject *self, void *) {
+    return Py_BuildValue("ii", self->state->capture->width(), self->state->capture->height());
+}
+
+static PyObject *Capture_get_running(CaptureObject *self, void *) {
+    return PyBool_FromLong(self->state->capture->running());
+}
+
+static PyObject *Capture_get_flag_gate(CaptureObject *self, void *) {
+    const pyoptris::FlagGate &gate = self->state->capture->flag_gate();
+    return Py_BuildValue("(idO)", (int) gate.policy(), gate.settle_ns() * 1e-9, gate.detect_frozen() ? Py_True : Py_False);
+}
+
+static PyMethodDef Capture_methods[] = {
+    { "latest",     (PyCFunction) Capture_latest,   METH_VARARGS | METH_KEYWORDS, "latest(metadata=False): most recent frame, None if nothing was captured yet" },
+    { "next",       (PyCFunction) Capture_next,     METH_VARARGS | METH_KEYWORDS, "next(timeout=None, metadata=False): next frame of this reader, None on timeout" },
+    { "latest_frame", (PyCFunction) Capture_latest_frame, METH_NOARGS, "latest_frame(): most recent frame as a pyoptris.Frame, None if nothing was captured yet" },
+    { "next_frame", (PyCFunction) Capture_next_frame, METH_VARARGS | METH_KEYWORDS, "next_frame(timeout=None): next frame of this reader as a pyoptris.Frame, None on timeout" },
+    { "next_batch", (PyCFunction) Capture_next_batch, METH_VARARGS | METH_KEYWORDS, "next_batch(n, timeout=None) -> (frames, timestamps, sequences) of the next n frames" },
+    { "drain",      (PyCFunction) Capture_drain,    METH_NOARGS, "All unread frames of this reader as an (n, h, w) array" },
+    { "stats",      (PyCFunction) Capture_stats,    METH_NOARGS, "Counters and fetch latency histogram of this capture" },
+    { "set_flag_gate", (PyCFunction) Capture_set_flag_gate, METH_VARARGS | METH_KEYWORDS, "set_flag_gate(policy, settle=0.1, detect_frozen=True): handling of flag cycle frames" },
+    { "reader",     (PyCFunction) Capture_reader,   METH_NOARGS, "Independent reader on the same capture thread" },
+    { "stream",     (PyCFunction) Capture_stream,   METH_VARARGS | METH_KEYWORDS, "stream(batch=1): frames of a new reader for async for" },
+    { "stop",       (PyCFunction) Capture_stop,     METH_NOARGS, "Stops the capture thread" },
+    { "__enter__",  (PyCFunction) Capture_enter,    METH_NOARGS, nullptr },
+    { "__exit__",   (PyCFunction) Capture_exit,     METH_VARARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Capture_getset[] = {
+    { "frames",     (getter) Capture_get_frames,    nullptr, "Frames captured so far", nullptr },
+    { "errors",     (getter) Capture_get_errors,    nullptr, "Failed SDK fetches", nullptr },
+    { "dropped",    (getter) Capture_get_dropped,   nullptr, "Frames overwritten before this reader read them", nullptr },
+    { "pending",    (getter) Capture_get_pending,   nullptr, "Frames this reader can read without waiting", nullptr },
+    { "capacity",   (getter) Capture_get_capacity,  nullptr, "Ring size in frames", nullptr },
+    { "size",       (getter) Capture_get_size,      nullptr, "(width, height) of the frames", nullptr },
+    { "running",    (getter) Capture_get_running,   nullptr, "True while the capture thread is alive", nullptr },
+    { "flag_gate",  (getter) Capture_get_flag_gate, nullptr, "(policy, settle, detect_frozen) of the capture thread", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+int add_capture_type(PyObject *module) {
+    CaptureType.tp_name = "pyoptris.Capture";
+    CaptureType.tp_basicsize = sizeof(CaptureObject);
+    CaptureType.tp_flags = Py_TPFLAGS_DEFAULT;
+    CaptureType.tp_doc = "Capture(capacity=16): background acquisition of thermal frames into a ring buffer";
+    CaptureType.tp_new = Capture_new;
+    CaptureType.tp_dealloc = (destructor) Capture_dealloc;
+    CaptureType.tp_methods = Capture_methods;
+    CaptureType.tp_getset = Capture_getset;
+    if (PyType_Ready(&CaptureType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&CaptureType);
+    if (PyModule_AddObject(module, "Capture", (PyObject *) &CaptureType) < 0) {
+        Py_DECREF(&CaptureType);
+        return -1;
+    }
+    return 0;
+}
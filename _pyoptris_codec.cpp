@@ -0,0 +1,567 @@
+#include "_pyoptris.h"
+
+#include "codec.h"
+#include "compressed_recording.h"
+
+#include <mutex>
+#include <string>
+
+using pyoptris::Capture;
+using pyoptris::CompressedReader;
+using pyoptris::CompressedRecordHeader;
+using pyoptris::CompressedWriter;
+using pyoptris::FrameDecoder;
+using pyoptris::FrameEncoder;
+
+// Codec state is used with the GIL released, the mutex keeps two threads off the same stream
+struct EncoderState {
+    std::mutex mutex;
+    FrameEncoder encoder;
+
+    EncoderState(int width, int height, int keyframeInterval) : encoder(width, height, keyframeInterval) {}
+};
+
+struct DecoderState {
+    std::mutex mutex;
+    FrameDecoder decoder;
+
+    DecoderState(int width, int height) : decoder(width, height) {}
+};
+
+struct CompressedRecordingState {
+    std::mutex mutex;
+    CompressedReader reader;
+};
+
+typedef struct {
+    PyObject_HEAD
+    EncoderState *state;
+} EncoderObject;
+
+typedef struct {
+    PyObject_HEAD
+    DecoderState *state;
+} DecoderObject;
+
+typedef struct {
+    PyObject_HEAD
+    CompressedWriter *writer;
+} CompressedRecorderObject;
+
+typedef struct {
+    PyObject_HEAD
+    CompressedRecordingState *state;
+} CompressedRecordingObject;
+
+static PyTypeObject EncoderType = { PyVarObject_HEAD_INIT(NULL, 0) };
+static PyTypeObject DecoderType = { PyVarObject_HEAD_INIT(NULL, 0) };
+static PyTypeObject CompressedRecorderType = { PyVarObject_HEAD_INIT(NULL, 0) };
+static PyTypeObject CompressedRecordingType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+static int check_frame_size(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        PyErr_SetString(PyExc_ValueError, "width and height must be positive");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Encoder(width, height, keyframe_interval=32)
+ * Lossless streaming encoder for raw uint16 frames, e.g. to send them over a network.
+ * Every keyframe_interval-th frame is a keyframe, the others are coded against the frame before.
+ */
+static PyObject *Encoder_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "width", "height", "keyframe_interval", nullptr };
+    int width, height;
+    int keyframeInterval = 32;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ii|i", (char **) keywords, &width, &height, &keyframeInterval)) {
+        return NULL;
+    }
+    if (check_frame_size(width, height) < 0) {
+        return NULL;
+    }
+    EncoderObject *self = (EncoderObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->state = new EncoderState(width, height, keyframeInterval);
+    return (PyObject *) self;
+}
+
+static void Encoder_dealloc(EncoderObject *self) {
+    delete self->state;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief encode(frame) -> bytes, frame is a (height, width) uint16 array
+ */
+static PyObject *Encoder_encode(EncoderObject *self, PyObject *frameObject) {
+    EncoderState *state = self->state;
+    int width = state->encoder.width();
+    int height = state->encoder.height();
+    PyArrayObject *frame = (PyArrayObject *) PyArray_FROM_OTF(frameObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (frame == NULL) {
+        return NULL;
+    }
+    if (PyArray_NDIM(frame) != 2 || PyArray_DIM(frame, 0) != height || PyArray_DIM(frame, 1) != width) {
+        Py_DECREF(frame);
+        PyErr_Format(PyExc_ValueError, "frame must have shape (%d, %d)", height, width);
+        return NULL;
+    }
+    PyObject *result = PyBytes_FromStringAndSize(NULL, (Py_ssize_t) pyoptris::codec_max_encoded_size((size_t) width * height));
+    if (result == NULL) {
+        Py_DECREF(frame);
+        return NULL;
+    }
+
+    const uint16_t *data = (const uint16_t *) PyArray_DATA(frame);
+    uint8_t *out = (uint8_t *) PyBytes_AS_STRING(result);
+    size_t size;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        size = state->encoder.encode(data, out);
+    }
+    Py_END_ALLOW_THREADS
+    Py_DECREF(frame);
+
+    if (_PyBytes_Resize(&result, (Py_ssize_t) size) < 0) {
+        return NULL;
+    }
+    return result;
+}
+
+/**
+ * @brief Makes the next frame a keyframe, e.g. when a new client connects
+ */
+static PyObject *Encoder_reset(EncoderObject *self, PyObject *) {
+    std::lock_guard<std::mutex> lock(self->state->mutex);
+    self->state->encoder.reset();
+    Py_RETURN_NONE;
+}
+
+static PyObject *Encoder_get_size(EncoderObject *self, void *) {
+    return Py_BuildValue("ii", self->state->encoder.width(), self->state->encoder.height());
+}
+
+static PyMethodDef Encoder_methods[] = {
+    { "encode", (PyCFunction) Encoder_encode,   METH_O, "encode(frame) -> bytes" },
+    { "reset",  (PyCFunction) Encoder_reset,    METH_NOARGS, "Makes the next frame a keyframe" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Encoder_getset[] = {
+    { "size",   (getter) Encoder_get_size,  nullptr, "(width, height) of the frames", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+/**
+ * @brief Decoder(width, height)
+ * Counterpart of Encoder, frames must be decoded in the order they were encoded, starting at a keyframe
+ */
+static PyObject *Decoder_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "width", "height", nullptr };
+    int width, height;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ii", (char **) keywords, &width, &height)) {
+        return NULL;
+    }
+    if (check_frame_size(width, height) < 0) {
+        return NULL;
+    }
+    DecoderObject *self = (DecoderObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->state = new DecoderState(width, height);
+    return (PyObject *) self;
+}
+
+static void Decoder_dealloc(DecoderObject *self) {
+    delete self->state;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief decode(data, out=None) -> (height, width) uint16 array
+ */
+static PyObject *Decoder_decode(DecoderObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "data", "out", nullptr };
+    Py_buffer data;
+    PyObject *out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*|O", (char **) keywords, &data, &out)) {
+        return NULL;
+    }
+    DecoderState *state = self->state;
+    npy_intp dimensions[2] = { state->decoder.height(), state->decoder.width() };
+    PyObject *result = frame_array(out, 2, dimensions, NPY_UINT16);
+    if (result == NULL) {
+        PyBuffer_Release(&data);
+        return NULL;
+    }
+
+    uint16_t *frame = (uint16_t *) PyArray_DATA((PyArrayObject *) result);
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        ok = state->decoder.decode((const uint8_t *) data.buf, (size_t) data.len, frame);
+    }
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&data);
+
+    if (!ok) {
+        Py_DECREF(result);
+        PyErr_SetString(PyExc_ValueError, "Malformed frame or delta frame without a keyframe before it");
+        return NULL;
+    }
+    return result;
+}
+
+static PyObject *Decoder_get_size(DecoderObject *self, void *) {
+    return Py_BuildValue("ii", self->state->decoder.width(), self->state->decoder.height());
+}
+
+static PyMethodDef Decoder_methods[] = {
+    { "decode", (PyCFunction) Decoder_decode,   METH_VARARGS | METH_KEYWORDS, "decode(data, out=None) -> frame" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Decoder_getset[] = {
+    { "size",   (getter) Decoder_get_size,  nullptr, "(width, height) of the frames", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+/**
+ * @brief CompressedRecorder(path, capture, keyframe_interval=32)
+ * Records every frame of capture (a pyoptris.Capture or pyoptris.Camera) losslessly compressed into a
+ * single file, encoding on a native thread.
+ */
+static PyObject *CompressedRecorder_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "path", "capture", "keyframe_interval", nullptr };
+    const char *path;
+    PyObject *captureObject;
+    int keyframeInterval = 32;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|i", (char **) keywords, &path, &captureObject, &keyframeInterval)) {
+        return NULL;
+    }
+    std::shared_ptr<Capture> capture = capture_of(captureObject);
+    if (capture == nullptr) {
+        return NULL;
+    }
+
+    CompressedWriter *writer = new CompressedWriter(capture, path, keyframeInterval, current_temperature_decimals());
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = writer->start(error);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        delete writer;
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return NULL;
+    }
+
+    CompressedRecorderObject *self = (CompressedRecorderObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        delete writer;
+        Py_END_ALLOW_THREADS
+        return NULL;
+    }
+    self->writer = writer;
+    return (PyObject *) self;
+}
+
+static void CompressedRecorder_dealloc(CompressedRecorderObject *self) {
+    CompressedWriter *writer = self->writer;
+    Py_BEGIN_ALLOW_THREADS
+    delete writer;
+    Py_END_ALLOW_THREADS
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief Compresses what the capture still holds for the recorder, then writes the index and closes the file
+ */
+static PyObject *CompressedRecorder_stop(CompressedRecorderObject *self, PyObject *) {
+    CompressedWriter *writer = self->writer;
+    Py_BEGIN_ALLOW_THREADS
+    writer->stop();
+    Py_END_ALLOW_THREADS
+    std::string error = writer->error();
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *CompressedRecorder_enter(CompressedRecorderObject *self, PyObject *) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject *CompressedRecorder_exit(CompressedRecorderObject *self, PyObject *) {
+    return CompressedRecorder_stop(self, NULL);
+}
+
+static PyObject *CompressedRecorder_get_frames(CompressedRecorderObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->writer->frames());
+}
+
+static PyObject *CompressedRecorder_get_dropped(CompressedRecorderObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->writer->dropped());
+}
+
+static PyObject *CompressedRecorder_get_bytes_written(CompressedRecorderObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->writer->bytes_out());
+}
+
+static PyObject *CompressedRecorder_get_ratio(CompressedRecorderObject *self, void *) {
+    uint64_t out = self->writer->bytes_out();
+    return PyFloat_FromDouble(out == 0 ? 0.0 : (double) self->writer->bytes_in() / (double) out);
+}
+
+static PyObject *CompressedRecorder_get_running(CompressedRecorderObject *self, void *) {
+    return PyBool_FromLong(self->writer->running());
+}
+
+static PyMethodDef CompressedRecorder_methods[] = {
+    { "stop",       (PyCFunction) CompressedRecorder_stop,  METH_NOARGS, "Records pending frames and closes the recording" },
+    { "__enter__",  (PyCFunction) CompressedRecorder_enter, METH_NOARGS, nullptr },
+    { "__exit__",   (PyCFunction) CompressedRecorder_exit,  METH_VARARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef CompressedRecorder_getset[] = {
+    { "frames",         (getter) CompressedRecorder_get_frames,         nullptr, "Frames recorded so far", nullptr },
+    { "dropped",        (getter) CompressedRecorder_get_dropped,        nullptr, "Frames overwritten in the capture ring before the recorder got to them", nullptr },
+    { "bytes_written",  (getter) CompressedRecorder_get_bytes_written,  nullptr, "Size of the file so far", nullptr },
+    { "ratio",          (getter) CompressedRecorder_get_ratio,          nullptr, "Raw frame bytes per byte written", nullptr },
+    { "running",        (getter) CompressedRecorder_get_running,        nullptr, "True while the encoder thread is alive", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+/**
+ * @brief CompressedRecording(path)
+ * Opens a compressed recording for reading. Frames are decoded into new arrays, sequential access decodes
+ * one frame per step, random access decodes forward from the keyframe before the frame.
+ */
+static PyObject *CompressedRecording_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "path", nullptr };
+    const char *path;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) keywords, &path)) {
+        return NULL;
+    }
+    CompressedRecordingState *state = new CompressedRecordingState();
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = state->reader.open(path, error);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        delete state;
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return NULL;
+    }
+    CompressedRecordingObject *self = (CompressedRecordingObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        delete state;
+        return NULL;
+    }
+    self->state = state;
+    return (PyObject *) self;
+}
+
+static void CompressedRecording_dealloc(CompressedRecordingObject *self) {
+    delete self->state;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static int compressed_frame_number(CompressedRecordingObject *self, Py_ssize_t i, uint64_t &n) {
+    Py_ssize_t count = (Py_ssize_t) self->state->reader.frames();
+    if (i < 0) {
+        i += count;
+    }
+    if (i < 0 || i >= count) {
+        PyErr_SetString(PyExc_IndexError, "frame number out of range");
+        return -1;
+    }
+    n = (uint64_t) i;
+    return 0;
+}
+
+static PyObject *decode_frame(CompressedRecordingObject *self, uint64_t n) {
+    CompressedRecordingState *state = self->state;
+    npy_intp dimensions[2] = { state->reader.height(), state->reader.width() };
+    PyObject *result = frame_array(Py_None, 2, dimensions, NPY_UINT16);
+    if (result == NULL) {
+        return NULL;
+    }
+    uint16_t *frame = (uint16_t *) PyArray_DATA((PyArrayObject *) result);
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        ok = state->reader.read(n, frame, nullptr);
+    }
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        Py_DECREF(result);
+        PyErr_SetString(PyExc_OSError, "Damaged compressed recording");
+        return NULL;
+    }
+    return result;
+}
+
+static Py_ssize_t CompressedRecording_length(CompressedRecordingObject *self) {
+    return (Py_ssize_t) self->state->reader.frames();
+}
+
+static PyObject *CompressedRecording_subscript(CompressedRecordingObject *self, PyObject *key) {
+    Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+    if (i == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+    uint64_t n;
+    if (compressed_frame_number(self, i, n) < 0) {
+        return NULL;
+    }
+    return decode_frame(self, n);
+}
+
+// Makes recordings iterable, iteration ends at the IndexError past the last frame
+static PyObject *CompressedRecording_item(CompressedRecordingObject *self, Py_ssize_t i) {
+    if (i < 0 || (uint64_t) i >= self->state->reader.frames()) {
+        PyErr_SetString(PyExc_IndexError, "frame number out of range");
+        return NULL;
+    }
+    return decode_frame(self, (uint64_t) i);
+}
+
+/**
+ * @brief entry(n) -> (timestamp, sequence), acquisition time in ns since the epoch and capture sequence number
+ */
+static PyObject *CompressedRecording_entry(CompressedRecordingObject *self, PyObject *key) {
+    Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+    if (i == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+    uint64_t n;
+    if (compressed_frame_number(self, i, n) < 0) {
+        return NULL;
+    }
+    CompressedRecordingState *state = self->state;
+    CompressedRecordHeader record;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        ok = state->reader.entry(n, record);
+    }
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        PyErr_SetString(PyExc_OSError, "Damaged compressed recording");
+        return NULL;
+    }
+    return Py_BuildValue("LK", (long long) record.timestamp, (unsigned long long) record.sequence);
+}
+
+static PyObject *CompressedRecording_get_size(CompressedRecordingObject *self, void *) {
+    return Py_BuildValue("ii", self->state->reader.width(), self->state->reader.height());
+}
+
+static PyObject *CompressedRecording_get_keyframe_interval(CompressedRecordingObject *self, void *) {
+    return PyLong_FromLong(self->state->reader.keyframe_interval());
+}
+
+static PyObject *CompressedRecording_get_temperature_decimals(CompressedRecordingObject *self, void *) {
+    return PyLong_FromLong(self->state->reader.temperature_decimals());
+}
+
+static PyMappingMethods CompressedRecording_mapping = {
+    (lenfunc) CompressedRecording_length,
+    (binaryfunc) CompressedRecording_subscript,
+    nullptr
+};
+
+static PySequenceMethods CompressedRecording_sequence = {
+    (lenfunc) CompressedRecording_length,
+    nullptr,
+    nullptr,
+    (ssizeargfunc) CompressedRecording_item,
+};
+
+static PyMethodDef CompressedRecording_methods[] = {
+    { "entry",  (PyCFunction) CompressedRecording_entry,    METH_O, "entry(n) -> (timestamp, sequence) of frame n" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef CompressedRecording_getset[] = {
+    { "size",                   (getter) CompressedRecording_get_size,                  nullptr, "(width, height) of the frames", nullptr },
+    { "keyframe_interval",      (getter) CompressedRecording_get_keyframe_interval,     nullptr, "Frames from one keyframe to the next", nullptr },
+    { "temperature_decimals",   (getter) CompressedRecording_get_temperature_decimals,  nullptr, "Decimals of the raw values, pass to raw_to_celsius", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+static int add_type(PyObject *module, PyTypeObject *type, const char *name) {
+    if (PyType_Ready(type) < 0) {
+        return -1;
+    }
+    Py_INCREF(type);
+    if (PyModule_AddObject(module, name, (PyObject *) type) < 0) {
+        Py_DECREF(type);
+        return -1;
+    }
+    return 0;
+}
+
+int add_codec_types(PyObject *module) {
+    EncoderType.tp_name = "pyoptris.Encoder";
+    EncoderType.tp_basicsize = sizeof(EncoderObject);
+    EncoderType.tp_flags = Py_TPFLAGS_DEFAULT;
+    EncoderType.tp_doc = "Encoder(width, height, keyframe_interval=32): lossless streaming encoder for raw frames";
+    EncoderType.tp_new = Encoder_new;
+    EncoderType.tp_dealloc = (destructor) Encoder_dealloc;
+    EncoderType.tp_methods = Encoder_methods;
+    EncoderType.tp_getset = Encoder_getset;
+
+    DecoderType.tp_name = "pyoptris.Decoder";
+    DecoderType.tp_basicsize = sizeof(DecoderObject);
+    DecoderType.tp_flags = Py_TPFLAGS_DEFAULT;
+    DecoderType.tp_doc = "Decoder(width, height): decodes the output of Encoder";
+    DecoderType.tp_new = Decoder_new;
+    DecoderType.tp_dealloc = (destructor) Decoder_dealloc;
+    DecoderType.tp_methods = Decoder_methods;
+    DecoderType.tp_getset = Decoder_getset;
+
+    CompressedRecorderType.tp_name = "pyoptris.CompressedRecorder";
+    CompressedRecorderType.tp_basicsize = sizeof(CompressedRecorderObject);
+    CompressedRecorderType.tp_flags = Py_TPFLAGS_DEFAULT;
+    CompressedRecorderType.tp_doc = "CompressedRecorder(path, capture, keyframe_interval=32): records a capture losslessly compressed";
+    CompressedRecorderType.tp_new = CompressedRecorder_new;
+    CompressedRecorderType.tp_dealloc = (destructor) CompressedRecorder_dealloc;
+    CompressedRecorderType.tp_methods = CompressedRecorder_methods;
+    CompressedRecorderType.tp_getset = CompressedRecorder_getset;
+
+    CompressedRecordingType.tp_name = "pyoptris.CompressedRecording";
+    CompressedRecordingType.tp_basicsize = sizeof(CompressedRecordingObject);
+    CompressedRecordingType.tp_flags = Py_TPFLAGS_DEFAULT;
+    CompressedRecordingType.tp_doc = "CompressedRecording(path): random access to a compressed recording";
+    CompressedRecordingType.tp_new = CompressedRecording_new;
+    CompressedRecordingType.tp_dealloc = (destructor) CompressedRecording_dealloc;
+    CompressedRecordingType.tp_as_mapping = &CompressedRecording_mapping;
+    CompressedRecordingType.tp_as_sequence = &CompressedRecording_sequence;
+    CompressedRecordingType.tp_methods = CompressedRecording_methods;
+    CompressedRecordingType.tp_getset = CompressedRecording_getset;
+
+    if (add_type(module, &EncoderType, "Encoder") < 0
+            || add_type(module, &DecoderType, "Decoder") < 0
+            || add_type(module, &CompressedRecorderType, "CompressedRecorder") < 0
+            || add_type(module, &CompressedRecordingType, "CompressedRecording") < 0) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "_pyoptris.h"
+
+#include "convert.h"
+
+using pyoptris::TemperatureScale;
+
+// Decimal places of the raw thermal values, 1 unless high precision mode is enabled
+static int temperatureDecimals = 1;
+
+TemperatureScale current_temperature_scale() {
+    return pyoptris::temperature_scale(temperatureDecimals);
+}
+
+int current_temperature_decimals() {
+    return temperatureDecimals;
+}
+
+static bool valid_decimals(long decimals) {
+    if (decimals < 0 || decimals > 4) {
+        PyErr_SetString(PyExc_ValueError, "decimals must be between 0 and 4");
+        return false;
+    }
+    return true;
+}
+
+int parse_temperature_scale(PyObject *decimals, TemperatureScale &scale) {
+    if (decimals == Py_None) {
+        scale = current_temperature_scale();
+        return 0;
+    }
+    long value = PyLong_AsLong(decimals);
+    if ((value == -1 && PyErr_Occurred()) || !valid_decimals(value)) {
+        return -1;
+    }
+    scale = pyoptris::temperature_scale((int) value);
+    return 0;
+}
+
+int parse_float_dtype(PyObject *dtype, PyObject *out, int &typenum) {
+    if (dtype == Py_None) {
+        typenum = out != Py_None && PyArray_Check(out) ? PyArray_TYPE((PyArrayObject *) out) : NPY_FLOAT32;
+    } else {
+        PyArray_Descr *descr = NULL;
+        if (!PyArray_DescrConverter(dtype, &descr)) {
+            return -1;
+        }
+        typenum = descr->type_num;
+        Py_DECREF(descr);
+    }
+    if (typenum != NPY_FLOAT32 && typenum != NPY_FLOAT16) {
+        PyErr_SetString(PyExc_TypeError, "dtype must be float32 or float16");
+        return -1;
+    }
+    return 0;
+}
+
+void convert_to_celsius(const uint16_t *raw, void *out, size_t n, int typenum, TemperatureScale scale) {
+    int64_t before = pyoptris::steady_now_ns();
+    if (typenum == NPY_FLOAT16) {
+        pyoptris::raw_to_celsius_f16(raw, static_cast<uint16_t *>(out), n, scale);
+    } else {
+        pyoptris::raw_to_celsius(raw, static_cast<float *>(out), n, scale);
+    }
+    pyoptris::pipeline_statistics().conversion.record(pyoptris::steady_now_ns() - before);
+}
+
+/**
+ * @brief Sets the number of decimal places of the raw thermal values
+ * 1 by default. With <enable_high_precision> set in the xml config pass IRImager::getTemprangeDecimal()
+ * of the selected temperature range, the conversion then becomes t = raw / 10^decimals - 100.
+ */
+PyObject * set_temperature_decimals(PyObject *, PyObject *args) {
+    int decimals;
+    if (!PyArg_ParseTuple(args, "i", &decimals)) {
+        PyErr_SetString(PyExc_RuntimeError, "Bad argument(s)");
+        return NULL;
+    }
+    if (!valid_decimals(decimals)) {
+        return NULL;
+    }
+    temperatureDecimals = decimals;
+    Py_RETURN_NONE;
+}
+
+PyObject * get_temperature_decimals(PyObject *, PyObject *) {
+    return PyLong_FromLong(temperatureDecimals);
+}
+
+/**
+ * @brief raw_to_celsius(raw, out=None, dtype=None, decimals=None)
+ * Converts raw thermal values of any shape to degrees Celsius with SIMD kernels and the GIL released.
+ * dtype is float32 (default) or float16, out receives the result in place if given.
+ * decimals overrides the value set with set_temperature_decimals().
+ */
+PyObject * raw_to_celsius(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "raw", "out", "dtype", "decimals", nullptr };
+    PyObject *rawObject;
+    PyObject *out = Py_None;
+    PyObject *dtype = Py_None;
+    PyObject *decimalsObject = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OOO", (char **) keywords, &rawObject, &out, &dtype, &decimalsObject)) {
+        return NULL;
+    }
+    int typenum;
+    TemperatureScale scale;
+    if (parse_float_dtype(dtype, out, typenum) < 0 || parse_temperature_scale(decimalsObject, scale) < 0) {
+        return NULL;
+    }
+
+    PyArrayObject *raw = (PyArrayObject *) PyArray_FROM_OTF(rawObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (raw == NULL) {
+        return NULL;
+    }
+    PyObject *result = frame_array(out, PyArray_NDIM(raw), PyArray_DIMS(raw), typenum);
+    if (result == NULL) {
+        Py_DECREF(raw);
+        return NULL;
+    }
+
+    const uint16_t *rawData = (const uint16_t *) PyArray_DATA(raw);
+    void *outData = PyArray_DATA((PyArrayObject *) result);
+    size_t n = (size_t) PyArray_SIZE(raw);
+    Py_BEGIN_ALLOW_THREADS
+    convert_to_celsius(rawData, outData, n, typenum, scale);
+    Py_END_ALLOW_THREADS
+
+    Py_DECREF(raw);
+    return result;
+}
+
+static PyMethodDef convert_methods[] = {
+    { "set_temperature_decimals",   (PyCFunction) set_temperature_decimals,     METH_VARARGS, nullptr },
+    { "get_temperature_decimals",   (PyCFunction) get_temperature_decimals,     METH_NOARGS, nullptr },
+    { "raw_to_celsius",             (PyCFunction) raw_to_celsius,               METH_VARARGS | METH_KEYWORDS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+int add_convert_functions(PyObject *module) {
+    return PyModule_AddFunctions(module, convert_methods);
+}
@@ -0,0 +1,369 @@
+#include "_pyoptris.h"
+
+#include "radiometry.h"
+
+#include <map>
+#include <string>
+
+using pyoptris::RadiometricCorrection;
+
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<const RadiometricCorrection> *correction;
+} CorrectionObject;
+
+static PyTypeObject CorrectionType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+// Named profiles and the one applied by default, only touched while holding the GIL
+static std::map<std::string, std::shared_ptr<const RadiometricCorrection>> profiles;
+static std::string activeProfile;
+
+/**
+ * @brief Parses an emissivity or transmissivity argument, a number or a 2D map of values in (0, 1]
+ * @param[out] map new reference to a float32 array, NULL for a number
+ * @return 0 on success, -1 with an exception set otherwise
+ */
+static int parse_map(PyObject *object, const char *name, PyArrayObject *&map, float &value) {
+    map = NULL;
+    if (PyFloat_Check(object) || PyLong_Check(object)) {
+        value = (float) PyFloat_AsDouble(object);
+        if (value == -1.0f && PyErr_Occurred()) {
+            return -1;
+        }
+        if (!(value > 0.0f && value <= 1.0f)) {
+            PyErr_Format(PyExc_ValueError, "%s must be in (0, 1]", name);
+            return -1;
+        }
+        return 0;
+    }
+    map = (PyArrayObject *) PyArray_FROM_OTF(object, NPY_FLOAT32, NPY_ARRAY_IN_ARRAY);
+    if (map == NULL) {
+        return -1;
+    }
+    if (PyArray_NDIM(map) != 2) {
+        PyErr_Format(PyExc_ValueError, "%s must be a number or an (h, w) array", name);
+        Py_CLEAR(map);
+        return -1;
+    }
+    const float *values = (const float *) PyArray_DATA(map);
+    for (npy_intp i = 0; i < PyArray_SIZE(map); i++) {
+        if (!(values[i] > 0.0f && values[i] <= 1.0f)) {
+            PyErr_Format(PyExc_ValueError, "%s must be in (0, 1] everywhere", name);
+            Py_CLEAR(map);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Correction(emissivity, transmissivity=1.0, ambient=20.0, reflected=None, size=None)
+ * Radiometric correction with per-pixel emissivity and transmissivity. Both are numbers or (h, w)
+ * arrays, size=(width, height) is needed when neither is an array. ambient is the temperature of the
+ * atmosphere between camera and object, reflected that of the surroundings the object mirrors
+ * (ambient if None), both in degrees Celsius.
+ */
+static PyObject *Correction_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "emissivity", "transmissivity", "ambient", "reflected", "size", nullptr };
+    PyObject *emissivityObject;
+    PyObject *transmissivityObject = NULL;
+    float ambient = 20.0f;
+    PyObject *reflectedObject = Py_None;
+    PyObject *sizeObject = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OfOO", (char **) keywords, &emissivityObject, &transmissivityObject,
+                                     &ambient, &reflectedObject, &sizeObject)) {
+        return NULL;
+    }
+    float reflected = ambient;
+    if (reflectedObject != Py_None) {
+        reflected = (float) PyFloat_AsDouble(reflectedObject);
+        if (reflected == -1.0f && PyErr_Occurred()) {
+            return NULL;
+        }
+    }
+
+    PyArrayObject *emissivityMap, *transmissivityMap = NULL;
+    float emissivity, transmissivity = 1.0f;
+    if (parse_map(emissivityObject, "emissivity", emissivityMap, emissivity) < 0) {
+        return NULL;
+    }
+    if (transmissivityObject != NULL && parse_map(transmissivityObject, "transmissivity", transmissivityMap, transmissivity) < 0) {
+        Py_XDECREF(emissivityMap);
+        return NULL;
+    }
+
+    int width = 0, height = 0;
+    const char *error = nullptr;
+    PyArrayObject *shaped = emissivityMap != NULL ? emissivityMap : transmissivityMap;
+    if (shaped != NULL) {
+        width = (int) PyArray_DIM(shaped, 1);
+        height = (int) PyArray_DIM(shaped, 0);
+    }
+    if (emissivityMap != NULL && transmissivityMap != NULL
+            && (PyArray_DIM(transmissivityMap, 0) != height || PyArray_DIM(transmissivityMap, 1) != width)) {
+        error = "emissivity and transmissivity maps differ in shape";
+    } else if (sizeObject != Py_None) {
+        int w, h;
+        if (!PyArg_ParseTuple(sizeObject, "ii", &w, &h)) {
+            error = "size must be (width, height)";
+        } else if (shaped != NULL && (w != width || h != height)) {
+            error = "size does not match the maps";
+        } else {
+            width = w;
+            height = h;
+        }
+    } else if (shaped == NULL) {
+        error = "size is required unless emissivity or transmissivity is a map";
+    }
+    if (error == nullptr && (width <= 0 || height <= 0)) {
+        error = "size must be positive";
+    }
+    if (error != nullptr) {
+        PyErr_Clear();
+        PyErr_SetString(PyExc_ValueError, error);
+        Py_XDECREF(emissivityMap);
+        Py_XDECREF(transmissivityMap);
+        return NULL;
+    }
+
+    const float *emissivityData = emissivityMap != NULL ? (const float *) PyArray_DATA(emissivityMap) : nullptr;
+    const float *transmissivityData = transmissivityMap != NULL ? (const float *) PyArray_DATA(transmissivityMap) : nullptr;
+    std::shared_ptr<const RadiometricCorrection> correction;
+    Py_BEGIN_ALLOW_THREADS
+    correction = std::make_shared<RadiometricCorrection>(width, height, emissivityData, emissivity,
+                                                         transmissivityData, transmissivity, ambient, reflected);
+    Py_END_ALLOW_THREADS
+    Py_XDECREF(emissivityMap);
+    Py_XDECREF(transmissivityMap);
+
+    CorrectionObject *self = (CorrectionObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->correction = new std::shared_ptr<const RadiometricCorrection>(correction);
+    return (PyObject *) self;
+}
+
+static void Correction_dealloc(CorrectionObject *self) {
+    delete self->correction;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+int resolve_correction(PyObject *profile, int width, int height, int typenum, std::shared_ptr<const RadiometricCorrection> &correction) {
+    correction = nullptr;
+    if (profile == Py_None) {
+        if (activeProfile.empty()) {
+            return 0;
+        }
+        correction = profiles[activeProfile];
+    } else if (PyObject_TypeCheck(profile, &CorrectionType)) {
+        correction = *((CorrectionObject *) profile)->correction;
+    } else {
+        const char *name = PyUnicode_AsUTF8(profile);
+        if (name == NULL) {
+            return -1;
+        }
+        auto found = profiles.find(name);
+        if (found == profiles.end()) {
+            PyErr_Format(PyExc_KeyError, "no correction profile named '%s'", name);
+            return -1;
+        }
+        correction = found->second;
+    }
+    if (correction->width() != width || correction->height() != height) {
+        PyErr_Format(PyExc_ValueError, "correction is %dx%d, frames are %dx%d", correction->width(), correction->height(), width, height);
+        correction = nullptr;
+        return -1;
+    }
+    if (typenum != NPY_FLOAT32) {
+        PyErr_SetString(PyExc_TypeError, "corrected temperatures are float32");
+        correction = nullptr;
+        return -1;
+    }
+    return 0;
+}
+
+void correct_to_celsius(const uint16_t *raw, void *out, size_t n, int typenum, pyoptris::TemperatureScale scale,
+                        const std::shared_ptr<const RadiometricCorrection> &correction) {
+    if (correction != nullptr) {
+        int64_t before = pyoptris::steady_now_ns();
+        correction->apply(raw, static_cast<float *>(out), scale);
+        pyoptris::pipeline_statistics().conversion.record(pyoptris::steady_now_ns() - before);
+    } else {
+        convert_to_celsius(raw, out, n, typenum, scale);
+    }
+}
+
+/**
+ * @brief apply(raw, out=None, decimals=None) -> corrected float32 degrees Celsius of an (h, w) raw frame
+ */
+static PyObject *Correction_apply(CorrectionObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "raw", "out", "decimals", nullptr };
+    PyObject *rawObject;
+    PyObject *out = Py_None;
+    PyObject *decimalsObject = Py_None;
+    pyoptris::TemperatureScale scale;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OO", (char **) keywords, &rawObject, &out, &decimalsObject)
+            || parse_temperature_scale(decimalsObject, scale) < 0) {
+        return NULL;
+    }
+    std::shared_ptr<const RadiometricCorrection> correction = *self->correction;
+    PyArrayObject *raw = (PyArrayObject *) PyArray_FROM_OTF(rawObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (raw == NULL) {
+        return NULL;
+    }
+    if (PyArray_NDIM(raw) != 2 || PyArray_DIM(raw, 0) != correction->height() || PyArray_DIM(raw, 1) != correction->width()) {
+        PyErr_Format(PyExc_ValueError, "raw must be a (%d, %d) frame", correction->height(), correction->width());
+        Py_DECREF(raw);
+        return NULL;
+    }
+    PyObject *result = frame_array(out, 2, PyArray_DIMS(raw), NPY_FLOAT32);
+    if (result == NULL) {
+        Py_DECREF(raw);
+        return NULL;
+    }
+    const uint16_t *rawData = (const uint16_t *) PyArray_DATA(raw);
+    float *outData = (float *) PyArray_DATA((PyArrayObject *) result);
+    size_t n = (size_t) PyArray_SIZE(raw);
+    Py_BEGIN_ALLOW_THREADS
+    correct_to_celsius(rawData, outData, n, NPY_FLOAT32, scale, correction);
+    Py_END_ALLOW_THREADS
+    Py_DECREF(raw);
+    return result;
+}
+
+static PyObject *Correction_get_size(CorrectionObject *self, void *) {
+    return Py_BuildValue("ii", (*self->correction)->width(), (*self->correction)->height());
+}
+
+static PyObject *Correction_get_ambient(CorrectionObject *self, void *) {
+    return PyFloat_FromDouble((*self->correction)->ambient());
+}
+
+static PyObject *Correction_get_reflected(CorrectionObject *self, void *) {
+    return PyFloat_FromDouble((*self->correction)->reflected());
+}
+
+static PyMethodDef Correction_methods[] = {
+    { "apply",      (PyCFunction) Correction_apply,     METH_VARARGS | METH_KEYWORDS, "apply(raw, out=None, decimals=None) -> corrected float32 degrees Celsius" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Correction_getset[] = {
+    { "size",       (getter) Correction_get_size,       nullptr, "(width, height) of the frames it applies to", nullptr },
+    { "ambient",    (getter) Correction_get_ambient,    nullptr, "Atmosphere temperature in degrees Celsius", nullptr },
+    { "reflected",  (getter) Correction_get_reflected,  nullptr, "Reflected temperature in degrees Celsius", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+/**
+ * @brief add_correction_profile(name, correction), replaces a profile of the same name
+ */
+PyObject * add_correction_profile(PyObject *, PyObject *args) {
+    const char *name;
+    PyObject *correction;
+    if (!PyArg_ParseTuple(args, "sO!", &name, &CorrectionType, &correction)) {
+        return NULL;
+    }
+    if (name[0] == '\0') {
+        PyErr_SetString(PyExc_ValueError, "name must not be empty");
+        return NULL;
+    }
+    profiles[name] = *((CorrectionObject *) correction)->correction;
+    Py_RETURN_NONE;
+}
+
+PyObject * remove_correction_profile(PyObject *, PyObject *args) {
+    const char *name;
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        return NULL;
+    }
+    if (profiles.erase(name) == 0) {
+        PyErr_Format(PyExc_KeyError, "no correction profile named '%s'", name);
+        return NULL;
+    }
+    if (activeProfile == name) {
+        activeProfile.clear();
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief correction_profiles() -> sorted list of the profile names
+ */
+PyObject * correction_profiles(PyObject *, PyObject *) {
+    PyObject *names = PyList_New(0);
+    if (names == NULL) {
+        return NULL;
+    }
+    for (auto &profile : profiles) {
+        PyObject *name = PyUnicode_FromString(profile.first.c_str());
+        if (name == NULL || PyList_Append(names, name) < 0) {
+            Py_XDECREF(name);
+            Py_DECREF(names);
+            return NULL;
+        }
+        Py_DECREF(name);
+    }
+    return names;
+}
+
+/**
+ * @brief set_correction_profile(name), the profile get_temperature_image applies unless told otherwise, None for none
+ */
+PyObject * set_correction_profile(PyObject *, PyObject *args) {
+    PyObject *nameObject;
+    if (!PyArg_ParseTuple(args, "O", &nameObject)) {
+        return NULL;
+    }
+    if (nameObject == Py_None) {
+        activeProfile.clear();
+        Py_RETURN_NONE;
+    }
+    const char *name = PyUnicode_AsUTF8(nameObject);
+    if (name == NULL) {
+        return NULL;
+    }
+    if (profiles.find(name) == profiles.end()) {
+        PyErr_Format(PyExc_KeyError, "no correction profile named '%s'", name);
+        return NULL;
+    }
+    activeProfile = name;
+    Py_RETURN_NONE;
+}
+
+PyObject * get_correction_profile(PyObject *, PyObject *) {
+    if (activeProfile.empty()) {
+        Py_RETURN_NONE;
+    }
+    return PyUnicode_FromString(activeProfile.c_str());
+}
+
+static PyMethodDef correction_methods[] = {
+    { "add_correction_profile",     (PyCFunction) add_correction_profile,       METH_VARARGS, nullptr },
+    { "remove_correction_profile",  (PyCFunction) remove_correction_profile,    METH_VARARGS, nullptr },
+    { "correction_profiles",        (PyCFunction) correction_profiles,          METH_NOARGS, nullptr },
+    { "set_correction_profile",     (PyCFunction) set_correction_profile,       METH_VARARGS, nullptr },
+    { "get_correction_profile",     (PyCFunction) get_correction_profile,       METH_NOARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+int add_correction_types(PyObject *module) {
+    CorrectionType.tp_name = "pyoptris.Correction";
+    CorrectionType.tp_basicsize = sizeof(CorrectionObject);
+    CorrectionType.tp_flags = Py_TPFLAGS_DEFAULT;
+    CorrectionType.tp_doc = "Correction(emissivity, transmissivity=1.0, ambient=20.0, reflected=None, size=None): per-pixel radiometric correction";
+    CorrectionType.tp_new = Correction_new;
+    CorrectionType.tp_dealloc = (destructor) Correction_dealloc;
+    CorrectionType.tp_methods = Correction_methods;
+    CorrectionType.tp_getset = Correction_getset;
+    if (PyType_Ready(&CorrectionType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&CorrectionType);
+    if (PyModule_AddObject(module, "Correction", (PyObject *) &CorrectionType) < 0) {
+        Py_DECREF(&CorrectionType);
+        return -1;
+    }
+    return PyModule_AddFunctions(module, correction_methods);
+}
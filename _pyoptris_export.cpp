@@ -0,0 +1,549 @@
+#include "_pyoptris.h"
+
+#include "exporter.h"
+#include "workers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using pyoptris::Capture;
+using pyoptris::ExportJob;
+using pyoptris::ExportOptions;
+using pyoptris::Exporter;
+
+static const size_t DEFAULT_CAPACITY = 256;
+
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<Exporter> *exporter;    // nullptr once closed
+} ExporterObject;
+
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<ExportJob> *job;
+} ExportJobObject;
+
+static PyTypeObject ExporterType = { PyVarObject_HEAD_INIT(NULL, 0) };
+static PyTypeObject ExportJobType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+/**
+ * @brief Exporter behind save_palette_to_png, started on first use
+ */
+static std::shared_ptr<Exporter> default_exporter() {
+    static std::mutex mutex;
+    static std::shared_ptr<Exporter> exporter;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (exporter == nullptr) {
+        exporter = std::make_shared<Exporter>(std::min(4, pyoptris::default_worker_threads()), DEFAULT_CAPACITY);
+    }
+    return exporter;
+}
+
+static PyObject *new_export_job(const std::shared_ptr<ExportJob> &job) {
+    ExportJobObject *self = (ExportJobObject *) ExportJobType.tp_alloc(&ExportJobType, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->job = new std::shared_ptr<ExportJob>(job);
+    return (PyObject *) self;
+}
+
+/**
+ * @brief Parses the format, palette, scaling, t_min, t_max and compression arguments shared by every submission
+ * @return 0 on success, -1 with an exception set otherwise
+ */
+static int parse_export_options(int format, int palette, int scaling, PyObject *tMin, PyObject *tMax, int compression, ExportOptions &options) {
+    if (format < pyoptris::EXPORT_PALETTE_PNG || format > pyoptris::EXPORT_RAW_TIFF) {
+        PyErr_SetString(PyExc_ValueError, "format must be EXPORT_PALETTE_PNG, EXPORT_RAW_PNG or EXPORT_RAW_TIFF");
+        return -1;
+    }
+    if (pyoptris::palette_lut(palette) == nullptr) {
+        PyErr_SetString(PyExc_ValueError, "Unknown palette");
+        return -1;
+    }
+    if (scaling < pyoptris::SCALING_MANUAL || scaling > pyoptris::SCALING_SIGMA3) {
+        PyErr_SetString(PyExc_ValueError, "Unknown palette scaling method");
+        return -1;
+    }
+    if (compression < 0 || compression > 9) {
+        PyErr_SetString(PyExc_ValueError, "compression must be in [0, 9]");
+        return -1;
+    }
+    options.format = (pyoptris::ExportFormat) format;
+    options.palette = palette;
+    options.scaling = (pyoptris::PaletteScaling) scaling;
+    options.compression = compression;
+    if (format != pyoptris::EXPORT_PALETTE_PNG) {
+        options.manual = { 0, 0 };
+        return 0;
+    }
+    return parse_manual_range(scaling, tMin, tMax, options.manual);
+}
+
+/**
+ * @brief Converts str, bytes and os.PathLike paths to the file system encoding
+ */
+static int path_string(PyObject *pathObject, std::string &path) {
+    PyObject *bytes = NULL;
+    if (!PyUnicode_FSConverter(pathObject, &bytes)) {
+        return -1;
+    }
+    path.assign(PyBytes_AS_STRING(bytes), (size_t) PyBytes_GET_SIZE(bytes));
+    Py_DECREF(bytes);
+    return 0;
+}
+
+/**
+ * @brief Copies frames (n, height, width) into exporter, waiting for room with the GIL released.
+ * Batches larger than the capacity are queued in capacity sized chunks as the threads catch up.
+ * @return new pyoptris.ExportJob, NULL with an exception set on failure; frames queued before a
+ * failure are still written
+ */
+static PyObject *submit_frames(const std::shared_ptr<Exporter> &exporter, PyArrayObject *frames, const std::vector<std::string> &paths,
+                               const ExportOptions &options, int64_t timeoutNs) {
+    size_t count = paths.size();
+    std::shared_ptr<ExportJob> job = std::make_shared<ExportJob>(count);
+    PyObject *jobObject = new_export_job(job);
+    if (jobObject == NULL) {
+        return NULL;
+    }
+    int height = (int) PyArray_DIM(frames, PyArray_NDIM(frames) - 2);
+    int width = (int) PyArray_DIM(frames, PyArray_NDIM(frames) - 1);
+    const uint16_t *data = (const uint16_t *) PyArray_DATA(frames);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t submitted = 0;
+    while (submitted < count) {
+        size_t chunk = std::min(count - submitted, exporter->capacity());
+        int64_t remainingNs = timeoutNs;
+        if (timeoutNs >= 0) {
+            int64_t elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            remainingNs = std::max<int64_t>(0, timeoutNs - elapsedNs);
+        }
+        int result = wait_released([&](int64_t slice) {
+            return exporter->reserve(chunk, slice) ? Capture::WAIT_FRAME : Capture::WAIT_TIMEOUT;
+        }, remainingNs);
+        if (result < 0) {
+            Py_DECREF(jobObject);
+            return NULL;
+        }
+        if (result == Capture::WAIT_TIMEOUT) {
+            PyErr_Format(PyExc_TimeoutError, "Export queue is full, %zu of %zu frames were submitted", submitted, count);
+            Py_DECREF(jobObject);
+            return NULL;
+        }
+        size_t end = submitted + chunk;
+        Py_BEGIN_ALLOW_THREADS
+        for (; submitted < end; submitted++) {
+            if (!exporter->submit(job, data + submitted * width * height, width, height, paths[submitted], options)) {
+                break;
+            }
+        }
+        Py_END_ALLOW_THREADS
+        if (submitted < end) {
+            // submit() released the room of the failed frame, the rest of the chunk was never used
+            exporter->release(end - submitted - 1);
+            Py_DECREF(jobObject);
+            return PyErr_NoMemory();
+        }
+    }
+    return jobObject;
+}
+
+/**
+ * @brief Exporter(threads=2, capacity=256)
+ * Writes frames as PNG or TIFF files on native threads. Submissions copy the frames and return a
+ * pyoptris.ExportJob right away; when capacity frames are waiting, submissions wait for room.
+ */
+static PyObject *Exporter_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "threads", "capacity", nullptr };
+    int threads = 2;
+    Py_ssize_t capacity = (Py_ssize_t) DEFAULT_CAPACITY;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|in", (char **) keywords, &threads, &capacity)) {
+        return NULL;
+    }
+    if (threads < 1 || threads > 64) {
+        PyErr_SetString(PyExc_ValueError, "threads must be in [1, 64]");
+        return NULL;
+    }
+    if (capacity < 1) {
+        PyErr_SetString(PyExc_ValueError, "capacity must be positive");
+        return NULL;
+    }
+    std::shared_ptr<Exporter> *exporter = nullptr;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        exporter = new std::shared_ptr<Exporter>(std::make_shared<Exporter>(threads, (size_t) capacity));
+    } catch (const std::exception &) {
+    }
+    Py_END_ALLOW_THREADS
+    if (exporter == nullptr) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to start the export threads");
+        return NULL;
+    }
+    ExporterObject *self = (ExporterObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        delete exporter;
+        Py_END_ALLOW_THREADS
+        return NULL;
+    }
+    self->exporter = exporter;
+    return (PyObject *) self;
+}
+
+/**
+ * @brief Drops the exporter, the threads finish writing what is queued
+ */
+static void close_exporter(ExporterObject *self) {
+    std::shared_ptr<Exporter> *exporter = self->exporter;
+    self->exporter = nullptr;
+    Py_BEGIN_ALLOW_THREADS
+    delete exporter;
+    Py_END_ALLOW_THREADS
+}
+
+static void Exporter_dealloc(ExporterObject *self) {
+    close_exporter(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static std::shared_ptr<Exporter> open_exporter(ExporterObject *self) {
+    if (self->exporter == nullptr) {
+        PyErr_SetString(PyExc_RuntimeError, "Exporter is closed");
+        return nullptr;
+    }
+    return *self->exporter;
+}
+
+/**
+ * @brief submit(frame, path, format=EXPORT_PALETTE_PNG, palette=PALETTE_IRON, scaling=SCALING_MIN_MAX, t_min=None, t_max=None,
+ *               compression=6, timeout=None) -> pyoptris.ExportJob
+ * timeout limits the wait for room in seconds, TimeoutError if it passes, None waits as long as it takes.
+ */
+static PyObject *Exporter_submit(ExporterObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "frame", "path", "format", "palette", "scaling", "t_min", "t_max", "compression", "timeout", nullptr };
+    PyObject *frameObject, *pathObject;
+    int format = pyoptris::EXPORT_PALETTE_PNG, palette = pyoptris::PALETTE_IRON, scaling = pyoptris::SCALING_MIN_MAX, compression = 6;
+    PyObject *tMin = Py_None, *tMax = Py_None, *timeout = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|iiiOOiO", (char **) keywords, &frameObject, &pathObject, &format, &palette,
+                                     &scaling, &tMin, &tMax, &compression, &timeout)) {
+        return NULL;
+    }
+    std::shared_ptr<Exporter> exporter = open_exporter(self);
+    ExportOptions options;
+    int64_t timeoutNs;
+    std::vector<std::string> paths(1);
+    if (exporter == nullptr || parse_export_options(format, palette, scaling, tMin, tMax, compression, options) < 0
+            || parse_timeout(timeout, timeoutNs) < 0 || path_string(pathObject, paths[0]) < 0) {
+        return NULL;
+    }
+    PyArrayObject *frame = (PyArrayObject *) PyArray_FROM_OTF(frameObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (frame == NULL) {
+        return NULL;
+    }
+    if (PyArray_NDIM(frame) != 2) {
+        PyErr_SetString(PyExc_ValueError, "frame must be a 2-D thermal image");
+        Py_DECREF(frame);
+        return NULL;
+    }
+    PyObject *job = submit_frames(exporter, frame, paths, options, timeoutNs);
+    Py_DECREF(frame);
+    return job;
+}
+
+/**
+ * @brief submit_batch(frames, paths, format=EXPORT_PALETTE_PNG, ...) -> one pyoptris.ExportJob for every file
+ * frames is an (n, height, width) array or a sequence of n frames, paths a sequence of n paths.
+ */
+static PyObject *Exporter_submit_batch(ExporterObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "frames", "paths", "format", "palette", "scaling", "t_min", "t_max", "compression", "timeout", nullptr };
+    PyObject *framesObject, *pathsObject;
+    int format = pyoptris::EXPORT_PALETTE_PNG, palette = pyoptris::PALETTE_IRON, scaling = pyoptris::SCALING_MIN_MAX, compression = 6;
+    PyObject *tMin = Py_None, *tMax = Py_None, *timeout = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|iiiOOiO", (char **) keywords, &framesObject, &pathsObject, &format, &palette,
+                                     &scaling, &tMin, &tMax, &compression, &timeout)) {
+        return NULL;
+    }
+    std::shared_ptr<Exporter> exporter = open_exporter(self);
+    ExportOptions options;
+    int64_t timeoutNs;
+    if (exporter == nullptr || parse_export_options(format, palette, scaling, tMin, tMax, compression, options) < 0
+            || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+    PyObject *pathSequence = PySequence_Fast(pathsObject, "paths must be a sequence");
+    if (pathSequence == NULL) {
+        return NULL;
+    }
+    std::vector<std::string> paths((size_t) PySequence_Fast_GET_SIZE(pathSequence));
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (path_string(PySequence_Fast_GET_ITEM(pathSequence, (Py_ssize_t) i), paths[i]) < 0) {
+            Py_DECREF(pathSequence);
+            return NULL;
+        }
+    }
+    Py_DECREF(pathSequence);
+    PyArrayObject *frames = (PyArrayObject *) PyArray_FROM_OTF(framesObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (frames == NULL) {
+        return NULL;
+    }
+    if (PyArray_NDIM(frames) != 3 || (size_t) PyArray_DIM(frames, 0) != paths.size()) {
+        PyErr_SetString(PyExc_ValueError, "frames must hold one 2-D thermal image per path");
+        Py_DECREF(frames);
+        return NULL;
+    }
+    PyObject *job = submit_frames(exporter, frames, paths, options, timeoutNs);
+    Py_DECREF(frames);
+    return job;
+}
+
+/**
+ * @brief wait(timeout=None) -> True once every frame submitted so far was written, False on timeout
+ */
+static PyObject *Exporter_wait(ExporterObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "timeout", nullptr };
+    PyObject *timeout = Py_None;
+    int64_t timeoutNs;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", (char **) keywords, &timeout) || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+    std::shared_ptr<Exporter> exporter = open_exporter(self);
+    if (exporter == nullptr) {
+        return NULL;
+    }
+    int result = wait_released([&](int64_t slice) {
+        return exporter->drain(slice) ? Capture::WAIT_FRAME : Capture::WAIT_TIMEOUT;
+    }, timeoutNs);
+    if (result < 0) {
+        return NULL;
+    }
+    return PyBool_FromLong(result == Capture::WAIT_FRAME);
+}
+
+/**
+ * @brief Writes what is queued and stops the threads, further submissions raise
+ */
+static PyObject *Exporter_close(ExporterObject *self, PyObject *) {
+    close_exporter(self);
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief stats() -> dict of submitted, written, failed, bytes and pending
+ */
+static PyObject *Exporter_stats(ExporterObject *self, PyObject *) {
+    std::shared_ptr<Exporter> exporter = open_exporter(self);
+    if (exporter == nullptr) {
+        return NULL;
+    }
+    Exporter::Stats stats = exporter->stats();
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:n}",
+        "submitted", (unsigned long long) stats.submitted,
+        "written", (unsigned long long) stats.written,
+        "failed", (unsigned long long) stats.failed,
+        "bytes", (unsigned long long) stats.bytes,
+        "pending", (Py_ssize_t) stats.pending);
+}
+
+static PyObject *Exporter_get_threads(ExporterObject *self, void *) {
+    std::shared_ptr<Exporter> exporter = open_exporter(self);
+    return exporter == nullptr ? NULL : PyLong_FromLong(exporter->threads());
+}
+
+static PyObject *Exporter_get_capacity(ExporterObject *self, void *) {
+    std::shared_ptr<Exporter> exporter = open_exporter(self);
+    return exporter == nullptr ? NULL : PyLong_FromSize_t(exporter->capacity());
+}
+
+static PyMethodDef Exporter_methods[] = {
+    { "submit",       (PyCFunction) Exporter_submit,       METH_VARARGS | METH_KEYWORDS, "submit(frame, path, format=EXPORT_PALETTE_PNG, ...) -> ExportJob" },
+    { "submit_batch", (PyCFunction) Exporter_submit_batch, METH_VARARGS | METH_KEYWORDS, "submit_batch(frames, paths, format=EXPORT_PALETTE_PNG, ...) -> ExportJob" },
+    { "wait",         (PyCFunction) Exporter_wait,         METH_VARARGS | METH_KEYWORDS, "wait(timeout=None) -> True once everything submitted was written" },
+    { "close",        (PyCFunction) Exporter_close,        METH_NOARGS, "Writes what is queued and stops the threads" },
+    { "stats",        (PyCFunction) Exporter_stats,        METH_NOARGS, "stats() -> dict of submitted, written, failed, bytes and pending" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Exporter_getset[] = {
+    { "threads",  (getter) Exporter_get_threads,  nullptr, "Threads encoding and writing files", nullptr },
+    { "capacity", (getter) Exporter_get_capacity, nullptr, "Frames that can be queued or being written at a time", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+static void ExportJob_dealloc(ExportJobObject *self) {
+    delete self->job;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief wait(timeout=None) -> True once every file of the job was written or failed, False on timeout
+ */
+static PyObject *ExportJob_wait(ExportJobObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "timeout", nullptr };
+    PyObject *timeout = Py_None;
+    int64_t timeoutNs;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", (char **) keywords, &timeout) || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+    std::shared_ptr<ExportJob> job = *self->job;
+    int result = wait_released([&](int64_t slice) {
+        return job->wait(slice) ? Capture::WAIT_FRAME : Capture::WAIT_TIMEOUT;
+    }, timeoutNs);
+    if (result < 0) {
+        return NULL;
+    }
+    return PyBool_FromLong(result == Capture::WAIT_FRAME);
+}
+
+/**
+ * @brief result(timeout=None) -> None once every file was written, RuntimeError listing the files that failed
+ */
+static PyObject *ExportJob_result(ExportJobObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *done = ExportJob_wait(self, args, kwargs);
+    if (done == NULL) {
+        return NULL;
+    }
+    bool finished = done == Py_True;
+    Py_DECREF(done);
+    if (!finished) {
+        PyErr_SetString(PyExc_TimeoutError, "Export job is not done");
+        return NULL;
+    }
+    std::vector<std::string> errors = (*self->job)->errors();
+    if (!errors.empty()) {
+        std::string message = std::to_string(errors.size()) + " of " + std::to_string((*self->job)->files()) + " files failed: " + errors[0];
+        PyErr_SetString(PyExc_RuntimeError, message.c_str());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *ExportJob_done(ExportJobObject *self, PyObject *) {
+    return PyBool_FromLong((*self->job)->remaining() == 0);
+}
+
+static PyObject *ExportJob_get_files(ExportJobObject *self, void *) {
+    return PyLong_FromSize_t((*self->job)->files());
+}
+
+static PyObject *ExportJob_get_remaining(ExportJobObject *self, void *) {
+    return PyLong_FromSize_t((*self->job)->remaining());
+}
+
+static PyObject *ExportJob_get_errors(ExportJobObject *self, void *) {
+    std::vector<std::string> errors = (*self->job)->errors();
+    PyObject *list = PyList_New((Py_ssize_t) errors.size());
+    if (list == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < errors.size(); i++) {
+        PyObject *error = PyUnicode_DecodeFSDefault(errors[i].c_str());
+        if (error == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, (Py_ssize_t) i, error);
+    }
+    return list;
+}
+
+static PyMethodDef ExportJob_methods[] = {
+    { "wait",   (PyCFunction) ExportJob_wait,   METH_VARARGS | METH_KEYWORDS, "wait(timeout=None) -> True once every file was written or failed" },
+    { "result", (PyCFunction) ExportJob_result, METH_VARARGS | METH_KEYWORDS, "result(timeout=None), raises if a file failed" },
+    { "done",   (PyCFunction) ExportJob_done,   METH_NOARGS, "done() -> True once every file was written or failed" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef ExportJob_getset[] = {
+    { "files",     (getter) ExportJob_get_files,     nullptr, "Files of the submission", nullptr },
+    { "remaining", (getter) ExportJob_get_remaining, nullptr, "Files not written yet", nullptr },
+    { "errors",    (getter) ExportJob_get_errors,    nullptr, "'path: reason' of every file that failed", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+/**
+ * @brief save_palette_to_png(thermal, path, palette=PALETTE_IRON, scaling=SCALING_MIN_MAX, t_min=None, t_max=None, compression=6)
+ * Colours a raw thermal frame and writes it as PNG on the module's export threads, like
+ * evo_irimager_to_palette_save_png but without blocking. Returns a pyoptris.ExportJob.
+ */
+static PyObject *save_palette_to_png(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "thermal", "path", "palette", "scaling", "t_min", "t_max", "compression", nullptr };
+    PyObject *frameObject, *pathObject;
+    int palette = pyoptris::PALETTE_IRON, scaling = pyoptris::SCALING_MIN_MAX, compression = 6;
+    PyObject *tMin = Py_None, *tMax = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|iiOOi", (char **) keywords, &frameObject, &pathObject, &palette, &scaling,
+                                     &tMin, &tMax, &compression)) {
+        return NULL;
+    }
+    ExportOptions options;
+    std::vector<std::string> paths(1);
+    if (parse_export_options(pyoptris::EXPORT_PALETTE_PNG, palette, scaling, tMin, tMax, compression, options) < 0
+            || path_string(pathObject, paths[0]) < 0) {
+        return NULL;
+    }
+    PyArrayObject *frame = (PyArrayObject *) PyArray_FROM_OTF(frameObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (frame == NULL) {
+        return NULL;
+    }
+    if (PyArray_NDIM(frame) != 2) {
+        PyErr_SetString(PyExc_ValueError, "thermal must be a 2-D thermal image");
+        Py_DECREF(frame);
+        return NULL;
+    }
+    std::shared_ptr<Exporter> exporter;
+    Py_BEGIN_ALLOW_THREADS
+    exporter = default_exporter();
+    Py_END_ALLOW_THREADS
+    PyObject *job = submit_frames(exporter, frame, paths, options, -1);
+    Py_DECREF(frame);
+    return job;
+}
+
+static PyMethodDef export_methods[] = {
+    { "save_palette_to_png", (PyCFunction) save_palette_to_png, METH_VARARGS | METH_KEYWORDS,
+      "save_palette_to_png(thermal, path, palette=PALETTE_IRON, scaling=SCALING_MIN_MAX, t_min=None, t_max=None, compression=6) -> ExportJob" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+int add_export_types(PyObject *module) {
+    ExporterType.tp_name = "pyoptris.Exporter";
+    ExporterType.tp_basicsize = sizeof(ExporterObject);
+    ExporterType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ExporterType.tp_doc = "Exporter(threads=2, capacity=256): writes PNG and TIFF files of frames on native threads";
+    ExporterType.tp_new = Exporter_new;
+    ExporterType.tp_dealloc = (destructor) Exporter_dealloc;
+    ExporterType.tp_methods = Exporter_methods;
+    ExporterType.tp_getset = Exporter_getset;
+
+    ExportJobType.tp_name = "pyoptris.ExportJob";
+    ExportJobType.tp_basicsize = sizeof(ExportJobObject);
+    ExportJobType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ExportJobType.tp_doc = "Completion of the files of one Exporter submission";
+    ExportJobType.tp_dealloc = (destructor) ExportJob_dealloc;
+    ExportJobType.tp_methods = ExportJob_methods;
+    ExportJobType.tp_getset = ExportJob_getset;
+
+    if (PyType_Ready(&ExporterType) < 0 || PyType_Ready(&ExportJobType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&ExporterType);
+    if (PyModule_AddObject(module, "Exporter", (PyObject *) &ExporterType) < 0) {
+        Py_DECREF(&ExporterType);
+        return -1;
+    }
+    Py_INCREF(&ExportJobType);
+    if (PyModule_AddObject(module, "ExportJob", (PyObject *) &ExportJobType) < 0) {
+        Py_DECREF(&ExportJobType);
+        return -1;
+    }
+    if (PyModule_AddIntConstant(module, "EXPORT_PALETTE_PNG", pyoptris::EXPORT_PALETTE_PNG) < 0
+            || PyModule_AddIntConstant(module, "EXPORT_RAW_PNG", pyoptris::EXPORT_RAW_PNG) < 0
+            || PyModule_AddIntConstant(module, "EXPORT_RAW_TIFF", pyoptris::EXPORT_RAW_TIFF) < 0) {
+        return -1;
+    }
+    return PyModule_AddFunctions(module, export_methods);
+}
@@ -0,0 +1,204 @@
+#include "_pyoptris.h"
+
+#include "formats.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using pyoptris::FormatChannel;
+using pyoptris::RawFormat;
+
+// Formats are immutable once loaded, so they are shared between objects and used without a lock
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<const RawFormat> *format;
+} RawFormatObject;
+
+static PyTypeObject RawFormatType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+static void RawFormat_dealloc(RawFormatObject *self) {
+    delete self->format;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief unpack(packets, channel=0, out=None, metadata_out=None) -> (frames, metadata)
+ * packets holds n raw frames of the In size, e.g. bytes read from a capture file or a (n, height, width)
+ * uint16 array. Returns the (n * subframes, height, width) thermal frames of the channel and their
+ * (n * subframes, metadata_words) metadata, in packet order.
+ */
+static PyObject *RawFormat_unpack(RawFormatObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "packets", "channel", "out", "metadata_out", nullptr };
+    Py_buffer packets;
+    int channelIndex = 0;
+    PyObject *out = Py_None, *metadataOut = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*|iOO", (char **) keywords, &packets, &channelIndex, &out, &metadataOut)) {
+        return NULL;
+    }
+    const RawFormat &format = **self->format;
+    if (channelIndex < 0 || channelIndex >= (int) format.channels.size()) {
+        PyBuffer_Release(&packets);
+        PyErr_Format(PyExc_ValueError, "channel must be in [0, %d]", (int) format.channels.size() - 1);
+        return NULL;
+    }
+    size_t packetBytes = format.packet_words() * sizeof(uint16_t);
+    if (packets.len == 0 || (size_t) packets.len % packetBytes != 0) {
+        PyBuffer_Release(&packets);
+        PyErr_Format(PyExc_ValueError, "packets must hold a positive multiple of %zu bytes", packetBytes);
+        return NULL;
+    }
+    size_t count = (size_t) packets.len / packetBytes;
+    const FormatChannel &channel = format.channels[channelIndex];
+    npy_intp subframes = (npy_intp) (count * channel.subframes);
+    npy_intp frameDimensions[3] = { subframes, channel.height, channel.width };
+    npy_intp metadataDimensions[2] = { subframes, (npy_intp) channel.metadataWords };
+    PyObject *frames = frame_array(out, 3, frameDimensions, NPY_UINT16);
+    if (frames == NULL) {
+        PyBuffer_Release(&packets);
+        return NULL;
+    }
+    PyObject *metadata = metadataOut == Py_None ? PyArray_SimpleNew(2, metadataDimensions, NPY_UINT16)
+                                                : frame_array(metadataOut, 2, metadataDimensions, NPY_UINT16);
+    if (metadata == NULL) {
+        Py_DECREF(frames);
+        PyBuffer_Release(&packets);
+        return NULL;
+    }
+
+    uint16_t *frameData = (uint16_t *) PyArray_DATA((PyArrayObject *) frames);
+    uint16_t *metadataData = (uint16_t *) PyArray_DATA((PyArrayObject *) metadata);
+    Py_BEGIN_ALLOW_THREADS
+    pyoptris::unpack_packets(channel, format.packet_words(), (const uint16_t *) packets.buf, count, frameData, metadataData);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&packets);
+
+    PyObject *result = PyTuple_Pack(2, frames, metadata);
+    Py_DECREF(frames);
+    Py_DECREF(metadata);
+    return result;
+}
+
+static PyObject *RawFormat_get_guid(RawFormatObject *self, void *) {
+    return PyUnicode_FromString((*self->format)->guid.c_str());
+}
+
+static PyObject *RawFormat_get_name(RawFormatObject *self, void *) {
+    return PyUnicode_FromString((*self->format)->name.c_str());
+}
+
+static PyObject *RawFormat_get_hw_rev(RawFormatObject *self, void *) {
+    return Py_BuildValue("ii", (*self->format)->hwRev[0], (*self->format)->hwRev[1]);
+}
+
+static PyObject *RawFormat_get_fw_rev(RawFormatObject *self, void *) {
+    return Py_BuildValue("ii", (*self->format)->fwRev[0], (*self->format)->fwRev[1]);
+}
+
+static PyObject *RawFormat_get_size(RawFormatObject *self, void *) {
+    return Py_BuildValue("ii", (*self->format)->width, (*self->format)->height);
+}
+
+static PyObject *RawFormat_get_rate(RawFormatObject *self, void *) {
+    return PyLong_FromLong((*self->format)->rate);
+}
+
+static PyObject *RawFormat_get_channels(RawFormatObject *self, void *) {
+    const std::vector<FormatChannel> &channels = (*self->format)->channels;
+    PyObject *list = PyList_New((Py_ssize_t) channels.size());
+    if (list == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < channels.size(); i++) {
+        const FormatChannel &channel = channels[i];
+        PyObject *entry = Py_BuildValue("{s:(ii),s:i,s:i,s:n}", "size", channel.width, channel.height, "rate", channel.rate,
+                                        "subframes", channel.subframes, "metadata_words", (Py_ssize_t) channel.metadataWords);
+        if (entry == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, (Py_ssize_t) i, entry);
+    }
+    return list;
+}
+
+static PyMethodDef RawFormat_methods[] = {
+    { "unpack", (PyCFunction) RawFormat_unpack, METH_VARARGS | METH_KEYWORDS,
+      "unpack(packets, channel=0, out=None, metadata_out=None) -> (frames, metadata)" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef RawFormat_getset[] = {
+    { "guid",       (getter) RawFormat_get_guid,        nullptr, "Guid of the format, as in Formats.def", nullptr },
+    { "name",       (getter) RawFormat_get_name,        nullptr, "Name of the format", nullptr },
+    { "hw_rev",     (getter) RawFormat_get_hw_rev,      nullptr, "(first, last) hardware revision of the format", nullptr },
+    { "fw_rev",     (getter) RawFormat_get_fw_rev,      nullptr, "(first, last) firmware revision of the format", nullptr },
+    { "size",       (getter) RawFormat_get_size,        nullptr, "(width, height) of a raw packet in 16 bit words", nullptr },
+    { "rate",       (getter) RawFormat_get_rate,        nullptr, "Packets per second", nullptr },
+    { "channels",   (getter) RawFormat_get_channels,    nullptr, "size, rate, subframes and metadata_words of every image stream", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+/**
+ * @brief load_formats(path) -> list of pyoptris.RawFormat
+ * Parses Formats.def and compiles the frame layout of every format.
+ */
+static PyObject *load_formats(PyObject *, PyObject *args) {
+    PyObject *pathBytes;
+    if (!PyArg_ParseTuple(args, "O&", PyUnicode_FSConverter, &pathBytes)) {
+        return NULL;
+    }
+    std::string path(PyBytes_AS_STRING(pathBytes), (size_t) PyBytes_GET_SIZE(pathBytes));
+    Py_DECREF(pathBytes);
+
+    std::vector<RawFormat> formats;
+    std::string error;
+    bool loaded;
+    Py_BEGIN_ALLOW_THREADS
+    loaded = pyoptris::load_formats(path, formats, error);
+    Py_END_ALLOW_THREADS
+    if (!loaded) {
+        PyErr_SetString(PyExc_ValueError, error.c_str());
+        return NULL;
+    }
+
+    PyObject *list = PyList_New((Py_ssize_t) formats.size());
+    if (list == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < formats.size(); i++) {
+        RawFormatObject *format = (RawFormatObject *) RawFormatType.tp_alloc(&RawFormatType, 0);
+        if (format == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        format->format = new std::shared_ptr<const RawFormat>(std::make_shared<const RawFormat>(std::move(formats[i])));
+        PyList_SET_ITEM(list, (Py_ssize_t) i, (PyObject *) format);
+    }
+    return list;
+}
+
+static PyMethodDef formats_methods[] = {
+    { "load_formats", (PyCFunction) load_formats, METH_VARARGS, "load_formats(path) -> list of RawFormat" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+int add_formats_type(PyObject *module) {
+    RawFormatType.tp_name = "pyoptris.RawFormat";
+    RawFormatType.tp_basicsize = sizeof(RawFormatObject);
+    RawFormatType.tp_flags = Py_TPFLAGS_DEFAULT;
+    RawFormatType.tp_doc = "Frame layout of a Formats.def format, returned by load_formats(path)";
+    RawFormatType.tp_dealloc = (destructor) RawFormat_dealloc;
+    RawFormatType.tp_methods = RawFormat_methods;
+    RawFormatType.tp_getset = RawFormat_getset;
+
+    if (PyType_Ready(&RawFormatType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&RawFormatType);
+    if (PyModule_AddObject(module, "RawFormat", (PyObject *) &RawFormatType) < 0) {
+        Py_DECREF(&RawFormatType);
+        return -1;
+    }
+    return PyModule_AddFunctions(module, formats_methods);
+}
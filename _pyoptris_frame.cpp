@@ -0,0 +1,589 @@
+#include "_pyoptris.h"
+
+#include <cstring>
+
+using pyoptris::FrameInfo;
+using pyoptris::FramePool;
+using pyoptris::FrameStatistics;
+using pyoptris::PaletteRange;
+using pyoptris::PaletteScaling;
+using pyoptris::TemperatureScale;
+
+// DLPack ABI, see https://github.com/dmlc/dlpack/blob/main/include/dlpack/dlpack.h
+enum {
+    DL_CPU = 1,
+    DL_UINT = 1,
+    DL_FLAG_READ_ONLY = 1
+};
+
+struct DLDevice {
+    int32_t device_type;
+    int32_t device_id;
+};
+
+struct DLDataType {
+    uint8_t code;
+    uint8_t bits;
+    uint16_t lanes;
+};
+
+struct DLTensor {
+    void *data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t *shape;
+    int64_t *strides;
+    uint64_t byte_offset;
+};
+
+struct DLManagedTensor {
+    DLTensor dl_tensor;
+    void *manager_ctx;
+    void (*deleter)(DLManagedTensor *self);
+};
+
+struct DLPackVersion {
+    uint32_t major;
+    uint32_t minor;
+};
+
+struct DLManagedTensorVersioned {
+    DLPackVersion version;
+    void *manager_ctx;
+    void (*deleter)(DLManagedTensorVersioned *self);
+    uint64_t flags;
+    DLTensor dl_tensor;
+};
+
+/**
+ * @brief Raw frame and the products derived from it, each computed on first use.
+ * The raw pixels never change, so products are computed without the GIL into buffers of their own and
+ * published with the GIL held; a thread losing the race drops its copy. Every array handed out is read-only.
+ */
+struct FrameState {
+    FramePool::Buffer *raw;
+    int width;
+    int height;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+    TemperatureScale scale;
+    bool hasInfo;
+    FrameInfo info;
+
+    bool hasStatistics = false;
+    FrameStatistics statistics;
+    PyObject *celsius = NULL;
+    PyObject *palette = NULL;       // last rendered palette image
+    int paletteId = 0;
+    PaletteRange paletteRange = { 0, 0 };
+    PyObject *histogram = NULL;     // last (counts, edges)
+    Py_ssize_t histogramBins = 0;
+
+    ~FrameState() {
+        Py_XDECREF(celsius);
+        Py_XDECREF(palette);
+        Py_XDECREF(histogram);
+        FramePool::release(raw);
+    }
+};
+
+typedef struct {
+    PyObject_HEAD
+    FrameState *state;
+} FrameObject;
+
+static PyTypeObject FrameType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+static PyObject *alloc_frame(PyTypeObject *type, FramePool::Buffer *raw, int width, int height, const FrameInfo *info, TemperatureScale scale) {
+    FrameObject *self = (FrameObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        FramePool::release(raw);
+        return NULL;
+    }
+    FrameState *state = new FrameState();
+    state->raw = raw;
+    state->width = width;
+    state->height = height;
+    state->shape[0] = height;
+    state->shape[1] = width;
+    state->strides[0] = (Py_ssize_t) width * sizeof(uint16_t);
+    state->strides[1] = sizeof(uint16_t);
+    state->scale = scale;
+    state->hasInfo = info != nullptr;
+    if (info != nullptr) {
+        state->info = *info;
+    }
+    self->state = state;
+    return (PyObject *) self;
+}
+
+PyObject *new_frame(FramePool::Buffer *raw, int width, int height, const FrameInfo *info, TemperatureScale scale) {
+    return alloc_frame(&FrameType, raw, width, height, info, scale);
+}
+
+/**
+ * @brief Frame(raw, decimals=None)
+ * Frame of a raw (h, w) uint16 image you already have, the pixels are copied once into a pooled buffer.
+ * decimals=None uses the decimals set with set_temperature_decimals().
+ */
+static PyObject *Frame_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "raw", "decimals", nullptr };
+    PyObject *rawObject;
+    PyObject *decimals = Py_None;
+    TemperatureScale scale;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", (char **) keywords, &rawObject, &decimals) || parse_temperature_scale(decimals, scale) < 0) {
+        return NULL;
+    }
+    PyArrayObject *raw = (PyArrayObject *) PyArray_FROM_OTF(rawObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (raw == NULL) {
+        return NULL;
+    }
+    if (PyArray_NDIM(raw) != 2 || PyArray_DIM(raw, 0) < 1 || PyArray_DIM(raw, 1) < 1) {
+        Py_DECREF(raw);
+        PyErr_SetString(PyExc_ValueError, "raw must be a non-empty 2-D thermal image");
+        return NULL;
+    }
+    int height = (int) PyArray_DIM(raw, 0), width = (int) PyArray_DIM(raw, 1);
+    size_t bytes = (size_t) PyArray_NBYTES(raw);
+    FramePool::Buffer *buffer = frame_pool()->acquire(bytes);
+    if (buffer == nullptr) {
+        Py_DECREF(raw);
+        return PyErr_NoMemory();
+    }
+    const void *data = PyArray_DATA(raw);
+    Py_BEGIN_ALLOW_THREADS
+    std::memcpy(buffer->data, data, bytes);
+    Py_END_ALLOW_THREADS
+    Py_DECREF(raw);
+    return alloc_frame(type, buffer, width, height, nullptr, scale);
+}
+
+static void Frame_dealloc(FrameObject *self) {
+    delete self->state;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static size_t pixels(const FrameState *state) {
+    return (size_t) state->width * state->height;
+}
+
+/**
+ * @brief Caches a filled product as read-only, the slot keeps what is there already
+ * @param product reference stolen
+ * @return new reference to the cached product
+ */
+static PyObject *publish(PyObject *&slot, PyObject *product) {
+    PyArray_CLEARFLAGS((PyArrayObject *) product, NPY_ARRAY_WRITEABLE);
+    if (slot == NULL) {
+        slot = product;
+    } else {
+        Py_DECREF(product);     // another thread got there first
+    }
+    Py_INCREF(slot);
+    return slot;
+}
+
+/**
+ * @brief Caches a product, replacing the one in slot
+ * @param product reference stolen
+ * @return new reference to product
+ */
+static PyObject *replace(PyObject *&slot, PyObject *product) {
+    PyObject *previous = slot;
+    slot = product;
+    Py_XDECREF(previous);
+    Py_INCREF(product);
+    return product;
+}
+
+static const FrameStatistics &frame_statistics_of(FrameState *state) {
+    if (!state->hasStatistics) {
+        const uint16_t *raw = (const uint16_t *) state->raw->data;
+        size_t n = pixels(state);
+        FrameStatistics statistics;
+        Py_BEGIN_ALLOW_THREADS
+        statistics = pyoptris::frame_statistics(raw, n);
+        Py_END_ALLOW_THREADS
+        state->statistics = statistics;
+        state->hasStatistics = true;
+    }
+    return state->statistics;
+}
+
+static int Frame_getbuffer(FrameObject *self, Py_buffer *view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "Frame is read-only");
+        return -1;
+    }
+    FrameState *state = self->state;
+    view->buf = state->raw->data;
+    view->obj = (PyObject *) self;
+    Py_INCREF(self);
+    view->len = (Py_ssize_t) (pixels(state) * sizeof(uint16_t));
+    view->readonly = 1;
+    view->itemsize = sizeof(uint16_t);
+    view->format = (flags & PyBUF_FORMAT) ? (char *) "H" : NULL;
+    view->ndim = 2;
+    view->shape = (flags & PyBUF_ND) ? state->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) ? state->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static PyBufferProcs Frame_as_buffer = { (getbufferproc) Frame_getbuffer, NULL };
+
+// Shape and strides in elements live next to the tensor they describe
+template <typename Managed>
+struct DLPackExport {
+    Managed managed;
+    int64_t shape[2];
+    int64_t strides[2];
+};
+
+template <typename Managed>
+static void dlpack_deleter(Managed *managed) {
+    // Consumers may delete the tensor from any thread
+    PyGILState_STATE gil = PyGILState_Ensure();
+    Py_DECREF((PyObject *) managed->manager_ctx);
+    PyGILState_Release(gil);
+    delete (DLPackExport<Managed> *) managed;
+}
+
+template <typename Managed>
+static void fill_dltensor(DLPackExport<Managed> *tensor, FrameObject *self) {
+    FrameState *state = self->state;
+    tensor->shape[0] = state->height;
+    tensor->shape[1] = state->width;
+    tensor->strides[0] = state->width;
+    tensor->strides[1] = 1;
+    DLTensor &dl = tensor->managed.dl_tensor;
+    dl.data = state->raw->data;
+    dl.device = { DL_CPU, 0 };
+    dl.ndim = 2;
+    dl.dtype = { DL_UINT, 16, 1 };
+    dl.shape = tensor->shape;
+    dl.strides = tensor->strides;
+    dl.byte_offset = 0;
+    Py_INCREF(self);
+    tensor->managed.manager_ctx = self;
+    tensor->managed.deleter = dlpack_deleter<Managed>;
+}
+
+// A capsule still carrying its original name was never consumed and owns the tensor
+static void release_dltensor(PyObject *capsule) {
+    if (PyCapsule_IsValid(capsule, "dltensor")) {
+        DLManagedTensor *managed = (DLManagedTensor *) PyCapsule_GetPointer(capsule, "dltensor");
+        managed->deleter(managed);
+    }
+}
+
+static void release_dltensor_versioned(PyObject *capsule) {
+    if (PyCapsule_IsValid(capsule, "dltensor_versioned")) {
+        DLManagedTensorVersioned *managed = (DLManagedTensorVersioned *) PyCapsule_GetPointer(capsule, "dltensor_versioned");
+        managed->deleter(managed);
+    }
+}
+
+/**
+ * @brief __dlpack__(stream=None, max_version=None, dl_device=None, copy=None)
+ * Capsule sharing the raw pixels with e.g. numpy.from_dlpack or torch.from_dlpack without a copy.
+ * Consumers asking for DLPack 1.0 get a tensor flagged read-only; older ones must not write to it either.
+ */
+static PyObject *Frame_dlpack(FrameObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "stream", "max_version", "dl_device", "copy", nullptr };
+    PyObject *stream = Py_None, *maxVersion = Py_None, *device = Py_None, *copy = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|$OOOO", (char **) keywords, &stream, &maxVersion, &device, &copy)) {
+        return NULL;
+    }
+    if (stream != Py_None) {
+        PyErr_SetString(PyExc_ValueError, "stream must be None for CPU frames");
+        return NULL;
+    }
+    if (copy == Py_True) {
+        PyErr_SetString(PyExc_BufferError, "Frame only exports its pixels without a copy");
+        return NULL;
+    }
+    if (device != Py_None) {
+        int deviceType, deviceId;
+        if (!PyArg_ParseTuple(device, "ii", &deviceType, &deviceId)) {
+            return NULL;
+        }
+        if (deviceType != DL_CPU || deviceId != 0) {
+            PyErr_SetString(PyExc_BufferError, "Frame lives on the CPU");
+            return NULL;
+        }
+    }
+    long major = 0;
+    if (maxVersion != Py_None) {
+        int minor;
+        if (!PyArg_ParseTuple(maxVersion, "li", &major, &minor)) {
+            return NULL;
+        }
+    }
+
+    if (major >= 1) {
+        DLPackExport<DLManagedTensorVersioned> *tensor = new DLPackExport<DLManagedTensorVersioned>();
+        tensor->managed.version = { 1, 0 };
+        tensor->managed.flags = DL_FLAG_READ_ONLY;
+        fill_dltensor(tensor, self);
+        PyObject *capsule = PyCapsule_New(&tensor->managed, "dltensor_versioned", release_dltensor_versioned);
+        if (capsule == NULL) {
+            dlpack_deleter(&tensor->managed);
+        }
+        return capsule;
+    }
+    DLPackExport<DLManagedTensor> *tensor = new DLPackExport<DLManagedTensor>();
+    fill_dltensor(tensor, self);
+    PyObject *capsule = PyCapsule_New(&tensor->managed, "dltensor", release_dltensor);
+    if (capsule == NULL) {
+        dlpack_deleter(&tensor->managed);
+    }
+    return capsule;
+}
+
+static PyObject *Frame_dlpack_device(FrameObject *, PyObject *) {
+    return Py_BuildValue("ii", (int) DL_CPU, 0);
+}
+
+/**
+ * @brief palette(palette=PALETTE_IRON, scaling=SCALING_MIN_MAX, t_min=None, t_max=None) -> (h, w, 3) uint8
+ * Rendered like render_palette(), reusing the frame statistics. The last image is kept, asking for it again costs nothing.
+ */
+static PyObject *Frame_palette(FrameObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "palette", "scaling", "t_min", "t_max", nullptr };
+    int paletteId = pyoptris::PALETTE_IRON;
+    int scaling = pyoptris::SCALING_MIN_MAX;
+    PyObject *tMin = Py_None;
+    PyObject *tMax = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|iiOO", (char **) keywords, &paletteId, &scaling, &tMin, &tMax)) {
+        return NULL;
+    }
+    if (scaling < pyoptris::SCALING_MANUAL || scaling > pyoptris::SCALING_SIGMA3) {
+        PyErr_SetString(PyExc_ValueError, "Unknown palette scaling method");
+        return NULL;
+    }
+    const uint32_t *lut = pyoptris::palette_lut(paletteId);
+    if (lut == nullptr) {
+        PyErr_SetString(PyExc_ValueError, "Unknown palette");
+        return NULL;
+    }
+    PaletteRange manual;
+    if (parse_manual_range(scaling, tMin, tMax, manual) < 0) {
+        return NULL;
+    }
+    FrameState *state = self->state;
+    FrameStatistics statistics = {};
+    if (scaling != pyoptris::SCALING_MANUAL) {
+        statistics = frame_statistics_of(state);
+    }
+    PaletteRange range = pyoptris::palette_range((PaletteScaling) scaling, statistics, manual);
+    if (state->palette != NULL && state->paletteId == paletteId && state->paletteRange.low == range.low
+            && state->paletteRange.high == range.high) {
+        Py_INCREF(state->palette);
+        return state->palette;
+    }
+
+    npy_intp dimensions[3] = { state->height, state->width, 3 };
+    PyObject *image = new_pooled_array(frame_pool(), 3, dimensions, NPY_UINT8);
+    if (image == NULL) {
+        return NULL;
+    }
+    const uint16_t *raw = (const uint16_t *) state->raw->data;
+    uint8_t *rgb = (uint8_t *) PyArray_DATA((PyArrayObject *) image);
+    size_t n = pixels(state);
+    Py_BEGIN_ALLOW_THREADS
+    int64_t before = pyoptris::steady_now_ns();
+    pyoptris::render_palette(raw, rgb, n, lut, range);
+    pyoptris::pipeline_statistics().conversion.record(pyoptris::steady_now_ns() - before);
+    Py_END_ALLOW_THREADS
+
+    PyArray_CLEARFLAGS((PyArrayObject *) image, NPY_ARRAY_WRITEABLE);
+    state->paletteId = paletteId;
+    state->paletteRange = range;
+    return replace(state->palette, image);
+}
+
+/**
+ * @brief histogram(bins=256) -> (counts, edges)
+ * Pixel counts in bins equal bins between the frame minimum and maximum, and the bins + 1 edges in degrees
+ * Celsius, as numpy.histogram(raw, bins) gives them in raw values. The last histogram is kept.
+ */
+static PyObject *Frame_histogram(FrameObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "bins", nullptr };
+    Py_ssize_t bins = 256;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|n", (char **) keywords, &bins)) {
+        return NULL;
+    }
+    if (bins < 1) {
+        PyErr_SetString(PyExc_ValueError, "bins must be positive");
+        return NULL;
+    }
+    FrameState *state = self->state;
+    if (state->histogram != NULL && state->histogramBins == bins) {
+        Py_INCREF(state->histogram);
+        return state->histogram;
+    }
+    const FrameStatistics &statistics = frame_statistics_of(state);
+    // A flat frame gets a bin around its value, like numpy does
+    double low = statistics.min, high = statistics.max;
+    if (low == high) {
+        low -= 0.5;
+        high += 0.5;
+    }
+
+    npy_intp countDimensions[1] = { bins };
+    npy_intp edgeDimensions[1] = { bins + 1 };
+    PyObject *counts = PyArray_SimpleNew(1, countDimensions, NPY_UINT32);
+    PyObject *edges = PyArray_SimpleNew(1, edgeDimensions, NPY_FLOAT64);
+    if (counts == NULL || edges == NULL) {
+        Py_XDECREF(counts);
+        Py_XDECREF(edges);
+        return NULL;
+    }
+    const uint16_t *raw = (const uint16_t *) state->raw->data;
+    uint32_t *countData = (uint32_t *) PyArray_DATA((PyArrayObject *) counts);
+    double *edgeData = (double *) PyArray_DATA((PyArrayObject *) edges);
+    size_t n = pixels(state);
+    TemperatureScale scale = state->scale;
+    Py_BEGIN_ALLOW_THREADS
+    pyoptris::frame_histogram(raw, n, low, high, countData, (size_t) bins);
+    for (Py_ssize_t i = 0; i <= bins; i++) {
+        edgeData[i] = (low + (high - low) * i / bins - scale.rawOffset) * scale.scale;
+    }
+    Py_END_ALLOW_THREADS
+    PyArray_CLEARFLAGS((PyArrayObject *) counts, NPY_ARRAY_WRITEABLE);
+    PyArray_CLEARFLAGS((PyArrayObject *) edges, NPY_ARRAY_WRITEABLE);
+
+    PyObject *histogram = Py_BuildValue("NN", counts, edges);
+    if (histogram == NULL) {
+        return NULL;
+    }
+    state->histogramBins = bins;
+    return replace(state->histogram, histogram);
+}
+
+/**
+ * @brief Read-only (h, w) uint16 view of the raw pixels, no copy
+ */
+static PyObject *Frame_get_raw(FrameObject *self, void *) {
+    FrameState *state = self->state;
+    npy_intp dimensions[2] = { state->height, state->width };
+    PyObject *array = PyArray_New(&PyArray_Type, 2, dimensions, NPY_UINT16, NULL, state->raw->data, 0,
+                                  NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED, NULL);
+    if (array == NULL) {
+        return NULL;
+    }
+    // The view keeps the frame, and with it the buffer, alive
+    Py_INCREF(self);
+    if (PyArray_SetBaseObject((PyArrayObject *) array, (PyObject *) self) < 0) {
+        Py_DECREF(array);
+        return NULL;
+    }
+    return array;
+}
+
+/**
+ * @brief Read-only (h, w) float32 degrees Celsius, converted on first access
+ */
+static PyObject *Frame_get_celsius(FrameObject *self, void *) {
+    FrameState *state = self->state;
+    if (state->celsius != NULL) {
+        Py_INCREF(state->celsius);
+        return state->celsius;
+    }
+    npy_intp dimensions[2] = { state->height, state->width };
+    PyObject *celsius = new_pooled_array(frame_pool(), 2, dimensions, NPY_FLOAT32);
+    if (celsius == NULL) {
+        return NULL;
+    }
+    const uint16_t *raw = (const uint16_t *) state->raw->data;
+    float *data = (float *) PyArray_DATA((PyArrayObject *) celsius);
+    size_t n = pixels(state);
+    TemperatureScale scale = state->scale;
+    Py_BEGIN_ALLOW_THREADS
+    int64_t before = pyoptris::steady_now_ns();
+    pyoptris::raw_to_celsius(raw, data, n, scale);
+    pyoptris::pipeline_statistics().conversion.record(pyoptris::steady_now_ns() - before);
+    Py_END_ALLOW_THREADS
+    return publish(state->celsius, celsius);
+}
+
+static PyObject *Frame_get_min(FrameObject *self, void *) {
+    TemperatureScale scale = self->state->scale;
+    return PyFloat_FromDouble((frame_statistics_of(self->state).min - scale.rawOffset) * scale.scale);
+}
+
+static PyObject *Frame_get_max(FrameObject *self, void *) {
+    TemperatureScale scale = self->state->scale;
+    return PyFloat_FromDouble((frame_statistics_of(self->state).max - scale.rawOffset) * scale.scale);
+}
+
+static PyObject *Frame_get_mean(FrameObject *self, void *) {
+    TemperatureScale scale = self->state->scale;
+    return PyFloat_FromDouble((frame_statistics_of(self->state).mean - scale.rawOffset) * scale.scale);
+}
+
+static PyObject *Frame_get_stddev(FrameObject *self, void *) {
+    return PyFloat_FromDouble(frame_statistics_of(self->state).stddev * self->state->scale.scale);
+}
+
+static PyObject *Frame_get_metadata(FrameObject *self, void *) {
+    if (!self->state->hasInfo) {
+        Py_RETURN_NONE;
+    }
+    return new_frame_metadata(self->state->info);
+}
+
+static PyObject *Frame_get_size(FrameObject *self, void *) {
+    return Py_BuildValue("ii", self->state->width, self->state->height);
+}
+
+static PyObject *Frame_get_shape(FrameObject *self, void *) {
+    return Py_BuildValue("ii", self->state->height, self->state->width);
+}
+
+static PyMethodDef Frame_methods[] = {
+    { "palette",            (PyCFunction) Frame_palette,        METH_VARARGS | METH_KEYWORDS,
+      "palette(palette=PALETTE_IRON, scaling=SCALING_MIN_MAX, t_min=None, t_max=None) -> (h, w, 3) uint8 image" },
+    { "histogram",          (PyCFunction) Frame_histogram,      METH_VARARGS | METH_KEYWORDS, "histogram(bins=256) -> (counts, edges in degrees Celsius)" },
+    { "__dlpack__",         (PyCFunction) Frame_dlpack,         METH_VARARGS | METH_KEYWORDS, "DLPack capsule of the raw pixels" },
+    { "__dlpack_device__",  (PyCFunction) Frame_dlpack_device,  METH_NOARGS, "(kDLCPU, 0)" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Frame_getset[] = {
+    { "raw",        (getter) Frame_get_raw,         nullptr, "Read-only (h, w) uint16 view of the raw pixels", nullptr },
+    { "celsius",    (getter) Frame_get_celsius,     nullptr, "Read-only (h, w) float32 degrees Celsius, converted on first access", nullptr },
+    { "min",        (getter) Frame_get_min,         nullptr, "Coldest pixel in degrees Celsius", nullptr },
+    { "max",        (getter) Frame_get_max,         nullptr, "Hottest pixel in degrees Celsius", nullptr },
+    { "mean",       (getter) Frame_get_mean,        nullptr, "Mean in degrees Celsius", nullptr },
+    { "stddev",     (getter) Frame_get_stddev,      nullptr, "Standard deviation in degrees Celsius", nullptr },
+    { "metadata",   (getter) Frame_get_metadata,    nullptr, "pyoptris.FrameMetadata, None for frames made with Frame(raw)", nullptr },
+    { "size",       (getter) Frame_get_size,        nullptr, "(width, height)", nullptr },
+    { "shape",      (getter) Frame_get_shape,       nullptr, "(height, width)", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+int add_frame_type(PyObject *module) {
+    FrameType.tp_name = "pyoptris.Frame";
+    FrameType.tp_basicsize = sizeof(FrameObject);
+    FrameType.tp_flags = Py_TPFLAGS_DEFAULT;
+    FrameType.tp_doc = "Frame(raw, decimals=None): raw thermal frame with lazily computed temperatures, palette images and statistics";
+    FrameType.tp_new = Frame_new;
+    FrameType.tp_dealloc = (destructor) Frame_dealloc;
+    FrameType.tp_as_buffer = &Frame_as_buffer;
+    FrameType.tp_methods = Frame_methods;
+    FrameType.tp_getset = Frame_getset;
+
+    if (PyType_Ready(&FrameType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&FrameType);
+    if (PyModule_AddObject(module, "Frame", (PyObject *) &FrameType) < 0) {
+        Py_DECREF(&FrameType);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,266 @@
+#include "_pyoptris.h"
+
+#include "linescan.h"
+
+#include <mutex>
+#include <new>
+#include <string>
+
+using pyoptris::Capture;
+using pyoptris::FrameInfo;
+using pyoptris::LineScan;
+
+struct LineScanState {
+    std::shared_ptr<LineScan> lineScan;
+    Capture::Cursor cursor;
+    std::mutex mutex;   // cursor, never held together with the GIL
+};
+
+typedef struct {
+    PyObject_HEAD
+    LineScanState *state;
+} LineScanObject;
+
+static PyTypeObject LineScanType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+/**
+ * @brief LineScan(capture, tile_height=1024, row=None, average=False, capacity=4)
+ * Assembles the strips of capture (a pyoptris.Capture or pyoptris.Camera streaming a strip format such as
+ * PI1M 764x8 @ 1000Hz) into (tile_height, width) tiles on a native thread. Every strip contributes all of its
+ * rows, the row given by row, or with average=True the average of its rows.
+ */
+static PyObject *LineScan_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "capture", "tile_height", "row", "average", "capacity", nullptr };
+    PyObject *captureObject;
+    int tileHeight = 1024;
+    PyObject *rowObject = Py_None;
+    int average = 0;
+    Py_ssize_t capacity = 4;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|iOpn", (char **) keywords, &captureObject, &tileHeight, &rowObject, &average, &capacity)) {
+        return NULL;
+    }
+    if (tileHeight < 1) {
+        PyErr_SetString(PyExc_ValueError, "tile_height must be positive");
+        return NULL;
+    }
+    if (capacity < 2) {
+        PyErr_SetString(PyExc_ValueError, "capacity must be at least 2");
+        return NULL;
+    }
+    pyoptris::LineScanMode mode = average ? pyoptris::LINESCAN_AVERAGE : pyoptris::LINESCAN_STRIP;
+    long row = 0;
+    if (rowObject != Py_None) {
+        if (average) {
+            PyErr_SetString(PyExc_ValueError, "row and average exclude each other");
+            return NULL;
+        }
+        row = PyLong_AsLong(rowObject);
+        if (row == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        mode = pyoptris::LINESCAN_ROW;
+    }
+    std::shared_ptr<Capture> capture = capture_of(captureObject);
+    if (capture == nullptr) {
+        return NULL;
+    }
+
+    std::shared_ptr<LineScan> lineScan;
+    std::string error;
+    bool started;
+    try {
+        lineScan = std::make_shared<LineScan>(capture, tileHeight, mode, (int) row, (size_t) capacity);
+        started = lineScan->start(error);
+    } catch (const std::bad_alloc &) {
+        return PyErr_NoMemory();
+    }
+    if (!started) {
+        PyErr_SetString(PyExc_ValueError, error.c_str());
+        return NULL;
+    }
+
+    LineScanObject *self = (LineScanObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        lineScan.reset();
+        Py_END_ALLOW_THREADS
+        return NULL;
+    }
+    self->state = new LineScanState();
+    self->state->lineScan = lineScan;
+    self->state->cursor = lineScan->cursor();
+    return (PyObject *) self;
+}
+
+static void LineScan_dealloc(LineScanObject *self) {
+    LineScanState *state = self->state;
+    Py_BEGIN_ALLOW_THREADS
+    delete state;
+    Py_END_ALLOW_THREADS
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject *new_tile_array(LineScanState *state) {
+    npy_intp dimensions[2] = { state->lineScan->tile_height(), state->lineScan->width() };
+    return new_pooled_array(frame_pool(), 2, dimensions, NPY_UINT16);
+}
+
+/**
+ * @brief next(timeout=None) -> (tile, timestamp) of the next completed tile, None on timeout.
+ * timestamp is the acquisition time of the first strip of the tile in ns since the epoch.
+ */
+static PyObject *LineScan_next(LineScanObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "timeout", nullptr };
+    PyObject *timeout = Py_None;
+    int64_t timeoutNs;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", (char **) keywords, &timeout) || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+    LineScanState *state = self->state;
+    PyObject *tile = new_tile_array(state);
+    if (tile == NULL) {
+        return NULL;
+    }
+    uint16_t *data = (uint16_t *) PyArray_DATA((PyArrayObject *) tile);
+    FrameInfo info;
+    int result = wait_released([state, data, &info](int64_t slice) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->lineScan->next(state->cursor, data, &info, slice);
+    }, timeoutNs);
+    switch(result) {
+        case Capture::WAIT_FRAME:
+            return Py_BuildValue("NL", tile, (long long) info.timestamp);
+
+        case Capture::WAIT_TIMEOUT:
+            Py_DECREF(tile);
+            Py_RETURN_NONE;
+
+        case Capture::WAIT_CLOSED:
+            PyErr_SetString(PyExc_RuntimeError, "Line scan stopped");
+            break;
+
+        default:
+            break;
+    }
+    Py_DECREF(tile);
+    return NULL;
+}
+
+/**
+ * @brief latest() -> (tile, timestamp) of the most recent completed tile, None before the first one
+ */
+static PyObject *LineScan_latest(LineScanObject *self, PyObject *) {
+    LineScanState *state = self->state;
+    PyObject *tile = new_tile_array(state);
+    if (tile == NULL) {
+        return NULL;
+    }
+    uint16_t *data = (uint16_t *) PyArray_DATA((PyArrayObject *) tile);
+    FrameInfo info;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = state->lineScan->latest(data, &info);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        Py_DECREF(tile);
+        Py_RETURN_NONE;
+    }
+    return Py_BuildValue("NL", tile, (long long) info.timestamp);
+}
+
+/**
+ * @brief window() -> the last tile_height assembled rows, oldest first, whether or not they complete a tile
+ */
+static PyObject *LineScan_window(LineScanObject *self, PyObject *) {
+    LineScanState *state = self->state;
+    PyObject *result = new_tile_array(state);
+    if (result == NULL) {
+        return NULL;
+    }
+    uint16_t *data = (uint16_t *) PyArray_DATA((PyArrayObject *) result);
+    Py_BEGIN_ALLOW_THREADS
+    state->lineScan->window(data);
+    Py_END_ALLOW_THREADS
+    return result;
+}
+
+static PyObject *LineScan_stop(LineScanObject *self, PyObject *) {
+    std::shared_ptr<LineScan> lineScan = self->state->lineScan;
+    Py_BEGIN_ALLOW_THREADS
+    lineScan->stop();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *LineScan_enter(LineScanObject *self, PyObject *) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject *LineScan_exit(LineScanObject *self, PyObject *) {
+    return LineScan_stop(self, NULL);
+}
+
+static PyObject *LineScan_get_tiles(LineScanObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->lineScan->tile_count());
+}
+
+static PyObject *LineScan_get_strips(LineScanObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->lineScan->strips());
+}
+
+static PyObject *LineScan_get_skipped(LineScanObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->lineScan->dropped());
+}
+
+static PyObject *LineScan_get_dropped(LineScanObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->cursor.dropped);
+}
+
+static PyObject *LineScan_get_size(LineScanObject *self, void *) {
+    return Py_BuildValue("ii", self->state->lineScan->width(), self->state->lineScan->tile_height());
+}
+
+static PyObject *LineScan_get_running(LineScanObject *self, void *) {
+    return PyBool_FromLong(self->state->lineScan->running());
+}
+
+static PyMethodDef LineScan_methods[] = {
+    { "next",       (PyCFunction) LineScan_next,    METH_VARARGS | METH_KEYWORDS, "next(timeout=None) -> (tile, timestamp), None on timeout" },
+    { "latest",     (PyCFunction) LineScan_latest,  METH_NOARGS, "(tile, timestamp) of the most recent tile, None if there is none" },
+    { "window",     (PyCFunction) LineScan_window,  METH_NOARGS, "The last tile_height rows, oldest first" },
+    { "stop",       (PyCFunction) LineScan_stop,    METH_NOARGS, "Stops the assembler thread" },
+    { "__enter__",  (PyCFunction) LineScan_enter,   METH_NOARGS, nullptr },
+    { "__exit__",   (PyCFunction) LineScan_exit,    METH_VARARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef LineScan_getset[] = {
+    { "tiles",      (getter) LineScan_get_tiles,    nullptr, "Tiles completed so far", nullptr },
+    { "strips",     (getter) LineScan_get_strips,   nullptr, "Strips assembled so far", nullptr },
+    { "skipped",    (getter) LineScan_get_skipped,  nullptr, "Strips overwritten in the capture ring before the assembler got to them", nullptr },
+    { "dropped",    (getter) LineScan_get_dropped,  nullptr, "Tiles overwritten before this object read them", nullptr },
+    { "size",       (getter) LineScan_get_size,     nullptr, "(width, tile_height) of the tiles", nullptr },
+    { "running",    (getter) LineScan_get_running,  nullptr, "True while the assembler thread is alive", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+int add_linescan_type(PyObject *module) {
+    LineScanType.tp_name = "pyoptris.LineScan";
+    LineScanType.tp_basicsize = sizeof(LineScanObject);
+    LineScanType.tp_flags = Py_TPFLAGS_DEFAULT;
+    LineScanType.tp_doc = "LineScan(capture, tile_height=1024, row=None, average=False, capacity=4): assembles strips into tiles";
+    LineScanType.tp_new = LineScan_new;
+    LineScanType.tp_dealloc = (destructor) LineScan_dealloc;
+    LineScanType.tp_methods = LineScan_methods;
+    LineScanType.tp_getset = LineScan_getset;
+    if (PyType_Ready(&LineScanType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&LineScanType);
+    if (PyModule_AddObject(module, "LineScan", (PyObject *) &LineScanType) < 0) {
+        Py_DECREF(&LineScanType);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,227 @@
+#include "_pyoptris.h"
+
+#include "palette.h"
+
+#include <cmath>
+#include <vector>
+
+using pyoptris::FrameStatistics;
+using pyoptris::PaletteRange;
+using pyoptris::PaletteScaling;
+using pyoptris::TemperatureScale;
+
+static uint16_t celsius_to_raw(double celsius, TemperatureScale scale) {
+    double raw = std::round(celsius / scale.scale + scale.rawOffset);
+    return (uint16_t) std::min(std::max(raw, 0.0), 65535.0);
+}
+
+int parse_manual_range(int scaling, PyObject *tMin, PyObject *tMax, PaletteRange &manual) {
+    manual = { 0, 0 };
+    if (scaling != pyoptris::SCALING_MANUAL) {
+        return 0;
+    }
+    if (tMin == Py_None || tMax == Py_None) {
+        PyErr_SetString(PyExc_ValueError, "Manual scaling needs t_min and t_max");
+        return -1;
+    }
+    double low = PyFloat_AsDouble(tMin);
+    double high = PyFloat_AsDouble(tMax);
+    if (PyErr_Occurred()) {
+        return -1;
+    }
+    TemperatureScale scale = current_temperature_scale();
+    manual.low = celsius_to_raw(low, scale);
+    manual.high = celsius_to_raw(high, scale);
+    return 0;
+}
+
+/**
+ * @brief render_palette(raw, palette=PALETTE_IRON, scaling=SCALING_MIN_MAX, t_min=None, t_max=None, out=None)
+ * Colours a raw thermal frame natively, without fetching a palette image from the SDK or daemon.
+ * palette may also be a sequence of palette ids, a list with one (h, w, 3) image per palette is returned then
+ * and the frame statistics are computed only once. t_min/t_max in degrees Celsius set the SCALING_MANUAL range.
+ */
+PyObject * render_palette(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "raw", "palette", "scaling", "t_min", "t_max", "out", nullptr };
+    PyObject *rawObject;
+    PyObject *paletteObject = NULL;
+    int scaling = pyoptris::SCALING_MIN_MAX;
+    PyObject *tMin = Py_None;
+    PyObject *tMax = Py_None;
+    PyObject *out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OiOOO", (char **) keywords, &rawObject, &paletteObject, &scaling, &tMin, &tMax, &out)) {
+        return NULL;
+    }
+    if (scaling < pyoptris::SCALING_MANUAL || scaling > pyoptris::SCALING_SIGMA3) {
+        PyErr_SetString(PyExc_ValueError, "Unknown palette scaling method");
+        return NULL;
+    }
+
+    std::vector<int> palettes;
+    bool many = paletteObject != NULL && PySequence_Check(paletteObject);
+    if (paletteObject == NULL) {
+        palettes.push_back(pyoptris::PALETTE_IRON);
+    } else if (many) {
+        Py_ssize_t count = PySequence_Size(paletteObject);
+        for (Py_ssize_t i = 0; i < count; i++) {
+            PyObject *item = PySequence_GetItem(paletteObject, i);
+            if (item == NULL) {
+                return NULL;
+            }
+            long id = PyLong_AsLong(item);
+            Py_DECREF(item);
+            if (id == -1 && PyErr_Occurred()) {
+                return NULL;
+            }
+            palettes.push_back((int) id);
+        }
+        if (out != Py_None) {
+            PyErr_SetString(PyExc_ValueError, "out can only be used with a single palette");
+            return NULL;
+        }
+    } else {
+        long id = PyLong_AsLong(paletteObject);
+        if (id == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        palettes.push_back((int) id);
+    }
+    std::vector<const uint32_t *> luts;
+    for (int id : palettes) {
+        const uint32_t *lut = pyoptris::palette_lut(id);
+        if (lut == nullptr) {
+            PyErr_SetString(PyExc_ValueError, "Unknown palette");
+            return NULL;
+        }
+        luts.push_back(lut);
+    }
+
+    PaletteRange manual;
+    if (parse_manual_range(scaling, tMin, tMax, manual) < 0) {
+        return NULL;
+    }
+
+    PyArrayObject *raw = (PyArrayObject *) PyArray_FROM_OTF(rawObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (raw == NULL) {
+        return NULL;
+    }
+    if (PyArray_NDIM(raw) != 2) {
+        Py_DECREF(raw);
+        PyErr_SetString(PyExc_ValueError, "raw must be a 2-D thermal image");
+        return NULL;
+    }
+    npy_intp dimensions[3] = { PyArray_DIM(raw, 0), PyArray_DIM(raw, 1), 3 };
+
+    std::vector<PyObject *> images;
+    for (size_t i = 0; i < palettes.size(); i++) {
+        PyObject *image = frame_array(out, 3, dimensions, NPY_UINT8);
+        if (image == NULL) {
+            for (PyObject *done : images) {
+                Py_DECREF(done);
+            }
+            Py_DECREF(raw);
+            return NULL;
+        }
+        images.push_back(image);
+    }
+
+    const uint16_t *rawData = (const uint16_t *) PyArray_DATA(raw);
+    size_t n = (size_t) PyArray_SIZE(raw);
+    std::vector<uint8_t *> targets;
+    for (PyObject *image : images) {
+        targets.push_back((uint8_t *) PyArray_DATA((PyArrayObject *) image));
+    }
+    Py_BEGIN_ALLOW_THREADS
+    int64_t before = pyoptris::steady_now_ns();
+    FrameStatistics stats = {};
+    if (scaling != pyoptris::SCALING_MANUAL) {
+        stats = pyoptris::frame_statistics(rawData, n);
+    }
+    PaletteRange range = pyoptris::palette_range((PaletteScaling) scaling, stats, manual);
+    for (size_t i = 0; i < luts.size(); i++) {
+        pyoptris::render_palette(rawData, targets[i], n, luts[i], range);
+    }
+    pyoptris::pipeline_statistics().conversion.record(pyoptris::steady_now_ns() - before);
+    Py_END_ALLOW_THREADS
+    Py_DECREF(raw);
+
+    if (!many) {
+        return images[0];
+    }
+    PyObject *result = PyList_New((Py_ssize_t) images.size());
+    if (result == NULL) {
+        for (PyObject *image : images) {
+            Py_DECREF(image);
+        }
+        return NULL;
+    }
+    for (size_t i = 0; i < images.size(); i++) {
+        PyList_SET_ITEM(result, (Py_ssize_t) i, images[i]);
+    }
+    return result;
+}
+
+/**
+ * @brief frame_statistics(raw) -> dict with min, max, mean and stddev in degrees Celsius
+ * Computed natively in a single pass over the raw frame.
+ */
+PyObject * frame_statistics(PyObject *, PyObject *args) {
+    PyObject *rawObject;
+    if (!PyArg_ParseTuple(args, "O", &rawObject)) {
+        PyErr_SetString(PyExc_RuntimeError, "Bad argument(s)");
+        return NULL;
+    }
+    PyArrayObject *raw = (PyArrayObject *) PyArray_FROM_OTF(rawObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (raw == NULL) {
+        return NULL;
+    }
+    const uint16_t *rawData = (const uint16_t *) PyArray_DATA(raw);
+    size_t n = (size_t) PyArray_SIZE(raw);
+    FrameStatistics stats;
+    Py_BEGIN_ALLOW_THREADS
+    stats = pyoptris::frame_statistics(rawData, n);
+    Py_END_ALLOW_THREADS
+    Py_DECREF(raw);
+
+    TemperatureScale scale = current_temperature_scale();
+    return Py_BuildValue("{s:d,s:d,s:d,s:d}",
+        "min", (stats.min - scale.rawOffset) * scale.scale,
+        "max", (stats.max - scale.rawOffset) * scale.scale,
+        "mean", (stats.mean - scale.rawOffset) * scale.scale,
+        "stddev", stats.stddev * scale.scale);
+}
+
+static PyMethodDef palette_methods[] = {
+    { "render_palette",     (PyCFunction) render_palette,       METH_VARARGS | METH_KEYWORDS, nullptr },
+    { "frame_statistics",   (PyCFunction) frame_statistics,     METH_VARARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+int add_palette_functions(PyObject *module) {
+    if (PyModule_AddFunctions(module, palette_methods) < 0) {
+        return -1;
+    }
+    static const struct { const char *name; int value; } constants[] = {
+        { "PALETTE_ALARM_BLUE",     pyoptris::PALETTE_ALARM_BLUE },
+        { "PALETTE_ALARM_BLUE_HI",  pyoptris::PALETTE_ALARM_BLUE_HI },
+        { "PALETTE_GRAY_BW",        pyoptris::PALETTE_GRAY_BW },
+        { "PALETTE_GRAY_WB",        pyoptris::PALETTE_GRAY_WB },
+        { "PALETTE_ALARM_GREEN",    pyoptris::PALETTE_ALARM_GREEN },
+        { "PALETTE_IRON",           pyoptris::PALETTE_IRON },
+        { "PALETTE_IRON_HI",        pyoptris::PALETTE_IRON_HI },
+        { "PALETTE_MEDICAL",        pyoptris::PALETTE_MEDICAL },
+        { "PALETTE_RAINBOW",        pyoptris::PALETTE_RAINBOW },
+        { "PALETTE_RAINBOW_HI",     pyoptris::PALETTE_RAINBOW_HI },
+        { "PALETTE_ALARM_RED",      pyoptris::PALETTE_ALARM_RED },
+        { "SCALING_MANUAL",         pyoptris::SCALING_MANUAL },
+        { "SCALING_MIN_MAX",        pyoptris::SCALING_MIN_MAX },
+        { "SCALING_SIGMA1",         pyoptris::SCALING_SIGMA1 },
+        { "SCALING_SIGMA3",         pyoptris::SCALING_SIGMA3 },
+    };
+    for (const auto &constant : constants) {
+        if (PyModule_AddIntConstant(module, constant.name, constant.value) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,371 @@
+#include "_pyoptris.h"
+
+#include "recording.h"
+
+#include <string>
+
+using pyoptris::Capture;
+using pyoptris::RecordingIndexEntry;
+using pyoptris::RecordingReader;
+using pyoptris::RecordingWriter;
+
+typedef struct {
+    PyObject_HEAD
+    RecordingWriter *writer;
+} RecorderObject;
+
+typedef struct {
+    PyObject_HEAD
+    RecordingReader *reader;
+} RecordingObject;
+
+static PyTypeObject RecorderType = { PyVarObject_HEAD_INIT(NULL, 0) };
+static PyTypeObject RecordingType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+/**
+ * @brief Recorder(path, capture, segment_frames=0)
+ * Records every frame of capture (a pyoptris.Capture or pyoptris.Camera) into memory-mapped segment
+ * files on a native thread. segment_frames=0 sizes segments to about 1 GiB.
+ */
+static PyObject *Recorder_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "path", "capture", "segment_frames", nullptr };
+    const char *path;
+    PyObject *captureObject;
+    unsigned long long segmentFrames = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|K", (char **) keywords, &path, &captureObject, &segmentFrames)) {
+        return NULL;
+    }
+    std::shared_ptr<Capture> capture = capture_of(captureObject);
+    if (capture == nullptr) {
+        return NULL;
+    }
+
+    RecordingWriter *writer = new RecordingWriter(capture, path, segmentFrames, current_temperature_decimals());
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = writer->start(error);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        delete writer;
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return NULL;
+    }
+
+    RecorderObject *self = (RecorderObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        delete writer;
+        Py_END_ALLOW_THREADS
+        return NULL;
+    }
+    self->writer = writer;
+    return (PyObject *) self;
+}
+
+static void Recorder_dealloc(RecorderObject *self) {
+    RecordingWriter *writer = self->writer;
+    Py_BEGIN_ALLOW_THREADS
+    delete writer;
+    Py_END_ALLOW_THREADS
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief Records what the capture still holds for the recorder, then closes the recording
+ */
+static PyObject *Recorder_stop(RecorderObject *self, PyObject *) {
+    RecordingWriter *writer = self->writer;
+    Py_BEGIN_ALLOW_THREADS
+    writer->stop();
+    Py_END_ALLOW_THREADS
+    std::string error = writer->error();
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Waits until the frames recorded so far are on disk
+ */
+static PyObject *Recorder_flush(RecorderObject *self, PyObject *) {
+    RecordingWriter *writer = self->writer;
+    Py_BEGIN_ALLOW_THREADS
+    writer->flush();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *Recorder_enter(RecorderObject *self, PyObject *) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject *Recorder_exit(RecorderObject *self, PyObject *) {
+    return Recorder_stop(self, NULL);
+}
+
+static PyObject *Recorder_get_frames(RecorderObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->writer->frames());
+}
+
+static PyObject *Recorder_get_dropped(RecorderObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->writer->dropped());
+}
+
+static PyObject *Recorder_get_segments(RecorderObject *self, void *) {
+    return PyLong_FromUnsignedLong(self->writer->segments());
+}
+
+static PyObject *Recorder_get_running(RecorderObject *self, void *) {
+    return PyBool_FromLong(self->writer->running());
+}
+
+static PyMethodDef Recorder_methods[] = {
+    { "stop",       (PyCFunction) Recorder_stop,    METH_NOARGS, "Records pending frames and closes the recording" },
+    { "flush",      (PyCFunction) Recorder_flush,   METH_NOARGS, "Waits until the recorded frames are on disk" },
+    { "__enter__",  (PyCFunction) Recorder_enter,   METH_NOARGS, nullptr },
+    { "__exit__",   (PyCFunction) Recorder_exit,    METH_VARARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Recorder_getset[] = {
+    { "frames",     (getter) Recorder_get_frames,   nullptr, "Frames recorded so far", nullptr },
+    { "dropped",    (getter) Recorder_get_dropped,  nullptr, "Frames overwritten in the capture ring before the recorder got to them", nullptr },
+    { "segments",   (getter) Recorder_get_segments, nullptr, "Segment files written so far", nullptr },
+    { "running",    (getter) Recorder_get_running,  nullptr, "True while the writer thread is alive", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+/**
+ * @brief Recording(path)
+ * Opens a recording, or one that is still being written, for reading. Frames are read-only views into
+ * the mapped files and keep the recording open while they are alive.
+ */
+static PyObject *Recording_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "path", nullptr };
+    const char *path;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) keywords, &path)) {
+        return NULL;
+    }
+    RecordingReader *reader = new RecordingReader();
+    std::string error;
+    if (!reader->open(path, error)) {
+        delete reader;
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return NULL;
+    }
+    RecordingObject *self = (RecordingObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        delete reader;
+        return NULL;
+    }
+    self->reader = reader;
+    return (PyObject *) self;
+}
+
+static void Recording_dealloc(RecordingObject *self) {
+    delete self->reader;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static int frame_number(RecordingObject *self, PyObject *key, uint64_t &n) {
+    Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+    if (i == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    Py_ssize_t count = (Py_ssize_t) self->reader->frames();
+    if (i < 0) {
+        i += count;
+    }
+    if (i < 0 || i >= count) {
+        PyErr_SetString(PyExc_IndexError, "frame number out of range");
+        return -1;
+    }
+    n = (uint64_t) i;
+    return 0;
+}
+
+static PyObject *frame_view(RecordingObject *self, uint64_t n) {
+    npy_intp dimensions[2] = { self->reader->height(), self->reader->width() };
+    const uint16_t *data = self->reader->frame(n, nullptr);
+    PyObject *view = PyArray_SimpleNewFromData(2, dimensions, NPY_UINT16, (void *) data);
+    if (view == NULL) {
+        return NULL;
+    }
+    PyArray_CLEARFLAGS((PyArrayObject *) view, NPY_ARRAY_WRITEABLE);
+    // The view keeps the mapping alive through the recording object
+    Py_INCREF(self);
+    if (PyArray_SetBaseObject((PyArrayObject *) view, (PyObject *) self) < 0) {
+        Py_DECREF(view);
+        return NULL;
+    }
+    return view;
+}
+
+static Py_ssize_t Recording_length(RecordingObject *self) {
+    return (Py_ssize_t) self->reader->frames();
+}
+
+static PyObject *Recording_subscript(RecordingObject *self, PyObject *key) {
+    uint64_t n;
+    if (frame_number(self, key, n) < 0) {
+        return NULL;
+    }
+    return frame_view(self, n);
+}
+
+/**
+ * @brief entry(n, metadata=False) -> (timestamp, sequence), acquisition time in ns since the epoch and capture sequence number.
+ * With metadata set the whole pyoptris.FrameMetadata of frame n, including its flag state, chip temperature and validity.
+ */
+static PyObject *Recording_entry(RecordingObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "n", "metadata", nullptr };
+    PyObject *key;
+    int metadata = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|p", (char **) keywords, &key, &metadata)) {
+        return NULL;
+    }
+    uint64_t n;
+    if (frame_number(self, key, n) < 0) {
+        return NULL;
+    }
+    pyoptris::FrameInfo info = self->reader->info(n);
+    if (metadata) {
+        return new_frame_metadata(info);
+    }
+    return Py_BuildValue("LK", (long long) info.timestamp, (unsigned long long) info.sequence);
+}
+
+/**
+ * @brief find(timestamp) -> number of the last frame taken at or before timestamp (ns since the epoch), -1 if none
+ */
+static PyObject *Recording_find(RecordingObject *self, PyObject *args) {
+    long long timestamp;
+    if (!PyArg_ParseTuple(args, "L", &timestamp)) {
+        return NULL;
+    }
+    return PyLong_FromLongLong(self->reader->find_timestamp(timestamp));
+}
+
+/**
+ * @brief at(timestamp) -> view of the last frame taken at or before timestamp, None if none
+ */
+static PyObject *Recording_at(RecordingObject *self, PyObject *args) {
+    long long timestamp;
+    if (!PyArg_ParseTuple(args, "L", &timestamp)) {
+        return NULL;
+    }
+    int64_t n = self->reader->find_timestamp(timestamp);
+    if (n < 0) {
+        Py_RETURN_NONE;
+    }
+    return frame_view(self, (uint64_t) n);
+}
+
+/**
+ * @brief timestamps() -> int64 array with the acquisition time of every frame
+ */
+static PyObject *Recording_timestamps(RecordingObject *self, PyObject *) {
+    npy_intp count = (npy_intp) self->reader->frames();
+    PyObject *result = PyArray_SimpleNew(1, &count, NPY_INT64);
+    if (result == NULL) {
+        return NULL;
+    }
+    int64_t *data = (int64_t *) PyArray_DATA((PyArrayObject *) result);
+    for (npy_intp i = 0; i < count; i++) {
+        const RecordingIndexEntry *entry;
+        self->reader->frame((uint64_t) i, &entry);
+        data[i] = entry->timestamp;
+    }
+    return result;
+}
+
+static PyObject *Recording_get_size(RecordingObject *self, void *) {
+    return Py_BuildValue("ii", self->reader->width(), self->reader->height());
+}
+
+static PyObject *Recording_get_segments(RecordingObject *self, void *) {
+    self->reader->frames();
+    return PyLong_FromSize_t(self->reader->segments());
+}
+
+static PyObject *Recording_get_temperature_decimals(RecordingObject *self, void *) {
+    return PyLong_FromLong(self->reader->temperature_decimals());
+}
+
+static PyMappingMethods Recording_mapping = {
+    (lenfunc) Recording_length,
+    (binaryfunc) Recording_subscript,
+    nullptr
+};
+
+// Makes recordings iterable, iteration ends at the IndexError past the last frame
+static PyObject *Recording_item(RecordingObject *self, Py_ssize_t i) {
+    if (i < 0 || (uint64_t) i >= self->reader->frames()) {
+        PyErr_SetString(PyExc_IndexError, "frame number out of range");
+        return NULL;
+    }
+    return frame_view(self, (uint64_t) i);
+}
+
+static PySequenceMethods Recording_sequence = {
+    (lenfunc) Recording_length,
+    nullptr,
+    nullptr,
+    (ssizeargfunc) Recording_item,
+};
+
+static PyMethodDef Recording_methods[] = {
+    { "entry",          (PyCFunction) Recording_entry,      METH_VARARGS | METH_KEYWORDS, "entry(n, metadata=False) -> (timestamp, sequence) of frame n, its pyoptris.FrameMetadata if metadata is set" },
+    { "find",           (PyCFunction) Recording_find,       METH_VARARGS, "find(timestamp) -> last frame number at or before timestamp, -1 if none" },
+    { "at",             (PyCFunction) Recording_at,         METH_VARARGS, "at(timestamp) -> last frame at or before timestamp, None if none" },
+    { "timestamps",     (PyCFunction) Recording_timestamps, METH_NOARGS, "Acquisition times of all frames in ns since the epoch" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Recording_getset[] = {
+    { "size",                   (getter) Recording_get_size,                    nullptr, "(width, height) of the frames", nullptr },
+    { "segments",               (getter) Recording_get_segments,                nullptr, "Segment files of the recording", nullptr },
+    { "temperature_decimals",   (getter) Recording_get_temperature_decimals,    nullptr, "Decimals of the raw values, pass to raw_to_celsius", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+int add_recording_types(PyObject *module) {
+    RecorderType.tp_name = "pyoptris.Recorder";
+    RecorderType.tp_basicsize = sizeof(RecorderObject);
+    RecorderType.tp_flags = Py_TPFLAGS_DEFAULT;
+    RecorderType.tp_doc = "Recorder(path, capture, segment_frames=0): records a capture into memory-mapped segment files";
+    RecorderType.tp_new = Recorder_new;
+    RecorderType.tp_dealloc = (destructor) Recorder_dealloc;
+    RecorderType.tp_methods = Recorder_methods;
+    RecorderType.tp_getset = Recorder_getset;
+
+    RecordingType.tp_name = "pyoptris.Recording";
+    RecordingType.tp_basicsize = sizeof(RecordingObject);
+    RecordingType.tp_flags = Py_TPFLAGS_DEFAULT;
+    RecordingType.tp_doc = "Recording(path): zero-copy frame access to a recording";
+    RecordingType.tp_new = Recording_new;
+    RecordingType.tp_dealloc = (destructor) Recording_dealloc;
+    RecordingType.tp_as_mapping = &Recording_mapping;
+    RecordingType.tp_as_sequence = &Recording_sequence;
+    RecordingType.tp_methods = Recording_methods;
+    RecordingType.tp_getset = Recording_getset;
+
+    if (PyType_Ready(&RecorderType) < 0 || PyType_Ready(&RecordingType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&RecorderType);
+    if (PyModule_AddObject(module, "Recorder", (PyObject *) &RecorderType) < 0) {
+        Py_DECREF(&RecorderType);
+        return -1;
+    }
+    Py_INCREF(&RecordingType);
+    if (PyModule_AddObject(module, "Recording", (PyObject *) &RecordingType) < 0) {
+        Py_DECREF(&RecordingType);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,567 @@
+#include "_pyoptris.h"
+
+#include "roi.h"
+
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+using pyoptris::Capture;
+using pyoptris::RoiEngine;
+using pyoptris::RoiMonitor;
+using pyoptris::RoiResultHeader;
+using pyoptris::RoiStatistics;
+using pyoptris::TemperatureScale;
+
+// Structured dtype mirroring RoiStatistics
+static PyArray_Descr *roiDtype = NULL;
+
+struct RoiEngineState {
+    std::mutex mutex;   // compute() runs without the GIL and sorts the spans on first use
+    RoiEngine engine;
+
+    RoiEngineState(int width, int height) : engine(width, height) {}
+};
+
+struct RoiMonitorState {
+    std::shared_ptr<RoiMonitor> monitor;
+    Capture::Cursor cursor;
+    std::vector<unsigned char> result;
+    std::mutex mutex;   // cursor and result, never held together with the GIL
+};
+
+typedef struct {
+    PyObject_HEAD
+    RoiEngineState *state;
+} RoiEngineObject;
+
+typedef struct {
+    PyObject_HEAD
+    RoiMonitorState *state;
+} RoiMonitorObject;
+
+static PyTypeObject RoiEngineType = { PyVarObject_HEAD_INIT(NULL, 0) };
+static PyTypeObject RoiMonitorType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+static PyObject *new_statistics_array(npy_intp count) {
+    Py_INCREF(roiDtype);
+    return PyArray_NewFromDescr(&PyArray_Type, roiDtype, 1, &count, NULL, NULL, 0, NULL);
+}
+
+/**
+ * @brief Converts frame to a contiguous uint16 array of the engine size
+ * @return new reference, NULL with an exception set on failure
+ */
+static PyArrayObject *engine_frame(RoiEngineState *state, PyObject *frameObject) {
+    PyArrayObject *frame = (PyArrayObject *) PyArray_FROM_OTF(frameObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (frame == NULL) {
+        return NULL;
+    }
+    int width = state->engine.width(), height = state->engine.height();
+    if (PyArray_NDIM(frame) != 2 || PyArray_DIM(frame, 0) != height || PyArray_DIM(frame, 1) != width) {
+        Py_DECREF(frame);
+        PyErr_Format(PyExc_ValueError, "frame must have shape (%d, %d)", height, width);
+        return NULL;
+    }
+    return frame;
+}
+
+/**
+ * @brief RoiEngine(width, height)
+ * Regions of interest evaluated together in a single pass over a frame. Every add_* method returns
+ * the index of the region in the statistics array.
+ */
+static PyObject *RoiEngine_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "width", "height", nullptr };
+    int width, height;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ii", (char **) keywords, &width, &height)) {
+        return NULL;
+    }
+    if (width <= 0 || height <= 0 || width > 65535 || height > 65535) {
+        PyErr_SetString(PyExc_ValueError, "width and height must be between 1 and 65535");
+        return NULL;
+    }
+    RoiEngineObject *self = (RoiEngineObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->state = new RoiEngineState(width, height);
+    return (PyObject *) self;
+}
+
+static void RoiEngine_dealloc(RoiEngineObject *self) {
+    delete self->state;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static int check_roi_count(RoiEngineState *state) {
+    if (state->engine.size() >= 65535) {
+        PyErr_SetString(PyExc_ValueError, "Too many regions");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief add_rect(x, y, width, height) -> index
+ */
+static PyObject *RoiEngine_add_rect(RoiEngineObject *self, PyObject *args) {
+    int x, y, width, height;
+    if (!PyArg_ParseTuple(args, "iiii", &x, &y, &width, &height) || check_roi_count(self->state) < 0) {
+        return NULL;
+    }
+    std::lock_guard<std::mutex> lock(self->state->mutex);
+    return PyLong_FromLong(self->state->engine.add_rect(x, y, width, height));
+}
+
+/**
+ * @brief add_polygon(points) -> index, points is a sequence of (x, y) vertices
+ */
+static PyObject *RoiEngine_add_polygon(RoiEngineObject *self, PyObject *pointsObject) {
+    if (check_roi_count(self->state) < 0) {
+        return NULL;
+    }
+    PyArrayObject *points = (PyArrayObject *) PyArray_FROM_OTF(pointsObject, NPY_FLOAT32, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+    if (points == NULL) {
+        return NULL;
+    }
+    if (PyArray_NDIM(points) != 2 || PyArray_DIM(points, 1) != 2 || PyArray_DIM(points, 0) < 3) {
+        Py_DECREF(points);
+        PyErr_SetString(PyExc_ValueError, "points must be at least 3 (x, y) pairs");
+        return NULL;
+    }
+    int roi;
+    {
+        std::lock_guard<std::mutex> lock(self->state->mutex);
+        roi = self->state->engine.add_polygon((const float *) PyArray_DATA(points), (size_t) PyArray_DIM(points, 0));
+    }
+    Py_DECREF(points);
+    return PyLong_FromLong(roi);
+}
+
+/**
+ * @brief add_mask(mask) -> index, mask is a (height, width) array, non-zero pixels belong to the region
+ */
+static PyObject *RoiEngine_add_mask(RoiEngineObject *self, PyObject *maskObject) {
+    if (check_roi_count(self->state) < 0) {
+        return NULL;
+    }
+    PyArrayObject *mask = (PyArrayObject *) PyArray_FROM_OTF(maskObject, NPY_UINT8, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+    if (mask == NULL) {
+        return NULL;
+    }
+    RoiEngine &engine = self->state->engine;
+    if (PyArray_NDIM(mask) != 2 || PyArray_DIM(mask, 0) != engine.height() || PyArray_DIM(mask, 1) != engine.width()) {
+        Py_DECREF(mask);
+        PyErr_Format(PyExc_ValueError, "mask must have shape (%d, %d)", engine.height(), engine.width());
+        return NULL;
+    }
+    int roi;
+    {
+        std::lock_guard<std::mutex> lock(self->state->mutex);
+        roi = engine.add_mask((const uint8_t *) PyArray_DATA(mask));
+    }
+    Py_DECREF(mask);
+    return PyLong_FromLong(roi);
+}
+
+/**
+ * @brief add_line(x0, y0, x1, y1) -> index, the pixels from (x0, y0) to (x1, y1) including both ends
+ */
+static PyObject *RoiEngine_add_line(RoiEngineObject *self, PyObject *args) {
+    int x0, y0, x1, y1;
+    if (!PyArg_ParseTuple(args, "iiii", &x0, &y0, &x1, &y1) || check_roi_count(self->state) < 0) {
+        return NULL;
+    }
+    std::lock_guard<std::mutex> lock(self->state->mutex);
+    return PyLong_FromLong(self->state->engine.add_line(x0, y0, x1, y1));
+}
+
+static PyObject *RoiEngine_clear(RoiEngineObject *self, PyObject *) {
+    std::lock_guard<std::mutex> lock(self->state->mutex);
+    self->state->engine.clear();
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief compute(frame, out=None, decimals=None)
+ * Statistics of every region in frame as a structured array with the fields min, max, mean, std (degrees
+ * Celsius), count and the coordinates min_x, min_y, max_x, max_y of the coldest and hottest pixel.
+ * The frame is read once with the GIL released.
+ */
+static PyObject *RoiEngine_compute(RoiEngineObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "frame", "out", "decimals", nullptr };
+    PyObject *frameObject;
+    PyObject *out = Py_None;
+    PyObject *decimals = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OO", (char **) keywords, &frameObject, &out, &decimals)) {
+        return NULL;
+    }
+    TemperatureScale scale;
+    if (parse_temperature_scale(decimals, scale) < 0) {
+        return NULL;
+    }
+    RoiEngineState *state = self->state;
+    PyArrayObject *frame = engine_frame(state, frameObject);
+    if (frame == NULL) {
+        return NULL;
+    }
+
+    npy_intp count = (npy_intp) state->engine.size();
+    PyObject *result;
+    if (out == Py_None) {
+        result = new_statistics_array(count);
+    } else if (!PyArray_Check(out) || !PyArray_EquivTypes(PyArray_DESCR((PyArrayObject *) out), roiDtype)
+            || PyArray_NDIM((PyArrayObject *) out) != 1 || PyArray_DIM((PyArrayObject *) out, 0) != count
+            || !PyArray_ISCARRAY((PyArrayObject *) out)) {
+        PyErr_SetString(PyExc_ValueError, "out must be a writeable contiguous array of RoiEngine.dtype with one entry per region");
+        result = NULL;
+    } else {
+        Py_INCREF(out);
+        result = out;
+    }
+    if (result == NULL) {
+        Py_DECREF(frame);
+        return NULL;
+    }
+
+    const uint16_t *data = (const uint16_t *) PyArray_DATA(frame);
+    RoiStatistics *stats = (RoiStatistics *) PyArray_DATA((PyArrayObject *) result);
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->engine.compute(data, stats, scale);
+    }
+    Py_END_ALLOW_THREADS
+    Py_DECREF(frame);
+    return result;
+}
+
+/**
+ * @brief profile(frame, index, decimals=None) -> float32 temperatures along a line region, from its start
+ */
+static PyObject *RoiEngine_profile(RoiEngineObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "frame", "index", "decimals", nullptr };
+    PyObject *frameObject;
+    Py_ssize_t index;
+    PyObject *decimals = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "On|O", (char **) keywords, &frameObject, &index, &decimals)) {
+        return NULL;
+    }
+    TemperatureScale scale;
+    if (parse_temperature_scale(decimals, scale) < 0) {
+        return NULL;
+    }
+    RoiEngineState *state = self->state;
+    if (index < 0 || (size_t) index >= state->engine.size() || state->engine.kind((size_t) index) != pyoptris::ROI_LINE) {
+        PyErr_SetString(PyExc_IndexError, "index is not a line region");
+        return NULL;
+    }
+    PyArrayObject *frame = engine_frame(state, frameObject);
+    if (frame == NULL) {
+        return NULL;
+    }
+    npy_intp length = (npy_intp) state->engine.profile_length((size_t) index);
+    PyObject *result = PyArray_SimpleNew(1, &length, NPY_FLOAT32);
+    if (result == NULL) {
+        Py_DECREF(frame);
+        return NULL;
+    }
+    const uint16_t *data = (const uint16_t *) PyArray_DATA(frame);
+    float *profile = (float *) PyArray_DATA((PyArrayObject *) result);
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::vector<uint16_t> raw((size_t) length);
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->engine.profile(data, (size_t) index, raw.data());
+        pyoptris::raw_to_celsius(raw.data(), profile, raw.size(), scale);
+    }
+    Py_END_ALLOW_THREADS
+    Py_DECREF(frame);
+    return result;
+}
+
+static Py_ssize_t RoiEngine_length(RoiEngineObject *self) {
+    return (Py_ssize_t) self->state->engine.size();
+}
+
+static PyObject *RoiEngine_get_size(RoiEngineObject *self, void *) {
+    return Py_BuildValue("ii", self->state->engine.width(), self->state->engine.height());
+}
+
+static PyObject *RoiEngine_get_dtype(RoiEngineObject *, void *) {
+    Py_INCREF(roiDtype);
+    return (PyObject *) roiDtype;
+}
+
+static PySequenceMethods RoiEngine_sequence = {
+    (lenfunc) RoiEngine_length,
+};
+
+static PyMethodDef RoiEngine_methods[] = {
+    { "add_rect",       (PyCFunction) RoiEngine_add_rect,       METH_VARARGS, "add_rect(x, y, width, height) -> index" },
+    { "add_polygon",    (PyCFunction) RoiEngine_add_polygon,    METH_O, "add_polygon(points) -> index" },
+    { "add_mask",       (PyCFunction) RoiEngine_add_mask,       METH_O, "add_mask(mask) -> index" },
+    { "add_line",       (PyCFunction) RoiEngine_add_line,       METH_VARARGS, "add_line(x0, y0, x1, y1) -> index" },
+    { "clear",          (PyCFunction) RoiEngine_clear,          METH_NOARGS, "Removes all regions" },
+    { "compute",        (PyCFunction) RoiEngine_compute,        METH_VARARGS | METH_KEYWORDS, "compute(frame, out=None, decimals=None) -> statistics of every region" },
+    { "profile",        (PyCFunction) RoiEngine_profile,        METH_VARARGS | METH_KEYWORDS, "profile(frame, index, decimals=None) -> temperatures along a line region" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef RoiEngine_getset[] = {
+    { "size",   (getter) RoiEngine_get_size,    nullptr, "(width, height) of the frames", nullptr },
+    { "dtype",  (getter) RoiEngine_get_dtype,   nullptr, "Structured dtype of the statistics", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+/**
+ * @brief RoiMonitor(engine, capture, capacity=64)
+ * Evaluates a copy of engine on every frame of capture (a pyoptris.Capture or pyoptris.Camera) on a native
+ * thread. Only the statistics cross into Python, frames never do.
+ */
+static PyObject *RoiMonitor_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "engine", "capture", "capacity", nullptr };
+    PyObject *engineObject;
+    PyObject *captureObject;
+    Py_ssize_t capacity = 64;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!O|n", (char **) keywords, &RoiEngineType, &engineObject, &captureObject, &capacity)) {
+        return NULL;
+    }
+    if (capacity < 2) {
+        PyErr_SetString(PyExc_ValueError, "capacity must be at least 2");
+        return NULL;
+    }
+    std::shared_ptr<Capture> capture = capture_of(captureObject);
+    if (capture == nullptr) {
+        return NULL;
+    }
+
+    RoiEngineState *engineState = ((RoiEngineObject *) engineObject)->state;
+    std::shared_ptr<RoiMonitor> monitor;
+    bool started;
+    try {
+        {
+            std::lock_guard<std::mutex> lock(engineState->mutex);
+            monitor = std::make_shared<RoiMonitor>(capture, engineState->engine, current_temperature_scale(), (size_t) capacity);
+        }
+        started = monitor->start();
+    } catch (const std::bad_alloc &) {
+        return PyErr_NoMemory();
+    }
+    if (!started) {
+        PyErr_SetString(PyExc_ValueError, "engine size does not match the frames of the capture");
+        return NULL;
+    }
+
+    RoiMonitorObject *self = (RoiMonitorObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        monitor.reset();
+        Py_END_ALLOW_THREADS
+        return NULL;
+    }
+    self->state = new RoiMonitorState();
+    self->state->monitor = monitor;
+    self->state->cursor = monitor->cursor();
+    self->state->result.resize(monitor->result_size());
+    return (PyObject *) self;
+}
+
+static void RoiMonitor_dealloc(RoiMonitorObject *self) {
+    RoiMonitorState *state = self->state;
+    Py_BEGIN_ALLOW_THREADS
+    delete state;
+    Py_END_ALLOW_THREADS
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief Copies the result in the state buffer out while state->mutex is held, the next caller overwrites it
+ */
+static void take_result(RoiMonitorState *state, PyObject *stats, RoiResultHeader &header) {
+    std::memcpy(&header, state->result.data(), sizeof(RoiResultHeader));
+    std::memcpy(PyArray_DATA((PyArrayObject *) stats), state->result.data() + sizeof(RoiResultHeader),
+                state->monitor->rois() * sizeof(RoiStatistics));
+}
+
+/**
+ * @brief (statistics, timestamp, sequence), steals stats
+ */
+static PyObject *result_tuple(PyObject *stats, const RoiResultHeader &header) {
+    return Py_BuildValue("NLK", stats, (long long) header.timestamp, (unsigned long long) header.sequence);
+}
+
+/**
+ * @brief next(timeout=None) -> (statistics, timestamp, sequence) of the next frame, None on timeout
+ */
+static PyObject *RoiMonitor_next(RoiMonitorObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "timeout", nullptr };
+    PyObject *timeout = Py_None;
+    int64_t timeoutNs;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", (char **) keywords, &timeout) || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+    RoiMonitorState *state = self->state;
+    PyObject *stats = new_statistics_array((npy_intp) state->monitor->rois());
+    if (stats == NULL) {
+        return NULL;
+    }
+    RoiResultHeader header;
+    int result = wait_released([state, stats, &header](int64_t slice) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        Capture::WaitResult wait = state->monitor->next(state->cursor, state->result.data(), slice);
+        if (wait == Capture::WAIT_FRAME) {
+            take_result(state, stats, header);
+        }
+        return wait;
+    }, timeoutNs);
+    switch(result) {
+        case Capture::WAIT_FRAME:
+            return result_tuple(stats, header);
+
+        case Capture::WAIT_TIMEOUT:
+            Py_DECREF(stats);
+            Py_RETURN_NONE;
+
+        case Capture::WAIT_CLOSED:
+            Py_DECREF(stats);
+            PyErr_SetString(PyExc_RuntimeError, "Monitor stopped");
+            return NULL;
+
+        default:
+            Py_DECREF(stats);
+            return NULL;
+    }
+}
+
+/**
+ * @brief latest() -> (statistics, timestamp, sequence) of the most recent frame, None before the first one
+ */
+static PyObject *RoiMonitor_latest(RoiMonitorObject *self, PyObject *) {
+    RoiMonitorState *state = self->state;
+    PyObject *stats = new_statistics_array((npy_intp) state->monitor->rois());
+    if (stats == NULL) {
+        return NULL;
+    }
+    RoiResultHeader header;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        ok = state->monitor->latest(state->result.data());
+        if (ok) {
+            take_result(state, stats, header);
+        }
+    }
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        Py_DECREF(stats);
+        Py_RETURN_NONE;
+    }
+    return result_tuple(stats, header);
+}
+
+static PyObject *RoiMonitor_stop(RoiMonitorObject *self, PyObject *) {
+    std::shared_ptr<RoiMonitor> monitor = self->state->monitor;
+    Py_BEGIN_ALLOW_THREADS
+    monitor->stop();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *RoiMonitor_enter(RoiMonitorObject *self, PyObject *) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject *RoiMonitor_exit(RoiMonitorObject *self, PyObject *) {
+    return RoiMonitor_stop(self, NULL);
+}
+
+static PyObject *RoiMonitor_get_frames(RoiMonitorObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->monitor->frames());
+}
+
+static PyObject *RoiMonitor_get_skipped(RoiMonitorObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->monitor->dropped());
+}
+
+static PyObject *RoiMonitor_get_dropped(RoiMonitorObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->cursor.dropped);
+}
+
+static PyObject *RoiMonitor_get_running(RoiMonitorObject *self, void *) {
+    return PyBool_FromLong(self->state->monitor->running());
+}
+
+static PyMethodDef RoiMonitor_methods[] = {
+    { "next",       (PyCFunction) RoiMonitor_next,      METH_VARARGS | METH_KEYWORDS, "next(timeout=None) -> (statistics, timestamp, sequence), None on timeout" },
+    { "latest",     (PyCFunction) RoiMonitor_latest,    METH_NOARGS, "(statistics, timestamp, sequence) of the most recent frame, None if there is none" },
+    { "stop",       (PyCFunction) RoiMonitor_stop,      METH_NOARGS, "Stops the monitor thread" },
+    { "__enter__",  (PyCFunction) RoiMonitor_enter,     METH_NOARGS, nullptr },
+    { "__exit__",   (PyCFunction) RoiMonitor_exit,      METH_VARARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef RoiMonitor_getset[] = {
+    { "frames",     (getter) RoiMonitor_get_frames,     nullptr, "Frames evaluated so far", nullptr },
+    { "skipped",    (getter) RoiMonitor_get_skipped,    nullptr, "Frames overwritten in the capture ring before the monitor got to them", nullptr },
+    { "dropped",    (getter) RoiMonitor_get_dropped,    nullptr, "Results overwritten before this object read them", nullptr },
+    { "running",    (getter) RoiMonitor_get_running,    nullptr, "True while the monitor thread is alive", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+static int create_roi_dtype() {
+    PyObject *fields = Py_BuildValue("[(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)]",
+        "min", "<f4", "max", "<f4", "mean", "<f4", "std", "<f4", "count", "<u4",
+        "min_x", "<u2", "min_y", "<u2", "max_x", "<u2", "max_y", "<u2");
+    if (fields == NULL) {
+        return -1;
+    }
+    // Packed like RoiStatistics, whose fields need no padding
+    int ok = PyArray_DescrConverter(fields, &roiDtype);
+    Py_DECREF(fields);
+    return ok ? 0 : -1;
+}
+
+int add_roi_types(PyObject *module) {
+    if (create_roi_dtype() < 0) {
+        return -1;
+    }
+
+    RoiEngineType.tp_name = "pyoptris.RoiEngine";
+    RoiEngineType.tp_basicsize = sizeof(RoiEngineObject);
+    RoiEngineType.tp_flags = Py_TPFLAGS_DEFAULT;
+    RoiEngineType.tp_doc = "RoiEngine(width, height): statistics of many regions of interest in one pass over a frame";
+    RoiEngineType.tp_new = RoiEngine_new;
+    RoiEngineType.tp_dealloc = (destructor) RoiEngine_dealloc;
+    RoiEngineType.tp_as_sequence = &RoiEngine_sequence;
+    RoiEngineType.tp_methods = RoiEngine_methods;
+    RoiEngineType.tp_getset = RoiEngine_getset;
+
+    RoiMonitorType.tp_name = "pyoptris.RoiMonitor";
+    RoiMonitorType.tp_basicsize = sizeof(RoiMonitorObject);
+    RoiMonitorType.tp_flags = Py_TPFLAGS_DEFAULT;
+    RoiMonitorType.tp_doc = "RoiMonitor(engine, capture, capacity=64): evaluates regions on every frame of a capture on a native thread";
+    RoiMonitorType.tp_new = RoiMonitor_new;
+    RoiMonitorType.tp_dealloc = (destructor) RoiMonitor_dealloc;
+    RoiMonitorType.tp_methods = RoiMonitor_methods;
+    RoiMonitorType.tp_getset = RoiMonitor_getset;
+
+    if (PyType_Ready(&RoiEngineType) < 0 || PyType_Ready(&RoiMonitorType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&RoiEngineType);
+    if (PyModule_AddObject(module, "RoiEngine", (PyObject *) &RoiEngineType) < 0) {
+        Py_DECREF(&RoiEngineType);
+        return -1;
+    }
+    Py_INCREF(&RoiMonitorType);
+    if (PyModule_AddObject(module, "RoiMonitor", (PyObject *) &RoiMonitorType) < 0) {
+        Py_DECREF(&RoiMonitorType);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,399 @@
+#include "_pyoptris.h"
+
+#include "shared_ring.h"
+
+#include <cstring>
+#include <mutex>
+#include <string>
+
+using pyoptris::Capture;
+using pyoptris::FrameInfo;
+using pyoptris::SharedPublisher;
+using pyoptris::SharedSubscriber;
+
+typedef struct {
+    PyObject_HEAD
+    SharedPublisher *publisher;
+} PublisherObject;
+
+struct SubscriberState {
+    SharedSubscriber subscriber;
+    std::string name;
+    Capture::Cursor cursor;
+    std::mutex mutex;   // cursor, never held together with the GIL
+};
+
+typedef struct {
+    PyObject_HEAD
+    SubscriberState *state;
+} SubscriberObject;
+
+static PyTypeObject PublisherType = { PyVarObject_HEAD_INIT(NULL, 0) };
+static PyTypeObject SubscriberType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+/**
+ * @brief SharedPublisher(name, capture, capacity=16)
+ * Publishes every frame of capture (a pyoptris.Capture or pyoptris.Camera) into the POSIX shared memory
+ * object name on a native thread, for SharedSubscriber objects in other processes.
+ */
+static PyObject *Publisher_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "name", "capture", "capacity", nullptr };
+    const char *name;
+    PyObject *captureObject;
+    Py_ssize_t capacity = 16;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|n", (char **) keywords, &name, &captureObject, &capacity)) {
+        return NULL;
+    }
+    if (capacity < 2) {
+        PyErr_SetString(PyExc_ValueError, "capacity must be at least 2");
+        return NULL;
+    }
+    std::shared_ptr<Capture> capture = capture_of(captureObject);
+    if (capture == nullptr) {
+        return NULL;
+    }
+
+    SharedPublisher *publisher = new SharedPublisher(name, capture, (size_t) capacity, current_temperature_decimals());
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = publisher->start(error);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        delete publisher;
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return NULL;
+    }
+
+    PublisherObject *self = (PublisherObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        delete publisher;
+        Py_END_ALLOW_THREADS
+        return NULL;
+    }
+    self->publisher = publisher;
+    return (PyObject *) self;
+}
+
+static void Publisher_dealloc(PublisherObject *self) {
+    SharedPublisher *publisher = self->publisher;
+    Py_BEGIN_ALLOW_THREADS
+    delete publisher;
+    Py_END_ALLOW_THREADS
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief Stops publishing, subscribers see the end of the stream and the name is removed
+ */
+static PyObject *Publisher_stop(PublisherObject *self, PyObject *) {
+    SharedPublisher *publisher = self->publisher;
+    Py_BEGIN_ALLOW_THREADS
+    publisher->stop();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *Publisher_enter(PublisherObject *self, PyObject *) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject *Publisher_exit(PublisherObject *self, PyObject *) {
+    return Publisher_stop(self, NULL);
+}
+
+static PyObject *Publisher_get_name(PublisherObject *self, void *) {
+    return PyUnicode_FromString(self->publisher->name().c_str());
+}
+
+static PyObject *Publisher_get_frames(PublisherObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->publisher->frames());
+}
+
+static PyObject *Publisher_get_dropped(PublisherObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->publisher->dropped());
+}
+
+static PyObject *Publisher_get_running(PublisherObject *self, void *) {
+    return PyBool_FromLong(self->publisher->running());
+}
+
+static PyMethodDef Publisher_methods[] = {
+    { "stop",       (PyCFunction) Publisher_stop,   METH_NOARGS, "Stops publishing and removes the shared memory name" },
+    { "__enter__",  (PyCFunction) Publisher_enter,  METH_NOARGS, nullptr },
+    { "__exit__",   (PyCFunction) Publisher_exit,   METH_VARARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Publisher_getset[] = {
+    { "name",       (getter) Publisher_get_name,    nullptr, "Name of the shared memory object", nullptr },
+    { "frames",     (getter) Publisher_get_frames,  nullptr, "Frames published so far", nullptr },
+    { "dropped",    (getter) Publisher_get_dropped, nullptr, "Capture frames overwritten before the publisher got to them", nullptr },
+    { "running",    (getter) Publisher_get_running, nullptr, "True while the publisher thread is alive", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+/**
+ * @brief SharedSubscriber(name)
+ * Maps the frame ring a SharedPublisher in another process writes to, positioned at the next frame.
+ */
+static PyObject *Subscriber_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "name", nullptr };
+    const char *name;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) keywords, &name)) {
+        return NULL;
+    }
+    SubscriberState *state = new SubscriberState();
+    std::string error;
+    if (!state->subscriber.open(name, error)) {
+        delete state;
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return NULL;
+    }
+    state->name = name;
+    state->cursor = state->subscriber.cursor();
+
+    SubscriberObject *self = (SubscriberObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        delete state;
+        return NULL;
+    }
+    self->state = state;
+    return (PyObject *) self;
+}
+
+static void Subscriber_dealloc(SubscriberObject *self) {
+    delete self->state;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief Read-only view of a frame in the mapping, the view keeps the subscriber and so the mapping alive
+ */
+static PyObject *frame_view(SubscriberObject *self, const uint16_t *frame) {
+    npy_intp dimensions[2] = { self->state->subscriber.height(), self->state->subscriber.width() };
+    PyObject *view = PyArray_SimpleNewFromData(2, dimensions, NPY_UINT16, (void *) frame);
+    if (view == NULL) {
+        return NULL;
+    }
+    PyArray_CLEARFLAGS((PyArrayObject *) view, NPY_ARRAY_WRITEABLE);
+    Py_INCREF(self);
+    if (PyArray_SetBaseObject((PyArrayObject *) view, (PyObject *) self) < 0) {
+        Py_DECREF(view);
+        return NULL;
+    }
+    return view;
+}
+
+static PyObject *new_frame_array(SubscriberState *state) {
+    npy_intp dimensions[2] = { state->subscriber.height(), state->subscriber.width() };
+    return new_pooled_array(frame_pool(), 2, dimensions, NPY_UINT16);
+}
+
+/**
+ * @brief next(timeout=None, copy=False) -> (frame, timestamp, sequence), None on timeout
+ * frame is a read-only view into shared memory that stays correct until the publisher laps the ring,
+ * check valid(sequence) after using it. copy=True returns a private array checked against that instead.
+ */
+static PyObject *Subscriber_next(SubscriberObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "timeout", "copy", nullptr };
+    PyObject *timeout = Py_None;
+    int copy = 0;
+    int64_t timeoutNs;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|Op", (char **) keywords, &timeout, &copy) || parse_timeout(timeout, timeoutNs) < 0) {
+        return NULL;
+    }
+    SubscriberState *state = self->state;
+    PyObject *frame = NULL;
+    void *data = NULL;
+    if (copy) {
+        frame = new_frame_array(state);
+        if (frame == NULL) {
+            return NULL;
+        }
+        data = PyArray_DATA((PyArrayObject *) frame);
+    }
+
+    const uint16_t *shared = nullptr;
+    FrameInfo info;
+    int result = wait_released([state, data, &shared, &info](int64_t slice) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        uint64_t dropped = state->cursor.dropped;
+        for (;;) {
+            Capture::WaitResult wait = state->subscriber.next(state->cursor, &shared, &info, slice);
+            if (wait == Capture::WAIT_FRAME && data != nullptr) {
+                std::memcpy(data, shared, state->subscriber.frame_size());
+                if (!state->subscriber.valid(info.sequence)) {
+                    // Overwritten while copying
+                    state->cursor.dropped++;
+                    continue;
+                }
+            }
+            if (wait == Capture::WAIT_FRAME) {
+                record_delivery(info, state->cursor.dropped - dropped);
+            }
+            return wait;
+        }
+    }, timeoutNs);
+    switch(result) {
+        case Capture::WAIT_FRAME:
+            if (frame == NULL) {
+                frame = frame_view(self, shared);
+                if (frame == NULL) {
+                    return NULL;
+                }
+            }
+            return Py_BuildValue("NLK", frame, (long long) info.timestamp, (unsigned long long) info.sequence);
+
+        case Capture::WAIT_TIMEOUT:
+            Py_XDECREF(frame);
+            Py_RETURN_NONE;
+
+        case Capture::WAIT_CLOSED:
+            PyErr_SetString(PyExc_RuntimeError, "Publisher stopped");
+            break;
+
+        default:
+            break;
+    }
+    Py_XDECREF(frame);
+    return NULL;
+}
+
+/**
+ * @brief latest(copy=False) -> (frame, timestamp, sequence) of the most recent frame, None before the first one.
+ * Does not move the subscriber.
+ */
+static PyObject *Subscriber_latest(SubscriberObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "copy", nullptr };
+    int copy = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", (char **) keywords, &copy)) {
+        return NULL;
+    }
+    SubscriberState *state = self->state;
+    const uint16_t *shared;
+    FrameInfo info;
+    if (!copy) {
+        if (!state->subscriber.latest(&shared, &info)) {
+            Py_RETURN_NONE;
+        }
+        PyObject *view = frame_view(self, shared);
+        if (view == NULL) {
+            return NULL;
+        }
+        record_delivery(info, 0);
+        return Py_BuildValue("NLK", view, (long long) info.timestamp, (unsigned long long) info.sequence);
+    }
+
+    PyObject *frame = new_frame_array(state);
+    if (frame == NULL) {
+        return NULL;
+    }
+    void *data = PyArray_DATA((PyArrayObject *) frame);
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    do {
+        ok = state->subscriber.latest(&shared, &info);
+    } while (ok && state->subscriber.read(info.sequence, data, &info) != pyoptris::FrameRing::READ_OK);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        Py_DECREF(frame);
+        Py_RETURN_NONE;
+    }
+    record_delivery(info, 0);
+    return Py_BuildValue("NLK", frame, (long long) info.timestamp, (unsigned long long) info.sequence);
+}
+
+/**
+ * @brief valid(sequence) -> True while the views of frame sequence still show that frame
+ */
+static PyObject *Subscriber_valid(SubscriberObject *self, PyObject *arg) {
+    unsigned long long sequence = PyLong_AsUnsignedLongLong(arg);
+    if (sequence == (unsigned long long) -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+    return PyBool_FromLong(self->state->subscriber.valid(sequence));
+}
+
+static PyObject *Subscriber_get_name(SubscriberObject *self, void *) {
+    return PyUnicode_FromString(self->state->name.c_str());
+}
+
+static PyObject *Subscriber_get_size(SubscriberObject *self, void *) {
+    return Py_BuildValue("ii", self->state->subscriber.width(), self->state->subscriber.height());
+}
+
+static PyObject *Subscriber_get_capacity(SubscriberObject *self, void *) {
+    return PyLong_FromSize_t(self->state->subscriber.capacity());
+}
+
+static PyObject *Subscriber_get_frames(SubscriberObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->subscriber.head());
+}
+
+static PyObject *Subscriber_get_dropped(SubscriberObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->state->cursor.dropped);
+}
+
+static PyObject *Subscriber_get_closed(SubscriberObject *self, void *) {
+    return PyBool_FromLong(self->state->subscriber.closed());
+}
+
+static PyObject *Subscriber_get_temperature_decimals(SubscriberObject *self, void *) {
+    return PyLong_FromLong(self->state->subscriber.temperature_decimals());
+}
+
+static PyMethodDef Subscriber_methods[] = {
+    { "next",       (PyCFunction) Subscriber_next,      METH_VARARGS | METH_KEYWORDS, "next(timeout=None, copy=False) -> (frame, timestamp, sequence), None on timeout" },
+    { "latest",     (PyCFunction) Subscriber_latest,    METH_VARARGS | METH_KEYWORDS, "latest(copy=False) -> (frame, timestamp, sequence) of the most recent frame" },
+    { "valid",      (PyCFunction) Subscriber_valid,     METH_O, "valid(sequence): True until the publisher overwrites the frame" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef Subscriber_getset[] = {
+    { "name",                   (getter) Subscriber_get_name,                   nullptr, "Name of the shared memory object", nullptr },
+    { "size",                   (getter) Subscriber_get_size,                   nullptr, "(width, height) of the frames", nullptr },
+    { "capacity",               (getter) Subscriber_get_capacity,               nullptr, "Ring size in frames", nullptr },
+    { "frames",                 (getter) Subscriber_get_frames,                 nullptr, "Frames published so far", nullptr },
+    { "dropped",                (getter) Subscriber_get_dropped,                nullptr, "Frames overwritten before this subscriber read them", nullptr },
+    { "closed",                 (getter) Subscriber_get_closed,                 nullptr, "True once the publisher stopped or its process is gone", nullptr },
+    { "temperature_decimals",   (getter) Subscriber_get_temperature_decimals,   nullptr, "Decimals of the raw values, as set in the publishing process", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+int add_shared_types(PyObject *module) {
+    PublisherType.tp_name = "pyoptris.SharedPublisher";
+    PublisherType.tp_basicsize = sizeof(PublisherObject);
+    PublisherType.tp_flags = Py_TPFLAGS_DEFAULT;
+    PublisherType.tp_doc = "SharedPublisher(name, capture, capacity=16): publishes frames into POSIX shared memory";
+    PublisherType.tp_new = Publisher_new;
+    PublisherType.tp_dealloc = (destructor) Publisher_dealloc;
+    PublisherType.tp_methods = Publisher_methods;
+    PublisherType.tp_getset = Publisher_getset;
+
+    SubscriberType.tp_name = "pyoptris.SharedSubscriber";
+    SubscriberType.tp_basicsize = sizeof(SubscriberObject);
+    SubscriberType.tp_flags = Py_TPFLAGS_DEFAULT;
+    SubscriberType.tp_doc = "SharedSubscriber(name): zero-copy reader of a SharedPublisher in another process";
+    SubscriberType.tp_new = Subscriber_new;
+    SubscriberType.tp_dealloc = (destructor) Subscriber_dealloc;
+    SubscriberType.tp_methods = Subscriber_methods;
+    SubscriberType.tp_getset = Subscriber_getset;
+
+    if (PyType_Ready(&PublisherType) < 0 || PyType_Ready(&SubscriberType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&PublisherType);
+    if (PyModule_AddObject(module, "SharedPublisher", (PyObject *) &PublisherType) < 0) {
+        Py_DECREF(&PublisherType);
+        return -1;
+    }
+    Py_INCREF(&SubscriberType);
+    if (PyModule_AddObject(module, "SharedSubscriber", (PyObject *) &SubscriberType) < 0) {
+        Py_DECREF(&SubscriberType);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,327 @@
+#include "_pyoptris.h"
+
+#include "spatial.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+using pyoptris::SpatialFilter;
+
+struct SpatialState {
+    SpatialFilter filter;
+    std::mutex mutex;   // stages and scratch buffers, never held together with the GIL
+
+    SpatialState(int width, int height, int threads) : filter(width, height, threads) {}
+};
+
+typedef struct {
+    PyObject_HEAD
+    SpatialState *state;
+} SpatialFilterObject;
+
+static PyTypeObject SpatialFilterType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+/**
+ * @brief SpatialFilter(size, threads=None)
+ * Chain of spatial filters run on raw uint16 frames in a single pass, added with add_bad_pixels(),
+ * add_median() and add_denoise() and applied in that order. Frames are split into bands of rows
+ * across threads, None uses up to 8 of the hardware threads. size=(width, height) of the frames.
+ */
+static PyObject *SpatialFilter_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "size", "threads", nullptr };
+    int width, height;
+    PyObject *threadsObject = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "(ii)|O", (char **) keywords, &width, &height, &threadsObject)) {
+        return NULL;
+    }
+    if (width <= 0 || height <= 0) {
+        PyErr_SetString(PyExc_ValueError, "size must be positive");
+        return NULL;
+    }
+    int threads = pyoptris::default_worker_threads();
+    if (threadsObject != Py_None) {
+        long value = PyLong_AsLong(threadsObject);
+        if (value == -1 && PyErr_Occurred()) {
+            return NULL;
+        }
+        if (value < 1 || value > 64) {
+            PyErr_SetString(PyExc_ValueError, "threads must be in [1, 64]");
+            return NULL;
+        }
+        threads = (int) value;
+    }
+    // More threads than bands would only wait
+    threads = std::min(threads, (height + SpatialFilter::BAND_ROWS - 1) / SpatialFilter::BAND_ROWS);
+
+    SpatialState *state = nullptr;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        state = new SpatialState(width, height, threads);
+    } catch (const std::exception &) {
+    }
+    Py_END_ALLOW_THREADS
+    if (state == nullptr) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to start the filter threads");
+        return NULL;
+    }
+    SpatialFilterObject *self = (SpatialFilterObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        delete state;
+        return NULL;
+    }
+    self->state = state;
+    return (PyObject *) self;
+}
+
+static void SpatialFilter_dealloc(SpatialFilterObject *self) {
+    delete self->state;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static int check_stage_count(SpatialState *state) {
+    if (state->filter.stages() >= SpatialFilter::MAX_STAGES) {
+        PyErr_Format(PyExc_ValueError, "At most %d stages", (int) SpatialFilter::MAX_STAGES);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief add_bad_pixels(mask) -> pixels in the mask, mask is a (height, width) array, non-zero pixels are replaced
+ */
+static PyObject *SpatialFilter_add_bad_pixels(SpatialFilterObject *self, PyObject *maskObject) {
+    SpatialState *state = self->state;
+    if (check_stage_count(state) < 0) {
+        return NULL;
+    }
+    PyArrayObject *mask = (PyArrayObject *) PyArray_FROM_OTF(maskObject, NPY_BOOL, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+    if (mask == NULL) {
+        return NULL;
+    }
+    int width = state->filter.width(), height = state->filter.height();
+    if (PyArray_NDIM(mask) != 2 || PyArray_DIM(mask, 0) != height || PyArray_DIM(mask, 1) != width) {
+        PyErr_Format(PyExc_ValueError, "mask must have shape (%d, %d)", height, width);
+        Py_DECREF(mask);
+        return NULL;
+    }
+    const uint8_t *maskData = (const uint8_t *) PyArray_DATA(mask);
+    size_t pixels = 0;
+    bool failed = false;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        try {
+            pixels = state->filter.add_bad_pixels(maskData);
+        } catch (const std::bad_alloc &) {
+            failed = true;
+        }
+    }
+    Py_END_ALLOW_THREADS
+    Py_DECREF(mask);
+    if (failed) {
+        return PyErr_NoMemory();
+    }
+    return PyLong_FromSize_t(pixels);
+}
+
+/**
+ * @brief add_median(size=3), size is 3 or 5
+ */
+static PyObject *SpatialFilter_add_median(SpatialFilterObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "size", nullptr };
+    int size = 3;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|i", (char **) keywords, &size) || check_stage_count(self->state) < 0) {
+        return NULL;
+    }
+    if (size != 3 && size != 5) {
+        PyErr_SetString(PyExc_ValueError, "size must be 3 or 5");
+        return NULL;
+    }
+    bool failed = false;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(self->state->mutex);
+        try {
+            self->state->filter.add_median(size);
+        } catch (const std::bad_alloc &) {
+            failed = true;
+        }
+    }
+    Py_END_ALLOW_THREADS
+    if (failed) {
+        return PyErr_NoMemory();
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief add_denoise(threshold), threshold is the largest difference to the centre in raw counts that is averaged
+ */
+static PyObject *SpatialFilter_add_denoise(SpatialFilterObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "threshold", nullptr };
+    int threshold;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i", (char **) keywords, &threshold) || check_stage_count(self->state) < 0) {
+        return NULL;
+    }
+    if (threshold < 0 || threshold > 65535) {
+        PyErr_SetString(PyExc_ValueError, "threshold must be in [0, 65535]");
+        return NULL;
+    }
+    bool failed = false;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(self->state->mutex);
+        try {
+            self->state->filter.add_denoise((uint16_t) threshold);
+        } catch (const std::bad_alloc &) {
+            failed = true;
+        }
+    }
+    Py_END_ALLOW_THREADS
+    if (failed) {
+        return PyErr_NoMemory();
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *SpatialFilter_clear(SpatialFilterObject *self, PyObject *) {
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(self->state->mutex);
+        self->state->filter.clear();
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief apply(frame, out=None) -> filtered uint16 frame, out may be frame itself
+ */
+static PyObject *SpatialFilter_apply(SpatialFilterObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "frame", "out", nullptr };
+    PyObject *frameObject;
+    PyObject *out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", (char **) keywords, &frameObject, &out)) {
+        return NULL;
+    }
+    SpatialState *state = self->state;
+    PyArrayObject *frame = (PyArrayObject *) PyArray_FROM_OTF(frameObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (frame == NULL) {
+        return NULL;
+    }
+    int width = state->filter.width(), height = state->filter.height();
+    if (PyArray_NDIM(frame) != 2 || PyArray_DIM(frame, 0) != height || PyArray_DIM(frame, 1) != width) {
+        PyErr_Format(PyExc_ValueError, "frame must be a (%d, %d) array", height, width);
+        Py_DECREF(frame);
+        return NULL;
+    }
+    PyObject *result = frame_array(out, 2, PyArray_DIMS(frame), NPY_UINT16);
+    if (result == NULL) {
+        Py_DECREF(frame);
+        return NULL;
+    }
+    const uint16_t *frameData = (const uint16_t *) PyArray_DATA(frame);
+    uint16_t *outData = (uint16_t *) PyArray_DATA((PyArrayObject *) result);
+    bool failed = false;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        try {
+            state->filter.apply(frameData, outData);
+        } catch (const std::bad_alloc &) {
+            failed = true;
+        }
+    }
+    Py_END_ALLOW_THREADS
+    Py_DECREF(frame);
+    if (failed) {
+        Py_DECREF(result);
+        return PyErr_NoMemory();
+    }
+    return result;
+}
+
+/**
+ * @brief stages -> [(kind, parameter)], the median size, denoise threshold or bad pixel count of every stage
+ */
+static PyObject *SpatialFilter_get_stages(SpatialFilterObject *self, void *) {
+    SpatialState *state = self->state;
+    std::vector<std::pair<int, uint32_t>> stages;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        for (size_t i = 0; i < state->filter.stages(); i++) {
+            stages.emplace_back((int) state->filter.kind(i), state->filter.parameter(i));
+        }
+    }
+    Py_END_ALLOW_THREADS
+    PyObject *list = PyList_New((Py_ssize_t) stages.size());
+    if (list == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < stages.size(); i++) {
+        PyObject *stage = Py_BuildValue("(ik)", stages[i].first, (unsigned long) stages[i].second);
+        if (stage == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, (Py_ssize_t) i, stage);
+    }
+    return list;
+}
+
+static PyObject *SpatialFilter_get_size(SpatialFilterObject *self, void *) {
+    return Py_BuildValue("ii", self->state->filter.width(), self->state->filter.height());
+}
+
+static PyObject *SpatialFilter_get_threads(SpatialFilterObject *self, void *) {
+    return PyLong_FromLong(self->state->filter.threads());
+}
+
+static PyObject *SpatialFilter_get_isa(SpatialFilterObject *, void *) {
+    return PyUnicode_FromString(pyoptris::spatial_isa());
+}
+
+static PyMethodDef SpatialFilter_methods[] = {
+    { "add_bad_pixels", (PyCFunction) SpatialFilter_add_bad_pixels, METH_O, "add_bad_pixels(mask) -> pixels in the mask, replaced by the mean of their good neighbours" },
+    { "add_median",     (PyCFunction) SpatialFilter_add_median,     METH_VARARGS | METH_KEYWORDS, "add_median(size=3), 3x3 or 5x5 median" },
+    { "add_denoise",    (PyCFunction) SpatialFilter_add_denoise,    METH_VARARGS | METH_KEYWORDS, "add_denoise(threshold), mean of the 3x3 neighbours within threshold counts" },
+    { "clear",          (PyCFunction) SpatialFilter_clear,          METH_NOARGS, "Removes every stage" },
+    { "apply",          (PyCFunction) SpatialFilter_apply,          METH_VARARGS | METH_KEYWORDS, "apply(frame, out=None) -> filtered uint16 frame" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef SpatialFilter_getset[] = {
+    { "stages",  (getter) SpatialFilter_get_stages,  nullptr, "[(kind, parameter)] in the order applied", nullptr },
+    { "size",    (getter) SpatialFilter_get_size,    nullptr, "(width, height) of the frames it filters", nullptr },
+    { "threads", (getter) SpatialFilter_get_threads, nullptr, "Threads a frame is split across", nullptr },
+    { "isa",     (getter) SpatialFilter_get_isa,     nullptr, "Instruction set of the median and denoise kernels", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+int add_spatial_type(PyObject *module) {
+    SpatialFilterType.tp_name = "pyoptris.SpatialFilter";
+    SpatialFilterType.tp_basicsize = sizeof(SpatialFilterObject);
+    SpatialFilterType.tp_flags = Py_TPFLAGS_DEFAULT;
+    SpatialFilterType.tp_doc = "SpatialFilter(size, threads=None): bad pixel, median and denoise stages run on raw frames in one pass";
+    SpatialFilterType.tp_new = SpatialFilter_new;
+    SpatialFilterType.tp_dealloc = (destructor) SpatialFilter_dealloc;
+    SpatialFilterType.tp_methods = SpatialFilter_methods;
+    SpatialFilterType.tp_getset = SpatialFilter_getset;
+    if (PyType_Ready(&SpatialFilterType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&SpatialFilterType);
+    if (PyModule_AddObject(module, "SpatialFilter", (PyObject *) &SpatialFilterType) < 0) {
+        Py_DECREF(&SpatialFilterType);
+        return -1;
+    }
+    if (PyModule_AddIntConstant(module, "SPATIAL_BAD_PIXELS", SpatialFilter::BAD_PIXELS) < 0
+            || PyModule_AddIntConstant(module, "SPATIAL_MEDIAN", SpatialFilter::MEDIAN) < 0
+            || PyModule_AddIntConstant(module, "SPATIAL_DENOISE", SpatialFilter::DENOISE) < 0) {
+        return -1;
+    }
+    return 0;
+}
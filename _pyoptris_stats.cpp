@@ -0,0 +1,187 @@
+#include "_pyoptris.h"
+
+#include <cmath>
+
+using pyoptris::FrameInfo;
+using pyoptris::LatencyHistogram;
+using pyoptris::PipelineStatistics;
+
+// Left zeroed, PyStructSequence_InitType2 fills it in and rejects types with a reference count set
+static PyTypeObject FrameMetadataType;
+
+static PyStructSequence_Field FrameMetadata_fields[] = {
+    { "sequence",           "Capture counter of the frame, the camera frame counter for the module level accessors" },
+    { "timestamp",          "Acquisition time in ns since the epoch" },
+    { "flag",               "Shutter flag state, one of FLAG_OPEN/CLOSED/OPENING/CLOSING/ERROR, None if not reported" },
+    { "chip_temperature",   "Detector temperature in degrees Celsius, None if not reported" },
+    { "fetch_ns",           "Time the SDK call blocked for this frame in ns" },
+    { "validity",           "FRAME_VALID, or why the flag gate rejected the frame: FRAME_FLAG, FRAME_SETTLING or FRAME_FROZEN" },
+    { "held",               "True if the pixels are the last valid frame, published in place of this one by FLAG_POLICY_HOLD" },
+    { nullptr, nullptr }
+};
+
+static PyStructSequence_Desc FrameMetadata_desc = {
+    "pyoptris.FrameMetadata",
+    "Acquisition record of one frame",
+    FrameMetadata_fields,
+    7
+};
+
+PyObject *new_frame_metadata(const FrameInfo &info) {
+    PyObject *metadata = PyStructSequence_New(&FrameMetadataType);
+    if (metadata == NULL) {
+        return NULL;
+    }
+    PyObject *flag;
+    if (info.flag == pyoptris::FLAG_UNKNOWN) {
+        Py_INCREF(Py_None);
+        flag = Py_None;
+    } else {
+        flag = PyLong_FromLong(info.flag);
+    }
+    PyObject *chipTemperature;
+    if (std::isnan(info.chipTemperature)) {
+        Py_INCREF(Py_None);
+        chipTemperature = Py_None;
+    } else {
+        chipTemperature = PyFloat_FromDouble(info.chipTemperature);
+    }
+    PyObject *values[7] = {
+        PyLong_FromUnsignedLongLong(info.sequence),
+        PyLong_FromLongLong(info.timestamp),
+        flag,
+        chipTemperature,
+        PyLong_FromLongLong(info.fetchNs),
+        PyLong_FromLong(info.validity),
+        PyBool_FromLong(info.held)
+    };
+    bool ok = true;
+    for (int i = 0; i < 7; i++) {
+        // Steals the reference, a NULL slot is left empty and released with the sequence
+        ok = ok && values[i] != NULL;
+        PyStructSequence_SET_ITEM(metadata, i, values[i]);
+    }
+    if (!ok) {
+        Py_DECREF(metadata);
+        return NULL;
+    }
+    return metadata;
+}
+
+PyObject *with_frame_metadata(PyObject *frame, const FrameInfo &info, int metadata) {
+    if (!metadata) {
+        return frame;
+    }
+    PyObject *record = new_frame_metadata(info);
+    if (record == NULL) {
+        Py_DECREF(frame);
+        return NULL;
+    }
+    return Py_BuildValue("NN", frame, record);
+}
+
+void record_delivery(const FrameInfo &info, uint64_t dropped) {
+    PipelineStatistics &statistics = pyoptris::pipeline_statistics();
+    statistics.delivery.record(pyoptris::system_now_ns() - info.timestamp);
+    statistics.delivered.fetch_add(1, std::memory_order_relaxed);
+    if (dropped > 0) {
+        statistics.dropped.fetch_add(dropped, std::memory_order_relaxed);
+    }
+}
+
+PyObject *latency_dict(const LatencyHistogram &histogram) {
+    LatencyHistogram::Snapshot snapshot;
+    histogram.snapshot(snapshot);
+    PyObject *buckets = PyList_New(0);
+    if (buckets == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++) {
+        if (snapshot.buckets[i] == 0) {
+            continue;
+        }
+        PyObject *bucket = Py_BuildValue("(dK)", LatencyHistogram::bucket_lower(i + 1) * 1e-3, (unsigned long long) snapshot.buckets[i]);
+        if (bucket == NULL || PyList_Append(buckets, bucket) < 0) {
+            Py_XDECREF(bucket);
+            Py_DECREF(buckets);
+            return NULL;
+        }
+        Py_DECREF(bucket);
+    }
+    double mean = snapshot.count > 0 ? (double) snapshot.totalNs / snapshot.count : 0.0;
+    return Py_BuildValue("{s:K,s:d,s:d,s:d,s:d,s:d,s:N}",
+        "count", (unsigned long long) snapshot.count,
+        "mean_us", mean * 1e-3,
+        "p50_us", snapshot.percentile(0.5) * 1e-3,
+        "p90_us", snapshot.percentile(0.9) * 1e-3,
+        "p99_us", snapshot.percentile(0.99) * 1e-3,
+        "max_us", snapshot.maxNs * 1e-3,
+        "buckets", buckets);
+}
+
+/**
+ * @brief stats(reset=False) -> dict
+ * Counters and latency histograms of every capture and accessor of the module: capture is the time the SDK
+ * blocked for a frame, conversion the Celsius and palette kernels, delivery the age of a frame when it is handed
+ * to Python. Histogram buckets are (upper bound in us, count) pairs, at most 25% wide. reset=True clears
+ * everything after reading.
+ */
+PyObject * stats(PyObject *, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "reset", nullptr };
+    int reset = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", (char **) keywords, &reset)) {
+        return NULL;
+    }
+    PipelineStatistics &statistics = pyoptris::pipeline_statistics();
+    PyObject *result = Py_BuildValue("{s:K,s:K,s:K,s:K,s:N,s:N,s:N}",
+        "captured", (unsigned long long) statistics.captured.load(std::memory_order_relaxed),
+        "errors", (unsigned long long) statistics.errors.load(std::memory_order_relaxed),
+        "delivered", (unsigned long long) statistics.delivered.load(std::memory_order_relaxed),
+        "dropped", (unsigned long long) statistics.dropped.load(std::memory_order_relaxed),
+        "capture", latency_dict(statistics.capture),
+        "conversion", latency_dict(statistics.conversion),
+        "delivery", latency_dict(statistics.delivery));
+    if (result != NULL && reset) {
+        statistics.reset();
+    }
+    return result;
+}
+
+static PyMethodDef stats_methods[] = {
+    { "stats",  (PyCFunction) stats,    METH_VARARGS | METH_KEYWORDS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+int add_stats_functions(PyObject *module) {
+    if (FrameMetadataType.tp_name == NULL && PyStructSequence_InitType2(&FrameMetadataType, &FrameMetadata_desc) < 0) {
+        return -1;
+    }
+    Py_INCREF(&FrameMetadataType);
+    if (PyModule_AddObject(module, "FrameMetadata", (PyObject *) &FrameMetadataType) < 0) {
+        Py_DECREF(&FrameMetadataType);
+        return -1;
+    }
+    static const struct {
+        const char *name;
+        int value;
+    } flags[] = {
+        { "FLAG_OPEN",          pyoptris::FLAG_OPEN },
+        { "FLAG_CLOSED",        pyoptris::FLAG_CLOSED },
+        { "FLAG_OPENING",       pyoptris::FLAG_OPENING },
+        { "FLAG_CLOSING",       pyoptris::FLAG_CLOSING },
+        { "FLAG_ERROR",         pyoptris::FLAG_ERROR },
+        { "FLAG_POLICY_TAG",    pyoptris::FLAG_POLICY_TAG },
+        { "FLAG_POLICY_DROP",   pyoptris::FLAG_POLICY_DROP },
+        { "FLAG_POLICY_HOLD",   pyoptris::FLAG_POLICY_HOLD },
+        { "FRAME_VALID",        pyoptris::FRAME_VALID },
+        { "FRAME_FLAG",         pyoptris::FRAME_FLAG },
+        { "FRAME_SETTLING",     pyoptris::FRAME_SETTLING },
+        { "FRAME_FROZEN",       pyoptris::FRAME_FROZEN }
+    };
+    for (const auto &flag : flags) {
+        if (PyModule_AddIntConstant(module, flag.name, flag.value) < 0) {
+            return -1;
+        }
+    }
+    return PyModule_AddFunctions(module, stats_methods);
+}
@@ -0,0 +1,441 @@
+#include "_pyoptris.h"
+
+#include "notifier.h"
+
+#include <string>
+
+using pyoptris::Capture;
+using pyoptris::FrameNotifier;
+
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<FrameNotifier> *notifier;
+    PyObject *reader;   // pyoptris.Capture reader of its own, created together with the notifier
+    Py_ssize_t batch;
+    PyObject *waiter;   // future of the pending __anext__, NULL if none
+    PyObject *loop;     // loop the descriptor is registered with while waiter is pending
+    int closed;         // close() stopped the notifier, nothing signals the descriptor any more
+} FrameStreamObject;
+
+static PyTypeObject FrameStreamType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+PyObject *new_frame_stream(PyObject *reader, Py_ssize_t batch) {
+    std::shared_ptr<Capture> capture = capture_of(reader);
+    if (capture == nullptr) {
+        return NULL;
+    }
+    std::shared_ptr<FrameNotifier> notifier = std::make_shared<FrameNotifier>(capture, (size_t) batch);
+    std::string error;
+    if (!notifier->start(error)) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return NULL;
+    }
+
+    FrameStreamObject *self = (FrameStreamObject *) FrameStreamType.tp_alloc(&FrameStreamType, 0);
+    if (self == NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        notifier.reset();
+        Py_END_ALLOW_THREADS
+        return NULL;
+    }
+    self->notifier = new std::shared_ptr<FrameNotifier>(notifier);
+    Py_INCREF(reader);
+    self->reader = reader;
+    self->batch = batch;
+    return (PyObject *) self;
+}
+
+static void FrameStream_dealloc(FrameStreamObject *self) {
+    // A registered descriptor keeps the stream alive through its callback, so nothing is registered here
+    std::shared_ptr<FrameNotifier> *notifier = self->notifier;
+    Py_BEGIN_ALLOW_THREADS
+    delete notifier;
+    Py_END_ALLOW_THREADS
+    Py_XDECREF(self->reader);
+    Py_XDECREF(self->waiter);
+    Py_XDECREF(self->loop);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief Reads the next frame or batch without blocking
+ * @param[out] item frame for a batch of 1, (frames, timestamps, sequences) otherwise
+ * @return 1 with item set, 0 if not enough frames arrived yet, 2 once the capture ended or the stream was
+ * closed, -1 with an exception set
+ */
+static int read_ready(FrameStreamObject *self, PyObject **item) {
+    if (self->closed) {
+        return 2;
+    }
+    // Frames still to come are only worth waiting for while the notifier is there to signal them
+    bool live = (*self->notifier)->running() && capture_of(self->reader)->running();
+    uint64_t pending = capture_reader_pending(self->reader);
+    if (pending < (uint64_t) self->batch) {
+        if (pending == 0) {
+            return live ? 0 : 2;
+        }
+        if (live) {
+            return 0;
+        }
+        // The capture ended part way through a batch, hand out the rest
+    }
+    if (self->batch == 1) {
+        *item = PyObject_CallMethod(self->reader, "next", "(i)", 0);
+    } else {
+        *item = capture_reader_batch(self->reader, self->batch, 0);
+    }
+    if (*item == NULL) {
+        return -1;
+    }
+    if (*item == Py_None) {
+        // Overwritten in the ring after pending was taken, the frames were counted in dropped
+        Py_DECREF(*item);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Completes future with the outcome of read_ready()
+ * @return 1 if the future was completed, 0 if no frames were ready, -1 with an exception set
+ */
+static int complete(FrameStreamObject *self, PyObject *future) {
+    PyObject *item = NULL;
+    PyObject *result;
+    switch (read_ready(self, &item)) {
+        case 0:
+            return 0;
+
+        case 1:
+            result = PyObject_CallMethod(future, "set_result", "(O)", item);
+            Py_DECREF(item);
+            break;
+
+        case 2:
+            result = PyObject_CallMethod(future, "set_exception", "(O)", PyExc_StopAsyncIteration);
+            break;
+
+        default: {
+            PyObject *type, *value, *traceback;
+            PyErr_Fetch(&type, &value, &traceback);
+            PyErr_NormalizeException(&type, &value, &traceback);
+            if (traceback != NULL) {
+                PyException_SetTraceback(value, traceback);
+            }
+            result = PyObject_CallMethod(future, "set_exception", "(O)", value);
+            Py_XDECREF(type);
+            Py_XDECREF(value);
+            Py_XDECREF(traceback);
+            break;
+        }
+    }
+    if (result == NULL) {
+        return -1;
+    }
+    Py_DECREF(result);
+    return 1;
+}
+
+static int unregister(FrameStreamObject *self) {
+    if (self->loop == NULL) {
+        return 0;
+    }
+    PyObject *loop = self->loop;
+    self->loop = NULL;
+    PyObject *result = PyObject_CallMethod(loop, "remove_reader", "(i)", (*self->notifier)->fileno());
+    Py_DECREF(loop);
+    if (result == NULL) {
+        return -1;
+    }
+    Py_DECREF(result);
+    return 0;
+}
+
+/**
+ * @brief Reader callback of the event loop, completes the pending __anext__ once frames are ready
+ */
+static PyObject *FrameStream_ready(FrameStreamObject *self, PyObject *) {
+    std::shared_ptr<FrameNotifier> notifier = *self->notifier;
+    notifier->drain();
+    if (self->waiter == NULL) {
+        if (unregister(self) < 0) {
+            return NULL;
+        }
+        Py_RETURN_NONE;
+    }
+
+    PyObject *done = PyObject_CallMethod(self->waiter, "done", NULL);
+    if (done == NULL) {
+        return NULL;
+    }
+    // A cancelled waiter is done as well, it is dropped like a completed one
+    int isDone = PyObject_IsTrue(done);
+    Py_DECREF(done);
+    int completed = isDone ? 1 : complete(self, self->waiter);
+    if (completed < 0) {
+        return NULL;
+    }
+    if (completed > 0) {
+        Py_CLEAR(self->waiter);
+        if (unregister(self) < 0) {
+            return NULL;
+        }
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief Done callback of the pending __anext__ future, a waiter cancelled e.g. by asyncio.wait_for() stops
+ * blocking the stream right away instead of at the next wakeup of the notifier
+ */
+static PyObject *FrameStream_waiter_done(FrameStreamObject *self, PyObject *future) {
+    if (self->waiter == future) {
+        Py_CLEAR(self->waiter);
+        if (unregister(self) < 0) {
+            return NULL;
+        }
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *FrameStream_aiter(FrameStreamObject *self) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+/**
+ * @brief Future of the next frame or batch, already completed if it is in the ring
+ */
+static PyObject *FrameStream_anext(FrameStreamObject *self) {
+    if (self->waiter != NULL) {
+        // A waiter that is done, but whose done callback has not run yet, is gone already
+        PyObject *done = PyObject_CallMethod(self->waiter, "done", NULL);
+        if (done == NULL) {
+            return NULL;
+        }
+        int isDone = PyObject_IsTrue(done);
+        Py_DECREF(done);
+        if (isDone < 0) {
+            return NULL;
+        }
+        if (!isDone) {
+            PyErr_SetString(PyExc_RuntimeError, "Another coroutine is already waiting for this stream");
+            return NULL;
+        }
+        Py_CLEAR(self->waiter);
+        if (unregister(self) < 0) {
+            return NULL;
+        }
+    }
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return NULL;
+    }
+    PyObject *loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
+    Py_DECREF(asyncio);
+    if (loop == NULL) {
+        return NULL;
+    }
+    PyObject *future = PyObject_CallMethod(loop, "create_future", NULL);
+    if (future == NULL) {
+        Py_DECREF(loop);
+        return NULL;
+    }
+    int completed = complete(self, future);
+    if (completed != 0) {
+        Py_DECREF(loop);
+        if (completed < 0) {
+            Py_DECREF(future);
+            return NULL;
+        }
+        return future;
+    }
+
+    // Nothing ready, the loop wakes up when the notifier signals
+    PyObject *callback = PyObject_GetAttrString((PyObject *) self, "_waiter_done");
+    PyObject *result = callback != NULL ? PyObject_CallMethod(future, "add_done_callback", "(O)", callback) : NULL;
+    Py_XDECREF(callback);
+    if (result == NULL) {
+        Py_DECREF(loop);
+        Py_DECREF(future);
+        return NULL;
+    }
+    Py_DECREF(result);
+    callback = PyObject_GetAttrString((PyObject *) self, "_ready");
+    if (callback == NULL) {
+        Py_DECREF(loop);
+        Py_DECREF(future);
+        return NULL;
+    }
+    result = PyObject_CallMethod(loop, "add_reader", "(iO)", (*self->notifier)->fileno(), callback);
+    Py_DECREF(callback);
+    if (result == NULL) {
+        Py_DECREF(loop);
+        Py_DECREF(future);
+        return NULL;
+    }
+    Py_DECREF(result);
+    self->loop = loop;
+    Py_INCREF(future);
+    self->waiter = future;
+    return future;
+}
+
+/**
+ * @brief poll() -> the next frame or batch if it is ready, None otherwise. For loops other than asyncio
+ * that poll fileno() themselves, raises StopIteration once the capture ended or the stream was closed.
+ */
+static PyObject *FrameStream_poll(FrameStreamObject *self, PyObject *) {
+    (*self->notifier)->drain();
+    PyObject *item = NULL;
+    switch (read_ready(self, &item)) {
+        case 0:
+            Py_RETURN_NONE;
+
+        case 1:
+            return item;
+
+        case 2:
+            PyErr_SetNone(PyExc_StopIteration);
+            return NULL;
+
+        default:
+            return NULL;
+    }
+}
+
+static PyObject *FrameStream_fileno(FrameStreamObject *self, PyObject *) {
+    return PyLong_FromLong((*self->notifier)->fileno());
+}
+
+/**
+ * @brief Stops the notifier thread, a pending __anext__ is cancelled and later ones raise StopAsyncIteration
+ */
+static PyObject *FrameStream_close(FrameStreamObject *self, PyObject *) {
+    self->closed = 1;
+    if (unregister(self) < 0) {
+        return NULL;
+    }
+    if (self->waiter != NULL) {
+        PyObject *waiter = self->waiter;
+        self->waiter = NULL;
+        PyObject *result = PyObject_CallMethod(waiter, "cancel", NULL);
+        Py_DECREF(waiter);
+        if (result == NULL) {
+            return NULL;
+        }
+        Py_DECREF(result);
+    }
+    std::shared_ptr<FrameNotifier> notifier = *self->notifier;
+    Py_BEGIN_ALLOW_THREADS
+    notifier->stop();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *FrameStream_enter(FrameStreamObject *self, PyObject *) {
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject *FrameStream_exit(FrameStreamObject *self, PyObject *) {
+    return FrameStream_close(self, NULL);
+}
+
+/**
+ * @brief async with support, returns an already completed future
+ */
+static PyObject *completed_future(PyObject *value) {
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return NULL;
+    }
+    PyObject *loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
+    Py_DECREF(asyncio);
+    if (loop == NULL) {
+        return NULL;
+    }
+    PyObject *future = PyObject_CallMethod(loop, "create_future", NULL);
+    Py_DECREF(loop);
+    if (future == NULL) {
+        return NULL;
+    }
+    PyObject *result = PyObject_CallMethod(future, "set_result", "(O)", value);
+    if (result == NULL) {
+        Py_DECREF(future);
+        return NULL;
+    }
+    Py_DECREF(result);
+    return future;
+}
+
+static PyObject *FrameStream_aenter(FrameStreamObject *self, PyObject *) {
+    return completed_future((PyObject *) self);
+}
+
+static PyObject *FrameStream_aexit(FrameStreamObject *self, PyObject *) {
+    PyObject *result = FrameStream_close(self, NULL);
+    if (result == NULL) {
+        return NULL;
+    }
+    Py_DECREF(result);
+    return completed_future(Py_None);
+}
+
+static PyObject *FrameStream_get_batch(FrameStreamObject *self, void *) {
+    return PyLong_FromSsize_t(self->batch);
+}
+
+static PyObject *FrameStream_get_dropped(FrameStreamObject *self, void *) {
+    return PyObject_GetAttrString(self->reader, "dropped");
+}
+
+static PyObject *FrameStream_get_wakeups(FrameStreamObject *self, void *) {
+    return PyLong_FromUnsignedLongLong((*self->notifier)->signals());
+}
+
+static PyMethodDef FrameStream_methods[] = {
+    { "fileno",     (PyCFunction) FrameStream_fileno,   METH_NOARGS, "Descriptor that becomes readable once frames arrived" },
+    { "poll",       (PyCFunction) FrameStream_poll,     METH_NOARGS, "The next frame or batch if ready, None otherwise" },
+    { "close",      (PyCFunction) FrameStream_close,    METH_NOARGS, "Stops the notifier thread" },
+    { "_ready",     (PyCFunction) FrameStream_ready,    METH_NOARGS, nullptr },
+    { "_waiter_done", (PyCFunction) FrameStream_waiter_done, METH_O, nullptr },
+    { "__enter__",  (PyCFunction) FrameStream_enter,    METH_NOARGS, nullptr },
+    { "__exit__",   (PyCFunction) FrameStream_exit,     METH_VARARGS, nullptr },
+    { "__aenter__", (PyCFunction) FrameStream_aenter,   METH_NOARGS, nullptr },
+    { "__aexit__",  (PyCFunction) FrameStream_aexit,    METH_VARARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef FrameStream_getset[] = {
+    { "batch",      (getter) FrameStream_get_batch,     nullptr, "Frames per item, 1 yields single frames", nullptr },
+    { "dropped",    (getter) FrameStream_get_dropped,   nullptr, "Frames overwritten before the stream read them", nullptr },
+    { "wakeups",    (getter) FrameStream_get_wakeups,   nullptr, "Times the descriptor was signalled", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+static PyAsyncMethods FrameStream_async = {
+    (unaryfunc) nullptr,
+    (unaryfunc) FrameStream_aiter,
+    (unaryfunc) FrameStream_anext
+};
+
+int add_stream_type(PyObject *module) {
+    FrameStreamType.tp_name = "pyoptris.FrameStream";
+    FrameStreamType.tp_basicsize = sizeof(FrameStreamObject);
+    FrameStreamType.tp_flags = Py_TPFLAGS_DEFAULT;
+    FrameStreamType.tp_doc = "Frames of a capture for asyncio: async for frame in camera.frames(), or poll() on fileno()";
+    FrameStreamType.tp_dealloc = (destructor) FrameStream_dealloc;
+    FrameStreamType.tp_as_async = &FrameStream_async;
+    FrameStreamType.tp_methods = FrameStream_methods;
+    FrameStreamType.tp_getset = FrameStream_getset;
+    if (PyType_Ready(&FrameStreamType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&FrameStreamType);
+    if (PyModule_AddObject(module, "FrameStream", (PyObject *) &FrameStreamType) < 0) {
+        Py_DECREF(&FrameStreamType);
+        return -1;
+    }
+    return 0;
+}
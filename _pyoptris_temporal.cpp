@@ -0,0 +1,239 @@
+#include "_pyoptris.h"
+
+#include "temporal.h"
+
+#include <mutex>
+
+using pyoptris::TemporalFilter;
+
+struct TemporalState {
+    TemporalFilter filter;
+    int width;
+    int height;
+    std::mutex mutex;   // serializes threads sharing the filter, never held together with the GIL
+
+    TemporalState(TemporalFilter::Mode mode, int width, int height, int length, double alpha)
+        : filter(mode, (size_t) width * height, length, alpha), width(width), height(height) {
+    }
+};
+
+typedef struct {
+    PyObject_HEAD
+    TemporalState *state;
+} TemporalFilterObject;
+
+static PyTypeObject TemporalFilterType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+/**
+ * @brief TemporalFilter(mode, size, length=8, alpha=None)
+ * Temporal noise reduction of raw uint16 frames for slow processes, state is per filter so every consumer
+ * keeps its own. mode is TEMPORAL_BOX (mean of the last length frames, length <= 255), TEMPORAL_EMA
+ * (exponential moving average, alpha defaults to 2 / (length + 1)) or TEMPORAL_MEDIAN (median of the last
+ * length frames, length <= 31). size=(width, height) of the frames.
+ */
+static PyObject *TemporalFilter_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "mode", "size", "length", "alpha", nullptr };
+    int mode;
+    int width, height;
+    int length = 8;
+    PyObject *alphaObject = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i(ii)|iO", (char **) keywords, &mode, &width, &height, &length, &alphaObject)) {
+        return NULL;
+    }
+    if (mode != TemporalFilter::BOX && mode != TemporalFilter::EMA && mode != TemporalFilter::MEDIAN) {
+        PyErr_SetString(PyExc_ValueError, "mode must be TEMPORAL_BOX, TEMPORAL_EMA or TEMPORAL_MEDIAN");
+        return NULL;
+    }
+    if (width <= 0 || height <= 0) {
+        PyErr_SetString(PyExc_ValueError, "size must be positive");
+        return NULL;
+    }
+    int maxLength = mode == TemporalFilter::MEDIAN ? TemporalFilter::MAX_MEDIAN_LENGTH : TemporalFilter::MAX_BOX_LENGTH;
+    if (length < 1 || (mode != TemporalFilter::EMA && length > maxLength)) {
+        PyErr_Format(PyExc_ValueError, "length must be in [1, %d]", maxLength);
+        return NULL;
+    }
+    double alpha = 2.0 / (length + 1);
+    if (alphaObject != Py_None) {
+        alpha = PyFloat_AsDouble(alphaObject);
+        if (alpha == -1.0 && PyErr_Occurred()) {
+            return NULL;
+        }
+        if (!(alpha > 0.0 && alpha <= 1.0)) {
+            PyErr_SetString(PyExc_ValueError, "alpha must be in (0, 1]");
+            return NULL;
+        }
+    }
+
+    TemporalState *state = nullptr;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        state = new TemporalState((TemporalFilter::Mode) mode, width, height, length, alpha);
+    } catch (const std::bad_alloc &) {
+    }
+    Py_END_ALLOW_THREADS
+    if (state == nullptr) {
+        return PyErr_NoMemory();
+    }
+    TemporalFilterObject *self = (TemporalFilterObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        delete state;
+        return NULL;
+    }
+    self->state = state;
+    return (PyObject *) self;
+}
+
+static void TemporalFilter_dealloc(TemporalFilterObject *self) {
+    delete self->state;
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/**
+ * @brief update(frame, out=None) -> filtered uint16 frame including frame, out may be frame itself
+ */
+static PyObject *TemporalFilter_update(TemporalFilterObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "frame", "out", nullptr };
+    PyObject *frameObject;
+    PyObject *out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", (char **) keywords, &frameObject, &out)) {
+        return NULL;
+    }
+    TemporalState *state = self->state;
+    PyArrayObject *frame = (PyArrayObject *) PyArray_FROM_OTF(frameObject, NPY_UINT16, NPY_ARRAY_IN_ARRAY);
+    if (frame == NULL) {
+        return NULL;
+    }
+    if (PyArray_NDIM(frame) != 2 || PyArray_DIM(frame, 0) != state->height || PyArray_DIM(frame, 1) != state->width) {
+        PyErr_Format(PyExc_ValueError, "frame must be a (%d, %d) array", state->height, state->width);
+        Py_DECREF(frame);
+        return NULL;
+    }
+    PyObject *result = frame_array(out, 2, PyArray_DIMS(frame), NPY_UINT16);
+    if (result == NULL) {
+        Py_DECREF(frame);
+        return NULL;
+    }
+    const uint16_t *frameData = (const uint16_t *) PyArray_DATA(frame);
+    uint16_t *outData = (uint16_t *) PyArray_DATA((PyArrayObject *) result);
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->filter.update(frameData, outData);
+    }
+    Py_END_ALLOW_THREADS
+    Py_DECREF(frame);
+    return result;
+}
+
+/**
+ * @brief value(out=None) -> filtered uint16 frame of the frames seen so far, None before the first one
+ */
+static PyObject *TemporalFilter_value(TemporalFilterObject *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "out", nullptr };
+    PyObject *out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", (char **) keywords, &out)) {
+        return NULL;
+    }
+    TemporalState *state = self->state;
+    npy_intp dimensions[2] = { state->height, state->width };
+    PyObject *result = frame_array(out, 2, dimensions, NPY_UINT16);
+    if (result == NULL) {
+        return NULL;
+    }
+    uint16_t *outData = (uint16_t *) PyArray_DATA((PyArrayObject *) result);
+    bool available;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        available = state->filter.output(outData);
+    }
+    Py_END_ALLOW_THREADS
+    if (!available) {
+        Py_DECREF(result);
+        Py_RETURN_NONE;
+    }
+    return result;
+}
+
+static PyObject *TemporalFilter_reset(TemporalFilterObject *self, PyObject *) {
+    TemporalState *state = self->state;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->filter.reset();
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *TemporalFilter_get_mode(TemporalFilterObject *self, void *) {
+    return PyLong_FromLong(self->state->filter.mode());
+}
+
+static PyObject *TemporalFilter_get_size(TemporalFilterObject *self, void *) {
+    return Py_BuildValue("ii", self->state->width, self->state->height);
+}
+
+static PyObject *TemporalFilter_get_length(TemporalFilterObject *self, void *) {
+    return PyLong_FromLong(self->state->filter.length());
+}
+
+static PyObject *TemporalFilter_get_alpha(TemporalFilterObject *self, void *) {
+    if (self->state->filter.mode() != TemporalFilter::EMA) {
+        Py_RETURN_NONE;
+    }
+    return PyFloat_FromDouble(self->state->filter.alpha());
+}
+
+static PyObject *TemporalFilter_get_frames(TemporalFilterObject *self, void *) {
+    uint64_t frames;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(self->state->mutex);
+        frames = self->state->filter.frames();
+    }
+    Py_END_ALLOW_THREADS
+    return PyLong_FromUnsignedLongLong(frames);
+}
+
+static PyMethodDef TemporalFilter_methods[] = {
+    { "update", (PyCFunction) TemporalFilter_update,    METH_VARARGS | METH_KEYWORDS, "update(frame, out=None) -> filtered uint16 frame including frame" },
+    { "value",  (PyCFunction) TemporalFilter_value,     METH_VARARGS | METH_KEYWORDS, "value(out=None) -> filtered uint16 frame so far, None before the first frame" },
+    { "reset",  (PyCFunction) TemporalFilter_reset,     METH_NOARGS, "Forgets every frame" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef TemporalFilter_getset[] = {
+    { "mode",   (getter) TemporalFilter_get_mode,   nullptr, "TEMPORAL_BOX, TEMPORAL_EMA or TEMPORAL_MEDIAN", nullptr },
+    { "size",   (getter) TemporalFilter_get_size,   nullptr, "(width, height) of the frames it filters", nullptr },
+    { "length", (getter) TemporalFilter_get_length, nullptr, "Frames averaged or taken the median of", nullptr },
+    { "alpha",  (getter) TemporalFilter_get_alpha,  nullptr, "Weight of a new frame as applied in Q16, None unless TEMPORAL_EMA", nullptr },
+    { "frames", (getter) TemporalFilter_get_frames, nullptr, "Frames added since construction or the last reset()", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+int add_temporal_type(PyObject *module) {
+    TemporalFilterType.tp_name = "pyoptris.TemporalFilter";
+    TemporalFilterType.tp_basicsize = sizeof(TemporalFilterObject);
+    TemporalFilterType.tp_flags = Py_TPFLAGS_DEFAULT;
+    TemporalFilterType.tp_doc = "TemporalFilter(mode, size, length=8, alpha=None): box, EMA or rolling median filter over raw frames";
+    TemporalFilterType.tp_new = TemporalFilter_new;
+    TemporalFilterType.tp_dealloc = (destructor) TemporalFilter_dealloc;
+    TemporalFilterType.tp_methods = TemporalFilter_methods;
+    TemporalFilterType.tp_getset = TemporalFilter_getset;
+    if (PyType_Ready(&TemporalFilterType) < 0) {
+        return -1;
+    }
+    Py_INCREF(&TemporalFilterType);
+    if (PyModule_AddObject(module, "TemporalFilter", (PyObject *) &TemporalFilterType) < 0) {
+        Py_DECREF(&TemporalFilterType);
+        return -1;
+    }
+    if (PyModule_AddIntConstant(module, "TEMPORAL_BOX", TemporalFilter::BOX) < 0
+            || PyModule_AddIntConstant(module, "TEMPORAL_EMA", TemporalFilter::EMA) < 0
+            || PyModule_AddIntConstant(module, "TEMPORAL_MEDIAN", TemporalFilter::MEDIAN) < 0) {
+        return -1;
+    }
+    return 0;
+}
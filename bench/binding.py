@@ -0,0 +1,150 @@
+"""End-to-end benchmark of the image accessors against the simulator backend.
+
+Build the module with PYOPTRIS_BACKEND=simulator first, then run from the repository root
+
+    python bench/binding.py [--seconds 1.0] [--paced]
+
+Prints one JSON object per line for every accessor and simulated format: frames/sec, p50/p99 call
+latency, bytes allocated per frame and the time each call holds the GIL. Unpaced runs (the default)
+replay pre-rendered frames as fast as they are fetched, so the numbers are the cost of the binding.
+"""
+import argparse
+import json
+import os
+import sys
+import tempfile
+import threading
+import time
+import tracemalloc
+
+import pyoptris
+
+FORMATS = [ (0, 160, 120), (1, 382, 288), (2, 764, 480), (3, 72, 56), (4, 764, 8) ]
+
+CALLS = [
+    ("get_thermal_image", lambda: pyoptris.get_thermal_image()),
+    ("get_palette_image", lambda: pyoptris.get_palette_image()),
+    ("get_thermal_palette_image", lambda: pyoptris.get_thermal_palette_image()),
+]
+
+CONFIG = """<?xml version="1.0" encoding="UTF-8"?>
+<imager>
+  <videoformatindex>{index}</videoformatindex>
+  <pacing>{pacing}</pacing>
+  <autoflag><enable>0</enable></autoflag>
+</imager>
+"""
+
+
+def percentile(samples, fraction):
+    ordered = sorted(samples)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * fraction))]
+
+
+def measure_latency(call, seconds):
+    samples = []
+    end = time.perf_counter() + seconds
+    now = time.perf_counter()
+    start = now
+    while now < end:
+        before = now
+        call()
+        now = time.perf_counter()
+        samples.append(now - before)
+    return samples, now - start
+
+
+def measure_allocations(call, frames):
+    """Bytes the interpreter and numpy allocate per call, pooled frame buffers excluded, plus pool misses"""
+    pool = pyoptris.pool_stats()
+    tracemalloc.start()
+    total = 0
+    for _ in range(frames):
+        tracemalloc.reset_peak()
+        before, _ = tracemalloc.get_traced_memory()
+        result = call()
+        _, peak = tracemalloc.get_traced_memory()
+        total += peak - before
+        del result
+    tracemalloc.stop()
+    misses = pyoptris.pool_stats()["allocations"] - pool["allocations"]
+    return total / frames, misses / frames
+
+
+def measure_gil(call, seconds):
+    """Time per call the caller keeps the GIL: call latency minus the time a spinning thread got to run meanwhile"""
+    switch = sys.getswitchinterval()
+    sys.setswitchinterval(1e-5)
+    ran = [0.0]
+    running = [True]
+
+    def spin():
+        last = time.perf_counter()
+        while running[0]:
+            now = time.perf_counter()
+            # Gaps longer than a few microseconds are time the GIL was held elsewhere
+            if now - last < 20e-6:
+                ran[0] += now - last
+            last = now
+
+    spinner = threading.Thread(target=spin)
+    spinner.start()
+    holds = []
+    end = time.perf_counter() + seconds
+    while time.perf_counter() < end:
+        ranBefore = ran[0]
+        before = time.perf_counter()
+        call()
+        latency = time.perf_counter() - before
+        holds.append(max(latency - (ran[0] - ranBefore), 0.0))
+    running[0] = False
+    spinner.join()
+    sys.setswitchinterval(switch)
+    return holds
+
+
+def run_format(index, width, height, seconds, paced):
+    config = tempfile.NamedTemporaryFile("w", suffix=".xml", delete=False)
+    config.write(CONFIG.format(index=index, pacing=1 if paced else 0))
+    config.close()
+    try:
+        pyoptris.usb_init(config.name)
+        try:
+            for name, call in CALLS:
+                for _ in range(10):
+                    call()
+                samples, elapsed = measure_latency(call, seconds)
+                bytesPerFrame, poolMisses = measure_allocations(call, 100)
+                holds = measure_gil(call, seconds / 2)
+                print(json.dumps({
+                    "suite": "binding",
+                    "call": name,
+                    "width": width,
+                    "height": height,
+                    "paced": paced,
+                    "frames": len(samples),
+                    "fps": round(len(samples) / elapsed, 1),
+                    "p50_us": round(percentile(samples, 0.5) * 1e6, 2),
+                    "p99_us": round(percentile(samples, 0.99) * 1e6, 2),
+                    "bytes_allocated_per_frame": round(bytesPerFrame, 1),
+                    "pool_allocations_per_frame": round(poolMisses, 3),
+                    "gil_hold_p50_us": round(percentile(holds, 0.5) * 1e6, 2),
+                    "gil_hold_p99_us": round(percentile(holds, 0.99) * 1e6, 2),
+                }), flush=True)
+        finally:
+            pyoptris.terminate()
+    finally:
+        os.unlink(config.name)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--seconds", type=float, default=1.0, help="measuring time per accessor and format")
+    parser.add_argument("--paced", action="store_true", help="run at the frame rate of the simulated camera")
+    args = parser.parse_args()
+    for index, width, height in FORMATS:
+        run_format(index, width, height, args.seconds, args.paced)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,367 @@
+/*
+ * Native kernel benchmark, one JSON object per line for every kernel and Formats.def output resolution.
+ *
+ *   g++ -O2 -std=c++17 -pthread -I. bench/kernels.cpp binning.cpp blobs.cpp capture.cpp codec.cpp convert.cpp formats.cpp framepool.cpp gate.cpp image.cpp palette.cpp radiometry.cpp ring.cpp roi.cpp simd.cpp spatial.cpp stats.cpp temporal.cpp workers.cpp -lz -o bench_kernels
+ *   ./bench_kernels [Formats.def] [seconds per kernel]
+ */
+#include "binning.h"
+#include "blobs.h"
+#include "codec.h"
+#include "convert.h"
+#include "formats.h"
+#include "framepool.h"
+#include "image.h"
+#include "palette.h"
+#include "radiometry.h"
+#include "ring.h"
+#include "roi.h"
+#include "spatial.h"
+#include "temporal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Every heap allocation of the process is counted, the kernels are expected not to make any
+static std::atomic<uint64_t> allocatedBytes(0);
+
+void *operator new(size_t size) {
+    allocatedBytes += size;
+    void *p = std::malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+static int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Distinct "Out = w h rate" sizes of Formats.def, in file order
+static std::vector<std::pair<int, int>> formats_def_resolutions(const char *path) {
+    std::vector<std::pair<int, int>> resolutions;
+    std::set<std::pair<int, int>> seen;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string key, equals;
+        int width, height;
+        if (fields >> key >> equals >> width >> height && key == "Out" && equals == "=") {
+            if (seen.insert({ width, height }).second) {
+                resolutions.push_back({ width, height });
+            }
+        }
+    }
+    return resolutions;
+}
+
+// Room temperature scene with a hot spot and noise in the SDK raw encoding, 20..80 degrees Celsius
+static void synthetic_frame(uint16_t *raw, int width, int height, uint32_t seed = 2463534242u) {
+    uint32_t state = seed;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            float dx = (float) (x - width / 2) / width, dy = (float) (y - height / 2) / std::max(height, 8);
+            float t = 20.0f + 60.0f * std::max(0.0f, 1.0f - 8.0f * (dx * dx + dy * dy)) + (float) (state & 15) * 0.1f;
+            raw[(size_t) y * width + x] = (uint16_t) ((t + 100.0f) * 10.0f);
+        }
+    }
+}
+
+static void report(const char *kernel, int width, int height, std::vector<int64_t> &samples, int64_t totalNs, uint64_t bytes,
+                   const std::string &extra) {
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    std::printf("{\"suite\": \"kernels\", \"kernel\": \"%s\", \"width\": %d, \"height\": %d, \"isa\": \"%s\", "
+                "\"frames\": %zu, \"fps\": %.1f, \"p50_us\": %.2f, \"p99_us\": %.2f, \"bytes_allocated_per_frame\": %.1f%s}\n",
+                kernel, width, height, pyoptris::convert_isa(), n, n * 1e9 / totalNs,
+                samples[n / 2] * 1e-3, samples[std::min(n - 1, n * 99 / 100)] * 1e-3, (double) bytes / n, extra.c_str());
+    std::fflush(stdout);
+}
+
+// extra is appended to the JSON object, e.g. ", \"ratio\": 3.1"
+static void run(const char *kernel, int width, int height, double seconds, const std::function<void()> &body,
+                const std::function<std::string()> &extra = nullptr) {
+    // Warm caches and lazily built tables before measuring
+    for (int i = 0; i < 3; i++) {
+        body();
+    }
+    std::vector<int64_t> samples;
+    samples.reserve(1 << 16);
+    uint64_t bytesBefore = allocatedBytes;
+    int64_t start = steady_ns();
+    int64_t end = start + (int64_t) (seconds * 1e9);
+    int64_t now = start;
+    while (now < end && samples.size() < samples.capacity()) {
+        int64_t before = now;
+        body();
+        now = steady_ns();
+        samples.push_back(now - before);
+    }
+    uint64_t bytes = allocatedBytes - bytesBefore;
+    report(kernel, width, height, samples, now - start, bytes, extra ? extra() : std::string());
+}
+
+int main(int argc, char **argv) {
+    const char *formatsDef = argc > 1 ? argv[1] : "Formats.def";
+    double seconds = argc > 2 ? std::atof(argv[2]) : 0.5;
+    std::vector<std::pair<int, int>> resolutions = formats_def_resolutions(formatsDef);
+    if (resolutions.empty()) {
+        std::fprintf(stderr, "No Out lines in %s\n", formatsDef);
+        return 1;
+    }
+
+    pyoptris::TemperatureScale scale = pyoptris::temperature_scale(1);
+    const uint32_t *lut = pyoptris::palette_lut(pyoptris::PALETTE_IRON);
+    for (const auto &resolution : resolutions) {
+        int width = resolution.first, height = resolution.second;
+        size_t n = (size_t) width * height;
+        uint16_t *raw = (uint16_t *) pyoptris::aligned_allocate(n * sizeof(uint16_t));
+        float *celsius = (float *) pyoptris::aligned_allocate(n * sizeof(float));
+        uint16_t *half = (uint16_t *) pyoptris::aligned_allocate(n * sizeof(uint16_t));
+        uint8_t *rgb = (uint8_t *) pyoptris::aligned_allocate(n * 3);
+        uint16_t *copy = (uint16_t *) pyoptris::aligned_allocate(n * sizeof(uint16_t));
+        synthetic_frame(raw, width, height);
+        pyoptris::FrameRing ring(16, n * sizeof(uint16_t));
+        uint64_t sequence = 0;
+
+        run("raw_to_celsius_f32", width, height, seconds, [&] {
+            pyoptris::raw_to_celsius(raw, celsius, n, scale);
+        });
+        run("raw_to_celsius_f16", width, height, seconds, [&] {
+            pyoptris::raw_to_celsius_f16(raw, half, n, scale);
+        });
+        // Emissivity falling off towards the edges, as for a curved target
+        std::vector<float> emissivity(n);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                float dx = (float) (x - width / 2) / width;
+                emissivity[(size_t) y * width + x] = 0.95f - 0.3f * dx * dx;
+            }
+        }
+        pyoptris::RadiometricCorrection correction(width, height, emissivity.data(), 1.0f, nullptr, 0.9f, 20.0f, 20.0f);
+        run("radiometric_correction", width, height, seconds, [&] {
+            correction.apply(raw, celsius, scale);
+        });
+        run("frame_statistics", width, height, seconds, [&] {
+            pyoptris::frame_statistics(raw, n);
+        });
+        std::vector<uint32_t> histogram(256);
+        run("frame_histogram", width, height, seconds, [&] {
+            pyoptris::FrameStatistics stats = pyoptris::frame_statistics(raw, n);
+            pyoptris::frame_histogram(raw, n, stats.min, stats.max, histogram.data(), histogram.size());
+        });
+        // Preview sizes: 2x2 mean, 4x4 max and a 2x2 mean with a three level thumbnail pyramid
+        const pyoptris::BinningOptions binnings[] = {
+            { 0, 0, width, height, 2, pyoptris::BINNING_MEAN, 0 },
+            { 0, 0, width, height, 4, pyoptris::BINNING_MAX, 0 },
+            { 0, 0, width, height, 2, pyoptris::BINNING_MEAN, 2 },
+        };
+        const char *binningKernels[] = { "bin_2x2_mean", "bin_4x4_max", "bin_pyramid" };
+        std::vector<uint16_t> binned((size_t) n);
+        std::vector<uint32_t> binningScratch((size_t) width);
+        for (size_t b = 0; b < 3; b++) {
+            std::string error;
+            const pyoptris::BinningOptions &options = binnings[b];
+            if (!pyoptris::check_binning(width, height, options, error)) {
+                continue;
+            }
+            // The levels are packed one after another into binned
+            uint16_t *outputs[3];
+            size_t offset = 0;
+            for (int level = 0; level <= options.levels; level++) {
+                outputs[level] = binned.data() + offset;
+                offset += (size_t) pyoptris::binned_width(options, level) * pyoptris::binned_height(options, level);
+            }
+            run(binningKernels[b], width, height, seconds, [&] {
+                pyoptris::bin_frame(raw, width, options, outputs, binningScratch.data());
+            });
+        }
+        run("render_palette", width, height, seconds, [&] {
+            pyoptris::FrameStatistics stats = pyoptris::frame_statistics(raw, n);
+            pyoptris::PaletteRange range = pyoptris::palette_range(pyoptris::SCALING_MIN_MAX, stats, { 0, 0 });
+            pyoptris::render_palette(raw, rgb, n, lut, range);
+        });
+        run("ring_publish_read", width, height, seconds, [&] {
+            pyoptris::FrameInfo info = { 0, 0 };
+            ring.publish(raw, info);
+            ring.read(sequence++, copy, &info);
+        });
+
+        // 64 regions spread over the frame: rectangles, polygons and lines
+        pyoptris::RoiEngine regions(width, height);
+        for (int i = 0; i < 64; i++) {
+            int x = (i * 37) % width, y = (i * 53) % height;
+            int w = std::max(width / 8, 1), h = std::max(height / 8, 1);
+            if (i % 4 == 2) {
+                float triangle[6] = { (float) x, (float) y, (float) (x + w), (float) y, (float) x, (float) (y + h) };
+                regions.add_polygon(triangle, 3);
+            } else if (i % 4 == 3) {
+                regions.add_line(x, y, x + w, y + h);
+            } else {
+                regions.add_rect(x, y, w, h);
+            }
+        }
+        std::vector<pyoptris::RoiStatistics> regionStats(regions.size());
+        run("roi_statistics_64", width, height, seconds, [&] {
+            regions.compute(raw, regionStats.data(), scale);
+        });
+
+        // A static scene with fresh sensor noise in every frame, the case delta frames are made for
+        std::vector<std::vector<uint16_t>> sequenceFrames(8, std::vector<uint16_t>(n));
+        for (size_t i = 0; i < sequenceFrames.size(); i++) {
+            synthetic_frame(sequenceFrames[i].data(), width, height, 2463534242u + (uint32_t) i * 7919u);
+        }
+        std::vector<std::vector<uint8_t>> encoded(sequenceFrames.size(), std::vector<uint8_t>(pyoptris::codec_max_encoded_size(n)));
+        std::vector<size_t> encodedSizes(sequenceFrames.size());
+        pyoptris::FrameEncoder encoder(width, height, 32);
+        pyoptris::FrameDecoder decoder(width, height);
+        uint64_t encodedFrames = 0, encodedBytes = 0;
+        size_t frameIndex = 0;
+        auto ratio = [&] {
+            char field[64];
+            std::snprintf(field, sizeof(field), ", \"ratio\": %.2f", (double) encodedFrames * n * sizeof(uint16_t) / encodedBytes);
+            return std::string(field);
+        };
+        run("codec_encode", width, height, seconds, [&] {
+            size_t i = frameIndex++ % sequenceFrames.size();
+            encodedSizes[i] = encoder.encode(sequenceFrames[i].data(), encoded[i].data());
+            encodedBytes += encodedSizes[i];
+            encodedFrames++;
+        }, ratio);
+        // Decoding the stored frames in order keeps the decoder one frame behind the stream, like a client would
+        encoder.reset();
+        for (size_t i = 0; i < sequenceFrames.size(); i++) {
+            encodedSizes[i] = encoder.encode(sequenceFrames[i].data(), encoded[i].data());
+        }
+        frameIndex = 0;
+        run("codec_decode", width, height, seconds, [&] {
+            size_t i = frameIndex++ % sequenceFrames.size();
+            decoder.decode(encoded[i].data(), encodedSizes[i], copy);
+        });
+
+        // The same noisy sequence through each temporal filter at its default length
+        pyoptris::TemporalFilter box(pyoptris::TemporalFilter::BOX, n, 8, 0.0);
+        pyoptris::TemporalFilter ema(pyoptris::TemporalFilter::EMA, n, 8, 2.0 / 9.0);
+        pyoptris::TemporalFilter median(pyoptris::TemporalFilter::MEDIAN, n, 8, 0.0);
+        const std::pair<const char *, pyoptris::TemporalFilter *> temporalFilters[] = {
+            { "temporal_box_8", &box }, { "temporal_ema", &ema }, { "temporal_median_8", &median }
+        };
+        for (const auto &filter : temporalFilters) {
+            frameIndex = 0;
+            run(filter.first, width, height, seconds, [&] {
+                filter.second->update(sequenceFrames[frameIndex++ % sequenceFrames.size()].data(), copy);
+            });
+        }
+
+        // Spatial stages alone and chained, split across the default threads; a mask of 0.1% bad pixels
+        std::vector<uint8_t> badPixels(n, 0);
+        for (size_t i = 0; i < n; i += 997) {
+            badPixels[i] = 1;
+        }
+        int threads = pyoptris::default_worker_threads();
+        pyoptris::SpatialFilter badPixelFilter(width, height, threads), median3(width, height, threads), median5(width, height, threads),
+            denoise(width, height, threads), chain(width, height, threads);
+        badPixelFilter.add_bad_pixels(badPixels.data());
+        median3.add_median(3);
+        median5.add_median(5);
+        denoise.add_denoise(40);
+        chain.add_bad_pixels(badPixels.data());
+        chain.add_median(3);
+        chain.add_denoise(40);
+        const std::pair<const char *, pyoptris::SpatialFilter *> spatialFilters[] = {
+            { "spatial_bad_pixels", &badPixelFilter }, { "spatial_median_3", &median3 }, { "spatial_median_5", &median5 },
+            { "spatial_denoise", &denoise }, { "spatial_chain", &chain }
+        };
+        for (const auto &filter : spatialFilters) {
+            run(filter.first, width, height, seconds, [&] {
+                filter.second->apply(raw, copy);
+            });
+        }
+
+        // Hot spot of the synthetic scene above 60 degrees Celsius, labelled and tracked
+        pyoptris::BlobDetector blobDetector(width, height, { 8, 1, 64, 16.0f, 5 });
+        run("blob_detect", width, height, seconds, [&] {
+            blobDetector.detect(raw, 1600, scale);
+        });
+
+        // Encoding only, as the export threads do it at the default compression level; rgb still holds the rendered palette
+        pyoptris::ImageEncoder imageEncoder;
+        uint64_t imageFrames = 0, imageBytes = 0;
+        auto imageRatio = [&] {
+            char field[64];
+            std::snprintf(field, sizeof(field), ", \"ratio\": %.2f", (double) imageFrames * n * sizeof(uint16_t) / imageBytes);
+            imageFrames = imageBytes = 0;
+            return std::string(field);
+        };
+        const std::pair<const char *, std::function<bool()>> imageFormats[] = {
+            { "export_png_palette", [&] { return imageEncoder.png_rgb(rgb, width, height, 6); } },
+            { "export_png_raw", [&] { return imageEncoder.png_gray16(raw, width, height, 6); } },
+            { "export_tiff_raw", [&] { return imageEncoder.tiff_gray16(raw, width, height, 6); } }
+        };
+        for (const auto &format : imageFormats) {
+            run(format.first, width, height, seconds, [&] {
+                format.second();
+                imageBytes += imageEncoder.data().size();
+                imageFrames++;
+            }, imageRatio);
+        }
+
+        pyoptris::aligned_free(raw);
+        pyoptris::aligned_free(celsius);
+        pyoptris::aligned_free(half);
+        pyoptris::aligned_free(rgb);
+        pyoptris::aligned_free(copy);
+    }
+
+    // Unpacking 64 raw packets at a time per format and channel, as when decoding a raw capture offline
+    std::vector<pyoptris::RawFormat> formats;
+    std::string error;
+    if (!pyoptris::load_formats(formatsDef, formats, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    const size_t packets = 64;
+    for (const pyoptris::RawFormat &format : formats) {
+        std::vector<uint16_t> raw(packets * format.packet_words());
+        for (size_t i = 0; i < raw.size(); i++) {
+            raw[i] = (uint16_t) (i * 2654435761u >> 16);
+        }
+        for (const pyoptris::FormatChannel &channel : format.channels) {
+            std::vector<uint16_t> frames(packets * channel.subframes * channel.width * channel.height);
+            std::vector<uint16_t> metadata(packets * channel.subframes * channel.metadataWords);
+            auto throughput = [&] {
+                char field[160];
+                std::snprintf(field, sizeof(field), ", \"format\": \"%s\", \"packets\": %zu, \"copies\": %zu", format.guid.c_str(), packets,
+                              channel.copies.size());
+                return std::string(field);
+            };
+            run("unpack_packets", channel.width, channel.height, seconds, [&] {
+                pyoptris::unpack_packets(channel, format.packet_words(), raw.data(), packets, frames.data(), metadata.data());
+            }, throughput);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,346 @@
+#include "binning.h"
+
+#include "simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace pyoptris {
+
+// A kernel reduces factor adjacent pixels of one row into bins from..to: summed into 32 bit for the
+// mean, or the maximum taken for max. Rows of a bin are reduced one after another into the same bins.
+
+template <int Factor>
+static void add_bins_scalar(const uint16_t *row, uint32_t *sums, int from, int to) {
+    for (int j = from; j < to; j++) {
+        uint32_t sum = 0;
+        for (int k = 0; k < Factor; k++) {
+            sum += row[j * Factor + k];
+        }
+        sums[j] += sum;
+    }
+}
+
+template <int Factor>
+static void max_bins_scalar(const uint16_t *row, uint16_t *maxima, int from, int to) {
+    for (int j = from; j < to; j++) {
+        uint16_t maximum = maxima[j];
+        for (int k = 0; k < Factor; k++) {
+            maximum = std::max(maximum, row[j * Factor + k]);
+        }
+        maxima[j] = maximum;
+    }
+}
+
+// Rounded means of width bins of factor * factor = 1 << shift pixels each
+PYOPTRIS_ALWAYS_INLINE static void mean_body(const uint32_t *sums, uint16_t *out, int width, int shift) {
+    uint32_t half = 1u << (shift - 1);
+    for (int j = 0; j < width; j++) {
+        out[j] = (uint16_t) ((sums[j] + half) >> shift);
+    }
+}
+
+static void mean_default(const uint32_t *sums, uint16_t *out, int width, int shift) {
+    mean_body(sums, out, width, shift);
+}
+
+#ifdef PYOPTRIS_X86
+
+// Narrowing to 16 bit only vectorizes with the packs of SSE4.1 and later
+PYOPTRIS_TARGET("avx2")
+static void mean_avx2(const uint32_t *sums, uint16_t *out, int width, int shift) {
+    mean_body(sums, out, width, shift);
+}
+
+// Sums of the 8 adjacent pixel pairs of 16 pixels, in 8 lanes of 32 bits
+PYOPTRIS_TARGET("avx2")
+static inline __m256i pair_sums_avx2(__m256i v) {
+    return _mm256_add_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xffff)), _mm256_srli_epi32(v, 16));
+}
+
+// Maxima of the 16 adjacent pixel pairs of the 32 pixels in a and b, in order
+PYOPTRIS_TARGET("avx2")
+static inline __m256i pair_maxima_avx2(__m256i a, __m256i b) {
+    __m256i low = _mm256_set1_epi32(0xffff);
+    a = _mm256_and_si256(_mm256_max_epu16(a, _mm256_srli_epi32(a, 16)), low);
+    b = _mm256_and_si256(_mm256_max_epu16(b, _mm256_srli_epi32(b, 16)), low);
+    // packus works within 128 bit lanes, the permute restores the order
+    return _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+PYOPTRIS_TARGET("avx2")
+static void add2_avx2(const uint16_t *row, uint32_t *sums, int from, int to) {
+    int j = from;
+    for (; j + 8 <= to; j += 8) {
+        __m256i pairs = pair_sums_avx2(_mm256_loadu_si256((const __m256i *) (row + 2 * j)));
+        __m256i *target = (__m256i *) (sums + j);
+        _mm256_storeu_si256(target, _mm256_add_epi32(_mm256_loadu_si256(target), pairs));
+    }
+    add_bins_scalar<2>(row, sums, j, to);
+}
+
+PYOPTRIS_TARGET("avx2")
+static void add4_avx2(const uint16_t *row, uint32_t *sums, int from, int to) {
+    int j = from;
+    for (; j + 8 <= to; j += 8) {
+        __m256 p0 = _mm256_castsi256_ps(pair_sums_avx2(_mm256_loadu_si256((const __m256i *) (row + 4 * j))));
+        __m256 p1 = _mm256_castsi256_ps(pair_sums_avx2(_mm256_loadu_si256((const __m256i *) (row + 4 * j + 16))));
+        __m256i evens = _mm256_castps_si256(_mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m256i odds = _mm256_castps_si256(_mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m256i quads = _mm256_permute4x64_epi64(_mm256_add_epi32(evens, odds), _MM_SHUFFLE(3, 1, 2, 0));
+        __m256i *target = (__m256i *) (sums + j);
+        _mm256_storeu_si256(target, _mm256_add_epi32(_mm256_loadu_si256(target), quads));
+    }
+    add_bins_scalar<4>(row, sums, j, to);
+}
+
+PYOPTRIS_TARGET("avx2")
+static void max2_avx2(const uint16_t *row, uint16_t *maxima, int from, int to) {
+    int j = from;
+    for (; j + 16 <= to; j += 16) {
+        const __m256i *source = (const __m256i *) (row + 2 * j);
+        __m256i pairs = pair_maxima_avx2(_mm256_loadu_si256(source), _mm256_loadu_si256(source + 1));
+        __m256i *target = (__m256i *) (maxima + j);
+        _mm256_storeu_si256(target, _mm256_max_epu16(_mm256_loadu_si256(target), pairs));
+    }
+    max_bins_scalar<2>(row, maxima, j, to);
+}
+
+PYOPTRIS_TARGET("avx2")
+static void max4_avx2(const uint16_t *row, uint16_t *maxima, int from, int to) {
+    int j = from;
+    for (; j + 16 <= to; j += 16) {
+        const __m256i *source = (const __m256i *) (row + 4 * j);
+        __m256i pairs0 = pair_maxima_avx2(_mm256_loadu_si256(source), _mm256_loadu_si256(source + 1));
+        __m256i pairs1 = pair_maxima_avx2(_mm256_loadu_si256(source + 2), _mm256_loadu_si256(source + 3));
+        __m256i quads = pair_maxima_avx2(pairs0, pairs1);
+        __m256i *target = (__m256i *) (maxima + j);
+        _mm256_storeu_si256(target, _mm256_max_epu16(_mm256_loadu_si256(target), quads));
+    }
+    max_bins_scalar<4>(row, maxima, j, to);
+}
+
+#endif
+
+#if defined(PYOPTRIS_SSE2)
+
+// Sums of the 4 adjacent pixel pairs of 8 pixels, in 4 lanes of 32 bits
+static inline __m128i pair_sums_sse2(__m128i v) {
+    return _mm_add_epi32(_mm_and_si128(v, _mm_set1_epi32(0xffff)), _mm_srli_epi32(v, 16));
+}
+
+// SSE2 only compares signed 16 bit lanes, flipping the top bit maps unsigned order onto signed order
+static inline __m128i flip_sse2(__m128i v) {
+    return _mm_xor_si128(v, _mm_set1_epi16((short) 0x8000));
+}
+
+// Maxima of the 8 adjacent pixel pairs of the 16 flipped pixels in a and b, in order and still flipped
+static inline __m128i pair_maxima_sse2(__m128i a, __m128i b) {
+    a = _mm_max_epi16(a, _mm_srli_epi32(a, 16));
+    b = _mm_max_epi16(b, _mm_srli_epi32(b, 16));
+    // Sign extended, the low halves pack back without saturating
+    a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+    b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+    return _mm_packs_epi32(a, b);
+}
+
+static void add2_sse2(const uint16_t *row, uint32_t *sums, int from, int to) {
+    int j = from;
+    for (; j + 4 <= to; j += 4) {
+        __m128i pairs = pair_sums_sse2(_mm_loadu_si128((const __m128i *) (row + 2 * j)));
+        __m128i *target = (__m128i *) (sums + j);
+        _mm_storeu_si128(target, _mm_add_epi32(_mm_loadu_si128(target), pairs));
+    }
+    add_bins_scalar<2>(row, sums, j, to);
+}
+
+static void add4_sse2(const uint16_t *row, uint32_t *sums, int from, int to) {
+    int j = from;
+    for (; j + 4 <= to; j += 4) {
+        __m128 p0 = _mm_castsi128_ps(pair_sums_sse2(_mm_loadu_si128((const __m128i *) (row + 4 * j))));
+        __m128 p1 = _mm_castsi128_ps(pair_sums_sse2(_mm_loadu_si128((const __m128i *) (row + 4 * j + 8))));
+        __m128i evens = _mm_castps_si128(_mm_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odds = _mm_castps_si128(_mm_shuffle_ps(p0, p1, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m128i *target = (__m128i *) (sums + j);
+        _mm_storeu_si128(target, _mm_add_epi32(_mm_loadu_si128(target), _mm_add_epi32(evens, odds)));
+    }
+    add_bins_scalar<4>(row, sums, j, to);
+}
+
+static void max2_sse2(const uint16_t *row, uint16_t *maxima, int from, int to) {
+    int j = from;
+    for (; j + 8 <= to; j += 8) {
+        const __m128i *source = (const __m128i *) (row + 2 * j);
+        __m128i pairs = pair_maxima_sse2(flip_sse2(_mm_loadu_si128(source)), flip_sse2(_mm_loadu_si128(source + 1)));
+        __m128i *target = (__m128i *) (maxima + j);
+        _mm_storeu_si128(target, flip_sse2(_mm_max_epi16(flip_sse2(_mm_loadu_si128(target)), pairs)));
+    }
+    max_bins_scalar<2>(row, maxima, j, to);
+}
+
+static void max4_sse2(const uint16_t *row, uint16_t *maxima, int from, int to) {
+    int j = from;
+    for (; j + 8 <= to; j += 8) {
+        const __m128i *source = (const __m128i *) (row + 4 * j);
+        __m128i pairs0 = pair_maxima_sse2(flip_sse2(_mm_loadu_si128(source)), flip_sse2(_mm_loadu_si128(source + 1)));
+        __m128i pairs1 = pair_maxima_sse2(flip_sse2(_mm_loadu_si128(source + 2)), flip_sse2(_mm_loadu_si128(source + 3)));
+        __m128i quads = pair_maxima_sse2(pairs0, pairs1);
+        __m128i *target = (__m128i *) (maxima + j);
+        _mm_storeu_si128(target, flip_sse2(_mm_max_epi16(flip_sse2(_mm_loadu_si128(target)), quads)));
+    }
+    max_bins_scalar<4>(row, maxima, j, to);
+}
+
+#elif defined(PYOPTRIS_NEON) && defined(__aarch64__)
+
+static void add2_neon(const uint16_t *row, uint32_t *sums, int from, int to) {
+    int j = from;
+    for (; j + 4 <= to; j += 4) {
+        vst1q_u32(sums + j, vpadalq_u16(vld1q_u32(sums + j), vld1q_u16(row + 2 * j)));
+    }
+    add_bins_scalar<2>(row, sums, j, to);
+}
+
+static void add4_neon(const uint16_t *row, uint32_t *sums, int from, int to) {
+    int j = from;
+    for (; j + 4 <= to; j += 4) {
+        uint32x4_t quads = vpaddq_u32(vpaddlq_u16(vld1q_u16(row + 4 * j)), vpaddlq_u16(vld1q_u16(row + 4 * j + 8)));
+        vst1q_u32(sums + j, vaddq_u32(vld1q_u32(sums + j), quads));
+    }
+    add_bins_scalar<4>(row, sums, j, to);
+}
+
+// vld2/vld4 deinterleave the pixels of a bin into separate registers
+static void max2_neon(const uint16_t *row, uint16_t *maxima, int from, int to) {
+    int j = from;
+    for (; j + 8 <= to; j += 8) {
+        uint16x8x2_t v = vld2q_u16(row + 2 * j);
+        vst1q_u16(maxima + j, vmaxq_u16(vld1q_u16(maxima + j), vmaxq_u16(v.val[0], v.val[1])));
+    }
+    max_bins_scalar<2>(row, maxima, j, to);
+}
+
+static void max4_neon(const uint16_t *row, uint16_t *maxima, int from, int to) {
+    int j = from;
+    for (; j + 8 <= to; j += 8) {
+        uint16x8x4_t v = vld4q_u16(row + 4 * j);
+        uint16x8_t quads = vmaxq_u16(vmaxq_u16(v.val[0], v.val[1]), vmaxq_u16(v.val[2], v.val[3]));
+        vst1q_u16(maxima + j, vmaxq_u16(vld1q_u16(maxima + j), quads));
+    }
+    max_bins_scalar<4>(row, maxima, j, to);
+}
+
+#endif
+
+typedef void (*AddKernel)(const uint16_t *, uint32_t *, int, int);
+typedef void (*MaxKernel)(const uint16_t *, uint16_t *, int, int);
+typedef void (*MeanKernel)(const uint32_t *, uint16_t *, int, int);
+
+struct BinningKernels {
+    AddKernel add2;
+    AddKernel add4;
+    MaxKernel max2;
+    MaxKernel max4;
+    MeanKernel mean;
+};
+
+static BinningKernels select_kernels() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        return { add2_avx2, add4_avx2, max2_avx2, max4_avx2, mean_avx2 };
+    }
+#endif
+#if defined(PYOPTRIS_SSE2)
+    return { add2_sse2, add4_sse2, max2_sse2, max4_sse2, mean_default };
+#elif defined(PYOPTRIS_NEON) && defined(__aarch64__)
+    return { add2_neon, add4_neon, max2_neon, max4_neon, mean_default };
+#else
+    return { add_bins_scalar<2>, add_bins_scalar<4>, max_bins_scalar<2>, max_bins_scalar<4>, mean_default };
+#endif
+}
+
+static const BinningKernels &kernels() {
+    static const BinningKernels selected = select_kernels();
+    return selected;
+}
+
+/**
+ * @brief Reduces factor rows starting at first, stride pixels apart, into width bins of out
+ * @param sums width entries of scratch for the mean
+ */
+static void reduce_rows(const uint16_t *first, size_t stride, int factor, BinningMode mode, int width, uint32_t *sums, uint16_t *out) {
+    const BinningKernels &selected = kernels();
+    if (factor == 1) {
+        std::memcpy(out, first, (size_t) width * sizeof(uint16_t));
+        return;
+    }
+    if (mode == BINNING_MAX) {
+        MaxKernel kernel = factor == 2 ? selected.max2 : selected.max4;
+        std::fill(out, out + width, (uint16_t) 0);
+        for (int r = 0; r < factor; r++) {
+            kernel(first + r * stride, out, 0, width);
+        }
+        return;
+    }
+    AddKernel kernel = factor == 2 ? selected.add2 : selected.add4;
+    std::fill(sums, sums + width, 0u);
+    for (int r = 0; r < factor; r++) {
+        kernel(first + r * stride, sums, 0, width);
+    }
+    // factor * factor is 4 or 16, the rounded division is a shift
+    selected.mean(sums, out, width, factor == 2 ? 2 : 4);
+}
+
+bool check_binning(int frameWidth, int frameHeight, const BinningOptions &options, std::string &error) {
+    if (options.factor != 1 && options.factor != 2 && options.factor != 4) {
+        error = "binning must be 1, 2 or 4";
+        return false;
+    }
+    if (options.mode != BINNING_MEAN && options.mode != BINNING_MAX) {
+        error = "binning_mode must be BINNING_MEAN or BINNING_MAX";
+        return false;
+    }
+    if (options.x < 0 || options.y < 0 || options.width < 1 || options.height < 1 || options.width > frameWidth - options.x
+            || options.height > frameHeight - options.y) {
+        error = "crop must be a non-empty rectangle within the " + std::to_string(frameWidth) + "x" + std::to_string(frameHeight) + " frame";
+        return false;
+    }
+    if (options.levels < 0 || options.levels > 15 || binned_width(options, options.levels) < 1 || binned_height(options, options.levels) < 1) {
+        error = "levels must be 0 or more, and the last level must keep at least one pixel";
+        return false;
+    }
+    return true;
+}
+
+int binned_width(const BinningOptions &options, int level) {
+    return (options.width / options.factor) >> level;
+}
+
+int binned_height(const BinningOptions &options, int level) {
+    return (options.height / options.factor) >> level;
+}
+
+size_t binning_scratch_bytes(const BinningOptions &options) {
+    return options.mode == BINNING_MEAN ? (size_t) binned_width(options, 0) * sizeof(uint32_t) : 0;
+}
+
+void bin_frame(const uint16_t *frame, int frameWidth, const BinningOptions &options, uint16_t *const *outputs, void *scratch) {
+    uint32_t *sums = (uint32_t *) scratch;
+    int width = binned_width(options, 0), height = binned_height(options, 0);
+    const uint16_t *origin = frame + (size_t) options.y * frameWidth + options.x;
+    size_t bandStride = (size_t) options.factor * frameWidth;
+    for (int i = 0; i < height; i++) {
+        reduce_rows(origin + i * bandStride, (size_t) frameWidth, options.factor, options.mode, width, sums, outputs[0] + (size_t) i * width);
+
+        // An odd row completes a pair, whose row of the next level is reduced right away
+        int row = i;
+        for (int level = 1; level <= options.levels && (row & 1); level++) {
+            row >>= 1;
+            int above = binned_width(options, level - 1), levelWidth = binned_width(options, level);
+            reduce_rows(outputs[level - 1] + (size_t) 2 * row * above, (size_t) above, 2, options.mode, levelWidth, sums,
+                        outputs[level] + (size_t) row * levelWidth);
+        }
+    }
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef PYOPTRIS_BINNING_H
+#define PYOPTRIS_BINNING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace pyoptris {
+
+enum BinningMode {
+    BINNING_MEAN = 0,   // rounded mean of the pixels of a bin
+    BINNING_MAX = 1     // hottest pixel of a bin, keeps hot spots visible in previews
+};
+
+struct BinningOptions {
+    int x;              // crop rectangle in the source frame
+    int y;
+    int width;
+    int height;
+    int factor;         // 1, 2 or 4, bins of factor x factor pixels
+    BinningMode mode;
+    int levels;         // pyramid levels after the binned crop, each binned 2x2 from the level before
+};
+
+/**
+ * @brief Checks options against a frameWidth x frameHeight frame
+ * @param[out] error reason if the options are unusable
+ */
+bool check_binning(int frameWidth, int frameHeight, const BinningOptions &options, std::string &error);
+
+/**
+ * @brief Size of a level, 0 is the binned crop. Rows and columns that do not fill a bin are left out.
+ */
+int binned_width(const BinningOptions &options, int level);
+int binned_height(const BinningOptions &options, int level);
+
+/**
+ * @brief Bytes of scratch bin_frame() needs
+ */
+size_t binning_scratch_bytes(const BinningOptions &options);
+
+/**
+ * @brief Crops and bins a frame and builds its pyramid in one pass over the source.
+ * Every factor rows of the crop are reduced to a row of level 0 by summing or taking the maximum of
+ * factor pixels across each row with vector instructions; each completed pair of rows of a level yields
+ * the next row of the level below, so all levels are done when the last source row was read and the
+ * small levels are built from rows still in cache.
+ * @param outputs options.levels + 1 buffers, binned_width * binned_height of their level each
+ * @param scratch binning_scratch_bytes(options) bytes
+ */
+void bin_frame(const uint16_t *frame, int frameWidth, const BinningOptions &options, uint16_t *const *outputs, void *scratch);
+
+}
+
+#endif
@@ -0,0 +1,223 @@
+#include "blobs.h"
+
+#include "simd.h"
+
+#include <algorithm>
+
+namespace pyoptris {
+
+// First x at or after x with row[x] >= threshold, width if there is none
+static int next_hot(const uint16_t *row, int x, int width, uint16_t threshold) {
+#if defined(PYOPTRIS_SSE2)
+    // Hot pixels are rare, whole vectors below the threshold are skipped; subs(threshold, v) == 0 is v >= threshold
+    const __m128i limit = _mm_set1_epi16((short) threshold);
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (row + x));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(limit, v), zero));
+        if (mask != 0) {
+            for (int i = 0;; i++) {
+                if (mask & (1 << (2 * i))) {
+                    return x + i;
+                }
+            }
+        }
+    }
+#elif defined(PYOPTRIS_NEON)
+    const uint16x8_t limit = vdupq_n_u16(threshold);
+    for (; x + 8 <= width; x += 8) {
+        uint64x2_t hot = vreinterpretq_u64_u16(vcgeq_u16(vld1q_u16(row + x), limit));
+        if ((vgetq_lane_u64(hot, 0) | vgetq_lane_u64(hot, 1)) != 0) {
+            break;
+        }
+    }
+#endif
+    while (x < width && row[x] < threshold) {
+        x++;
+    }
+    return x;
+}
+
+BlobDetector::BlobDetector(int width, int height, const BlobOptions &options)
+    : frameWidth(width), frameHeight(height), config(options), nextId(1) {
+}
+
+uint32_t BlobDetector::find(uint32_t component) {
+    while (components[component].parent != component) {
+        uint32_t parent = components[component].parent;
+        components[component].parent = components[parent].parent;     // path halving
+        component = parent;
+    }
+    return component;
+}
+
+// The root with the lower index wins, so roots stay in raster order of their first run
+void BlobDetector::join(uint32_t a, uint32_t b) {
+    a = find(a);
+    b = find(b);
+    if (a < b) {
+        components[b].parent = a;
+    } else if (b < a) {
+        components[a].parent = b;
+    }
+}
+
+void BlobDetector::label(const uint16_t *frame, uint16_t threshold) {
+    runs.clear();
+    components.clear();
+    int reach = config.connectivity == 8 ? 1 : 0;
+    size_t previousBegin = 0, previousEnd = 0;
+    for (int y = 0; y < frameHeight; y++) {
+        const uint16_t *row = frame + (size_t) y * frameWidth;
+        size_t rowBegin = runs.size();
+        int x = 0;
+        while ((x = next_hot(row, x, frameWidth, threshold)) < frameWidth) {
+            int x0 = x;
+            uint16_t peak = row[x];
+            int peakX = x;
+            uint64_t sum = 0;
+            for (; x < frameWidth && row[x] >= threshold; x++) {
+                sum += row[x];
+                if (row[x] > peak) {
+                    peak = row[x];
+                    peakX = x;
+                }
+            }
+            int x1 = x - 1;
+            uint32_t length = (uint32_t) (x1 - x0 + 1);
+            uint32_t index = (uint32_t) components.size();
+            components.push_back({ index, length, (uint64_t) (x0 + x1) * length / 2, (uint64_t) y * length, sum, peak, (uint16_t) peakX,
+                                   (uint16_t) y, (uint16_t) x0, (uint16_t) y, (uint16_t) x1, (uint16_t) y });
+            runs.push_back({ (uint16_t) x0, (uint16_t) x1, index });
+        }
+
+        // Runs of both rows are sorted by x, so the runs above a run are found by walking both lists once
+        size_t above = previousBegin;
+        for (size_t r = rowBegin; r < runs.size(); r++) {
+            while (above < previousEnd && runs[above].x1 + reach < runs[r].x0) {
+                above++;
+            }
+            for (size_t q = above; q < previousEnd && runs[q].x0 <= runs[r].x1 + reach; q++) {
+                join(runs[r].component, runs[q].component);
+            }
+        }
+        previousBegin = rowBegin;
+        previousEnd = runs.size();
+    }
+
+    // Fold every run into its root; roots have lower indices, so each is complete once the loop passed it
+    for (uint32_t i = 0; i < (uint32_t) components.size(); i++) {
+        uint32_t root = find(i);
+        if (root == i) {
+            continue;
+        }
+        Component &c = components[i];
+        Component &r = components[root];
+        r.area += c.area;
+        r.sumX += c.sumX;
+        r.sumY += c.sumY;
+        r.sum += c.sum;
+        if (c.peak > r.peak || (c.peak == r.peak && (c.peakY < r.peakY || (c.peakY == r.peakY && c.peakX < r.peakX)))) {
+            r.peak = c.peak;
+            r.peakX = c.peakX;
+            r.peakY = c.peakY;
+        }
+        r.left = std::min(r.left, c.left);
+        r.top = std::min(r.top, c.top);
+        r.right = std::max(r.right, c.right);
+        r.bottom = std::max(r.bottom, c.bottom);
+    }
+}
+
+void BlobDetector::track() {
+    float maxDistance2 = config.maxDistance * config.maxDistance;
+    size_t known = trackList.size();
+    trackMatched.assign(known, 0);
+    for (Blob &blob : blobs) {
+        size_t best = known;
+        float bestDistance2 = maxDistance2;
+        for (size_t t = 0; t < known; t++) {
+            if (trackMatched[t]) {
+                continue;
+            }
+            const Track &track = trackList[t];
+            float dx = blob.x - (track.x + track.dx), dy = blob.y - (track.y + track.dy);
+            float distance2 = dx * dx + dy * dy;
+            if (distance2 <= bestDistance2) {
+                best = t;
+                bestDistance2 = distance2;
+            }
+        }
+        if (best < known) {
+            Track &track = trackList[best];
+            track.dx = blob.x - track.x;
+            track.dy = blob.y - track.y;
+            track.x = blob.x;
+            track.y = blob.y;
+            track.age++;
+            track.missed = 0;
+            trackMatched[best] = 1;
+            blob.id = track.id;
+            blob.age = track.age;
+        } else {
+            blob.id = nextId++;
+            blob.age = 1;
+            trackList.push_back({ blob.id, 1, 0, blob.x, blob.y, 0.0f, 0.0f });
+        }
+    }
+    // Unmatched tracks coast along their last movement until they were missed too often
+    size_t kept = 0;
+    for (size_t t = 0; t < trackList.size(); t++) {
+        Track track = trackList[t];
+        if (t < known && !trackMatched[t]) {
+            track.x += track.dx;
+            track.y += track.dy;
+            if (++track.missed > config.maxMissed) {
+                continue;
+            }
+        }
+        trackList[kept++] = track;
+    }
+    trackList.resize(kept);
+}
+
+const std::vector<Blob> &BlobDetector::detect(const uint16_t *frame, uint16_t threshold, TemperatureScale scale) {
+    label(frame, threshold);
+    blobs.clear();
+    for (uint32_t i = 0; i < (uint32_t) components.size(); i++) {
+        const Component &c = components[i];
+        if (c.parent != i || c.area < config.minArea) {
+            continue;
+        }
+        Blob blob;
+        blob.id = 0;
+        blob.age = 0;
+        blob.area = c.area;
+        blob.peak = ((float) c.peak - scale.rawOffset) * scale.scale;
+        blob.mean = ((float) ((double) c.sum / c.area) - scale.rawOffset) * scale.scale;
+        blob.x = (float) ((double) c.sumX / c.area + 0.5);
+        blob.y = (float) ((double) c.sumY / c.area + 0.5);
+        blob.peakX = c.peakX;
+        blob.peakY = c.peakY;
+        blob.left = c.left;
+        blob.top = c.top;
+        blob.right = c.right;
+        blob.bottom = c.bottom;
+        blobs.push_back(blob);
+    }
+    // Largest first, blobs of equal area top to bottom
+    std::sort(blobs.begin(), blobs.end(), [](const Blob &a, const Blob &b) {
+        return a.area != b.area ? a.area > b.area : (a.top != b.top ? a.top < b.top : a.left < b.left);
+    });
+    if (blobs.size() > config.maxBlobs) {
+        blobs.resize(config.maxBlobs);
+    }
+    track();
+    return blobs;
+}
+
+void BlobDetector::reset() {
+    trackList.clear();
+}
+
+}
@@ -0,0 +1,122 @@
+#ifndef PYOPTRIS_BLOBS_H
+#define PYOPTRIS_BLOBS_H
+
+#include "convert.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pyoptris {
+
+/**
+ * @brief One hot blob of a frame, temperatures in degrees Celsius.
+ * (x, y) is the centroid of its pixels, where pixel (x, y) covers [x, x + 1) x [y, y + 1); the peak
+ * is the first hottest pixel in row-major order and the bounding box includes left/right and top/bottom.
+ */
+struct Blob {
+    uint32_t id;            // track, the same for a blob followed from frame to frame
+    uint32_t age;           // frames the track was detected in, 1 for a new blob
+    uint32_t area;          // pixels
+    float peak;
+    float mean;
+    float x;
+    float y;
+    uint16_t peakX;
+    uint16_t peakY;
+    uint16_t left;
+    uint16_t top;
+    uint16_t right;
+    uint16_t bottom;
+};
+
+static_assert(sizeof(Blob) == 40, "Blob is mirrored by a numpy dtype");
+
+struct BlobOptions {
+    int connectivity;       // 4 or 8
+    uint32_t minArea;       // smaller blobs are ignored
+    size_t maxBlobs;        // largest blobs reported per frame
+    float maxDistance;      // pixels between the predicted and the found centroid of a tracked blob
+    uint32_t maxMissed;     // frames a track survives without its blob
+};
+
+/**
+ * @brief Finds the connected pixels at or above a threshold and follows them from frame to frame.
+ * Each row is scanned once for runs of hot pixels, skipping cold pixels a vector at a time, and runs
+ * touching a run of the row above are joined with union-find. Area, sums, peak and bounds are
+ * gathered per run while scanning, so the frame is read once and no label image is written.
+ * Tracks keep the id of a blob while its centroid stays within maxDistance of where its last
+ * movement predicts it; blobs are matched largest first.
+ */
+class BlobDetector {
+public:
+    BlobDetector(int width, int height, const BlobOptions &options);
+
+    /**
+     * @brief Blobs of frame, largest first, at most maxBlobs of them
+     * @param threshold raw value a pixel needs to be hot
+     * @return valid until the next call
+     */
+    const std::vector<Blob> &detect(const uint16_t *frame, uint16_t threshold, TemperatureScale scale);
+
+    /**
+     * @brief Forgets the tracks, the next blobs get new ids; ids are never reused
+     */
+    void reset();
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    const BlobOptions &options() const { return config; }
+    size_t tracks() const { return trackList.size(); }
+
+private:
+    struct Run {
+        uint16_t x0;
+        uint16_t x1;        // inclusive
+        uint32_t component;
+    };
+
+    struct Component {
+        uint32_t parent;
+        uint32_t area;
+        uint64_t sumX;      // of the pixel indices, the centroid adds 0.5
+        uint64_t sumY;
+        uint64_t sum;
+        uint16_t peak;
+        uint16_t peakX;
+        uint16_t peakY;
+        uint16_t left;
+        uint16_t top;
+        uint16_t right;
+        uint16_t bottom;
+    };
+
+    struct Track {
+        uint32_t id;
+        uint32_t age;
+        uint32_t missed;
+        float x;
+        float y;
+        float dx;           // movement over the last frame
+        float dy;
+    };
+
+    uint32_t find(uint32_t component);
+    void join(uint32_t a, uint32_t b);
+    void label(const uint16_t *frame, uint16_t threshold);
+    void track();
+
+    int frameWidth;
+    int frameHeight;
+    BlobOptions config;
+    std::vector<Run> runs;
+    std::vector<Component> components;
+    std::vector<Blob> blobs;
+    std::vector<Track> trackList;
+    std::vector<uint8_t> trackMatched;
+    uint32_t nextId;
+};
+
+}
+
+#endif
@@ -0,0 +1,203 @@
+#include "capture.h"
+#include "framepool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace pyoptris {
+
+Capture::Capture(std::shared_ptr<FrameSource> source, size_t capacity)
+    : source(std::move(source)), ringCapacity(std::max<size_t>(capacity, 2)), frameWidth(0), frameHeight(0),
+      staging(nullptr), previous(nullptr), lastValid(nullptr), isRunning(false), isFailed(false), errorCount(0), gatedCount(0), suppressedCount(0), heldCount(0) {
+}
+
+Capture::~Capture() {
+    stop();
+    free_staging();
+}
+
+void Capture::free_staging() {
+    aligned_free(staging);
+    aligned_free(previous);
+    aligned_free(lastValid);
+    staging = previous = lastValid = nullptr;
+}
+
+int Capture::start() {
+    int ok = source->thermal_size(frameWidth, frameHeight);
+    if (ok != 0) {
+        return ok;
+    }
+    ring.reset(new FrameRing(ringCapacity, (size_t) frameWidth * frameHeight * sizeof(uint16_t)));
+    free_staging();
+    size_t frameSize = ring->frame_size();
+    staging = static_cast<uint16_t *>(aligned_allocate(frameSize));
+    previous = static_cast<uint16_t *>(aligned_allocate(frameSize));
+    lastValid = static_cast<uint16_t *>(aligned_allocate(frameSize));
+    if (staging == nullptr || previous == nullptr || lastValid == nullptr) {
+        free_staging();
+        throw std::bad_alloc();
+    }
+    isRunning.store(true, std::memory_order_release);
+    thread = std::thread(&Capture::run, this);
+    return 0;
+}
+
+void Capture::stop() {
+    isRunning.store(false, std::memory_order_release);
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Capture::run() {
+    size_t frameSize = ring->frame_size();
+    size_t pixels = (size_t) frameWidth * frameHeight;
+    // The two staging buffers swap roles every frame, so the gate can compare with the previous frame without a copy
+    uint16_t *staging = this->staging;
+    uint16_t *previous = this->previous;
+    bool havePrevious = false;
+    // Last valid frame, published in place of invalid ones under FLAG_POLICY_HOLD
+    bool haveLastValid = false;
+    // Back-to-back errors of an unplugged or unconnected camera, retried with a growing pause
+    int consecutiveErrors = 0;
+
+    PipelineStatistics &statistics = pipeline_statistics();
+    while (isRunning.load(std::memory_order_acquire)) {
+        FrameInfo info;
+        int64_t before = steady_now_ns();
+        int ok = source->fetch_thermal(staging, frameWidth, frameHeight, info);
+        if (ok == 0) {
+            consecutiveErrors = 0;
+            int64_t after = steady_now_ns();
+            info.fetchNs = after - before;
+            fetchLatency.record(info.fetchNs);
+            statistics.capture.record(info.fetchNs);
+            statistics.captured.fetch_add(1, std::memory_order_relaxed);
+
+            gate.classify(staging, havePrevious ? previous : nullptr, pixels, info, after);
+            FlagPolicy policy = gate.policy();
+            if (info.validity == FRAME_VALID) {
+                if (policy == FLAG_POLICY_HOLD) {
+                    std::memcpy(lastValid, staging, frameSize);
+                    haveLastValid = true;
+                }
+                ring->publish(staging, info);
+            } else {
+                gatedCount.fetch_add(1, std::memory_order_relaxed);
+                if (policy == FLAG_POLICY_TAG) {
+                    ring->publish(staging, info);
+                } else if (policy == FLAG_POLICY_HOLD && haveLastValid) {
+                    info.held = true;
+                    heldCount.fetch_add(1, std::memory_order_relaxed);
+                    ring->publish(lastValid, info);
+                } else {
+                    suppressedCount.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            std::swap(staging, previous);
+            havePrevious = true;
+        } else if (ok == -2) {
+            statistics.errors.fetch_add(1, std::memory_order_relaxed);
+            isFailed.store(true, std::memory_order_release);
+            break;
+        } else {
+            statistics.errors.fetch_add(1, std::memory_order_relaxed);
+            errorCount.fetch_add(1, std::memory_order_relaxed);
+            // A single error is retried right away, then 1 ms doubling up to the stop poll interval
+            if (++consecutiveErrors > 1) {
+                int shift = std::min(consecutiveErrors - 2, 7);
+                int64_t pauseNs = std::min<int64_t>(INT64_C(1000000) << shift, CAPTURE_STOP_POLL_NS);
+                std::this_thread::sleep_for(std::chrono::nanoseconds(pauseNs));
+            }
+        }
+    }
+
+    isRunning.store(false, std::memory_order_release);
+    ring->close();
+}
+
+Capture::Cursor Capture::cursor() const {
+    Cursor cursor = { ring->head(), 0 };
+    return cursor;
+}
+
+bool Capture::latest(void *data, FrameInfo *info) {
+    return latest_in(*ring, data, info);
+}
+
+bool Capture::latest_in(const FrameRing &ring, void *data, FrameInfo *info) {
+    for (;;) {
+        uint64_t head = ring.head();
+        if (head == 0) {
+            return false;
+        }
+        if (ring.read(head - 1, data, info) == FrameRing::READ_OK) {
+            return true;
+        }
+    }
+}
+
+Capture::WaitResult Capture::next(Cursor &cursor, void *data, FrameInfo *info, int64_t timeoutNs) {
+    return next_in(*ring, cursor, data, info, timeoutNs);
+}
+
+Capture::WaitResult Capture::next_in(FrameRing &ring, Cursor &cursor, void *data, FrameInfo *info, int64_t timeoutNs) {
+    for (;;) {
+        uint64_t tail = ring.tail();
+        if (cursor.next < tail) {
+            cursor.dropped += tail - cursor.next;
+            cursor.next = tail;
+        }
+        switch (ring.read(cursor.next, data, info)) {
+            case FrameRing::READ_OK:
+                cursor.next++;
+                return WAIT_FRAME;
+
+            case FrameRing::READ_OVERWRITTEN:
+                // The producer is lapping this slot, the frame is gone
+                cursor.dropped++;
+                cursor.next++;
+                break;
+
+            case FrameRing::READ_PENDING:
+                if (ring.closed()) {
+                    return WAIT_CLOSED;
+                }
+                if (!ring.wait(cursor.next, timeoutNs)) {
+                    return ring.closed() ? WAIT_CLOSED : WAIT_TIMEOUT;
+                }
+                break;
+        }
+    }
+}
+
+Capture::WaitResult Capture::next_batch(Cursor &cursor, void *data, FrameInfo *infos, size_t count, size_t &read, int64_t timeoutNs) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point deadline = Clock::now() + std::chrono::nanoseconds(std::max<int64_t>(timeoutNs, 0));
+    unsigned char *frames = static_cast<unsigned char *>(data);
+    size_t frameSize = ring->frame_size();
+    while (read < count) {
+        int64_t remaining = -1;
+        if (timeoutNs >= 0) {
+            remaining = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count(), 0);
+        }
+        WaitResult result = next(cursor, frames + read * frameSize, infos != nullptr ? infos + read : nullptr, remaining);
+        if (result != WAIT_FRAME) {
+            return result;
+        }
+        read++;
+    }
+    return WAIT_FRAME;
+}
+
+uint64_t Capture::pending(const Cursor &cursor) const {
+    uint64_t head = ring->head();
+    uint64_t from = std::max(cursor.next, ring->tail());
+    return head > from ? head - from : 0;
+}
+
+}
@@ -0,0 +1,189 @@
+#ifndef PYOPTRIS_CAPTURE_H
+#define PYOPTRIS_CAPTURE_H
+
+#include "gate.h"
+#include "ring.h"
+#include "stats.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace pyoptris {
+
+/**
+ * @brief Longest single wait of a thread consuming a capture, waits are sliced so its stop() is noticed without a frame arriving
+ */
+static const int64_t CAPTURE_STOP_POLL_NS = 100000000;
+
+/**
+ * @brief Producer of thermal frames, implemented on top of an SDK binding.
+ * Return codes follow the SDK: 0 on success, -1 on error, -2 on fatal error.
+ */
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+
+    virtual int thermal_size(int &width, int &height) = 0;
+
+    /**
+     * @brief Blocks until the next thermal frame is available and copies it into data
+     * @param[out] data width * height pixels
+     * @param[out] info metadata, sequence is assigned by the ring and fetchNs measured by the capture,
+     * flag and chipTemperature keep their defaults if the source does not report them
+     */
+    virtual int fetch_thermal(uint16_t *data, int width, int height, FrameInfo &info) = 0;
+};
+
+/**
+ * @brief Drains a FrameSource on a native thread into a FrameRing.
+ * The thread never touches Python, consumers read through a Cursor of their own.
+ */
+class Capture {
+public:
+    /**
+     * @brief Read position of one consumer
+     */
+    struct Cursor {
+        uint64_t next;      // sequence number of the next frame to deliver
+        uint64_t dropped;   // frames overwritten before this consumer got to them
+    };
+
+    enum WaitResult {
+        WAIT_FRAME,
+        WAIT_TIMEOUT,
+        WAIT_CLOSED
+    };
+
+    Capture(std::shared_ptr<FrameSource> source, size_t capacity);
+    ~Capture();
+
+    Capture(const Capture &) = delete;
+    Capture &operator=(const Capture &) = delete;
+
+    /**
+     * @brief Queries the image size, allocates the ring and spawns the capture thread
+     * @return SDK error code of the size query, 0 on success
+     * @throws std::bad_alloc if the ring or the staging frames cannot be allocated, the thread is not started
+     */
+    int start();
+
+    /**
+     * @brief Stops the capture thread and closes the ring, waiting consumers are released
+     */
+    void stop();
+
+    bool running() const { return isRunning.load(std::memory_order_acquire); }
+
+    /**
+     * @brief true if the capture thread gave up after a fatal SDK error
+     */
+    bool failed() const { return isFailed.load(std::memory_order_acquire); }
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    size_t capacity() const { return ringCapacity; }
+    size_t frame_size() const { return ring->frame_size(); }
+
+    uint64_t frames() const { return ring->head(); }
+    uint64_t errors() const { return errorCount.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Frames the flag gate found invalid, whatever the policy did with them
+     */
+    uint64_t gated() const { return gatedCount.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Invalid frames left out of the ring by FLAG_POLICY_DROP, or by FLAG_POLICY_HOLD before the first valid frame
+     */
+    uint64_t suppressed() const { return suppressedCount.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Invalid frames replaced by the last valid one under FLAG_POLICY_HOLD
+     */
+    uint64_t held() const { return heldCount.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Flag cycle handling of the capture thread, may be reconfigured while it runs
+     */
+    FlagGate &flag_gate() { return gate; }
+    const FlagGate &flag_gate() const { return gate; }
+
+    /**
+     * @brief Time the source blocked in fetch_thermal, successful fetches only
+     */
+    const LatencyHistogram &fetch_latency() const { return fetchLatency; }
+
+    /**
+     * @brief Creates a cursor positioned at the next frame to be captured
+     */
+    Cursor cursor() const;
+
+    /**
+     * @brief Copies the most recent frame
+     * @return false if no frame has been captured yet
+     */
+    bool latest(void *data, FrameInfo *info);
+
+    /**
+     * @brief Copies the frame at the cursor and advances it, skipping frames that were overwritten
+     * @param timeoutNs maximum time to wait for a frame in ns, negative waits forever
+     */
+    WaitResult next(Cursor &cursor, void *data, FrameInfo *info, int64_t timeoutNs);
+
+    /**
+     * @brief next() for count frames in a row, the frames are stored back to back in data
+     * @param infos count entries, may be nullptr
+     * @param[in,out] read frames already stored, the call continues behind them, so an interrupted batch can be resumed
+     * @param timeoutNs maximum time to wait for the whole call in ns, negative waits forever
+     * @return WAIT_FRAME once read reaches count
+     */
+    WaitResult next_batch(Cursor &cursor, void *data, FrameInfo *infos, size_t count, size_t &read, int64_t timeoutNs);
+
+    /**
+     * @brief Blocks until frame sequence is captured without copying it, e.g. to signal other threads
+     * @param timeoutNs maximum time to wait in ns, negative waits forever
+     * @return false on timeout or once the capture stopped
+     */
+    bool wait_frame(uint64_t sequence, int64_t timeoutNs) { return ring->wait(sequence, timeoutNs); }
+
+    /**
+     * @brief Number of frames that next() can deliver without waiting
+     */
+    uint64_t pending(const Cursor &cursor) const;
+
+    /**
+     * @brief next() and latest() on any ring, for consumers of rings derived from a capture
+     */
+    static WaitResult next_in(FrameRing &ring, Cursor &cursor, void *data, FrameInfo *info, int64_t timeoutNs);
+    static bool latest_in(const FrameRing &ring, void *data, FrameInfo *info);
+
+private:
+    void run();
+    void free_staging();
+
+    std::shared_ptr<FrameSource> source;
+    std::unique_ptr<FrameRing> ring;
+    size_t ringCapacity;
+    int frameWidth;
+    int frameHeight;
+    // Staging frames of the capture thread, allocated by start() so a failure is reported to the caller
+    uint16_t *staging;
+    uint16_t *previous;
+    uint16_t *lastValid;
+
+    std::thread thread;
+    std::atomic<bool> isRunning;
+    std::atomic<bool> isFailed;
+    std::atomic<uint64_t> errorCount;
+    std::atomic<uint64_t> gatedCount;
+    std::atomic<uint64_t> suppressedCount;
+    std::atomic<uint64_t> heldCount;
+    LatencyHistogram fetchLatency;
+    FlagGate gate;
+};
+
+}
+
+#endif
@@ -0,0 +1,198 @@
+#include "codec.h"
+
+#include <algorithm>
+
+namespace pyoptris {
+
+size_t codec_max_encoded_size(size_t n) {
+    return 1 + (n + CODEC_BLOCK - 1) / CODEC_BLOCK + n * sizeof(uint16_t);
+}
+
+// Deltas are signed, keyframe values unsigned, the predictor compares them accordingly
+template <bool DELTA>
+static inline int32_t domain(uint16_t value) {
+    return DELTA ? (int32_t) (int16_t) value : (int32_t) value;
+}
+
+// Median edge detector: picks the smaller neighbour above an edge, the larger one below it, the plane otherwise.
+// That is the plane prediction clamped to the range of left and up, which compiles without branches.
+static inline int32_t median_edge(int32_t left, int32_t up, int32_t upLeft) {
+    int32_t low = left < up ? left : up;
+    int32_t high = left < up ? up : left;
+    int32_t plane = left + up - upLeft;
+    plane = plane < low ? low : plane;
+    return plane > high ? high : plane;
+}
+
+static inline uint16_t zigzag(uint16_t r) {
+    return (uint16_t) ((r << 1) ^ (0u - (r >> 15)));
+}
+
+static inline uint16_t unzigzag(uint16_t z) {
+    return (uint16_t) ((z >> 1) ^ (0u - (z & 1u)));
+}
+
+template <bool DELTA>
+static void residuals_of(const uint16_t *frame, const uint16_t *previous, uint16_t *residuals, int width, int height,
+                         std::vector<int32_t> &rows) {
+    int32_t *row = rows.data();
+    int32_t *up = rows.data() + width;
+    for (int y = 0; y < height; y++) {
+        const uint16_t *src = frame + (size_t) y * width;
+        const uint16_t *ref = DELTA ? previous + (size_t) y * width : nullptr;
+        uint16_t *dst = residuals + (size_t) y * width;
+        for (int x = 0; x < width; x++) {
+            row[x] = domain<DELTA>(DELTA ? (uint16_t) (src[x] - ref[x]) : src[x]);
+        }
+        // The whole row is known to the encoder, so unlike in reconstruct() the predictions are independent
+        // and the loops vectorise. The first row predicts from the left, the first column from above.
+        if (y == 0) {
+            dst[0] = zigzag((uint16_t) row[0]);
+            for (int x = 1; x < width; x++) {
+                dst[x] = zigzag((uint16_t) (row[x] - row[x - 1]));
+            }
+        } else {
+            dst[0] = zigzag((uint16_t) (row[0] - up[0]));
+            for (int x = 1; x < width; x++) {
+                dst[x] = zigzag((uint16_t) (row[x] - median_edge(row[x - 1], up[x], up[x - 1])));
+            }
+        }
+        std::swap(row, up);
+    }
+}
+
+template <bool DELTA>
+static void reconstruct(const uint16_t *residuals, const uint16_t *previous, uint16_t *frame, int width, int height,
+                        std::vector<int32_t> &rows) {
+    int32_t *row = rows.data();
+    int32_t *up = rows.data() + width;
+    for (int y = 0; y < height; y++) {
+        const uint16_t *src = residuals + (size_t) y * width;
+        const uint16_t *ref = DELTA ? previous + (size_t) y * width : nullptr;
+        uint16_t *dst = frame + (size_t) y * width;
+        int32_t left = y == 0 ? 0 : up[0];
+        for (int x = 0; x < width; x++) {
+            int32_t prediction = y == 0 || x == 0 ? left : median_edge(left, up[x], up[x - 1]);
+            uint16_t value = (uint16_t) ((uint16_t) prediction + unzigzag(src[x]));
+            left = row[x] = domain<DELTA>(value);
+            dst[x] = DELTA ? (uint16_t) (ref[x] + value) : value;
+        }
+        std::swap(row, up);
+    }
+}
+
+static int bit_width(uint32_t value) {
+    int bits = 0;
+    while (value != 0) {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+
+static size_t pack(const uint16_t *values, size_t n, uint8_t *out) {
+    uint8_t *p = out;
+    for (size_t start = 0; start < n; start += CODEC_BLOCK) {
+        size_t count = std::min(CODEC_BLOCK, n - start);
+        const uint16_t *block = values + start;
+        uint32_t any = 0;
+        for (size_t i = 0; i < count; i++) {
+            any |= block[i];
+        }
+        int bits = bit_width(any);
+        *p++ = (uint8_t) bits;
+        uint64_t accumulator = 0;
+        int filled = 0;
+        for (size_t i = 0; i < count; i++) {
+            accumulator |= (uint64_t) block[i] << filled;
+            filled += bits;
+            while (filled >= 8) {
+                *p++ = (uint8_t) accumulator;
+                accumulator >>= 8;
+                filled -= 8;
+            }
+        }
+        if (filled > 0) {
+            *p++ = (uint8_t) accumulator;
+        }
+    }
+    return (size_t) (p - out);
+}
+
+static bool unpack(const uint8_t *data, size_t size, uint16_t *values, size_t n) {
+    const uint8_t *p = data;
+    const uint8_t *end = data + size;
+    for (size_t start = 0; start < n; start += CODEC_BLOCK) {
+        size_t count = std::min(CODEC_BLOCK, n - start);
+        if (p == end) {
+            return false;
+        }
+        int bits = *p++;
+        if (bits > 16 || (size_t) (end - p) < (count * bits + 7) / 8) {
+            return false;
+        }
+        uint16_t *block = values + start;
+        uint32_t mask = (1u << bits) - 1;
+        uint64_t accumulator = 0;
+        int filled = 0;
+        for (size_t i = 0; i < count; i++) {
+            while (filled < bits) {
+                accumulator |= (uint64_t) *p++ << filled;
+                filled += 8;
+            }
+            block[i] = (uint16_t) (accumulator & mask);
+            accumulator >>= bits;
+            filled -= bits;
+        }
+    }
+    return true;
+}
+
+FrameEncoder::FrameEncoder(int width, int height, int keyframeInterval)
+    : frameWidth(width), frameHeight(height), interval(std::max(keyframeInterval, 1)), sinceKeyframe(-1),
+      previous((size_t) width * height), residuals((size_t) width * height), rows((size_t) width * 2) {
+}
+
+size_t FrameEncoder::encode(const uint16_t *frame, uint8_t *out) {
+    size_t n = (size_t) frameWidth * frameHeight;
+    bool keyframe = sinceKeyframe < 0 || sinceKeyframe + 1 >= interval;
+    if (keyframe) {
+        residuals_of<false>(frame, nullptr, residuals.data(), frameWidth, frameHeight, rows);
+        sinceKeyframe = 0;
+    } else {
+        residuals_of<true>(frame, previous.data(), residuals.data(), frameWidth, frameHeight, rows);
+        sinceKeyframe++;
+    }
+    std::copy(frame, frame + n, previous.begin());
+    out[0] = keyframe ? CODEC_KEYFRAME : CODEC_DELTA;
+    return 1 + pack(residuals.data(), n, out + 1);
+}
+
+FrameDecoder::FrameDecoder(int width, int height)
+    : frameWidth(width), frameHeight(height), primed(false),
+      previous((size_t) width * height), residuals((size_t) width * height), rows((size_t) width * 2) {
+}
+
+bool FrameDecoder::decode(const uint8_t *data, size_t size, uint16_t *frame) {
+    size_t n = (size_t) frameWidth * frameHeight;
+    if (size < 1 || (data[0] != CODEC_KEYFRAME && data[0] != CODEC_DELTA)) {
+        return false;
+    }
+    bool keyframe = data[0] == CODEC_KEYFRAME;
+    if (!keyframe && !primed) {
+        return false;
+    }
+    if (!unpack(data + 1, size - 1, residuals.data(), n)) {
+        return false;
+    }
+    if (keyframe) {
+        reconstruct<false>(residuals.data(), nullptr, frame, frameWidth, frameHeight, rows);
+    } else {
+        reconstruct<true>(residuals.data(), previous.data(), frame, frameWidth, frameHeight, rows);
+    }
+    std::copy(frame, frame + n, previous.begin());
+    primed = true;
+    return true;
+}
+
+}
@@ -0,0 +1,92 @@
+#ifndef PYOPTRIS_CODEC_H
+#define PYOPTRIS_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pyoptris {
+
+/*
+ * Lossless codec for raw thermal frames.
+ *
+ * Keyframes predict every pixel from its left, upper and upper left neighbours with the median edge
+ * detector of LOCO-I. Delta frames apply the same predictor to the difference against the previous
+ * frame, so static scenery costs only the sensor noise and moving edges are still predicted spatially.
+ * Residuals are zigzag mapped and bit-packed in blocks of 32 with one width byte per block.
+ * All arithmetic wraps at 16 bit, any uint16 frame round-trips exactly.
+ *
+ * Encoded frame: one type byte (CODEC_KEYFRAME or CODEC_DELTA) followed by the packed blocks.
+ */
+
+static const uint8_t CODEC_KEYFRAME = 'K';
+static const uint8_t CODEC_DELTA = 'D';
+static const size_t CODEC_BLOCK = 32;
+
+/**
+ * @brief Upper bound of an encoded frame of n pixels
+ */
+size_t codec_max_encoded_size(size_t n);
+
+/**
+ * @brief Streaming encoder, keeps the previous frame to encode deltas against
+ */
+class FrameEncoder {
+public:
+    /**
+     * @param keyframeInterval every keyframeInterval-th frame is a keyframe, 1 makes every frame one
+     */
+    FrameEncoder(int width, int height, int keyframeInterval);
+
+    /**
+     * @brief Encodes frame into out, which must hold codec_max_encoded_size(width * height) bytes
+     * @return encoded size in bytes
+     */
+    size_t encode(const uint16_t *frame, uint8_t *out);
+
+    /**
+     * @brief Makes the next frame a keyframe, e.g. for a new subscriber
+     */
+    void reset() { sinceKeyframe = -1; }
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+
+private:
+    int frameWidth;
+    int frameHeight;
+    int interval;
+    int sinceKeyframe;          // frames since the last keyframe, -1 forces one
+    std::vector<uint16_t> previous;
+    std::vector<uint16_t> residuals;
+    std::vector<int32_t> rows;      // predictor input of the current and the previous row
+};
+
+/**
+ * @brief Streaming decoder, the counterpart of FrameEncoder
+ */
+class FrameDecoder {
+public:
+    FrameDecoder(int width, int height);
+
+    /**
+     * @brief Decodes one encoded frame into frame
+     * @return false on malformed data or a delta frame without a keyframe before it
+     */
+    bool decode(const uint8_t *data, size_t size, uint16_t *frame);
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+
+private:
+    int frameWidth;
+    int frameHeight;
+    bool primed;
+    std::vector<uint16_t> previous;
+    std::vector<uint16_t> residuals;
+    std::vector<int32_t> rows;      // predictor input of the current and the previous row
+};
+
+}
+
+#endif
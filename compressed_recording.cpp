@@ -0,0 +1,244 @@
+#include "compressed_recording.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace pyoptris {
+
+CompressedWriter::CompressedWriter(std::shared_ptr<Capture> capture, const std::string &path, int keyframeInterval, int temperatureDecimals)
+    : capture(capture), path(path), keyframeInterval(std::max(keyframeInterval, 1)), temperatureDecimals(temperatureDecimals), offset(0),
+      isRunning(false), stopping(false), frameCount(0), droppedCount(0), bytesIn(0), bytesOut(0) {
+}
+
+CompressedWriter::~CompressedWriter() {
+    stop();
+}
+
+bool CompressedWriter::write(const void *data, size_t size) {
+    file.write((const char *) data, (std::streamsize) size);
+    offset += size;
+    bytesOut.store(offset, std::memory_order_relaxed);
+    return file.good();
+}
+
+bool CompressedWriter::start(std::string &error) {
+    if (capture->width() <= 0 || capture->height() <= 0) {
+        error = "Capture is not running";
+        return false;
+    }
+    cursor = capture->cursor();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        error = "Could not create " + path;
+        return false;
+    }
+    CompressedFileHeader header = {};
+    std::memcpy(header.magic, COMPRESSED_MAGIC, sizeof(COMPRESSED_MAGIC));
+    header.version = COMPRESSED_VERSION;
+    header.width = (uint32_t) capture->width();
+    header.height = (uint32_t) capture->height();
+    header.keyframeInterval = (uint32_t) keyframeInterval;
+    header.temperatureDecimals = temperatureDecimals;
+    if (!write(&header, sizeof(header))) {
+        error = "Could not write " + path;
+        file.close();
+        return false;
+    }
+    isRunning.store(true, std::memory_order_release);
+    thread = std::thread(&CompressedWriter::run, this);
+    return true;
+}
+
+void CompressedWriter::run() {
+    int width = capture->width();
+    int height = capture->height();
+    size_t pixels = (size_t) width * height;
+    FrameEncoder encoder(width, height, keyframeInterval);
+    std::vector<uint16_t> frame(pixels);
+    std::vector<uint8_t> encoded(codec_max_encoded_size(pixels));
+    bool ok = true;
+
+    for (;;) {
+        FrameInfo info;
+        bool draining = stopping.load(std::memory_order_acquire);
+        Capture::WaitResult result = capture->next(cursor, frame.data(), &info, draining ? 0 : CAPTURE_STOP_POLL_NS);
+        if (result == Capture::WAIT_FRAME) {
+            size_t size = encoder.encode(frame.data(), encoded.data());
+            CompressedRecordHeader record;
+            record.size = (uint32_t) size;
+            record.flags = encoded[0] == CODEC_KEYFRAME ? COMPRESSED_KEYFRAME : 0;
+            record.timestamp = info.timestamp;
+            record.sequence = info.sequence;
+            if (record.flags & COMPRESSED_KEYFRAME) {
+                keyframes.push_back(offset);
+            }
+            if (!write(&record, sizeof(record)) || !write(encoded.data(), size)) {
+                ok = false;
+                break;
+            }
+            frameCount.fetch_add(1, std::memory_order_relaxed);
+            bytesIn.fetch_add(pixels * sizeof(uint16_t), std::memory_order_relaxed);
+            droppedCount.store(cursor.dropped, std::memory_order_relaxed);
+        } else if (result == Capture::WAIT_CLOSED || draining) {
+            break;
+        }
+    }
+
+    if (ok) {
+        CompressedTrailer trailer;
+        trailer.indexOffset = offset;
+        trailer.frames = frameCount.load(std::memory_order_relaxed);
+        trailer.keyframes = keyframes.size();
+        std::memcpy(trailer.magic, COMPRESSED_INDEX_MAGIC, sizeof(COMPRESSED_INDEX_MAGIC));
+        ok = write(keyframes.data(), keyframes.size() * sizeof(uint64_t)) && write(&trailer, sizeof(trailer));
+    }
+    file.close();
+    if (!ok || file.fail()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        failure = "Could not write " + path;
+    }
+    isRunning.store(false, std::memory_order_release);
+}
+
+void CompressedWriter::stop() {
+    stopping.store(true, std::memory_order_release);
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+std::string CompressedWriter::error() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failure;
+}
+
+bool CompressedReader::open(const std::string &path, std::string &error) {
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        error = "Could not open " + path;
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    fileSize = (uint64_t) file.tellg();
+    file.seekg(0);
+    if (fileSize < sizeof(header) || !file.read((char *) &header, sizeof(header))
+            || std::memcmp(header.magic, COMPRESSED_MAGIC, sizeof(COMPRESSED_MAGIC)) != 0
+            || header.version != COMPRESSED_VERSION || header.keyframeInterval == 0) {
+        error = "Not a pyoptris compressed recording: " + path;
+        return false;
+    }
+
+    // A closed recording ends in the keyframe index, anything else is walked record by record
+    CompressedTrailer trailer;
+    bool indexed = false;
+    if (fileSize >= sizeof(header) + sizeof(trailer)) {
+        file.seekg((std::streamoff) (fileSize - sizeof(trailer)));
+        indexed = file.read((char *) &trailer, sizeof(trailer))
+            && std::memcmp(trailer.magic, COMPRESSED_INDEX_MAGIC, sizeof(COMPRESSED_INDEX_MAGIC)) == 0
+            && trailer.indexOffset + trailer.keyframes * sizeof(uint64_t) + sizeof(trailer) == fileSize;
+    }
+    if (indexed) {
+        keyframes.resize(trailer.keyframes);
+        file.seekg((std::streamoff) trailer.indexOffset);
+        indexed = file.read((char *) keyframes.data(), (std::streamsize) (keyframes.size() * sizeof(uint64_t))).good();
+        frameCount = trailer.frames;
+    }
+    if (!indexed && !scan()) {
+        error = "Damaged compressed recording: " + path;
+        return false;
+    }
+    if (keyframes.size() != (frameCount + header.keyframeInterval - 1) / header.keyframeInterval) {
+        error = "Damaged compressed recording: " + path;
+        return false;
+    }
+    decoder.reset(new FrameDecoder((int) header.width, (int) header.height));
+    payload.reserve(codec_max_encoded_size((size_t) header.width * header.height));
+    return true;
+}
+
+bool CompressedReader::scan() {
+    keyframes.clear();
+    frameCount = 0;
+    uint64_t offset = sizeof(header);
+    CompressedRecordHeader record;
+    // A recording cut short by a crash ends at the last complete record
+    while (read_record(offset, record, nullptr)) {
+        bool keyframe = (record.flags & COMPRESSED_KEYFRAME) != 0;
+        if (keyframe != (frameCount % header.keyframeInterval == 0)) {
+            return false;
+        }
+        if (keyframe) {
+            keyframes.push_back(offset);
+        }
+        frameCount++;
+        offset += sizeof(record) + record.size;
+    }
+    return true;
+}
+
+bool CompressedReader::read_record(uint64_t offset, CompressedRecordHeader &record, std::vector<uint8_t> *data) {
+    if (offset + sizeof(record) > fileSize) {
+        return false;
+    }
+    file.clear();
+    file.seekg((std::streamoff) offset);
+    if (!file.read((char *) &record, sizeof(record)) || offset + sizeof(record) + record.size > fileSize) {
+        return false;
+    }
+    if (data != nullptr) {
+        data->resize(record.size);
+        return file.read((char *) data->data(), record.size).good();
+    }
+    return true;
+}
+
+void CompressedReader::start_of(uint64_t n, uint64_t &i, uint64_t &offset) const {
+    // Continue from the last decoded frame when it precedes n within the same keyframe run
+    uint64_t run = n / header.keyframeInterval;
+    if (decoded >= 0 && n > (uint64_t) decoded && (uint64_t) decoded / header.keyframeInterval == run) {
+        i = (uint64_t) decoded + 1;
+        offset = nextOffset;
+    } else {
+        i = run * header.keyframeInterval;
+        offset = keyframes[run];
+    }
+}
+
+bool CompressedReader::entry(uint64_t n, CompressedRecordHeader &record) {
+    if (n >= frameCount) {
+        return false;
+    }
+    uint64_t i, offset;
+    start_of(n, i, offset);
+    for (; read_record(offset, record, nullptr); i++) {
+        if (i == n) {
+            return true;
+        }
+        offset += sizeof(record) + record.size;
+    }
+    return false;
+}
+
+bool CompressedReader::read(uint64_t n, uint16_t *frame, CompressedRecordHeader *record) {
+    if (n >= frameCount) {
+        return false;
+    }
+    uint64_t i, offset;
+    start_of(n, i, offset);
+    decoded = -1;
+    CompressedRecordHeader current;
+    for (; i <= n; i++) {
+        if (!read_record(offset, current, &payload) || !decoder->decode(payload.data(), payload.size(), frame)) {
+            return false;
+        }
+        offset += sizeof(current) + current.size;
+    }
+    decoded = (int64_t) n;
+    nextOffset = offset;
+    if (record != nullptr) {
+        *record = current;
+    }
+    return true;
+}
+
+}
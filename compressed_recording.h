@@ -0,0 +1,165 @@
+#ifndef PYOPTRIS_COMPRESSED_RECORDING_H
+#define PYOPTRIS_COMPRESSED_RECORDING_H
+
+#include "capture.h"
+#include "codec.h"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pyoptris {
+
+/*
+ * Compressed recording container, little endian:
+ *
+ *   CompressedFileHeader
+ *   per frame: CompressedRecordHeader followed by size bytes of FrameEncoder output
+ *   uint64 file offset of every keyframe record
+ *   CompressedTrailer
+ *
+ * Every keyframeInterval-th frame is a keyframe, so frame n decodes from keyframe n / keyframeInterval.
+ * The index and trailer are written when the recording is closed, readers of a file that was not closed
+ * rebuild the index by walking the records.
+ */
+
+static const char COMPRESSED_MAGIC[8] = { 'P', 'Y', 'O', 'P', 'T', 'C', 'M', 'P' };
+static const char COMPRESSED_INDEX_MAGIC[8] = { 'P', 'Y', 'O', 'P', 'T', 'I', 'D', 'X' };
+static const uint32_t COMPRESSED_VERSION = 1;
+
+struct CompressedFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t keyframeInterval;
+    int32_t temperatureDecimals;
+    uint32_t reserved;
+};
+
+struct CompressedRecordHeader {
+    uint32_t size;              // bytes of encoded frame following the header
+    uint32_t flags;             // COMPRESSED_KEYFRAME
+    int64_t timestamp;          // acquisition time in ns since the epoch
+    uint64_t sequence;          // capture sequence number
+};
+
+static const uint32_t COMPRESSED_KEYFRAME = 1;
+
+struct CompressedTrailer {
+    uint64_t indexOffset;
+    uint64_t frames;
+    uint64_t keyframes;
+    char magic[8];
+};
+
+static_assert(sizeof(CompressedFileHeader) == 32 && sizeof(CompressedRecordHeader) == 24 && sizeof(CompressedTrailer) == 32,
+              "container structures have a fixed size on disk");
+
+/**
+ * @brief Compresses the frames of a Capture into a container file on a worker thread
+ */
+class CompressedWriter {
+public:
+    CompressedWriter(std::shared_ptr<Capture> capture, const std::string &path, int keyframeInterval, int temperatureDecimals);
+    ~CompressedWriter();
+
+    CompressedWriter(const CompressedWriter &) = delete;
+    CompressedWriter &operator=(const CompressedWriter &) = delete;
+
+    /**
+     * @brief Creates the file and starts the worker thread
+     * @param[out] error description of the failure
+     */
+    bool start(std::string &error);
+
+    /**
+     * @brief Compresses what the capture still holds for this writer, then writes the index and closes the file
+     */
+    void stop();
+
+    bool running() const { return isRunning.load(std::memory_order_acquire); }
+    uint64_t frames() const { return frameCount.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+    uint64_t bytes_in() const { return bytesIn.load(std::memory_order_relaxed); }
+    uint64_t bytes_out() const { return bytesOut.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Why the worker thread stopped early, empty if it did not
+     */
+    std::string error();
+
+private:
+    void run();
+    bool write(const void *data, size_t size);
+
+    std::shared_ptr<Capture> capture;
+    Capture::Cursor cursor;
+    std::string path;
+    int keyframeInterval;
+    int temperatureDecimals;
+    std::ofstream file;
+    uint64_t offset;
+    std::vector<uint64_t> keyframes;
+
+    std::thread thread;
+    std::atomic<bool> isRunning;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> frameCount;
+    std::atomic<uint64_t> droppedCount;
+    std::atomic<uint64_t> bytesIn;
+    std::atomic<uint64_t> bytesOut;
+    std::mutex mutex;   // failure
+    std::string failure;
+};
+
+/**
+ * @brief Random access to a compressed recording. Sequential reads decode one frame each,
+ * a jump decodes forward from the keyframe before the target.
+ */
+class CompressedReader {
+public:
+    bool open(const std::string &path, std::string &error);
+
+    uint64_t frames() const { return frameCount; }
+    int width() const { return (int) header.width; }
+    int height() const { return (int) header.height; }
+    int keyframe_interval() const { return (int) header.keyframeInterval; }
+    int temperature_decimals() const { return header.temperatureDecimals; }
+
+    /**
+     * @brief Decodes frame n into frame, width * height values
+     * @param[out] record header of the frame, may be nullptr
+     * @return false on a damaged file
+     */
+    bool read(uint64_t n, uint16_t *frame, CompressedRecordHeader *record);
+
+    /**
+     * @brief Header of frame n without decoding it
+     */
+    bool entry(uint64_t n, CompressedRecordHeader &record);
+
+private:
+    bool read_record(uint64_t offset, CompressedRecordHeader &record, std::vector<uint8_t> *payload);
+    void start_of(uint64_t n, uint64_t &i, uint64_t &offset) const;
+    bool scan();
+
+    std::ifstream file;
+    uint64_t fileSize = 0;
+    CompressedFileHeader header = {};
+    uint64_t frameCount = 0;
+    std::vector<uint64_t> keyframes;
+    std::unique_ptr<FrameDecoder> decoder;
+    std::vector<uint8_t> payload;
+    int64_t decoded = -1;       // frame the decoder state belongs to
+    uint64_t nextOffset = 0;    // record following the decoded frame
+};
+
+}
+
+#endif
@@ -0,0 +1,216 @@
+#include "convert.h"
+#include "simd.h"
+
+#include <cstring>
+
+namespace pyoptris {
+
+TemperatureScale temperature_scale(int decimals) {
+    float factor = 1.0f;
+    for (int i = 0; i < decimals; i++) {
+        factor *= 10.0f;
+    }
+    // 100 degrees below zero maps to raw 0 at every precision
+    TemperatureScale scale = { 100.0f * factor, 1.0f / factor };
+    return scale;
+}
+
+/**
+ * @brief float to IEEE half, round to nearest even, overflow saturates to infinity
+ */
+static uint16_t float_to_half(float value) {
+    const uint32_t f32Infinity = 255u << 23;
+    const uint32_t f16Overflow = (127u + 16u) << 23;
+    const uint32_t denormMagicBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t half;
+    if (bits >= f16Overflow) {
+        half = bits > f32Infinity ? 0x7e00 : 0x7c00;
+    } else if (bits < (113u << 23)) {
+        // Result is subnormal or zero, let the FPU do the rounding by aligning against a magic number
+        float magnitude, denormMagic;
+        std::memcpy(&magnitude, &bits, sizeof(bits));
+        std::memcpy(&denormMagic, &denormMagicBits, sizeof(denormMagicBits));
+        magnitude += denormMagic;
+        std::memcpy(&bits, &magnitude, sizeof(bits));
+        half = (uint16_t) (bits - denormMagicBits);
+    } else {
+        uint32_t mantissaOdd = (bits >> 13) & 1;
+        bits += ((uint32_t) (15 - 127) << 23) + 0xfff;
+        bits += mantissaOdd;
+        half = (uint16_t) (bits >> 13);
+    }
+    return half | (uint16_t) (sign >> 16);
+}
+
+static void raw_to_celsius_scalar(const uint16_t *raw, float *out, size_t n, TemperatureScale s) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = ((float) raw[i] - s.rawOffset) * s.scale;
+    }
+}
+
+static void raw_to_celsius_f16_scalar(const uint16_t *raw, uint16_t *out, size_t n, TemperatureScale s) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = float_to_half(((float) raw[i] - s.rawOffset) * s.scale);
+    }
+}
+
+#ifdef PYOPTRIS_X86
+
+PYOPTRIS_TARGET("avx2")
+static inline void convert16_avx2(const uint16_t *raw, __m256 offset, __m256 scale, __m256 &lo, __m256 &hi) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) raw);
+    __m256i v0 = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+    __m256i v1 = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+    lo = _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(v0), offset), scale);
+    hi = _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(v1), offset), scale);
+}
+
+PYOPTRIS_TARGET("avx2")
+static void raw_to_celsius_avx2(const uint16_t *raw, float *out, size_t n, TemperatureScale s) {
+    __m256 offset = _mm256_set1_ps(s.rawOffset);
+    __m256 scale = _mm256_set1_ps(s.scale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 lo, hi;
+        convert16_avx2(raw + i, offset, scale, lo, hi);
+        _mm256_storeu_ps(out + i, lo);
+        _mm256_storeu_ps(out + i + 8, hi);
+    }
+    raw_to_celsius_scalar(raw + i, out + i, n - i, s);
+}
+
+PYOPTRIS_TARGET("avx2,f16c")
+static void raw_to_celsius_f16_avx2(const uint16_t *raw, uint16_t *out, size_t n, TemperatureScale s) {
+    __m256 offset = _mm256_set1_ps(s.rawOffset);
+    __m256 scale = _mm256_set1_ps(s.scale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 lo, hi;
+        convert16_avx2(raw + i, offset, scale, lo, hi);
+        _mm_storeu_si128((__m128i *) (out + i), _mm256_cvtps_ph(lo, _MM_FROUND_TO_NEAREST_INT));
+        _mm_storeu_si128((__m128i *) (out + i + 8), _mm256_cvtps_ph(hi, _MM_FROUND_TO_NEAREST_INT));
+    }
+    raw_to_celsius_f16_scalar(raw + i, out + i, n - i, s);
+}
+
+#endif
+
+#ifdef PYOPTRIS_SSE2
+
+static void raw_to_celsius_sse2(const uint16_t *raw, float *out, size_t n, TemperatureScale s) {
+    __m128 offset = _mm_set1_ps(s.rawOffset);
+    __m128 scale = _mm_set1_ps(s.scale);
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (raw + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+        __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_sub_ps(lo, offset), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_sub_ps(hi, offset), scale));
+    }
+    raw_to_celsius_scalar(raw + i, out + i, n - i, s);
+}
+
+#endif
+
+#ifdef PYOPTRIS_NEON
+
+static inline void convert8_neon(const uint16_t *raw, float32x4_t offset, float32x4_t scale, float32x4_t &lo, float32x4_t &hi) {
+    uint16x8_t v = vld1q_u16(raw);
+    lo = vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))), offset), scale);
+    hi = vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))), offset), scale);
+}
+
+static void raw_to_celsius_neon(const uint16_t *raw, float *out, size_t n, TemperatureScale s) {
+    float32x4_t offset = vdupq_n_f32(s.rawOffset);
+    float32x4_t scale = vdupq_n_f32(s.scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t lo, hi;
+        convert8_neon(raw + i, offset, scale, lo, hi);
+        vst1q_f32(out + i, lo);
+        vst1q_f32(out + i + 4, hi);
+    }
+    raw_to_celsius_scalar(raw + i, out + i, n - i, s);
+}
+
+#ifdef __aarch64__
+static void raw_to_celsius_f16_neon(const uint16_t *raw, uint16_t *out, size_t n, TemperatureScale s) {
+    float32x4_t offset = vdupq_n_f32(s.rawOffset);
+    float32x4_t scale = vdupq_n_f32(s.scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t lo, hi;
+        convert8_neon(raw + i, offset, scale, lo, hi);
+        vst1q_u16(out + i, vreinterpretq_u16_f16(vcombine_f16(vcvt_f16_f32(lo), vcvt_f16_f32(hi))));
+    }
+    raw_to_celsius_f16_scalar(raw + i, out + i, n - i, s);
+}
+#endif
+
+#endif
+
+typedef void (*ConvertF32)(const uint16_t *, float *, size_t, TemperatureScale);
+typedef void (*ConvertF16)(const uint16_t *, uint16_t *, size_t, TemperatureScale);
+
+static ConvertF32 select_f32() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        return raw_to_celsius_avx2;
+    }
+#endif
+#if defined(PYOPTRIS_SSE2)
+    return raw_to_celsius_sse2;
+#elif defined(PYOPTRIS_NEON)
+    return raw_to_celsius_neon;
+#else
+    return raw_to_celsius_scalar;
+#endif
+}
+
+static ConvertF16 select_f16() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2() && cpu_has_f16c()) {
+        return raw_to_celsius_f16_avx2;
+    }
+#endif
+#if defined(PYOPTRIS_NEON) && defined(__aarch64__)
+    return raw_to_celsius_f16_neon;
+#else
+    return raw_to_celsius_f16_scalar;
+#endif
+}
+
+void raw_to_celsius(const uint16_t *raw, float *out, size_t n, TemperatureScale scale) {
+    static const ConvertF32 kernel = select_f32();
+    kernel(raw, out, n, scale);
+}
+
+void raw_to_celsius_f16(const uint16_t *raw, uint16_t *out, size_t n, TemperatureScale scale) {
+    static const ConvertF16 kernel = select_f16();
+    kernel(raw, out, n, scale);
+}
+
+const char *convert_isa() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        return "avx2";
+    }
+#endif
+#if defined(PYOPTRIS_SSE2)
+    return "sse2";
+#elif defined(PYOPTRIS_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+}
@@ -0,0 +1,44 @@
+#ifndef PYOPTRIS_CONVERT_H
+#define PYOPTRIS_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pyoptris {
+
+/**
+ * @brief Linear mapping of raw thermal values to degrees Celsius, t = (raw - rawOffset) * scale
+ * With the default single decimal this is the SDK formula t = (raw - 1000) / 10.
+ */
+struct TemperatureScale {
+    float rawOffset;
+    float scale;
+};
+
+/**
+ * @brief Scale for a camera reporting temperatures with the given number of decimal places
+ * decimals is 1 unless enable_high_precision is set in the xml config, then it is the value of
+ * IRImager::getTemprangeDecimal() for the selected temperature range.
+ */
+TemperatureScale temperature_scale(int decimals);
+
+/**
+ * @brief Converts n raw values to float32 degrees Celsius
+ * Dispatches to AVX2, SSE2 or NEON when available, out may not alias raw.
+ */
+void raw_to_celsius(const uint16_t *raw, float *out, size_t n, TemperatureScale scale);
+
+/**
+ * @brief Converts n raw values to IEEE half precision degrees Celsius, stored as their bit patterns
+ * Uses F16C or NEON half conversion when available, rounding is to nearest even in every path.
+ */
+void raw_to_celsius_f16(const uint16_t *raw, uint16_t *out, size_t n, TemperatureScale scale);
+
+/**
+ * @brief Name of the instruction set picked for the conversion kernels, e.g. "avx2"
+ */
+const char *convert_isa();
+
+}
+
+#endif
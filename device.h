@@ -0,0 +1,54 @@
+#ifndef PYOPTRIS_DEVICE_H
+#define PYOPTRIS_DEVICE_H
+
+#include "capture.h"
+
+#include <memory>
+#include <string>
+
+namespace pyoptris {
+
+/**
+ * @brief One camera with its own SDK instance, as opposed to the direct_binding singleton.
+ * Every device serializes access to its own SDK objects only, devices never share a lock.
+ * Return codes follow the SDK: 0 on success, -1 on error, -2 on fatal error.
+ */
+class Device : public FrameSource {
+public:
+    virtual ~Device() {}
+
+    virtual std::string serial() = 0;
+
+    virtual int set_temperature_range(int minimum, int maximum) = 0;
+
+    virtual int set_radiation_parameters(float emissivity, float transmissivity, float ambientTemperature) = 0;
+
+    /**
+     * @param mode 0 means manual control, 1 means automode
+     */
+    virtual int set_shutter_mode(int mode) = 0;
+
+    virtual int trigger_shutter_flag() = 0;
+
+    virtual int set_focus_motor_position(float position) = 0;
+
+    virtual int get_focus_motor_position(float &position) = 0;
+
+    /**
+     * @brief Stops streaming and releases the camera, must not be called while fetch_thermal runs
+     */
+    virtual void close() = 0;
+};
+
+/**
+ * @brief Opens the camera described by an xml config, implemented by the backend selected in setup.py
+ * @param serial serial number overriding <serial> of the config, 0 keeps the config value
+ * @param[out] error description of the failure
+ * @return device, nullptr on failure
+ */
+std::shared_ptr<Device> open_device(const char *xmlConfig, const char *formatsDef, const char *logFile,
+                                    unsigned long serial, std::string &error);
+
+}
+
+#endif
@@ -0,0 +1,11 @@
+#include "device.h"
+
+namespace pyoptris {
+
+// Backend for SDK distributions that only ship direct_binding.h, e.g. the Windows irDirectSDK
+std::shared_ptr<Device> open_device(const char *, const char *, const char *, unsigned long, std::string &error) {
+    error = "Camera objects need the libirimager C++ SDK, this build only has the direct binding";
+    return nullptr;
+}
+
+}
@@ -0,0 +1,174 @@
+#include "exporter.h"
+#include "image.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace pyoptris {
+
+template <class Predicate>
+static bool wait_for(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, int64_t timeoutNs, Predicate predicate) {
+    if (timeoutNs < 0) {
+        condition.wait(lock, predicate);
+        return true;
+    }
+    return condition.wait_for(lock, std::chrono::nanoseconds(timeoutNs), predicate);
+}
+
+ExportJob::ExportJob(size_t files) : fileCount(files), pendingCount(files) {
+}
+
+bool ExportJob::wait(int64_t timeoutNs) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return wait_for(finished, lock, timeoutNs, [this] { return pendingCount == 0; });
+}
+
+size_t ExportJob::remaining() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pendingCount;
+}
+
+std::vector<std::string> ExportJob::errors() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failures;
+}
+
+void ExportJob::finish(std::string *error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error != nullptr) {
+        failures.push_back(std::move(*error));
+    }
+    if (--pendingCount == 0) {
+        finished.notify_all();
+    }
+}
+
+Exporter::Exporter(int threads, size_t capacity)
+    : pool(FramePool::create(capacity)), maxPending(capacity), taken(0), active(0), stopping(false), counters() {
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(&Exporter::run, this);
+    }
+}
+
+Exporter::~Exporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queued.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+bool Exporter::reserve(size_t count, int64_t timeoutNs) {
+    if (count > maxPending) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!wait_for(room, lock, timeoutNs, [&] { return taken + count <= maxPending; })) {
+        return false;
+    }
+    taken += count;
+    return true;
+}
+
+void Exporter::release(size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        taken -= count;
+    }
+    room.notify_all();
+}
+
+bool Exporter::submit(const std::shared_ptr<ExportJob> &job, const uint16_t *frame, int width, int height, const std::string &path,
+                      const ExportOptions &options) {
+    size_t size = (size_t) width * height * sizeof(uint16_t);
+    FramePool::Buffer *buffer = pool->acquire(size);
+    if (buffer == nullptr) {
+        release(1);
+        return false;
+    }
+    std::memcpy(buffer->data, frame, size);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back({ job, buffer, width, height, path, options });
+        active++;
+        counters.submitted++;
+    }
+    queued.notify_one();
+    return true;
+}
+
+bool Exporter::drain(int64_t timeoutNs) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return wait_for(room, lock, timeoutNs, [this] { return active == 0; });
+}
+
+Exporter::Stats Exporter::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats = counters;
+    stats.pending = active;
+    return stats;
+}
+
+void Exporter::run() {
+    ImageEncoder encoder;
+    std::vector<uint8_t> rgb;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        queued.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) {
+            return;     // stopping, and everything queued was written
+        }
+        Task task = std::move(tasks.front());
+        tasks.pop_front();
+        lock.unlock();
+
+        const uint16_t *frame = (const uint16_t *) task.frame->data;
+        size_t n = (size_t) task.width * task.height;
+        bool encoded;
+        switch (task.options.format) {
+        case EXPORT_PALETTE_PNG: {
+            FrameStatistics stats = {};
+            if (task.options.scaling != SCALING_MANUAL) {
+                stats = frame_statistics(frame, n);
+            }
+            PaletteRange range = palette_range(task.options.scaling, stats, task.options.manual);
+            rgb.resize(3 * n);
+            render_palette(frame, rgb.data(), n, palette_lut(task.options.palette), range);
+            encoded = encoder.png_rgb(rgb.data(), task.width, task.height, task.options.compression);
+            break;
+        }
+        case EXPORT_RAW_PNG:
+            encoded = encoder.png_gray16(frame, task.width, task.height, task.options.compression);
+            break;
+        default:
+            encoded = encoder.tiff_gray16(frame, task.width, task.height, task.options.compression);
+            break;
+        }
+        FramePool::release(task.frame);
+
+        std::string error;
+        bool written = false;
+        if (!encoded) {
+            error = task.path + ": encoding failed";
+        } else {
+            written = write_file(task.path, encoder.data().data(), encoder.data().size(), error);
+        }
+        lock.lock();
+        if (written) {
+            counters.written++;
+            counters.bytes += encoder.data().size();
+        } else {
+            counters.failed++;
+        }
+        active--;
+        taken--;
+        // Finished under the lock so that stats() agrees with every job reported done
+        task.job->finish(written ? nullptr : &error);
+        room.notify_all();
+    }
+}
+
+}
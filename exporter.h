@@ -0,0 +1,153 @@
+#ifndef PYOPTRIS_EXPORTER_H
+#define PYOPTRIS_EXPORTER_H
+
+#include "framepool.h"
+#include "palette.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pyoptris {
+
+enum ExportFormat {
+    EXPORT_PALETTE_PNG = 0,     // 8 bit RGB coloured with a palette
+    EXPORT_RAW_PNG = 1,         // 16 bit greyscale of the raw values, lossless
+    EXPORT_RAW_TIFF = 2         // 16 bit greyscale of the raw values, lossless
+};
+
+struct ExportOptions {
+    ExportFormat format;
+    int palette;                // EXPORT_PALETTE_PNG only
+    PaletteScaling scaling;     // EXPORT_PALETTE_PNG only
+    PaletteRange manual;        // range of SCALING_MANUAL
+    int compression;            // zlib level 0..9
+};
+
+/**
+ * @brief Completion of the files of one submission, shared between the exporter and its caller
+ */
+class ExportJob {
+public:
+    explicit ExportJob(size_t files);
+
+    /**
+     * @brief Blocks until every file was written or failed
+     * @param timeoutNs negative waits forever
+     * @return true once the job is done
+     */
+    bool wait(int64_t timeoutNs);
+
+    size_t files() const { return fileCount; }
+    size_t remaining();
+
+    /**
+     * @brief "path: reason" of every file that failed so far
+     */
+    std::vector<std::string> errors();
+
+private:
+    friend class Exporter;
+
+    void finish(std::string *error);
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t fileCount;
+    size_t pendingCount;
+    std::vector<std::string> failures;
+};
+
+/**
+ * @brief Encodes and writes frames on a fixed set of native threads.
+ * Frames are copied into pooled buffers when they are submitted, so the caller can reuse its frame
+ * right away. At most capacity frames are queued or being written at a time; reserve() waits for
+ * room, so bursts slow the producer down instead of growing the queue without bound. Each thread
+ * keeps its own encoder and palette buffer, nothing is allocated per frame once they warmed up.
+ */
+class Exporter {
+public:
+    struct Stats {
+        uint64_t submitted;
+        uint64_t written;
+        uint64_t failed;
+        uint64_t bytes;         // encoded bytes written
+        size_t pending;         // frames queued or being written
+    };
+
+    Exporter(int threads, size_t capacity);
+
+    /**
+     * @brief Writes everything queued, then joins the threads
+     */
+    ~Exporter();
+
+    Exporter(const Exporter &) = delete;
+    Exporter &operator=(const Exporter &) = delete;
+
+    /**
+     * @brief Waits until count more frames fit and reserves room for them
+     * @param timeoutNs negative waits forever
+     * @return false on timeout or if count exceeds the capacity
+     */
+    bool reserve(size_t count, int64_t timeoutNs);
+
+    /**
+     * @brief Returns room reserved with reserve() that will not be submitted
+     */
+    void release(size_t count);
+
+    /**
+     * @brief Copies a frame and queues it on room taken with reserve()
+     * @return false if no buffer could be allocated, the room is released then
+     */
+    bool submit(const std::shared_ptr<ExportJob> &job, const uint16_t *frame, int width, int height, const std::string &path,
+                const ExportOptions &options);
+
+    /**
+     * @brief Blocks until every frame submitted so far was written
+     * @param timeoutNs negative waits forever
+     * @return false on timeout
+     */
+    bool drain(int64_t timeoutNs);
+
+    Stats stats();
+    int threads() const { return (int) workers.size(); }
+    size_t capacity() const { return maxPending; }
+
+private:
+    struct Task {
+        std::shared_ptr<ExportJob> job;
+        FramePool::Buffer *frame;
+        int width;
+        int height;
+        std::string path;
+        ExportOptions options;
+    };
+
+    void run();
+
+    std::shared_ptr<FramePool> pool;
+    size_t maxPending;
+
+    std::mutex mutex;
+    std::condition_variable queued;     // a task was queued or the exporter stops
+    std::condition_variable room;       // a task finished, reserve() and drain() recheck
+    std::deque<Task> tasks;
+    size_t taken;                       // reserved, queued and being written
+    size_t active;                      // queued and being written
+    bool stopping;
+    Stats counters;
+
+    std::vector<std::thread> workers;
+};
+
+}
+
+#endif
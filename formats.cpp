@@ -0,0 +1,294 @@
+#include "formats.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace pyoptris {
+
+// Appends copy, folding it into a single run or into the last copy of the same kind where it continues that.
+// Copies write disjoint words, so their order does not matter.
+static void add_copy(std::vector<LayoutCopy> &copies, LayoutCopy copy) {
+    if (copy.count > 1 && copy.length == copy.sourceStride && copy.length == copy.targetStride) {
+        copy.length *= copy.count;
+        copy.count = 1;
+    }
+    auto previous = copies.rbegin();
+    while (previous != copies.rend() && previous->metadata != copy.metadata) {
+        ++previous;
+    }
+    if (previous != copies.rend()) {
+        LayoutCopy &last = *previous;
+        if (last.count == 1 && copy.count == 1 && last.source + last.length == copy.source && last.target + last.length == copy.target) {
+            last.length += copy.length;
+            return;
+        }
+        // Rows continuing the strided copy before, e.g. the groups and subframes of the 1 kHz formats
+        if (last.length == copy.length && last.sourceStride == copy.sourceStride && last.targetStride == copy.targetStride
+                && last.source + last.count * last.sourceStride == copy.source && last.target + last.count * last.targetStride == copy.target) {
+            last.count += copy.count;
+            return;
+        }
+    }
+    copies.push_back(copy);
+}
+
+static void trim(std::string &text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    size_t end = text.find_last_not_of(" \t\r\n");
+    text = begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+}
+
+static bool parse_number(const char *&p, uint64_t &value) {
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    if (!std::isdigit((unsigned char) *p)) {
+        return false;
+    }
+    char *end;
+    value = std::strtoull(p, &end, 10);
+    p = end;
+    return true;
+}
+
+// "(a..b)"
+static bool parse_range(const std::string &text, int range[2]) {
+    return std::sscanf(text.c_str(), " ( %d .. %d )", &range[0], &range[1]) == 2;
+}
+
+/**
+ * @brief Compiles the Def line of subframe into channel.copies.
+ * A line is a list of groups "(offset rows item...)": starting at word offset of the packet, rows rows of
+ * the items are read, "d:n" n thermal words, "m:n" n metadata words and "s:n" n words of padding.
+ */
+static bool compile_def(const std::string &text, size_t packetWords, int subframe, FormatChannel &channel, std::string &error) {
+    uint64_t frameWords = (uint64_t) channel.width * channel.height;
+    uint64_t dataBase = (uint64_t) subframe * frameWords;
+    uint64_t metadataBase = (uint64_t) subframe * channel.metadataWords;
+    uint64_t data = 0, metadata = 0;
+    const char *p = text.c_str();
+    for (;;) {
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        uint64_t offset, rows;
+        if (*p++ != '(' || !parse_number(p, offset) || !parse_number(p, rows)) {
+            error = "malformed Def group";
+            return false;
+        }
+        struct Item {
+            char kind;
+            uint64_t words;
+        };
+        std::vector<Item> items;
+        uint64_t rowWords = 0, rowData = 0, rowMetadata = 0;
+        for (;;) {
+            while (*p == ' ' || *p == '\t') {
+                p++;
+            }
+            if (*p == ')') {
+                p++;
+                break;
+            }
+            char kind = *p;
+            uint64_t words;
+            if ((kind != 'd' && kind != 's' && kind != 'm') || p[1] != ':') {
+                error = "malformed Def item";
+                return false;
+            }
+            p += 2;
+            if (!parse_number(p, words)) {
+                error = "malformed Def item";
+                return false;
+            }
+            items.push_back({ kind, words });
+            rowWords += words;
+            rowData += kind == 'd' ? words : 0;
+            rowMetadata += kind == 'm' ? words : 0;
+        }
+        if (rows == 0 || rowWords == 0) {
+            continue;
+        }
+        uint64_t source = offset, dataOffset = 0, metadataOffset = 0;
+        for (const Item &item : items) {
+            if (item.kind != 's' && item.words > 0) {
+                if (source + (rows - 1) * rowWords + item.words > packetWords) {
+                    error = "Def reads past the end of the In frame";
+                    return false;
+                }
+                bool isMetadata = item.kind == 'm';
+                uint64_t target = isMetadata ? metadataBase + metadata + metadataOffset : dataBase + data + dataOffset;
+                add_copy(channel.copies, { (uint32_t) source, (uint32_t) rowWords, (uint32_t) target,
+                                           (uint32_t) (isMetadata ? rowMetadata : rowData), (uint32_t) item.words, (uint32_t) rows, isMetadata });
+                (isMetadata ? metadataOffset : dataOffset) += item.words;
+            }
+            source += item.words;
+        }
+        data += rows * rowData;
+        metadata += rows * rowMetadata;
+    }
+    if (data != frameWords) {
+        error = "Def holds " + std::to_string(data) + " thermal words, Out needs " + std::to_string(frameWords);
+        return false;
+    }
+    if (subframe == 0) {
+        channel.metadataWords = (size_t) metadata;
+    } else if (metadata != channel.metadataWords) {
+        error = "subframes differ in their metadata words";
+        return false;
+    }
+    return true;
+}
+
+static bool finish_channel(const FormatChannel &channel, int defs, std::string &error) {
+    if (defs != channel.subframes) {
+        error = "SFrames = " + std::to_string(channel.subframes) + " but " + std::to_string(defs) + " Def lines";
+        return false;
+    }
+    return true;
+}
+
+bool load_formats(const std::string &path, std::vector<RawFormat> &formats, std::string &error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Could not open " + path;
+        return false;
+    }
+    formats.clear();
+    RawFormat format;
+    bool inFormat = false;
+    bool hasIn = false;
+    int defs = 0;
+    int lineNumber = 0;
+    std::string line;
+    auto fail = [&](const std::string &reason) {
+        error = path + ":" + std::to_string(lineNumber) + ": " + reason;
+        return false;
+    };
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        trim(line);
+        if (line.empty()) {
+            continue;
+        }
+        if (line == "[Format]") {
+            format = RawFormat();
+            format.hwRev[0] = format.fwRev[0] = 0;
+            format.hwRev[1] = format.fwRev[1] = -1;
+            inFormat = true;
+            hasIn = false;
+            defs = 0;
+            continue;
+        }
+        if (line == "[Format end]") {
+            if (!inFormat) {
+                return fail("[Format end] without [Format]");
+            }
+            if (format.channels.empty()) {
+                return fail("format without Out");
+            }
+            std::string reason;
+            if (!finish_channel(format.channels.back(), defs, reason)) {
+                return fail(reason);
+            }
+            formats.push_back(std::move(format));
+            inFormat = false;
+            continue;
+        }
+        size_t equals = line.find('=');
+        if (!inFormat || equals == std::string::npos) {
+            continue;   // file header
+        }
+        std::string key = line.substr(0, equals), value = line.substr(equals + 1);
+        trim(key);
+        trim(value);
+        if (key == "Guid") {
+            format.guid = value;
+        } else if (key == "Name") {
+            format.name = value.size() >= 2 && value.front() == '"' && value.back() == '"' ? value.substr(1, value.size() - 2) : value;
+        } else if (key == "HWRev" || key == "FWRev") {
+            if (!parse_range(value, key == "HWRev" ? format.hwRev : format.fwRev)) {
+                return fail("malformed " + key);
+            }
+        } else if (key == "In") {
+            if (std::sscanf(value.c_str(), "%d %d %d", &format.width, &format.height, &format.rate) != 3 || format.width <= 0
+                    || format.height <= 0) {
+                return fail("malformed In");
+            }
+            hasIn = true;
+        } else if (key == "Out") {
+            std::string reason;
+            if (!format.channels.empty() && !finish_channel(format.channels.back(), defs, reason)) {
+                return fail(reason);
+            }
+            FormatChannel channel = { 0, 0, 0, 0, 0, {} };
+            if (std::sscanf(value.c_str(), "%d %d %d", &channel.width, &channel.height, &channel.rate) != 3 || channel.width <= 0
+                    || channel.height <= 0) {
+                return fail("malformed Out");
+            }
+            format.channels.push_back(std::move(channel));
+            defs = 0;
+        } else if (key == "SFrames") {
+            if (format.channels.empty() || (format.channels.back().subframes = std::atoi(value.c_str())) <= 0) {
+                return fail("SFrames needs an Out before it and must be positive");
+            }
+        } else if (key == "Def") {
+            if (!hasIn || format.channels.empty() || format.channels.back().subframes == 0) {
+                return fail("Def needs In, Out and SFrames before it");
+            }
+            FormatChannel &channel = format.channels.back();
+            if (defs >= channel.subframes) {
+                return fail("more Def lines than SFrames");
+            }
+            std::string reason;
+            if (!compile_def(value, format.packet_words(), defs, channel, reason)) {
+                return fail(reason);
+            }
+            defs++;
+        }
+        // Channels and DeviceRes follow from the Out blocks and the camera, they need no handling
+    }
+    if (inFormat) {
+        return fail("[Format] without [Format end]");
+    }
+    return true;
+}
+
+void unpack_packets(const FormatChannel &channel, size_t packetWords, const uint16_t *packets, size_t count, uint16_t *frames,
+                    uint16_t *metadata) {
+    size_t frameWords = (size_t) channel.subframes * channel.width * channel.height;
+    size_t metadataWords = (size_t) channel.subframes * channel.metadataWords;
+    for (size_t n = 0; n < count; n++) {
+        const uint16_t *packet = packets + n * packetWords;
+        for (const LayoutCopy &copy : channel.copies) {
+            const uint16_t *source = packet + copy.source;
+            uint16_t *target = (copy.metadata ? metadata : frames) + copy.target;
+            if (copy.length == 1) {
+                // Single metadata words trailing the rows
+                for (uint32_t i = 0; i < copy.count; i++) {
+                    target[(size_t) i * copy.targetStride] = source[(size_t) i * copy.sourceStride];
+                }
+            } else {
+                // memcpy picks the widest vector moves of the CPU at run time
+                size_t bytes = (size_t) copy.length * sizeof(uint16_t);
+                for (uint32_t i = 0; i < copy.count; i++) {
+                    std::memcpy(target + (size_t) i * copy.targetStride, source + (size_t) i * copy.sourceStride, bytes);
+                }
+            }
+        }
+        frames += frameWords;
+        metadata += metadataWords;
+    }
+}
+
+}
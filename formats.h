@@ -0,0 +1,69 @@
+#ifndef PYOPTRIS_FORMATS_H
+#define PYOPTRIS_FORMATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pyoptris {
+
+/**
+ * @brief count runs of length words, the source and target advancing by their strides after each run
+ */
+struct LayoutCopy {
+    uint32_t source;            // word offset into the packet
+    uint32_t sourceStride;
+    uint32_t target;            // word offset into the frames or metadata of one packet
+    uint32_t targetStride;
+    uint32_t length;
+    uint32_t count;
+    bool metadata;              // target is the metadata instead of the frames
+};
+
+/**
+ * @brief One "Out" block of a format: the subframes of one image stream and how to cut them out of a packet
+ */
+struct FormatChannel {
+    int width;
+    int height;
+    int rate;                   // subframes per second
+    int subframes;              // per packet
+    size_t metadataWords;       // per subframe
+    std::vector<LayoutCopy> copies;     // every subframe of a packet, compiled from its Def line
+};
+
+/**
+ * @brief A [Format] section of Formats.def. Packets are the raw USB frames of width * height words.
+ */
+struct RawFormat {
+    std::string guid;
+    std::string name;
+    int hwRev[2];               // inclusive ranges
+    int fwRev[2];
+    int width;
+    int height;
+    int rate;                   // packets per second
+    std::vector<FormatChannel> channels;
+
+    size_t packet_words() const { return (size_t) width * height; }
+};
+
+/**
+ * @brief Parses Formats.def and compiles every Def line into copies. Runs that are contiguous in the
+ * packet and in the output are merged, so e.g. a format without padding unpacks with one copy per subframe.
+ * @param[out] error description of the failure, with the line number
+ */
+bool load_formats(const std::string &path, std::vector<RawFormat> &formats, std::string &error);
+
+/**
+ * @brief Cuts count packets into their subframes and metadata
+ * @param frames count * subframes * height * width words
+ * @param metadata count * subframes * metadataWords words
+ */
+void unpack_packets(const FormatChannel &channel, size_t packetWords, const uint16_t *packets, size_t count, uint16_t *frames,
+                    uint16_t *metadata);
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "framepool.h"
+
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace pyoptris {
+
+static const size_t ALIGNMENT = 64;
+
+// The Buffer header lives in front of the pixel data in the same block, padded to keep the data aligned
+static const size_t HEADER_SIZE = (sizeof(FramePool::Buffer) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+void *aligned_allocate(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, ALIGNMENT);
+#else
+    void *p = nullptr;
+    if (posix_memalign(&p, ALIGNMENT, size) != 0) {
+        return nullptr;
+    }
+    return p;
+#endif
+}
+
+void aligned_free(void *p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+static void destroy_buffer(FramePool::Buffer *buffer) {
+    buffer->~Buffer();
+    aligned_free(buffer);
+}
+
+std::shared_ptr<FramePool> FramePool::create(size_t maxCachedPerSize, size_t maxCachedBytes) {
+    return std::shared_ptr<FramePool>(new FramePool(maxCachedPerSize, maxCachedBytes));
+}
+
+FramePool::FramePool(size_t maxCachedPerSize, size_t maxCachedBytes)
+    : maxCachedPerSize(maxCachedPerSize), maxCachedBytes(maxCachedBytes), useClock(0), counters() {
+}
+
+FramePool::~FramePool() {
+    trim();
+}
+
+FramePool::Buffer *FramePool::acquire(size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = freeLists.find(size);
+        if (it != freeLists.end()) {
+            Buffer *buffer = it->second.buffers.back();
+            it->second.buffers.pop_back();
+            if (it->second.buffers.empty()) {
+                freeLists.erase(it);
+            } else {
+                it->second.lastUse = ++useClock;
+            }
+            counters.reuses++;
+            counters.outstanding++;
+            counters.cachedBytes -= size;
+            buffer->pool = shared_from_this();
+            return buffer;
+        }
+    }
+
+    void *block = aligned_allocate(HEADER_SIZE + size);
+    if (block == nullptr) {
+        return nullptr;
+    }
+    Buffer *buffer = new (block) Buffer { shared_from_this(), size, static_cast<char *>(block) + HEADER_SIZE };
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.allocations++;
+    counters.outstanding++;
+    return buffer;
+}
+
+void FramePool::release(Buffer *buffer) {
+    // Idle buffers must not own the pool, otherwise the pool could never be destroyed
+    std::shared_ptr<FramePool> pool = std::move(buffer->pool);
+    pool->recycle(buffer);
+}
+
+void FramePool::recycle(Buffer *buffer) {
+    std::vector<Buffer *> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.outstanding--;
+        if (buffer->size > maxCachedBytes || maxCachedPerSize == 0) {
+            evicted.push_back(buffer);
+        } else {
+            FreeList &list = freeLists[buffer->size];
+            list.lastUse = ++useClock;
+            if (list.buffers.size() < maxCachedPerSize) {
+                list.buffers.push_back(buffer);
+                counters.cachedBytes += buffer->size;
+            } else {
+                evicted.push_back(buffer);
+            }
+        }
+        // Over the byte cap, the size used longest ago goes first. Only runs while many sizes are in use.
+        while (counters.cachedBytes > maxCachedBytes) {
+            auto oldest = freeLists.begin();
+            for (auto it = freeLists.begin(); it != freeLists.end(); ++it) {
+                if (it->second.lastUse < oldest->second.lastUse) {
+                    oldest = it;
+                }
+            }
+            evicted.push_back(oldest->second.buffers.back());
+            oldest->second.buffers.pop_back();
+            counters.cachedBytes -= oldest->first;
+            if (oldest->second.buffers.empty()) {
+                freeLists.erase(oldest);
+            }
+        }
+    }
+    for (Buffer *idle : evicted) {
+        destroy_buffer(idle);
+    }
+}
+
+void FramePool::trim() {
+    std::unordered_map<size_t, FreeList> idle;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.swap(freeLists);
+        counters.cachedBytes = 0;
+    }
+    for (auto &entry : idle) {
+        for (Buffer *buffer : entry.second.buffers) {
+            destroy_buffer(buffer);
+        }
+    }
+}
+
+FramePool::Stats FramePool::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+}
@@ -0,0 +1,93 @@
+#ifndef PYOPTRIS_FRAMEPOOL_H
+#define PYOPTRIS_FRAMEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace pyoptris {
+
+/**
+ * @brief Allocates size bytes aligned to a 64 byte boundary (cache line / AVX-512 width)
+ * @return pointer to the block, nullptr on failure
+ */
+void *aligned_allocate(size_t size);
+
+/**
+ * @brief Releases a block obtained from aligned_allocate
+ */
+void aligned_free(void *p);
+
+/**
+ * @brief Recycles frame buffers keyed by their byte size.
+ * Acquisition at a fixed image format only ever asks for one or two distinct sizes, so after
+ * the first few frames every acquire() is served from the free list and the heap is untouched.
+ * Crops, binning and batches of varying length ask for many sizes, idle bytes are therefore capped
+ * and the sizes used longest ago are returned to the heap first.
+ * Buffers keep the pool alive, so a pool may be dropped while arrays still reference its memory.
+ */
+class FramePool : public std::enable_shared_from_this<FramePool> {
+public:
+    struct Buffer {
+        std::shared_ptr<FramePool> pool;
+        size_t size;
+        void *data;
+    };
+
+    struct Stats {
+        uint64_t allocations;       // buffers obtained from the heap
+        uint64_t reuses;            // buffers served from a free list
+        uint64_t outstanding;       // buffers currently handed out
+        uint64_t cachedBytes;       // bytes parked in free lists
+    };
+
+    /**
+     * @brief Creates a pool
+     * @param maxCachedPerSize number of idle buffers kept per size, surplus is returned to the heap
+     * @param maxCachedBytes idle bytes kept over all sizes
+     */
+    static std::shared_ptr<FramePool> create(size_t maxCachedPerSize = 8, size_t maxCachedBytes = 64 << 20);
+
+    ~FramePool();
+
+    /**
+     * @brief Hands out a buffer of at least size bytes, 64 byte aligned
+     * @return buffer, nullptr if the allocation failed
+     */
+    Buffer *acquire(size_t size);
+
+    /**
+     * @brief Returns a buffer to the pool it was acquired from
+     */
+    static void release(Buffer *buffer);
+
+    /**
+     * @brief Frees every idle buffer
+     */
+    void trim();
+
+    Stats stats();
+
+private:
+    struct FreeList {
+        std::vector<Buffer *> buffers;
+        uint64_t lastUse;           // useClock of the last acquire or release of this size
+    };
+
+    FramePool(size_t maxCachedPerSize, size_t maxCachedBytes);
+    void recycle(Buffer *buffer);
+
+    std::mutex mutex;
+    std::unordered_map<size_t, FreeList> freeLists;     // sizes with idle buffers only
+    size_t maxCachedPerSize;
+    size_t maxCachedBytes;
+    uint64_t useClock;
+    Stats counters;
+};
+
+}
+
+#endif
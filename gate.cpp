@@ -0,0 +1,41 @@
+#include "gate.h"
+
+#include <cstring>
+
+namespace pyoptris {
+
+FlagGate::FlagGate() : currentPolicy(FLAG_POLICY_TAG), settle(100000000), frozen(true), inFlag(false), settleUntil(0) {
+}
+
+void FlagGate::configure(FlagPolicy policy, int64_t settleNs, bool detectFrozen) {
+    currentPolicy.store(policy, std::memory_order_relaxed);
+    settle.store(settleNs, std::memory_order_relaxed);
+    frozen.store(detectFrozen, std::memory_order_relaxed);
+}
+
+void FlagGate::classify(const uint16_t *frame, const uint16_t *previous, size_t size, FrameInfo &info, int64_t now) {
+    bool flagged;
+    int validity;
+    if (info.flag != FLAG_UNKNOWN) {
+        flagged = info.flag != FLAG_OPEN;
+        validity = FRAME_FLAG;
+    } else {
+        // Sensor noise makes two live frames differ in practically every pixel, memcmp bails out at the first one
+        flagged = frozen.load(std::memory_order_relaxed) && previous != nullptr
+            && std::memcmp(frame, previous, size * sizeof(uint16_t)) == 0;
+        validity = FRAME_FROZEN;
+    }
+
+    if (flagged) {
+        inFlag = true;
+        info.validity = validity;
+        return;
+    }
+    if (inFlag) {
+        inFlag = false;
+        settleUntil = now + settle.load(std::memory_order_relaxed);
+    }
+    info.validity = now < settleUntil ? FRAME_SETTLING : FRAME_VALID;
+}
+
+}
@@ -0,0 +1,61 @@
+#ifndef PYOPTRIS_GATE_H
+#define PYOPTRIS_GATE_H
+
+#include "ring.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace pyoptris {
+
+/**
+ * @brief What a capture does with frames taken while the shutter flag is in the way or settling
+ */
+enum FlagPolicy {
+    FLAG_POLICY_TAG = 0,    // publish them with FrameInfo::validity set
+    FLAG_POLICY_DROP = 1,   // leave them out of the ring
+    FLAG_POLICY_HOLD = 2    // publish the last valid frame in their place, FrameInfo::held set
+};
+
+/**
+ * @brief Classifies frames against shutter flag cycles. A frame is invalid while the flag is not open,
+ * and for settleNs after it opened again while the detector recovers. Sources that do not report the
+ * flag state fall back to frozen frame detection: the SDK repeats the last image during a flag cycle,
+ * so a frame identical to its predecessor is taken as a flag period.
+ * The settings are atomics, they may be changed while the capture thread classifies frames.
+ */
+class FlagGate {
+public:
+    FlagGate();
+
+    /**
+     * @param settleNs time after the flag opened during which frames are still invalid
+     * @param detectFrozen compare frames of sources without flag state with their predecessor
+     */
+    void configure(FlagPolicy policy, int64_t settleNs, bool detectFrozen);
+
+    FlagPolicy policy() const { return (FlagPolicy) currentPolicy.load(std::memory_order_relaxed); }
+    int64_t settle_ns() const { return settle.load(std::memory_order_relaxed); }
+    bool detect_frozen() const { return frozen.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Sets info.validity of a fetched frame, called by the capture thread only
+     * @param previous frame fetched before this one, nullptr if there is none
+     * @param now steady clock in ns
+     */
+    void classify(const uint16_t *frame, const uint16_t *previous, size_t size, FrameInfo &info, int64_t now);
+
+private:
+    std::atomic<int> currentPolicy;
+    std::atomic<int64_t> settle;
+    std::atomic<bool> frozen;
+
+    // Capture thread only
+    bool inFlag;
+    int64_t settleUntil;
+};
+
+}
+
+#endif
@@ -0,0 +1,256 @@
+#include "image.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace pyoptris {
+
+static void put_u16le(std::vector<uint8_t> &out, uint32_t value) {
+    out.push_back((uint8_t) value);
+    out.push_back((uint8_t) (value >> 8));
+}
+
+static void put_u32le(std::vector<uint8_t> &out, uint32_t value) {
+    put_u16le(out, value & 0xffff);
+    put_u16le(out, value >> 16);
+}
+
+static void put_u32be(std::vector<uint8_t> &out, uint32_t value) {
+    out.push_back((uint8_t) (value >> 24));
+    out.push_back((uint8_t) (value >> 16));
+    out.push_back((uint8_t) (value >> 8));
+    out.push_back((uint8_t) value);
+}
+
+ImageEncoder::ImageEncoder() : streamReady(false), streamLevel(-1) {
+    std::memset(&stream, 0, sizeof(stream));
+}
+
+ImageEncoder::~ImageEncoder() {
+    if (streamReady) {
+        deflateEnd(&stream);
+    }
+}
+
+bool ImageEncoder::begin_deflate(int level) {
+    if (!streamReady) {
+        if (deflateInit(&stream, level) != Z_OK) {
+            return false;
+        }
+        streamReady = true;
+        streamLevel = level;
+        return true;
+    }
+    // Reusing the stream keeps zlib from reallocating its window and hash tables for every image
+    if (deflateReset(&stream) != Z_OK) {
+        return false;
+    }
+    if (level != streamLevel) {
+        if (deflateParams(&stream, level, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        streamLevel = level;
+    }
+    return true;
+}
+
+// compressed is sized to deflateBound() up front, so every call finds room for its output
+bool ImageEncoder::deflate_bytes(const uint8_t *bytes, size_t size, bool last) {
+    stream.next_in = (Bytef *) bytes;
+    stream.avail_in = (uInt) size;
+    int result = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+    return last ? result == Z_STREAM_END : (result == Z_OK && stream.avail_in == 0);
+}
+
+void ImageEncoder::png_chunk(const char *type, const uint8_t *payload, size_t size) {
+    put_u32be(encoded, (uint32_t) size);
+    size_t start = encoded.size();
+    encoded.insert(encoded.end(), type, type + 4);
+    encoded.insert(encoded.end(), payload, payload + size);
+    put_u32be(encoded, (uint32_t) crc32(0, encoded.data() + start, (uInt) (size + 4)));
+}
+
+bool ImageEncoder::png(const uint8_t *pixels, int width, int height, int bitDepth, int colourType, int bytesPerPixel, bool swapBytes, int level) {
+    size_t rowBytes = (size_t) width * bytesPerPixel;
+    if (!begin_deflate(level)) {
+        return false;
+    }
+    size_t bound = deflateBound(&stream, (uLong) ((rowBytes + 1) * height));
+    if (compressed.size() < bound) {
+        compressed.resize(bound);
+    }
+    stream.next_out = compressed.data();
+    stream.avail_out = (uInt) compressed.size();
+
+    row.resize(rowBytes);
+    filtered.resize(rowBytes + 1);
+    for (int y = 0; y < height; y++) {
+        const uint8_t *source = pixels + (size_t) y * rowBytes;
+        if (swapBytes) {
+            // PNG samples are big endian
+            for (size_t i = 0; i < rowBytes; i += 2) {
+                row[i] = source[i + 1];
+                row[i + 1] = source[i];
+            }
+            source = row.data();
+        }
+        if (level == 0) {
+            filtered[0] = 0;
+            std::memcpy(filtered.data() + 1, source, rowBytes);
+        } else {
+            filtered[0] = 1;
+            size_t first = std::min(rowBytes, (size_t) bytesPerPixel);
+            std::memcpy(filtered.data() + 1, source, first);
+            for (size_t i = first; i < rowBytes; i++) {
+                filtered[i + 1] = (uint8_t) (source[i] - source[i - bytesPerPixel]);
+            }
+        }
+        if (!deflate_bytes(filtered.data(), filtered.size(), false)) {
+            return false;
+        }
+    }
+    if (!deflate_bytes(nullptr, 0, true)) {
+        return false;
+    }
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    encoded.assign(signature, signature + 8);
+    // IHDR: size, bit depth, colour type, deflate, adaptive filtering, not interlaced
+    const uint8_t header[13] = {
+        (uint8_t) (width >> 24), (uint8_t) (width >> 16), (uint8_t) (width >> 8), (uint8_t) width,
+        (uint8_t) (height >> 24), (uint8_t) (height >> 16), (uint8_t) (height >> 8), (uint8_t) height,
+        (uint8_t) bitDepth, (uint8_t) colourType, 0, 0, 0
+    };
+    png_chunk("IHDR", header, sizeof(header));
+    png_chunk("IDAT", compressed.data(), stream.total_out);
+    png_chunk("IEND", nullptr, 0);
+    return true;
+}
+
+bool ImageEncoder::png_rgb(const uint8_t *rgb, int width, int height, int level) {
+    return png(rgb, width, height, 8, 2, 3, false, level);
+}
+
+bool ImageEncoder::png_gray16(const uint16_t *raw, int width, int height, int level) {
+    uint16_t probe = 1;
+    bool littleEndian = *(const uint8_t *) &probe == 1;
+    return png((const uint8_t *) raw, width, height, 16, 0, 2, littleEndian, level);
+}
+
+bool ImageEncoder::tiff_gray16(const uint16_t *raw, int width, int height, int level) {
+    size_t rowBytes = (size_t) width * 2;
+    size_t stripBytes = rowBytes * height;
+    encoded.clear();
+    encoded.push_back('I');
+    encoded.push_back('I');
+    put_u16le(encoded, 42);
+    put_u32le(encoded, 0);  // IFD offset, patched once the strip is written
+
+    row.resize(rowBytes);
+    if (level == 0) {
+        encoded.reserve(8 + stripBytes + 256);
+        for (int y = 0; y < height; y++) {
+            const uint16_t *source = raw + (size_t) y * width;
+            for (int x = 0; x < width; x++) {
+                row[2 * x] = (uint8_t) source[x];
+                row[2 * x + 1] = (uint8_t) (source[x] >> 8);
+            }
+            encoded.insert(encoded.end(), row.begin(), row.end());
+        }
+    } else {
+        if (!begin_deflate(level)) {
+            return false;
+        }
+        size_t bound = deflateBound(&stream, (uLong) stripBytes);
+        if (compressed.size() < bound) {
+            compressed.resize(bound);
+        }
+        stream.next_out = compressed.data();
+        stream.avail_out = (uInt) compressed.size();
+        // Predictor 2: every sample but the first of a row stores the difference to its left neighbour
+        for (int y = 0; y < height; y++) {
+            const uint16_t *source = raw + (size_t) y * width;
+            uint16_t previous = 0;
+            for (int x = 0; x < width; x++) {
+                uint16_t delta = (uint16_t) (source[x] - previous);
+                previous = source[x];
+                row[2 * x] = (uint8_t) delta;
+                row[2 * x + 1] = (uint8_t) (delta >> 8);
+            }
+            if (!deflate_bytes(row.data(), rowBytes, false)) {
+                return false;
+            }
+        }
+        if (!deflate_bytes(nullptr, 0, true)) {
+            return false;
+        }
+        encoded.insert(encoded.end(), compressed.data(), compressed.data() + stream.total_out);
+    }
+    uint32_t stripSize = (uint32_t) (encoded.size() - 8);
+    if (encoded.size() % 2 != 0) {
+        encoded.push_back(0);   // the IFD starts on a word boundary
+    }
+    uint32_t ifdOffset = (uint32_t) encoded.size();
+    for (int i = 0; i < 4; i++) {
+        encoded[4 + i] = (uint8_t) (ifdOffset >> (8 * i));
+    }
+
+    const uint16_t SHORT = 3, LONG = 4;
+    struct Entry {
+        uint16_t tag;
+        uint16_t type;
+        uint32_t value;
+    };
+    const Entry entries[] = {
+        { 256, LONG,  (uint32_t) width },           // ImageWidth
+        { 257, LONG,  (uint32_t) height },          // ImageLength
+        { 258, SHORT, 16 },                         // BitsPerSample
+        { 259, SHORT, level == 0 ? 1u : 8u },       // Compression: none or Adobe Deflate
+        { 262, SHORT, 1 },                          // PhotometricInterpretation: black is zero
+        { 273, LONG,  8 },                          // StripOffsets
+        { 277, SHORT, 1 },                          // SamplesPerPixel
+        { 278, LONG,  (uint32_t) height },          // RowsPerStrip
+        { 279, LONG,  stripSize },                  // StripByteCounts
+        { 284, SHORT, 1 },                          // PlanarConfiguration: chunky
+        { 317, SHORT, level == 0 ? 1u : 2u },       // Predictor: none or horizontal differencing
+        { 339, SHORT, 1 }                           // SampleFormat: unsigned integer
+    };
+    put_u16le(encoded, (uint32_t) (sizeof(entries) / sizeof(entries[0])));
+    for (const Entry &entry : entries) {
+        put_u16le(encoded, entry.tag);
+        put_u16le(encoded, entry.type);
+        put_u32le(encoded, 1);
+        if (entry.type == SHORT) {
+            // Values shorter than 4 bytes are left justified in the value field
+            put_u16le(encoded, entry.value);
+            put_u16le(encoded, 0);
+        } else {
+            put_u32le(encoded, entry.value);
+        }
+    }
+    put_u32le(encoded, 0);  // no further IFD
+    return true;
+}
+
+bool write_file(const std::string &path, const uint8_t *data, size_t size, std::string &error) {
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    bool written = std::fwrite(data, 1, size, file) == size;
+    int writeErrno = errno;
+    if (std::fclose(file) != 0 && written) {
+        written = false;
+        writeErrno = errno;
+    }
+    if (!written) {
+        error = path + ": " + std::strerror(writeErrno);
+        std::remove(path.c_str());
+    }
+    return written;
+}
+
+}
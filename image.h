@@ -0,0 +1,72 @@
+#ifndef PYOPTRIS_IMAGE_H
+#define PYOPTRIS_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+namespace pyoptris {
+
+/**
+ * @brief PNG and TIFF encoder reusing its zlib state and buffers, so encoding a stream of frames of
+ * one size allocates nothing after the first frame. Rows are stored with the PNG Sub filter or the
+ * TIFF horizontal predictor, which turns the smooth thermal gradients into small residuals.
+ * Not thread safe, every thread encodes with an ImageEncoder of its own.
+ */
+class ImageEncoder {
+public:
+    ImageEncoder();
+    ~ImageEncoder();
+
+    ImageEncoder(const ImageEncoder &) = delete;
+    ImageEncoder &operator=(const ImageEncoder &) = delete;
+
+    /**
+     * @brief 8 bit RGB PNG of width * height packed triplets
+     * @param level zlib compression level, 0 stores the rows uncompressed
+     * @return false if zlib failed
+     */
+    bool png_rgb(const uint8_t *rgb, int width, int height, int level);
+
+    /**
+     * @brief 16 bit greyscale PNG of raw values, lossless
+     */
+    bool png_gray16(const uint16_t *raw, int width, int height, int level);
+
+    /**
+     * @brief 16 bit greyscale single strip TIFF of raw values, Adobe Deflate compressed unless level is 0
+     */
+    bool tiff_gray16(const uint16_t *raw, int width, int height, int level);
+
+    /**
+     * @brief Encoded file of the last successful call
+     */
+    const std::vector<uint8_t> &data() const { return encoded; }
+
+private:
+    bool begin_deflate(int level);
+    bool deflate_bytes(const uint8_t *bytes, size_t size, bool last);
+    void png_chunk(const char *type, const uint8_t *payload, size_t size);
+    bool png(const uint8_t *pixels, int width, int height, int bitDepth, int colourType, int bytesPerPixel, bool swapBytes, int level);
+
+    z_stream stream;
+    bool streamReady;
+    int streamLevel;
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> compressed;
+    std::vector<uint8_t> row;
+    std::vector<uint8_t> filtered;
+};
+
+/**
+ * @brief Writes size bytes to path, replacing it
+ * @param[out] error description of the failure
+ */
+bool write_file(const std::string &path, const uint8_t *data, size_t size, std::string &error);
+
+}
+
+#endif
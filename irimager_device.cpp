@@ -0,0 +1,194 @@
+#include "device.h"
+
+#include <libirimager/IRDevice.h>
+#include <libirimager/IRDeviceParams.h>
+#include <libirimager/IRImager.h>
+#include <libirimager/IRImagerClient.h>
+#include <libirimager/IRLogger.h>
+
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace pyoptris {
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Camera driven through the libirimager C++ API, one IRDevice/IRImager pair per instance
+ */
+class IRImagerDevice : public Device, public evo::IRImagerClient {
+public:
+    IRImagerDevice() : device(nullptr), target(nullptr), targetSize(0), delivered(false), flag(FLAG_UNKNOWN), chipTemperature(0) {
+    }
+
+    ~IRImagerDevice() override {
+        close();
+    }
+
+    bool open(const char *xmlConfig, const char *formatsDef, const char *logFile, unsigned long serial, std::string &error) {
+        if (logFile != nullptr) {
+            evo::IRLogger::setVerbosity(evo::IRLOG_ERROR, evo::IRLOG_OFF, logFile);
+        }
+        if (!evo::IRDeviceParamsReader::readXML(xmlConfig, params)) {
+            error = "Cannot read xml config";
+            return false;
+        }
+        if (serial != 0) {
+            params.serial = serial;
+        }
+        if (formatsDef != nullptr) {
+            // The C++ API wants the directory holding Formats.def, the direct binding the file itself
+            std::string path = formatsDef;
+            size_t separator = path.find_last_of("/\\");
+            params.formatsPath = separator == std::string::npos ? std::string(".") : path.substr(0, separator);
+        }
+        device = evo::IRDevice::IRCreateDevice(params);
+        if (device == nullptr) {
+            error = "Camera not found";
+            return false;
+        }
+        if (!imager.init(&params, device->getFrequency(), device->getWidth(), device->getHeight(), device->controlledViaHID())) {
+            error = "Cannot initialize imager";
+            return false;
+        }
+        imager.setClient(this);
+        rawBuffer.resize(imager.getRawBufferSize());
+        if (device->startStreaming() != 0) {
+            error = "Cannot start streaming";
+            return false;
+        }
+        return true;
+    }
+
+    std::string serial() override {
+        return std::to_string(params.serial);
+    }
+
+    int thermal_size(int &width, int &height) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        width = imager.getWidth();
+        height = imager.getHeight();
+        return 0;
+    }
+
+    int fetch_thermal(uint16_t *data, int width, int height, FrameInfo &info) override {
+        // Raw frames that do not complete a thermal frame (subframes, decimated frame rates) are consumed silently
+        for (;;) {
+            double timestamp;
+            int status = device->getFrame(rawBuffer.data(), &timestamp);
+            if (status == evo::IRIMAGER_DISCONNECTED) {
+                return -2;
+            }
+            if (status != evo::IRIMAGER_SUCCESS) {
+                return -1;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            target = data;
+            targetSize = (size_t) width * height;
+            delivered = false;
+            imager.process(rawBuffer.data(), nullptr);
+            target = nullptr;
+            if (delivered) {
+                info.timestamp = now_ns();
+                info.flag = flag;
+                info.chipTemperature = chipTemperature;
+                return 0;
+            }
+        }
+    }
+
+    int set_temperature_range(int minimum, int maximum) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return imager.setTempRange(minimum, maximum) ? 0 : -1;
+    }
+
+    int set_radiation_parameters(float emissivity, float transmissivity, float ambientTemperature) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        imager.setRadiationParameters(emissivity, transmissivity, ambientTemperature);
+        return 0;
+    }
+
+    int set_shutter_mode(int mode) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        imager.setAutoFlag(mode == 1);
+        return 0;
+    }
+
+    int trigger_shutter_flag() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        imager.forceFlagEvent();
+        return 0;
+    }
+
+    int set_focus_motor_position(float position) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return imager.setFocusmotorPos(position) ? 0 : -1;
+    }
+
+    int get_focus_motor_position(float &position) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        position = imager.getFocusmotorPos();
+        return position < 0 ? -1 : 0;
+    }
+
+    void close() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (device != nullptr) {
+            device->stopStreaming();
+            delete device;
+            device = nullptr;
+        }
+    }
+
+    // evo::IRImagerClient, called from imager.process() on the capture thread with the mutex held
+
+    void onRawFrame(unsigned char *, int) override {
+    }
+
+    void onThermalFrame(unsigned short *data, unsigned int w, unsigned int h, evo::IRFrameMetadata meta, void *) override {
+        if (target != nullptr && (size_t) w * h == targetSize) {
+            std::memcpy(target, data, targetSize * sizeof(uint16_t));
+            flag = (int) meta.flagState;
+            chipTemperature = meta.tempChip;
+            delivered = true;
+        }
+    }
+
+    void onVisibleFrame(unsigned char *, unsigned int, unsigned int, evo::IRFrameMetadata, void *) override {
+    }
+
+    void onFlagStateChange(evo::EnumFlagState, void *) override {
+    }
+
+    void onProcessExit(void *) override {
+    }
+
+private:
+    evo::IRDeviceParams params;
+    evo::IRDevice *device;
+    evo::IRImager imager;
+    std::vector<unsigned char> rawBuffer;
+
+    std::mutex mutex;
+    uint16_t *target;
+    size_t targetSize;
+    bool delivered;
+    int flag;
+    float chipTemperature;
+};
+
+std::shared_ptr<Device> open_device(const char *xmlConfig, const char *formatsDef, const char *logFile,
+                                    unsigned long serial, std::string &error) {
+    std::shared_ptr<IRImagerDevice> device = std::make_shared<IRImagerDevice>();
+    if (!device->open(xmlConfig, formatsDef, logFile, serial, error)) {
+        return nullptr;
+    }
+    return device;
+}
+
+}
@@ -0,0 +1,137 @@
+#include "linescan.h"
+
+#include "framepool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace pyoptris {
+
+LineScan::LineScan(std::shared_ptr<Capture> capture, int tileHeight, LineScanMode mode, int row, size_t capacity)
+    : capture(capture), tileHeight(std::max(tileHeight, 1)), mode(mode), row(row),
+      frameWidth(capture->width()), stripHeight(capture->height()),
+      tiles(capacity, (size_t) capture->width() * std::max(tileHeight, 1) * sizeof(uint16_t)),
+      strip(nullptr), filled(0), tileInfo(), rollingNext(0), isRunning(false), stripCount(0), droppedCount(0) {
+}
+
+LineScan::~LineScan() {
+    stop();
+    aligned_free(strip);
+}
+
+bool LineScan::start(std::string &error) {
+    if (frameWidth <= 0 || stripHeight <= 0) {
+        error = "Capture is not running";
+        return false;
+    }
+    if (mode == LINESCAN_ROW && (row < 0 || row >= stripHeight)) {
+        error = "row must be within the strip height of " + std::to_string(stripHeight);
+        return false;
+    }
+    tile.assign((size_t) frameWidth * tileHeight, 0);
+    rolling.assign((size_t) frameWidth * tileHeight, 0);
+    if (strip == nullptr) {
+        strip = static_cast<uint16_t *>(aligned_allocate(capture->frame_size()));
+        if (strip == nullptr) {
+            throw std::bad_alloc();
+        }
+    }
+    isRunning.store(true, std::memory_order_release);
+    thread = std::thread(&LineScan::run, this);
+    return true;
+}
+
+void LineScan::append(const uint16_t *line, int64_t timestamp) {
+    if (filled == 0) {
+        tileInfo.timestamp = timestamp;
+    }
+    std::memcpy(tile.data() + (size_t) filled * frameWidth, line, frameWidth * sizeof(uint16_t));
+    {
+        std::lock_guard<std::mutex> lock(windowMutex);
+        std::memcpy(rolling.data() + (size_t) rollingNext * frameWidth, line, frameWidth * sizeof(uint16_t));
+        rollingNext = (rollingNext + 1) % tileHeight;
+    }
+    if (++filled == tileHeight) {
+        tiles.publish(tile.data(), tileInfo);
+        filled = 0;
+    }
+}
+
+void LineScan::run() {
+    Capture::Cursor strips = capture->cursor();
+    std::vector<uint16_t> line(frameWidth);
+    std::vector<uint32_t> sums(frameWidth);
+
+    while (isRunning.load(std::memory_order_acquire)) {
+        FrameInfo info;
+        Capture::WaitResult wait = capture->next(strips, strip, &info, CAPTURE_STOP_POLL_NS);
+        if (wait == Capture::WAIT_CLOSED) {
+            break;
+        }
+        if (wait != Capture::WAIT_FRAME) {
+            continue;
+        }
+        switch (mode) {
+            case LINESCAN_STRIP:
+                for (int y = 0; y < stripHeight; y++) {
+                    append(strip + (size_t) y * frameWidth, info.timestamp);
+                }
+                break;
+
+            case LINESCAN_ROW:
+                append(strip + (size_t) row * frameWidth, info.timestamp);
+                break;
+
+            case LINESCAN_AVERAGE:
+                std::fill(sums.begin(), sums.end(), 0);
+                for (int y = 0; y < stripHeight; y++) {
+                    const uint16_t *source = strip + (size_t) y * frameWidth;
+                    for (int x = 0; x < frameWidth; x++) {
+                        sums[x] += source[x];
+                    }
+                }
+                for (int x = 0; x < frameWidth; x++) {
+                    line[x] = (uint16_t) ((sums[x] + stripHeight / 2) / stripHeight);
+                }
+                append(line.data(), info.timestamp);
+                break;
+        }
+        stripCount.fetch_add(1, std::memory_order_relaxed);
+        droppedCount.store(strips.dropped, std::memory_order_relaxed);
+    }
+
+    isRunning.store(false, std::memory_order_release);
+    tiles.close();
+}
+
+void LineScan::stop() {
+    isRunning.store(false, std::memory_order_release);
+    if (thread.joinable()) {
+        thread.join();
+    }
+    tiles.close();
+}
+
+Capture::Cursor LineScan::cursor() const {
+    Capture::Cursor cursor = { tiles.head(), 0 };
+    return cursor;
+}
+
+bool LineScan::latest(uint16_t *data, FrameInfo *info) {
+    return Capture::latest_in(tiles, data, info);
+}
+
+Capture::WaitResult LineScan::next(Capture::Cursor &cursor, uint16_t *data, FrameInfo *info, int64_t timeoutNs) {
+    return Capture::next_in(tiles, cursor, data, info, timeoutNs);
+}
+
+void LineScan::window(uint16_t *data) {
+    std::lock_guard<std::mutex> lock(windowMutex);
+    size_t rowSize = (size_t) frameWidth;
+    size_t older = (size_t) (tileHeight - rollingNext);
+    std::memcpy(data, rolling.data() + rollingNext * rowSize, older * rowSize * sizeof(uint16_t));
+    std::memcpy(data + older * rowSize, rolling.data(), (size_t) rollingNext * rowSize * sizeof(uint16_t));
+}
+
+}
@@ -0,0 +1,108 @@
+#ifndef PYOPTRIS_LINESCAN_H
+#define PYOPTRIS_LINESCAN_H
+
+#include "capture.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pyoptris {
+
+/**
+ * @brief What a strip contributes to the assembled image
+ */
+enum LineScanMode {
+    LINESCAN_STRIP,     // every row of the strip
+    LINESCAN_ROW,       // one chosen row of the strip
+    LINESCAN_AVERAGE    // the average of all rows of the strip, one row
+};
+
+/**
+ * @brief Assembles the strips of a line-scan format such as PI1M 764x8 @ 1000Hz into tiles on a native thread.
+ * Strips are appended in capture order. Every tileHeight rows a completed tile is published to a ring
+ * of its own, consumers read tiles with cursors like frames of a Capture. The timestamp of a tile is
+ * that of its first strip. Next to the tiles a rolling window of the last tileHeight rows is kept.
+ */
+class LineScan {
+public:
+    /**
+     * @param row strip row used by LINESCAN_ROW
+     * @param capacity tiles kept for consumers that fall behind
+     */
+    LineScan(std::shared_ptr<Capture> capture, int tileHeight, LineScanMode mode, int row, size_t capacity);
+    ~LineScan();
+
+    LineScan(const LineScan &) = delete;
+    LineScan &operator=(const LineScan &) = delete;
+
+    /**
+     * @param[out] error description of a bad configuration
+     * @throws std::bad_alloc if the strip and tile buffers cannot be allocated
+     */
+    bool start(std::string &error);
+
+    /**
+     * @brief Stops the thread and closes the tile ring, waiting consumers are released.
+     * A partially filled tile is discarded, window() still has its rows.
+     */
+    void stop();
+
+    bool running() const { return isRunning.load(std::memory_order_acquire); }
+
+    int width() const { return frameWidth; }
+    int tile_height() const { return tileHeight; }
+    size_t tile_size() const { return tiles.frame_size(); }
+
+    uint64_t tile_count() const { return tiles.head(); }
+    uint64_t strips() const { return stripCount.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Strips overwritten in the capture ring before the assembler got to them
+     */
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+    Capture::Cursor cursor() const;
+    bool latest(uint16_t *data, FrameInfo *info);
+    Capture::WaitResult next(Capture::Cursor &cursor, uint16_t *data, FrameInfo *info, int64_t timeoutNs);
+
+    /**
+     * @brief Copies the last tileHeight rows, oldest first. Rows not assembled yet are zero.
+     */
+    void window(uint16_t *data);
+
+private:
+    void run();
+    void append(const uint16_t *line, int64_t timestamp);
+
+    std::shared_ptr<Capture> capture;
+    int tileHeight;
+    LineScanMode mode;
+    int row;
+    int frameWidth;
+    int stripHeight;
+    FrameRing tiles;
+
+    // Assembler thread only
+    uint16_t *strip;                // aligned like ring slots, allocated by start()
+    std::vector<uint16_t> tile;
+    int filled;
+    FrameInfo tileInfo;
+
+    std::mutex windowMutex;
+    std::vector<uint16_t> rolling;  // circular, rollingNext is the oldest row once it wrapped
+    int rollingNext;
+
+    std::thread thread;
+    std::atomic<bool> isRunning;
+    std::atomic<uint64_t> stripCount;
+    std::atomic<uint64_t> droppedCount;
+};
+
+}
+
+#endif
@@ -0,0 +1,194 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pyoptris {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : base(nullptr), length(0), writable(false), file(INVALID_HANDLE_VALUE), mapping(nullptr) {
+}
+
+static bool map_handle(HANDLE file, uint64_t size, bool writable, void *&mapping, unsigned char *&base) {
+    mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                 (DWORD) (size >> 32), (DWORD) size, nullptr);
+    if (mapping == nullptr) {
+        return false;
+    }
+    base = (unsigned char *) MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, (SIZE_T) size);
+    return base != nullptr;
+}
+
+bool MappedFile::create(const std::string &path, uint64_t size, std::string &error) {
+    file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "Cannot create " + path;
+        return false;
+    }
+    writable = true;
+    length = size;
+    if (!map_handle(file, size, true, mapping, base)) {
+        error = "Cannot map " + path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::open(const std::string &path, std::string &error) {
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "Cannot open " + path;
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    writable = false;
+    length = (uint64_t) size.QuadPart;
+    if (!map_handle(file, length, false, mapping, base)) {
+        error = "Cannot map " + path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::flush(bool wait) {
+    if (base != nullptr && writable) {
+        FlushViewOfFile(base, 0);
+        if (wait) {
+            FlushFileBuffers(file);
+        }
+    }
+}
+
+void MappedFile::close(uint64_t truncateTo) {
+    if (base != nullptr) {
+        UnmapViewOfFile(base);
+        base = nullptr;
+    }
+    if (mapping != nullptr) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        if (writable && truncateTo != 0) {
+            LARGE_INTEGER position;
+            position.QuadPart = (LONGLONG) truncateTo;
+            SetFilePointerEx(file, position, nullptr, FILE_BEGIN);
+            SetEndOfFile(file);
+        }
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+    length = 0;
+}
+
+#else
+
+MappedFile::MappedFile() : base(nullptr), length(0), writable(false), descriptor(-1) {
+}
+
+/**
+ * @brief Sizes a new file to size bytes with its blocks allocated, so running out of disk space fails here
+ * instead of raising SIGBUS on a later write to the mapping. Falls back to a sparse file where the file
+ * system or platform cannot preallocate.
+ * @return 0 on success, an errno value otherwise
+ */
+static int preallocate(int descriptor, uint64_t size) {
+#ifndef __APPLE__
+    int result = posix_fallocate(descriptor, 0, (off_t) size);
+    if (result != EOPNOTSUPP && result != EINVAL) {
+        return result;
+    }
+#endif
+    return ftruncate(descriptor, (off_t) size) == 0 ? 0 : errno;
+}
+
+bool MappedFile::create(const std::string &path, uint64_t size, std::string &error) {
+    descriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (descriptor < 0) {
+        error = "Cannot create " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    writable = true;
+    int result = preallocate(descriptor, size);
+    if (result != 0) {
+        error = "Cannot size " + path + ": " + std::strerror(result);
+        close();
+        return false;
+    }
+    void *p = mmap(nullptr, (size_t) size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    if (p == MAP_FAILED) {
+        error = "Cannot map " + path + ": " + std::strerror(errno);
+        close();
+        return false;
+    }
+    base = (unsigned char *) p;
+    length = size;
+    return true;
+}
+
+bool MappedFile::open(const std::string &path, std::string &error) {
+    descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        error = "Cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    writable = false;
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        error = "Cannot map empty file " + path;
+        close();
+        return false;
+    }
+    void *p = mmap(nullptr, (size_t) status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (p == MAP_FAILED) {
+        error = "Cannot map " + path + ": " + std::strerror(errno);
+        close();
+        return false;
+    }
+    base = (unsigned char *) p;
+    length = (uint64_t) status.st_size;
+    return true;
+}
+
+void MappedFile::flush(bool wait) {
+    if (base != nullptr && writable) {
+        msync(base, (size_t) length, wait ? MS_SYNC : MS_ASYNC);
+    }
+}
+
+void MappedFile::close(uint64_t truncateTo) {
+    if (base != nullptr) {
+        munmap(base, (size_t) length);
+        base = nullptr;
+    }
+    if (descriptor >= 0) {
+        if (writable && truncateTo != 0) {
+            if (ftruncate(descriptor, (off_t) truncateTo) != 0) {
+                // Keeping the preallocated size only wastes space, the header still bounds the frames
+            }
+        }
+        ::close(descriptor);
+        descriptor = -1;
+    }
+    length = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+}
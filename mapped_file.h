@@ -0,0 +1,62 @@
+#ifndef PYOPTRIS_MAPPED_FILE_H
+#define PYOPTRIS_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace pyoptris {
+
+/**
+ * @brief A file mapped into memory as a whole, mmap on POSIX and a file mapping on Windows
+ */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * @brief Creates or replaces path with a file of size bytes and maps it writable.
+     * Disk space is allocated up front where the file system supports it, so a full disk fails the call
+     * rather than a later write to the mapping.
+     * @param[out] error description of the failure
+     */
+    bool create(const std::string &path, uint64_t size, std::string &error);
+
+    /**
+     * @brief Maps an existing file read-only
+     */
+    bool open(const std::string &path, std::string &error);
+
+    /**
+     * @brief Schedules dirty pages for writeback, waits for the writeback if wait is set
+     */
+    void flush(bool wait);
+
+    /**
+     * @brief Unmaps and closes the file, a writable file is cut to truncateTo bytes unless that is 0
+     */
+    void close(uint64_t truncateTo = 0);
+
+    bool is_open() const { return base != nullptr; }
+    unsigned char *data() const { return base; }
+    uint64_t size() const { return length; }
+
+private:
+    unsigned char *base;
+    uint64_t length;
+    bool writable;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#else
+    int descriptor;
+#endif
+};
+
+}
+
+#endif
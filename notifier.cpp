@@ -0,0 +1,124 @@
+#include "notifier.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#endif
+
+namespace pyoptris {
+
+FrameNotifier::FrameNotifier(std::shared_ptr<Capture> capture, size_t batch)
+    : capture(capture), batch(batch < 1 ? 1 : batch), readFd(-1), writeFd(-1), isRunning(false), signalCount(0) {
+}
+
+FrameNotifier::~FrameNotifier() {
+    stop();
+#ifndef _WIN32
+    if (writeFd >= 0 && writeFd != readFd) {
+        close(writeFd);
+    }
+    if (readFd >= 0) {
+        close(readFd);
+    }
+#endif
+}
+
+bool FrameNotifier::start(std::string &error) {
+    if (!capture->running()) {
+        error = "Capture is not running";
+        return false;
+    }
+#if defined(_WIN32)
+    // The proactor loop of asyncio on Windows cannot watch descriptors
+    error = "Frame notifications need a POSIX system";
+    return false;
+#else
+#if defined(__linux__)
+    readFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (readFd < 0) {
+        error = std::string("eventfd: ") + std::strerror(errno);
+        return false;
+    }
+    writeFd = readFd;
+#else
+    int fds[2];
+    if (pipe(fds) != 0) {
+        error = std::string("pipe: ") + std::strerror(errno);
+        return false;
+    }
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    readFd = fds[0];
+    writeFd = fds[1];
+#endif
+    isRunning.store(true, std::memory_order_release);
+    thread = std::thread(&FrameNotifier::run, this);
+    return true;
+#endif
+}
+
+void FrameNotifier::stop() {
+    isRunning.store(false, std::memory_order_release);
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void FrameNotifier::signal() {
+#ifndef _WIN32
+    // A full pipe or eventfd counter is already readable, nothing is lost by failing here
+    if (writeFd == readFd) {
+        uint64_t one = 1;
+        ssize_t ignored = write(writeFd, &one, sizeof(one));
+        (void) ignored;
+    } else {
+        char one = 1;
+        ssize_t ignored = write(writeFd, &one, 1);
+        (void) ignored;
+    }
+#endif
+    signalCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameNotifier::drain() {
+#ifndef _WIN32
+    unsigned char buffer[64];
+    while (read(readFd, buffer, sizeof(buffer)) > 0) {
+        if (writeFd == readFd) {
+            break;  // one read resets an eventfd
+        }
+    }
+#endif
+}
+
+void FrameNotifier::run() {
+    // Signal when the frame completing a batch arrived, counted from the frames at start so that a
+    // cursor created together with the notifier sees whole batches
+    uint64_t next = capture->frames() + batch;
+    while (isRunning.load(std::memory_order_acquire)) {
+        if (!capture->wait_frame(next - 1, CAPTURE_STOP_POLL_NS)) {
+            if (!capture->running()) {
+                break;
+            }
+            continue;
+        }
+        signal();
+        uint64_t head = capture->frames();
+        while (next <= head) {
+            next += batch;
+        }
+    }
+
+    // Wakes the loop so it notices the end of the capture
+    signal();
+    isRunning.store(false, std::memory_order_release);
+}
+
+}
@@ -0,0 +1,68 @@
+#ifndef PYOPTRIS_NOTIFIER_H
+#define PYOPTRIS_NOTIFIER_H
+
+#include "capture.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace pyoptris {
+
+/**
+ * @brief Makes the frames of a capture pollable for event loops such as asyncio.
+ * A native thread waits on the capture and signals a file descriptor (an eventfd on Linux, a pipe on
+ * other POSIX systems) every batch frames, so a loop wakes once per frame or once per batch and then
+ * reads the frames without blocking. The frames themselves are read through a cursor as usual.
+ */
+class FrameNotifier {
+public:
+    FrameNotifier(std::shared_ptr<Capture> capture, size_t batch);
+    ~FrameNotifier();
+
+    FrameNotifier(const FrameNotifier &) = delete;
+    FrameNotifier &operator=(const FrameNotifier &) = delete;
+
+    /**
+     * @param[out] error description of why the descriptor could not be created
+     */
+    bool start(std::string &error);
+
+    /**
+     * @brief Stops the thread, the descriptor stays open until destruction
+     */
+    void stop();
+
+    bool running() const { return isRunning.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Descriptor that becomes readable once frames arrived, -1 before start()
+     */
+    int fileno() const { return readFd; }
+
+    /**
+     * @brief Resets the descriptor to not readable, called by the event loop before it reads the frames
+     */
+    void drain();
+
+    uint64_t signals() const { return signalCount.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void signal();
+
+    std::shared_ptr<Capture> capture;
+    size_t batch;
+    int readFd;
+    int writeFd;    // same as readFd for an eventfd
+
+    std::thread thread;
+    std::atomic<bool> isRunning;
+    std::atomic<uint64_t> signalCount;
+};
+
+}
+
+#endif
@@ -116,14 +116,14 @@ def get_palette_image(width: int, height: int) -> numpy.ndarray:
 #
 #__IRDIRECTSDK_API__ int evo_irimager_get_thermal_palette_image(int w_t, int h_t, unsigned short* data_t, int w_p, int h_p, unsigned char* data_p );
 #
-def get_thermal_palette_image(width: int, height: int) -> (numpy.ndarray, numpy.ndarray):
-    w = ctypes.byref(ctypes.c_int(width))
-    h = ctypes.byref(ctypes.c_int(height))
+def get_thermal_palette_image(width: int, height: int, paletteWidth: int = None, paletteHeight: int = None) -> (numpy.ndarray, numpy.ndarray):
+    if paletteWidth is None or paletteHeight is None:
+        paletteWidth, paletteHeight = get_palette_image_size()
     thermalData = numpy.empty((height, width), dtype=numpy.uint16)
-    paletteData = numpy.empty((height, width, 3), dtype=numpy.uint8)
+    paletteData = numpy.empty((paletteHeight, paletteWidth, 3), dtype=numpy.uint8)
     thermalDataPointer = thermalData.ctypes.data_as(ctypes.POINTER(ctypes.c_ushort))
     paletteDataPointer = paletteData.ctypes.data_as(ctypes.POINTER(ctypes.c_ubyte))
-    _ = lib.evo_irimager_get_palette_image(w, h, thermalDataPointer, w, h, paletteDataPointer)
+    _ = lib.evo_irimager_get_thermal_palette_image(width, height, thermalDataPointer, paletteWidth, paletteHeight, paletteDataPointer)
     return (thermalData, paletteData)
 
 #
@@ -0,0 +1,247 @@
+#include "palette.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace pyoptris {
+
+struct ColorStop {
+    float position;
+    uint8_t r, g, b;
+};
+
+// Gradients are given as stops over [0, 1], linearly interpolated into the lookup tables
+static const ColorStop GRAY_BW[] = { {0.0f, 0, 0, 0}, {1.0f, 255, 255, 255} };
+static const ColorStop GRAY_WB[] = { {0.0f, 255, 255, 255}, {1.0f, 0, 0, 0} };
+static const ColorStop IRON[] = {
+    {0.00f, 0, 0, 0}, {0.15f, 32, 0, 140}, {0.40f, 204, 0, 119}, {0.60f, 238, 76, 16},
+    {0.80f, 255, 184, 0}, {0.95f, 255, 240, 120}, {1.00f, 255, 255, 255}
+};
+// Iron with more stops and a steeper middle section, for more contrast in mid temperatures
+static const ColorStop IRON_HI[] = {
+    {0.00f, 0, 0, 0}, {0.08f, 20, 0, 80}, {0.20f, 70, 0, 160}, {0.32f, 150, 0, 160},
+    {0.44f, 210, 20, 100}, {0.56f, 240, 80, 20}, {0.68f, 255, 140, 0}, {0.80f, 255, 200, 0},
+    {0.90f, 255, 240, 100}, {1.00f, 255, 255, 255}
+};
+static const ColorStop RAINBOW[] = {
+    {0.00f, 0, 0, 255}, {0.25f, 0, 255, 255}, {0.50f, 0, 255, 0}, {0.75f, 255, 255, 0}, {1.00f, 255, 0, 0}
+};
+static const ColorStop RAINBOW_HI[] = {
+    {0.00f, 0, 0, 0}, {0.10f, 80, 0, 120}, {0.22f, 0, 0, 255}, {0.36f, 0, 200, 255}, {0.50f, 0, 255, 0},
+    {0.64f, 255, 255, 0}, {0.78f, 255, 128, 0}, {0.90f, 255, 0, 0}, {1.00f, 255, 255, 255}
+};
+// Medical is banded so isotherms stand out, every band is a flat colour
+static const ColorStop MEDICAL[] = {
+    {0.0f, 0, 0, 0}, {0.1f, 0, 0, 128}, {0.2f, 0, 0, 255}, {0.3f, 0, 128, 255}, {0.4f, 0, 200, 100},
+    {0.5f, 0, 255, 0}, {0.6f, 200, 255, 0}, {0.7f, 255, 200, 0}, {0.8f, 255, 100, 0}, {0.9f, 255, 0, 0}
+};
+static const int MEDICAL_BANDS = 10;
+
+// Alarm palettes are gray ramps with the part beyond the alarm threshold painted in a signal colour
+static const int ALARM_LOW = PALETTE_LUT_SIZE / 8;
+static const int ALARM_HIGH = PALETTE_LUT_SIZE - PALETTE_LUT_SIZE / 8;
+
+static uint32_t pack(int r, int g, int b) {
+    return (uint32_t) r | ((uint32_t) g << 8) | ((uint32_t) b << 16);
+}
+
+static void fill_gradient(uint32_t *lut, const ColorStop *stops, size_t count) {
+    for (int i = 0; i < PALETTE_LUT_SIZE; i++) {
+        float x = (float) i / (PALETTE_LUT_SIZE - 1);
+        size_t k = 1;
+        while (k < count - 1 && stops[k].position < x) {
+            k++;
+        }
+        const ColorStop &a = stops[k - 1];
+        const ColorStop &b = stops[k];
+        float t = std::min(std::max((x - a.position) / (b.position - a.position), 0.0f), 1.0f);
+        lut[i] = pack((int) std::lround(a.r + t * (b.r - a.r)),
+                      (int) std::lround(a.g + t * (b.g - a.g)),
+                      (int) std::lround(a.b + t * (b.b - a.b)));
+    }
+}
+
+static void fill_bands(uint32_t *lut, const ColorStop *stops, int bands) {
+    for (int i = 0; i < PALETTE_LUT_SIZE; i++) {
+        const ColorStop &band = stops[std::min(i * bands / PALETTE_LUT_SIZE, bands - 1)];
+        lut[i] = pack(band.r, band.g, band.b);
+    }
+}
+
+static void fill_alarm(uint32_t *lut, int from, int to, uint32_t color) {
+    fill_gradient(lut, GRAY_BW, 2);
+    for (int i = from; i < to; i++) {
+        lut[i] = color;
+    }
+}
+
+struct PaletteTables {
+    uint32_t luts[PALETTE_ALARM_RED + 1][PALETTE_LUT_SIZE];
+
+    PaletteTables() {
+        std::memset(luts, 0, sizeof(luts));
+        fill_alarm(luts[PALETTE_ALARM_BLUE], 0, ALARM_LOW, pack(0, 64, 255));
+        fill_alarm(luts[PALETTE_ALARM_BLUE_HI], ALARM_HIGH, PALETTE_LUT_SIZE, pack(0, 64, 255));
+        fill_gradient(luts[PALETTE_GRAY_BW], GRAY_BW, 2);
+        fill_gradient(luts[PALETTE_GRAY_WB], GRAY_WB, 2);
+        fill_alarm(luts[PALETTE_ALARM_GREEN], ALARM_HIGH, PALETTE_LUT_SIZE, pack(0, 220, 0));
+        fill_gradient(luts[PALETTE_IRON], IRON, sizeof(IRON) / sizeof(IRON[0]));
+        fill_gradient(luts[PALETTE_IRON_HI], IRON_HI, sizeof(IRON_HI) / sizeof(IRON_HI[0]));
+        fill_bands(luts[PALETTE_MEDICAL], MEDICAL, MEDICAL_BANDS);
+        fill_gradient(luts[PALETTE_RAINBOW], RAINBOW, sizeof(RAINBOW) / sizeof(RAINBOW[0]));
+        fill_gradient(luts[PALETTE_RAINBOW_HI], RAINBOW_HI, sizeof(RAINBOW_HI) / sizeof(RAINBOW_HI[0]));
+        fill_alarm(luts[PALETTE_ALARM_RED], ALARM_HIGH, PALETTE_LUT_SIZE, pack(255, 0, 0));
+    }
+};
+
+const uint32_t *palette_lut(int palette) {
+    static const PaletteTables tables;
+    if (palette < PALETTE_ALARM_BLUE || palette > PALETTE_ALARM_RED) {
+        return nullptr;
+    }
+    return tables.luts[palette];
+}
+
+// Partial sums of a block fit 32 bit (4096 * 65535), squares are summed in 64 bit
+static const size_t STATISTICS_BLOCK = 4096;
+
+PYOPTRIS_ALWAYS_INLINE static void statistics_body(const uint16_t *raw, size_t n, uint16_t &lo, uint16_t &hi, uint64_t &sum, uint64_t &sumSquares) {
+    uint16_t blockMin = 0xffff, blockMax = 0;
+    for (size_t start = 0; start < n; start += STATISTICS_BLOCK) {
+        size_t end = std::min(n, start + STATISTICS_BLOCK);
+        uint32_t blockSum = 0;
+        uint64_t blockSquares = 0;
+        for (size_t i = start; i < end; i++) {
+            uint32_t v = raw[i];
+            blockMin = std::min<uint16_t>(blockMin, (uint16_t) v);
+            blockMax = std::max<uint16_t>(blockMax, (uint16_t) v);
+            blockSum += v;
+            blockSquares += v * v;
+        }
+        sum += blockSum;
+        sumSquares += blockSquares;
+    }
+    lo = blockMin;
+    hi = blockMax;
+}
+
+#ifdef PYOPTRIS_X86
+PYOPTRIS_TARGET("avx2")
+static void statistics_avx2(const uint16_t *raw, size_t n, uint16_t &lo, uint16_t &hi, uint64_t &sum, uint64_t &sumSquares) {
+    statistics_body(raw, n, lo, hi, sum, sumSquares);
+}
+#endif
+
+static void statistics_default(const uint16_t *raw, size_t n, uint16_t &lo, uint16_t &hi, uint64_t &sum, uint64_t &sumSquares) {
+    statistics_body(raw, n, lo, hi, sum, sumSquares);
+}
+
+FrameStatistics frame_statistics(const uint16_t *raw, size_t n) {
+    FrameStatistics stats = { 0, 0, 0.0, 0.0 };
+    if (n == 0) {
+        return stats;
+    }
+    uint64_t sum = 0, sumSquares = 0;
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        statistics_avx2(raw, n, stats.min, stats.max, sum, sumSquares);
+    } else
+#endif
+    statistics_default(raw, n, stats.min, stats.max, sum, sumSquares);
+
+    stats.mean = (double) sum / n;
+    double variance = (double) sumSquares / n - stats.mean * stats.mean;
+    stats.stddev = variance > 0 ? std::sqrt(variance) : 0.0;
+    return stats;
+}
+
+void frame_histogram(const uint16_t *raw, size_t n, double low, double high, uint32_t *counts, size_t bins) {
+    std::fill(counts, counts + bins, 0u);
+    if (bins == 0 || !(high > low)) {
+        return;
+    }
+    // The bin is scaled from the offset like numpy.histogram does, so both agree on values at the edges
+    double factor = (double) bins / (high - low);
+    for (size_t i = 0; i < n; i++) {
+        double v = raw[i];
+        if (v >= low && v <= high) {
+            counts[std::min((size_t) ((v - low) * factor), bins - 1)]++;
+        }
+    }
+}
+
+PaletteRange palette_range(PaletteScaling scaling, const FrameStatistics &stats, PaletteRange manual) {
+    PaletteRange range = { stats.min, stats.max };
+    double sigmas = 0;
+    switch (scaling) {
+        case SCALING_MANUAL:
+            return manual;
+
+        case SCALING_MIN_MAX:
+            return range;
+
+        case SCALING_SIGMA1:
+            sigmas = 1;
+            break;
+
+        case SCALING_SIGMA3:
+            sigmas = 3;
+            break;
+    }
+    double low = std::max(stats.mean - sigmas * stats.stddev, (double) stats.min);
+    double high = std::min(stats.mean + sigmas * stats.stddev, (double) stats.max);
+    range.low = (uint16_t) std::floor(low);
+    range.high = (uint16_t) std::ceil(high);
+    return range;
+}
+
+// Indices are computed for a block first so that loop vectorizes, the table lookups follow
+static const size_t RENDER_BLOCK = 256;
+
+PYOPTRIS_ALWAYS_INLINE static void render_body(const uint16_t *raw, uint8_t *rgb, size_t n, const uint32_t *lut, PaletteRange range) {
+    uint32_t low = range.low;
+    uint32_t span = range.high > range.low ? range.high - range.low : 1;
+    uint32_t factor = ((uint32_t) (PALETTE_LUT_SIZE - 1) << 16) / span;
+
+    uint16_t index[RENDER_BLOCK];
+    for (size_t start = 0; start < n; start += RENDER_BLOCK) {
+        size_t count = std::min(RENDER_BLOCK, n - start);
+        const uint16_t *src = raw + start;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t v = std::min(std::max((uint32_t) src[i], low), low + span) - low;
+            index[i] = (uint16_t) ((v * factor) >> 16);
+        }
+        uint8_t *dst = rgb + start * 3;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t color = lut[index[i]];
+            dst[3 * i] = (uint8_t) color;
+            dst[3 * i + 1] = (uint8_t) (color >> 8);
+            dst[3 * i + 2] = (uint8_t) (color >> 16);
+        }
+    }
+}
+
+#ifdef PYOPTRIS_X86
+PYOPTRIS_TARGET("avx2")
+static void render_avx2(const uint16_t *raw, uint8_t *rgb, size_t n, const uint32_t *lut, PaletteRange range) {
+    render_body(raw, rgb, n, lut, range);
+}
+#endif
+
+static void render_default(const uint16_t *raw, uint8_t *rgb, size_t n, const uint32_t *lut, PaletteRange range) {
+    render_body(raw, rgb, n, lut, range);
+}
+
+void render_palette(const uint16_t *raw, uint8_t *rgb, size_t n, const uint32_t *lut, PaletteRange range) {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        render_avx2(raw, rgb, n, lut, range);
+        return;
+    }
+#endif
+    render_default(raw, rgb, n, lut, range);
+}
+
+}
@@ -0,0 +1,88 @@
+#ifndef PYOPTRIS_PALETTE_H
+#define PYOPTRIS_PALETTE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pyoptris {
+
+/**
+ * @brief Palette ids, numbered like EnumOptrisColoringPalette of the SDK
+ */
+enum ColoringPalette {
+    PALETTE_ALARM_BLUE      = 1,
+    PALETTE_ALARM_BLUE_HI   = 2,
+    PALETTE_GRAY_BW         = 3,
+    PALETTE_GRAY_WB         = 4,
+    PALETTE_ALARM_GREEN     = 5,
+    PALETTE_IRON            = 6,
+    PALETTE_IRON_HI         = 7,
+    PALETTE_MEDICAL         = 8,
+    PALETTE_RAINBOW         = 9,
+    PALETTE_RAINBOW_HI      = 10,
+    PALETTE_ALARM_RED       = 11
+};
+
+/**
+ * @brief Scaling ids, numbered like EnumOptrisPaletteScalingMethod of the SDK
+ */
+enum PaletteScaling {
+    SCALING_MANUAL  = 1,
+    SCALING_MIN_MAX = 2,
+    SCALING_SIGMA1  = 3,
+    SCALING_SIGMA3  = 4
+};
+
+/**
+ * @brief Entries per palette lookup table
+ */
+static const int PALETTE_LUT_SIZE = 1024;
+
+struct FrameStatistics {
+    uint16_t min;
+    uint16_t max;
+    double mean;
+    double stddev;
+};
+
+/**
+ * @brief Raw value interval stretched over the palette, values outside are clamped
+ */
+struct PaletteRange {
+    uint16_t low;
+    uint16_t high;
+};
+
+/**
+ * @brief min, max, mean and standard deviation of n raw values in a single pass
+ */
+FrameStatistics frame_statistics(const uint16_t *raw, size_t n);
+
+/**
+ * @brief Counts n raw values in bins equally wide bins over [low, high], like numpy.histogram
+ * The last bin includes high, values outside [low, high] are not counted.
+ * @param[out] counts bins entries
+ */
+void frame_histogram(const uint16_t *raw, size_t n, double low, double high, uint32_t *counts, size_t bins);
+
+/**
+ * @brief Range selected by a scaling method
+ * Sigma methods span mean +- 1 or 3 standard deviations, clipped to the frame min/max.
+ * @param manual range used by SCALING_MANUAL
+ */
+PaletteRange palette_range(PaletteScaling scaling, const FrameStatistics &stats, PaletteRange manual);
+
+/**
+ * @brief Lookup table of a palette, PALETTE_LUT_SIZE entries of 0x00BBGGRR
+ * @return nullptr for an unknown palette id
+ */
+const uint32_t *palette_lut(int palette);
+
+/**
+ * @brief Maps n raw values through a palette into packed RGB triplets (3 * n bytes)
+ */
+void render_palette(const uint16_t *raw, uint8_t *rgb, size_t n, const uint32_t *lut, PaletteRange range);
+
+}
+
+#endif
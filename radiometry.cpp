@@ -0,0 +1,157 @@
+#include "radiometry.h"
+#include "simd.h"
+
+#include <cmath>
+
+namespace pyoptris {
+
+static const float KELVIN = 273.15f;
+
+RadiometricCorrection::RadiometricCorrection(int width, int height, const float *emissivity, float emissivityValue,
+                                             const float *transmissivity, float transmissivityValue, float ambient, float reflected)
+    : frameWidth(width), frameHeight(height), ambientTemperature(ambient), reflectedTemperature(reflected),
+      gain((size_t) width * height), bias((size_t) width * height) {
+    double ambientKelvin = (double) ambient + KELVIN;
+    double reflectedKelvin = (double) reflected + KELVIN;
+    double ambientRadiation = ambientKelvin * ambientKelvin * ambientKelvin * ambientKelvin;
+    double reflectedRadiation = reflectedKelvin * reflectedKelvin * reflectedKelvin * reflectedKelvin;
+    for (size_t i = 0; i < gain.size(); i++) {
+        double eps = emissivity != nullptr ? emissivity[i] : emissivityValue;
+        double tau = transmissivity != nullptr ? transmissivity[i] : transmissivityValue;
+        double g = 1.0 / (tau * eps);
+        gain[i] = (float) g;
+        bias[i] = (float) (-(tau * (1.0 - eps) * reflectedRadiation + (1.0 - tau) * ambientRadiation) * g);
+    }
+}
+
+// t = raw * a + b in Kelvin
+static void correct_scalar(const uint16_t *raw, float *out, const float *gain, const float *bias, size_t n, float a, float b) {
+    for (size_t i = 0; i < n; i++) {
+        float t = (float) raw[i] * a + b;
+        float t2 = t * t;
+        float w = t2 * t2 * gain[i] + bias[i];
+        out[i] = std::sqrt(std::sqrt(w > 0.0f ? w : 0.0f)) - KELVIN;
+    }
+}
+
+#ifdef PYOPTRIS_X86
+
+PYOPTRIS_TARGET("avx2")
+static inline __m256 correct8_avx2(__m256i raw32, const float *gain, const float *bias, __m256 a, __m256 b, __m256 zero, __m256 kelvin) {
+    __m256 t = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(raw32), a), b);
+    __m256 t2 = _mm256_mul_ps(t, t);
+    __m256 w = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(t2, t2), _mm256_loadu_ps(gain)), _mm256_loadu_ps(bias));
+    w = _mm256_max_ps(w, zero);
+    return _mm256_sub_ps(_mm256_sqrt_ps(_mm256_sqrt_ps(w)), kelvin);
+}
+
+PYOPTRIS_TARGET("avx2")
+static void correct_avx2(const uint16_t *raw, float *out, const float *gain, const float *bias, size_t n, float a, float b) {
+    __m256 va = _mm256_set1_ps(a);
+    __m256 vb = _mm256_set1_ps(b);
+    __m256 zero = _mm256_setzero_ps();
+    __m256 kelvin = _mm256_set1_ps(KELVIN);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (raw + i));
+        __m256i v0 = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+        __m256i v1 = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+        _mm256_storeu_ps(out + i, correct8_avx2(v0, gain + i, bias + i, va, vb, zero, kelvin));
+        _mm256_storeu_ps(out + i + 8, correct8_avx2(v1, gain + i + 8, bias + i + 8, va, vb, zero, kelvin));
+    }
+    correct_scalar(raw + i, out + i, gain + i, bias + i, n - i, a, b);
+}
+
+#endif
+
+#ifdef PYOPTRIS_SSE2
+
+static inline __m128 correct4_sse2(__m128i raw32, const float *gain, const float *bias, __m128 a, __m128 b, __m128 zero, __m128 kelvin) {
+    __m128 t = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(raw32), a), b);
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 w = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(t2, t2), _mm_loadu_ps(gain)), _mm_loadu_ps(bias));
+    w = _mm_max_ps(w, zero);
+    return _mm_sub_ps(_mm_sqrt_ps(_mm_sqrt_ps(w)), kelvin);
+}
+
+static void correct_sse2(const uint16_t *raw, float *out, const float *gain, const float *bias, size_t n, float a, float b) {
+    __m128 va = _mm_set1_ps(a);
+    __m128 vb = _mm_set1_ps(b);
+    __m128 zero = _mm_setzero_ps();
+    __m128 kelvin = _mm_set1_ps(KELVIN);
+    __m128i zeroi = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (raw + i));
+        _mm_storeu_ps(out + i, correct4_sse2(_mm_unpacklo_epi16(v, zeroi), gain + i, bias + i, va, vb, zero, kelvin));
+        _mm_storeu_ps(out + i + 4, correct4_sse2(_mm_unpackhi_epi16(v, zeroi), gain + i + 4, bias + i + 4, va, vb, zero, kelvin));
+    }
+    correct_scalar(raw + i, out + i, gain + i, bias + i, n - i, a, b);
+}
+
+#endif
+
+#if defined(PYOPTRIS_NEON) && defined(__aarch64__)
+
+static inline float32x4_t correct4_neon(uint32x4_t raw32, const float *gain, const float *bias, float32x4_t a, float32x4_t b, float32x4_t zero, float32x4_t kelvin) {
+    float32x4_t t = vaddq_f32(vmulq_f32(vcvtq_f32_u32(raw32), a), b);
+    float32x4_t t2 = vmulq_f32(t, t);
+    float32x4_t w = vaddq_f32(vmulq_f32(vmulq_f32(t2, t2), vld1q_f32(gain)), vld1q_f32(bias));
+    w = vmaxq_f32(w, zero);
+    return vsubq_f32(vsqrtq_f32(vsqrtq_f32(w)), kelvin);
+}
+
+static void correct_neon(const uint16_t *raw, float *out, const float *gain, const float *bias, size_t n, float a, float b) {
+    float32x4_t va = vdupq_n_f32(a);
+    float32x4_t vb = vdupq_n_f32(b);
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t kelvin = vdupq_n_f32(KELVIN);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t v = vld1q_u16(raw + i);
+        vst1q_f32(out + i, correct4_neon(vmovl_u16(vget_low_u16(v)), gain + i, bias + i, va, vb, zero, kelvin));
+        vst1q_f32(out + i + 4, correct4_neon(vmovl_u16(vget_high_u16(v)), gain + i + 4, bias + i + 4, va, vb, zero, kelvin));
+    }
+    correct_scalar(raw + i, out + i, gain + i, bias + i, n - i, a, b);
+}
+
+#endif
+
+typedef void (*CorrectKernel)(const uint16_t *, float *, const float *, const float *, size_t, float, float);
+
+static CorrectKernel select_kernel() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        return correct_avx2;
+    }
+#endif
+#if defined(PYOPTRIS_SSE2)
+    return correct_sse2;
+#elif defined(PYOPTRIS_NEON) && defined(__aarch64__)
+    return correct_neon;
+#else
+    return correct_scalar;
+#endif
+}
+
+void RadiometricCorrection::apply(const uint16_t *raw, float *out, TemperatureScale scale) const {
+    static const CorrectKernel kernel = select_kernel();
+    kernel(raw, out, gain.data(), bias.data(), gain.size(), scale.scale, KELVIN - scale.rawOffset * scale.scale);
+}
+
+const char *radiometry_isa() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        return "avx2";
+    }
+#endif
+#if defined(PYOPTRIS_SSE2)
+    return "sse2";
+#elif defined(PYOPTRIS_NEON) && defined(__aarch64__)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef PYOPTRIS_RADIOMETRY_H
+#define PYOPTRIS_RADIOMETRY_H
+
+#include "convert.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pyoptris {
+
+/**
+ * @brief Per-pixel emissivity and transmissivity correction of raw thermal frames.
+ * The camera measures every surface as a black body seen through a clear path. With the total
+ * radiation approximation W ~ T^4 (T in Kelvin) the radiation reaching a pixel is
+ *   W_measured = tau eps W_object + tau (1 - eps) W_reflected + (1 - tau) W_ambient
+ * which is solved for W_object. Per pixel that is one gain and one bias on T^4, precomputed when the
+ * correction is built, so the kernel costs a few multiplies and two square roots per pixel.
+ */
+class RadiometricCorrection {
+public:
+    /**
+     * @param emissivity width * height values in (0, 1], nullptr for emissivityValue everywhere
+     * @param transmissivity width * height values in (0, 1], nullptr for transmissivityValue everywhere
+     * @param ambient temperature of the atmosphere between camera and object in degrees Celsius
+     * @param reflected temperature of the surroundings the object reflects in degrees Celsius
+     */
+    RadiometricCorrection(int width, int height, const float *emissivity, float emissivityValue,
+                          const float *transmissivity, float transmissivityValue, float ambient, float reflected);
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    float ambient() const { return ambientTemperature; }
+    float reflected() const { return reflectedTemperature; }
+
+    /**
+     * @brief Converts a raw frame to corrected degrees Celsius, out may not alias raw.
+     * Pixels whose corrected radiation would be negative come out as absolute zero.
+     */
+    void apply(const uint16_t *raw, float *out, TemperatureScale scale) const;
+
+private:
+    int frameWidth;
+    int frameHeight;
+    float ambientTemperature;
+    float reflectedTemperature;
+    std::vector<float> gain;    // 1 / (tau eps)
+    std::vector<float> bias;    // -(tau (1 - eps) W_reflected + (1 - tau) W_ambient) / (tau eps)
+};
+
+/**
+ * @brief Name of the instruction set picked for the correction kernel, e.g. "avx2"
+ */
+const char *radiometry_isa();
+
+}
+
+#endif
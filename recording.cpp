@@ -0,0 +1,297 @@
+#include "recording.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+namespace pyoptris {
+
+static const uint64_t DEFAULT_SEGMENT_BYTES = 1ull << 30;
+
+static uint64_t round_up(uint64_t value, uint64_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string recording_segment_path(const std::string &path, uint32_t segment) {
+    if (segment == 0) {
+        return path;
+    }
+    char number[16];
+    std::snprintf(number, sizeof(number), ".%04u", segment);
+    size_t separator = path.find_last_of("/\\");
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (separator != std::string::npos && dot < separator)) {
+        return path + number;
+    }
+    return path.substr(0, dot) + number + path.substr(dot);
+}
+
+RecordingWriter::RecordingWriter(std::shared_ptr<Capture> capture, const std::string &path, uint64_t segmentFrames, int temperatureDecimals)
+    : capture(capture), path(path), segmentFrames(segmentFrames), temperatureDecimals(temperatureDecimals),
+      header(nullptr), index(nullptr), data(nullptr),
+      isRunning(false), stopping(false), frameCount(0), droppedCount(0), segmentCount(0) {
+    frameStride = round_up(capture->frame_size(), 64);
+    if (this->segmentFrames == 0) {
+        this->segmentFrames = std::max<uint64_t>(1, DEFAULT_SEGMENT_BYTES / frameStride);
+    }
+}
+
+RecordingWriter::~RecordingWriter() {
+    stop();
+}
+
+bool RecordingWriter::open_segment(uint32_t segment, std::string &error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t indexOffset = RECORDING_HEADER_SIZE;
+    uint64_t dataOffset = round_up(indexOffset + segmentFrames * sizeof(RecordingIndexEntry), 4096);
+    if (!file.create(recording_segment_path(path, segment), dataOffset + segmentFrames * frameStride, error)) {
+        return false;
+    }
+    header = new (file.data()) RecordingHeader();
+    std::memcpy(header->magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+    header->version = RECORDING_VERSION;
+    header->headerSize = (uint32_t) RECORDING_HEADER_SIZE;
+    header->width = (uint32_t) capture->width();
+    header->height = (uint32_t) capture->height();
+    header->segment = segment;
+    header->temperatureDecimals = temperatureDecimals;
+    header->frameStride = frameStride;
+    header->capacity = segmentFrames;
+    header->indexOffset = indexOffset;
+    header->dataOffset = dataOffset;
+    header->firstFrame = frameCount.load(std::memory_order_relaxed);
+    header->created = now_ns();
+    header->frameCount.store(0, std::memory_order_release);
+    index = (RecordingIndexEntry *) (file.data() + indexOffset);
+    data = file.data() + dataOffset;
+    segmentCount.store(segment + 1, std::memory_order_relaxed);
+    return true;
+}
+
+void RecordingWriter::close_segment() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file.is_open()) {
+        return;
+    }
+    uint64_t used = header->dataOffset + header->frameCount.load(std::memory_order_relaxed) * frameStride;
+    header->closed = 1;
+    file.flush(false);
+    file.close(used);
+    header = nullptr;
+    index = nullptr;
+    data = nullptr;
+}
+
+bool RecordingWriter::start(std::string &error) {
+    if (capture->width() <= 0 || capture->height() <= 0) {
+        error = "Capture is not running";
+        return false;
+    }
+    cursor = capture->cursor();
+    overflow.resize(capture->frame_size());
+    if (!open_segment(0, error)) {
+        return false;
+    }
+    isRunning.store(true, std::memory_order_release);
+    thread = std::thread(&RecordingWriter::run, this);
+    return true;
+}
+
+void RecordingWriter::run() {
+    for (;;) {
+        uint64_t n = 0;
+        if (header != nullptr) {
+            n = header->frameCount.load(std::memory_order_relaxed);
+            if (n == segmentFrames) {
+                close_segment();
+                n = 0;
+            }
+        }
+
+        FrameInfo info;
+        bool draining = stopping.load(std::memory_order_acquire);
+        int64_t timeoutNs = draining ? 0 : CAPTURE_STOP_POLL_NS;
+        Capture::WaitResult result;
+        if (header != nullptr) {
+            // The ring copies the frame straight into its place in the segment
+            result = capture->next(cursor, data + n * frameStride, &info, timeoutNs);
+        } else {
+            // The next segment is only created once a frame for it arrived, so a recording stopped on a
+            // segment boundary does not leave an empty segment behind
+            result = capture->next(cursor, overflow.data(), &info, timeoutNs);
+            if (result == Capture::WAIT_FRAME) {
+                std::string error;
+                if (!open_segment(segmentCount.load(std::memory_order_relaxed), error)) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    failure = error;
+                    break;
+                }
+                std::memcpy(data, overflow.data(), overflow.size());
+            }
+        }
+        if (result == Capture::WAIT_FRAME) {
+            RecordingIndexEntry &entry = index[n];
+            entry.timestamp = info.timestamp;
+            entry.sequence = info.sequence;
+            entry.flags = info.held ? RECORDING_FRAME_HELD : 0;
+            entry.chipTemperature = info.chipTemperature;
+            entry.flag = info.flag;
+            entry.validity = info.validity;
+            header->frameCount.store(n + 1, std::memory_order_release);
+            frameCount.fetch_add(1, std::memory_order_relaxed);
+            droppedCount.store(cursor.dropped, std::memory_order_relaxed);
+        } else if (result == Capture::WAIT_CLOSED || draining) {
+            break;
+        }
+    }
+    close_segment();
+    isRunning.store(false, std::memory_order_release);
+}
+
+void RecordingWriter::stop() {
+    stopping.store(true, std::memory_order_release);
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void RecordingWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    file.flush(true);
+}
+
+std::string RecordingWriter::error() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failure;
+}
+
+bool RecordingReader::map_segment(uint32_t segment, std::string &error) {
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    std::string path = recording_segment_path(basePath, segment);
+    if (!file->open(path, error)) {
+        return false;
+    }
+    const RecordingHeader *header = (const RecordingHeader *) file->data();
+    if (file->size() < RECORDING_HEADER_SIZE || std::memcmp(header->magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0
+            || header->version == 0 || header->version > RECORDING_VERSION || header->segment != segment || file->size() < header->dataOffset) {
+        error = "Not a pyoptris recording: " + path;
+        return false;
+    }
+    if (segment == 0) {
+        frameWidth = (int) header->width;
+        frameHeight = (int) header->height;
+        decimals = header->temperatureDecimals;
+        segmentCapacity = header->capacity;
+        version = header->version;
+    } else if (header->capacity != segmentCapacity || header->version != version) {
+        error = "Segment does not match the recording: " + path;
+        return false;
+    }
+    segmentFiles.push_back({ std::move(file), header });
+    return true;
+}
+
+bool RecordingReader::open(const std::string &path, std::string &error) {
+    basePath = path;
+    segmentFiles.clear();
+    if (!map_segment(0, error)) {
+        return false;
+    }
+    frames();
+    return true;
+}
+
+uint64_t RecordingReader::frames() {
+    // A full last segment means the writer has moved on to the next one, or will with the next frame
+    while (segmentFiles.back().header->frameCount.load(std::memory_order_acquire) == segmentCapacity) {
+        std::string error;
+        if (!map_segment((uint32_t) segmentFiles.size(), error)) {
+            break;
+        }
+    }
+    return (segmentFiles.size() - 1) * segmentCapacity + segmentFiles.back().header->frameCount.load(std::memory_order_acquire);
+}
+
+const uint16_t *RecordingReader::frame(uint64_t n, const RecordingIndexEntry **entry) const {
+    const Segment &segment = segmentFiles[n / segmentCapacity];
+    uint64_t i = n % segmentCapacity;
+    const unsigned char *base = segment.file->data();
+    if (entry != nullptr) {
+        *entry = (const RecordingIndexEntry *) (base + segment.header->indexOffset) + i;
+    }
+    return (const uint16_t *) (base + segment.header->dataOffset + i * segment.header->frameStride);
+}
+
+FrameInfo RecordingReader::info(uint64_t n) const {
+    const RecordingIndexEntry *entry;
+    frame(n, &entry);
+    FrameInfo info;
+    info.sequence = entry->sequence;
+    info.timestamp = entry->timestamp;
+    if (version >= 2) {
+        info.flag = entry->flag;
+        info.chipTemperature = entry->chipTemperature;
+        info.validity = entry->validity;
+        info.held = (entry->flags & RECORDING_FRAME_HELD) != 0;
+    }
+    return info;
+}
+
+int64_t RecordingReader::timestamp_of(uint64_t n) const {
+    const RecordingIndexEntry *entry;
+    frame(n, &entry);
+    return entry->timestamp;
+}
+
+int64_t RecordingReader::find_timestamp(int64_t timestamp) {
+    uint64_t count = frames();
+    if (count == 0 || timestamp < timestamp_of(0)) {
+        return -1;
+    }
+    int64_t first = timestamp_of(0);
+    int64_t last = timestamp_of(count - 1);
+    if (timestamp >= last) {
+        return (int64_t) count - 1;
+    }
+
+    // Guess from the average frame period, then widen a bracket around the guess and bisect it
+    uint64_t guess = (uint64_t) ((double) (timestamp - first) / (double) (last - first) * (double) (count - 1));
+    guess = std::min(guess, count - 2);
+    uint64_t low, high;
+    uint64_t step = 1;
+    if (timestamp_of(guess) <= timestamp) {
+        low = guess;
+        high = std::min(guess + step, count - 1);
+        while (timestamp_of(high) <= timestamp) {
+            low = high;
+            step *= 2;
+            high = std::min(high + step, count - 1);
+        }
+    } else {
+        high = guess;
+        low = guess >= step ? guess - step : 0;
+        while (timestamp_of(low) > timestamp) {
+            high = low;
+            step *= 2;
+            low = low >= step ? low - step : 0;
+        }
+    }
+    // Invariant: timestamp_of(low) <= timestamp < timestamp_of(high)
+    while (high - low > 1) {
+        uint64_t middle = low + (high - low) / 2;
+        if (timestamp_of(middle) <= timestamp) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return (int64_t) low;
+}
+
+}
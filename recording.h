@@ -0,0 +1,200 @@
+#ifndef PYOPTRIS_RECORDING_H
+#define PYOPTRIS_RECORDING_H
+
+#include "capture.h"
+#include "mapped_file.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pyoptris {
+
+/*
+ * Recording segment layout, little endian:
+ *
+ *   [0, RECORDING_HEADER_SIZE)             RecordingHeader, zero padded
+ *   [indexOffset, +capacity * 32)          RecordingIndexEntry per frame
+ *   [dataOffset, +capacity * frameStride)  raw uint16 frames, frame i at dataOffset + i * frameStride
+ *
+ * Segments are sized for capacity frames when created and cut to the frames written when closed.
+ * A recording that outgrows a segment continues in the next one, see recording_segment_path().
+ */
+
+static const char RECORDING_MAGIC[8] = { 'P', 'Y', 'O', 'P', 'T', 'R', 'E', 'C' };
+static const uint32_t RECORDING_VERSION = 2;   // 1 left the flag state, chip temperature and validity of frames out
+static const uint64_t RECORDING_HEADER_SIZE = 4096;
+
+struct RecordingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t width;
+    uint32_t height;
+    uint32_t segment;               // number of this segment, 0 for the first
+    int32_t temperatureDecimals;    // raw encoding of the frames, see temperature_scale()
+    uint64_t frameStride;           // bytes from one frame to the next, a multiple of 64
+    uint64_t capacity;              // frames the segment was sized for
+    uint64_t indexOffset;
+    uint64_t dataOffset;
+    uint64_t firstFrame;            // frame number of the first frame of this segment within the recording
+    int64_t created;                // ns since the epoch
+    std::atomic<uint64_t> frameCount;   // stored after a frame and its index entry are complete
+    uint32_t closed;                // 1 once the writer is done with this segment
+    uint32_t reserved;
+};
+
+static const uint32_t RECORDING_FRAME_HELD = 1;    // the pixels are the last valid frame, see FrameInfo::held
+
+struct RecordingIndexEntry {
+    int64_t timestamp;          // acquisition time in ns since the epoch
+    uint64_t sequence;          // capture sequence number, gaps are frames the recorder dropped
+    uint32_t flags;             // RECORDING_FRAME_* bits
+    float chipTemperature;      // degrees Celsius, NaN if not reported
+    int32_t flag;               // FlagState while the frame was taken
+    int32_t validity;           // FrameValidity
+};
+
+static_assert(sizeof(RecordingIndexEntry) == 32, "index entries are 32 bytes on disk");
+
+/**
+ * @brief Path of segment n: path itself for 0, "name.0001.ext" style for the following ones
+ */
+std::string recording_segment_path(const std::string &path, uint32_t segment);
+
+/**
+ * @brief Records the frames of a Capture into segment files on a native thread.
+ * Frames are copied straight from the ring into the mapping, nothing is allocated per frame and
+ * nothing is synced per frame, the page cache writes the segments back in the background.
+ */
+class RecordingWriter {
+public:
+    /**
+     * @param segmentFrames frames per segment file, 0 sizes segments to about 1 GiB
+     */
+    RecordingWriter(std::shared_ptr<Capture> capture, const std::string &path, uint64_t segmentFrames, int temperatureDecimals);
+    ~RecordingWriter();
+
+    RecordingWriter(const RecordingWriter &) = delete;
+    RecordingWriter &operator=(const RecordingWriter &) = delete;
+
+    /**
+     * @brief Creates the first segment and starts the writer thread
+     * @param[out] error description of the failure
+     */
+    bool start(std::string &error);
+
+    /**
+     * @brief Writes what the capture still holds for this writer, then closes the segment
+     */
+    void stop();
+
+    /**
+     * @brief Forces written frames to disk
+     */
+    void flush();
+
+    bool running() const { return isRunning.load(std::memory_order_acquire); }
+    uint64_t frames() const { return frameCount.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+    uint32_t segments() const { return segmentCount.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Why the writer thread stopped early, empty if it did not
+     */
+    std::string error();
+
+private:
+    bool open_segment(uint32_t segment, std::string &error);
+    void close_segment();
+    void run();
+
+    std::shared_ptr<Capture> capture;
+    Capture::Cursor cursor;
+    std::string path;
+    uint64_t segmentFrames;
+    uint64_t frameStride;
+    int temperatureDecimals;
+
+    std::mutex mutex;   // the mapping, shared between the writer thread and flush()
+    MappedFile file;
+    RecordingHeader *header;
+    RecordingIndexEntry *index;
+    unsigned char *data;
+    std::vector<unsigned char> overflow;   // first frame of the next segment, read before the segment exists
+
+    std::thread thread;
+    std::atomic<bool> isRunning;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> frameCount;
+    std::atomic<uint64_t> droppedCount;
+    std::atomic<uint32_t> segmentCount;
+    std::string failure;
+};
+
+/**
+ * @brief Read access to a recording, including one that is still being written.
+ * Frame pointers stay valid as long as the reader lives.
+ */
+class RecordingReader {
+public:
+    /**
+     * @brief Maps the first segment and every following one that exists
+     */
+    bool open(const std::string &path, std::string &error);
+
+    /**
+     * @brief Frames recorded so far, picks up frames and segments a live writer added since the last call
+     */
+    uint64_t frames();
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    int temperature_decimals() const { return decimals; }
+    size_t segments() const { return segmentFiles.size(); }
+
+    /**
+     * @brief Frame n in O(1), n < frames()
+     * @param[out] entry index entry of the frame, may be nullptr
+     */
+    const uint16_t *frame(uint64_t n, const RecordingIndexEntry **entry) const;
+
+    /**
+     * @brief Acquisition record of frame n from its index entry, n < frames().
+     * fetchNs is not recorded and stays 0, version 1 segments report no flag state or chip temperature.
+     */
+    FrameInfo info(uint64_t n) const;
+
+    /**
+     * @brief Last frame taken at or before timestamp, -1 if the recording starts after it.
+     * Interpolates between the first and last timestamp and walks from there, which is O(1) for a
+     * stream at a steady frame rate.
+     */
+    int64_t find_timestamp(int64_t timestamp);
+
+private:
+    struct Segment {
+        std::unique_ptr<MappedFile> file;
+        const RecordingHeader *header;
+    };
+
+    bool map_segment(uint32_t segment, std::string &error);
+
+    int64_t timestamp_of(uint64_t n) const;
+
+    std::string basePath;
+    std::vector<Segment> segmentFiles;
+    uint64_t segmentCapacity = 0;
+    int frameWidth = 0;
+    int frameHeight = 0;
+    int decimals = 1;
+    uint32_t version = RECORDING_VERSION;
+};
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "ring.h"
+#include "framepool.h"
+
+#include <chrono>
+#include <cstring>
+#include <new>
+
+namespace pyoptris {
+
+FrameRing::FrameRing(size_t capacity, size_t frameSize)
+    : slots(capacity), frameSize(frameSize), slotStride((frameSize + 63) / 64 * 64),
+      headSequence(0), isClosed(false), waiters(0) {
+    storage = static_cast<unsigned char *>(aligned_allocate(slotStride * capacity));
+    if (storage == nullptr) {
+        throw std::bad_alloc();
+    }
+    for (Slot &slot : slots) {
+        slot.stamp.store(0, std::memory_order_relaxed);
+    }
+}
+
+FrameRing::~FrameRing() {
+    aligned_free(storage);
+}
+
+uint64_t FrameRing::tail() const {
+    uint64_t h = head();
+    return h > slots.size() ? h - slots.size() : 0;
+}
+
+void FrameRing::publish(const void *data, FrameInfo info) {
+    uint64_t sequence = headSequence.load(std::memory_order_relaxed);
+    size_t index = sequence % slots.size();
+    Slot &slot = slots[index];
+
+    info.sequence = sequence;
+    slot.stamp.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(storage + index * slotStride, data, frameSize);
+    slot.info = info;
+    slot.stamp.store(sequence + 1, std::memory_order_release);
+    // Sequentially consistent pair with wait(): either the waiter sees the new head or we see the waiter
+    headSequence.store(sequence + 1);
+
+    if (waiters.load() > 0) {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        published.notify_all();
+    }
+}
+
+FrameRing::ReadResult FrameRing::read(uint64_t sequence, void *data, FrameInfo *info) const {
+    if (sequence >= head()) {
+        return READ_PENDING;
+    }
+    size_t index = sequence % slots.size();
+    const Slot &slot = slots[index];
+
+    if (slot.stamp.load(std::memory_order_acquire) != sequence + 1) {
+        return READ_OVERWRITTEN;
+    }
+    std::memcpy(data, storage + index * slotStride, frameSize);
+    FrameInfo copy = slot.info;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.stamp.load(std::memory_order_relaxed) != sequence + 1) {
+        return READ_OVERWRITTEN;
+    }
+    if (info != nullptr) {
+        *info = copy;
+    }
+    return READ_OK;
+}
+
+bool FrameRing::wait(uint64_t sequence, int64_t timeoutNs) {
+    if (sequence < head()) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(waitMutex);
+    waiters.fetch_add(1);
+    auto ready = [&] { return sequence < headSequence.load() || closed(); };
+    if (timeoutNs < 0) {
+        published.wait(lock, ready);
+    } else {
+        published.wait_for(lock, std::chrono::nanoseconds(timeoutNs), ready);
+    }
+    waiters.fetch_sub(1);
+    return sequence < head();
+}
+
+void FrameRing::close() {
+    std::lock_guard<std::mutex> lock(waitMutex);
+    isClosed.store(true, std::memory_order_release);
+    published.notify_all();
+}
+
+}
@@ -0,0 +1,138 @@
+#ifndef PYOPTRIS_RING_H
+#define PYOPTRIS_RING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace pyoptris {
+
+/**
+ * @brief Shutter flag position, same values as evo::EnumFlagState
+ */
+enum FlagState {
+    FLAG_UNKNOWN = -1,      // not reported by the source
+    FLAG_OPEN = 0,
+    FLAG_CLOSED = 1,
+    FLAG_OPENING = 2,
+    FLAG_CLOSING = 3,
+    FLAG_ERROR = 4
+};
+
+/**
+ * @brief Whether a frame shows the scene, set by the FlagGate of the capture
+ */
+enum FrameValidity {
+    FRAME_VALID = 0,
+    FRAME_FLAG = 1,         // taken while the shutter flag was not open
+    FRAME_SETTLING = 2,     // taken while the detector recovered from a flag cycle
+    FRAME_FROZEN = 3        // repeat of the previous frame of a source without flag state
+};
+
+/**
+ * @brief Bookkeeping that travels with every frame through the ring
+ */
+struct FrameInfo {
+    uint64_t sequence = 0;      // index assigned by the capture thread, starts at 0, gaps never occur
+    int64_t timestamp = 0;      // wall clock time of acquisition in ns since the epoch
+    int64_t fetchNs = 0;        // time the source blocked for this frame in ns
+    int flag = FLAG_UNKNOWN;    // FlagState while the frame was taken
+    float chipTemperature = std::numeric_limits<float>::quiet_NaN();    // degrees Celsius, NaN if not reported
+    int validity = FRAME_VALID; // FrameValidity of the acquired frame
+    bool held = false;          // the pixels are the last valid frame, published in place of an invalid one
+};
+
+/**
+ * @brief Fixed-size single-producer/multi-consumer ring of thermal frames.
+ * The producer never waits on consumers, the oldest frame is overwritten when the ring is full.
+ * Every slot carries a stamp used as a seqlock, so consumers copy frames out without taking a lock
+ * and detect when a slot was overwritten underneath them. The mutex/condition variable pair is only
+ * used to park consumers that wait for a frame that has not been published yet.
+ */
+class FrameRing {
+public:
+    enum ReadResult {
+        READ_OK,            // frame copied out
+        READ_PENDING,       // frame not published yet
+        READ_OVERWRITTEN    // frame was already replaced by a newer one
+    };
+
+    /**
+     * @throws std::bad_alloc if the slots cannot be allocated
+     */
+    FrameRing(size_t capacity, size_t frameSize);
+    ~FrameRing();
+
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    size_t capacity() const { return slots.size(); }
+
+    /**
+     * @brief Size of one frame in bytes
+     */
+    size_t frame_size() const { return frameSize; }
+
+    /**
+     * @brief Number of frames published so far, i.e. the sequence number of the next frame
+     */
+    uint64_t head() const { return headSequence.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Sequence number of the oldest frame that may still be readable
+     */
+    uint64_t tail() const;
+
+    /**
+     * @brief Copies a frame into the next slot and wakes waiting consumers. Producer thread only.
+     * info.sequence is overwritten with the ring sequence number.
+     */
+    void publish(const void *data, FrameInfo info);
+
+    /**
+     * @brief Copies frame sequence out of the ring
+     * @param[out] data destination of frame_size() bytes
+     * @param[out] info metadata of the frame, may be nullptr
+     */
+    ReadResult read(uint64_t sequence, void *data, FrameInfo *info) const;
+
+    /**
+     * @brief Blocks until frame sequence is published, the ring is closed or the timeout expires
+     * @param timeoutNs timeout in ns, negative waits forever
+     * @return true if the frame is published
+     */
+    bool wait(uint64_t sequence, int64_t timeoutNs);
+
+    /**
+     * @brief Marks the end of the stream and releases all waiting consumers
+     */
+    void close();
+
+    bool closed() const { return isClosed.load(std::memory_order_acquire); }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> stamp;    // sequence + 1 of the frame held, 0 while being written
+        FrameInfo info;
+    };
+
+    std::vector<Slot> slots;
+    size_t frameSize;
+    size_t slotStride;
+    unsigned char *storage;
+
+    std::atomic<uint64_t> headSequence;
+    std::atomic<bool> isClosed;
+
+    std::atomic<int> waiters;
+    std::mutex waitMutex;
+    std::condition_variable published;
+};
+
+}
+
+#endif
@@ -0,0 +1,321 @@
+#include "roi.h"
+
+#include "framepool.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace pyoptris {
+
+// Spans are at most a row long, so a span sum fits 32 bit (65535 * 65535 < 2^32)
+PYOPTRIS_ALWAYS_INLINE static void span_body(const uint16_t *raw, size_t n, uint16_t &lo, uint16_t &hi, uint32_t &sum, uint64_t &sumSquares) {
+    uint16_t spanMin = 0xffff, spanMax = 0;
+    uint32_t spanSum = 0;
+    uint64_t spanSquares = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t v = raw[i];
+        spanMin = std::min<uint16_t>(spanMin, (uint16_t) v);
+        spanMax = std::max<uint16_t>(spanMax, (uint16_t) v);
+        spanSum += v;
+        spanSquares += v * v;
+    }
+    lo = spanMin;
+    hi = spanMax;
+    sum = spanSum;
+    sumSquares = spanSquares;
+}
+
+typedef void (*SpanKernel)(const uint16_t *, size_t, uint16_t &, uint16_t &, uint32_t &, uint64_t &);
+
+#ifdef PYOPTRIS_X86
+PYOPTRIS_TARGET("avx2")
+static void span_avx2(const uint16_t *raw, size_t n, uint16_t &lo, uint16_t &hi, uint32_t &sum, uint64_t &sumSquares) {
+    span_body(raw, n, lo, hi, sum, sumSquares);
+}
+#endif
+
+static void span_default(const uint16_t *raw, size_t n, uint16_t &lo, uint16_t &hi, uint32_t &sum, uint64_t &sumSquares) {
+    span_body(raw, n, lo, hi, sum, sumSquares);
+}
+
+static SpanKernel span_kernel() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        return span_avx2;
+    }
+#endif
+    return span_default;
+}
+
+RoiEngine::RoiEngine(int width, int height) : frameWidth(width), frameHeight(height), sorted(true) {
+}
+
+int RoiEngine::add(RoiKind kind) {
+    kinds.push_back(kind);
+    linePixels.emplace_back();
+    accumulators.emplace_back();
+    return (int) kinds.size() - 1;
+}
+
+void RoiEngine::add_span(int roi, int y, int x0, int x1) {
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, frameWidth);
+    if (y < 0 || y >= frameHeight || x0 >= x1) {
+        return;
+    }
+    spans.push_back({ (uint16_t) y, (uint16_t) x0, (uint16_t) (x1 - x0), (uint16_t) roi });
+    sorted = false;
+}
+
+int RoiEngine::add_rect(int x, int y, int width, int height) {
+    int roi = add(ROI_RECT);
+    for (int row = std::max(y, 0); row < std::min(y + height, frameHeight); row++) {
+        add_span(roi, row, x, x + width);
+    }
+    return roi;
+}
+
+int RoiEngine::add_polygon(const float *xy, size_t vertices) {
+    int roi = add(ROI_POLYGON);
+    if (vertices < 3) {
+        return roi;
+    }
+    float top = xy[1], bottom = xy[1];
+    for (size_t i = 1; i < vertices; i++) {
+        top = std::min(top, xy[2 * i + 1]);
+        bottom = std::max(bottom, xy[2 * i + 1]);
+    }
+
+    // Scanline fill through the pixel centres: the crossings of every row centre with the edges,
+    // sorted, pair up into the runs inside the polygon
+    std::vector<float> crossings;
+    int first = std::max(0, (int) std::floor(top));
+    int last = std::min(frameHeight - 1, (int) std::ceil(bottom));
+    for (int y = first; y <= last; y++) {
+        float centre = y + 0.5f;
+        crossings.clear();
+        for (size_t i = 0; i < vertices; i++) {
+            size_t j = (i + 1) % vertices;
+            float xi = xy[2 * i], yi = xy[2 * i + 1];
+            float xj = xy[2 * j], yj = xy[2 * j + 1];
+            if ((yi <= centre && centre < yj) || (yj <= centre && centre < yi)) {
+                crossings.push_back(xi + (centre - yi) / (yj - yi) * (xj - xi));
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+        for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+            // Pixels whose centre x + 0.5 lies in [left, right)
+            int x0 = (int) std::ceil(crossings[i] - 0.5f);
+            int x1 = (int) std::ceil(crossings[i + 1] - 0.5f);
+            add_span(roi, y, x0, x1);
+        }
+    }
+    return roi;
+}
+
+int RoiEngine::add_mask(const uint8_t *mask) {
+    int roi = add(ROI_MASK);
+    for (int y = 0; y < frameHeight; y++) {
+        const uint8_t *row = mask + (size_t) y * frameWidth;
+        int x = 0;
+        while (x < frameWidth) {
+            while (x < frameWidth && row[x] == 0) {
+                x++;
+            }
+            int start = x;
+            while (x < frameWidth && row[x] != 0) {
+                x++;
+            }
+            add_span(roi, y, start, x);
+        }
+    }
+    return roi;
+}
+
+int RoiEngine::add_line(int x0, int y0, int x1, int y1) {
+    int roi = add(ROI_LINE);
+    std::vector<uint32_t> &pixels = linePixels[roi];
+
+    // Bresenham, pixels outside the frame are skipped
+    int dx = std::abs(x1 - x0), dy = -std::abs(y1 - y0);
+    int stepX = x0 < x1 ? 1 : -1, stepY = y0 < y1 ? 1 : -1;
+    int error = dx + dy;
+    int x = x0, y = y0;
+    int runY = -1, runStart = 0, runEnd = 0;
+    for (;;) {
+        if (x >= 0 && x < frameWidth && y >= 0 && y < frameHeight) {
+            pixels.push_back((uint32_t) y * frameWidth + x);
+            // Horizontal runs of the line become one span each
+            if (y == runY && (x == runEnd || x == runStart - 1)) {
+                runStart = std::min(runStart, x);
+                runEnd = std::max(runEnd, x + 1);
+            } else {
+                if (runY >= 0) {
+                    add_span(roi, runY, runStart, runEnd);
+                }
+                runY = y;
+                runStart = x;
+                runEnd = x + 1;
+            }
+        }
+        if (x == x1 && y == y1) {
+            break;
+        }
+        int doubled = 2 * error;
+        if (doubled >= dy) {
+            error += dy;
+            x += stepX;
+        }
+        if (doubled <= dx) {
+            error += dx;
+            y += stepY;
+        }
+    }
+    if (runY >= 0) {
+        add_span(roi, runY, runStart, runEnd);
+    }
+    return roi;
+}
+
+void RoiEngine::clear() {
+    spans.clear();
+    kinds.clear();
+    linePixels.clear();
+    accumulators.clear();
+    sorted = true;
+}
+
+void RoiEngine::compute(const uint16_t *frame, RoiStatistics *out, TemperatureScale scale) {
+    if (!sorted) {
+        std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) {
+            return a.y != b.y ? a.y < b.y : a.x < b.x;
+        });
+        sorted = true;
+    }
+    for (Accumulator &accumulator : accumulators) {
+        accumulator = { 0xffff, 0, 0, 0, 0, 0, 0 };
+    }
+
+    SpanKernel kernel = span_kernel();
+    for (const Span &span : spans) {
+        Accumulator &accumulator = accumulators[span.roi];
+        uint32_t offset = (uint32_t) span.y * frameWidth + span.x;
+        const uint16_t *raw = frame + offset;
+        uint16_t lo, hi;
+        uint32_t sum;
+        uint64_t sumSquares;
+        kernel(raw, span.length, lo, hi, sum, sumSquares);
+        // Spans come in row-major order, so only a strictly better value moves the hot and cold spots
+        if (accumulator.count == 0 || lo < accumulator.min) {
+            accumulator.min = lo;
+            accumulator.minAt = offset + (uint32_t) (std::find(raw, raw + span.length, lo) - raw);
+        }
+        if (accumulator.count == 0 || hi > accumulator.max) {
+            accumulator.max = hi;
+            accumulator.maxAt = offset + (uint32_t) (std::find(raw, raw + span.length, hi) - raw);
+        }
+        accumulator.count += span.length;
+        accumulator.sum += sum;
+        accumulator.sumSquares += sumSquares;
+    }
+
+    for (size_t i = 0; i < accumulators.size(); i++) {
+        const Accumulator &accumulator = accumulators[i];
+        RoiStatistics &stats = out[i];
+        stats.count = accumulator.count;
+        if (accumulator.count == 0) {
+            stats.min = stats.max = stats.mean = stats.stddev = std::numeric_limits<float>::quiet_NaN();
+            stats.minX = stats.minY = stats.maxX = stats.maxY = 0;
+            continue;
+        }
+        double mean = (double) accumulator.sum / accumulator.count;
+        double variance = (double) accumulator.sumSquares / accumulator.count - mean * mean;
+        stats.min = ((float) accumulator.min - scale.rawOffset) * scale.scale;
+        stats.max = ((float) accumulator.max - scale.rawOffset) * scale.scale;
+        stats.mean = (float) ((mean - scale.rawOffset) * scale.scale);
+        stats.stddev = (float) ((variance > 0 ? std::sqrt(variance) : 0.0) * scale.scale);
+        stats.minX = (uint16_t) (accumulator.minAt % frameWidth);
+        stats.minY = (uint16_t) (accumulator.minAt / frameWidth);
+        stats.maxX = (uint16_t) (accumulator.maxAt % frameWidth);
+        stats.maxY = (uint16_t) (accumulator.maxAt / frameWidth);
+    }
+}
+
+void RoiEngine::profile(const uint16_t *frame, size_t roi, uint16_t *out) const {
+    const std::vector<uint32_t> &pixels = linePixels[roi];
+    for (size_t i = 0; i < pixels.size(); i++) {
+        out[i] = frame[pixels[i]];
+    }
+}
+
+RoiMonitor::RoiMonitor(std::shared_ptr<Capture> capture, const RoiEngine &engine, TemperatureScale scale, size_t capacity)
+    : capture(capture), engine(engine), scale(scale),
+      results(capacity, sizeof(RoiResultHeader) + engine.size() * sizeof(RoiStatistics)),
+      isRunning(false), droppedCount(0) {
+}
+
+RoiMonitor::~RoiMonitor() {
+    stop();
+}
+
+bool RoiMonitor::start() {
+    if (engine.width() != capture->width() || engine.height() != capture->height()) {
+        return false;
+    }
+    isRunning.store(true, std::memory_order_release);
+    thread = std::thread(&RoiMonitor::run, this);
+    return true;
+}
+
+void RoiMonitor::run() {
+    Capture::Cursor frames = capture->cursor();
+    uint16_t *frame = static_cast<uint16_t *>(aligned_allocate(capture->frame_size()));
+    std::vector<unsigned char> result(results.frame_size());
+    RoiResultHeader *header = reinterpret_cast<RoiResultHeader *>(result.data());
+    RoiStatistics *stats = reinterpret_cast<RoiStatistics *>(result.data() + sizeof(RoiResultHeader));
+
+    while (isRunning.load(std::memory_order_acquire)) {
+        FrameInfo info;
+        Capture::WaitResult wait = capture->next(frames, frame, &info, CAPTURE_STOP_POLL_NS);
+        if (wait == Capture::WAIT_CLOSED) {
+            break;
+        }
+        if (wait == Capture::WAIT_FRAME) {
+            engine.compute(frame, stats, scale);
+            header->timestamp = info.timestamp;
+            header->sequence = info.sequence;
+            results.publish(result.data(), info);
+            droppedCount.store(frames.dropped, std::memory_order_relaxed);
+        }
+    }
+
+    isRunning.store(false, std::memory_order_release);
+    results.close();
+    aligned_free(frame);
+}
+
+void RoiMonitor::stop() {
+    isRunning.store(false, std::memory_order_release);
+    if (thread.joinable()) {
+        thread.join();
+    }
+    results.close();
+}
+
+Capture::Cursor RoiMonitor::cursor() const {
+    Capture::Cursor cursor = { results.head(), 0 };
+    return cursor;
+}
+
+bool RoiMonitor::latest(void *data) {
+    return Capture::latest_in(results, data, nullptr);
+}
+
+Capture::WaitResult RoiMonitor::next(Capture::Cursor &cursor, void *data, int64_t timeoutNs) {
+    return Capture::next_in(results, cursor, data, nullptr, timeoutNs);
+}
+
+}
@@ -0,0 +1,196 @@
+#ifndef PYOPTRIS_ROI_H
+#define PYOPTRIS_ROI_H
+
+#include "capture.h"
+#include "convert.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace pyoptris {
+
+/**
+ * @brief Statistics of one region of interest in one frame, temperatures in degrees Celsius.
+ * The coordinates are those of the first coldest and the first hottest pixel in row-major order.
+ * A region without pixels in the frame has count 0 and NaN temperatures.
+ */
+struct RoiStatistics {
+    float min;
+    float max;
+    float mean;
+    float stddev;
+    uint32_t count;
+    uint16_t minX;
+    uint16_t minY;
+    uint16_t maxX;
+    uint16_t maxY;
+};
+
+static_assert(sizeof(RoiStatistics) == 28, "RoiStatistics is mirrored by a numpy dtype");
+
+enum RoiKind {
+    ROI_RECT,
+    ROI_POLYGON,
+    ROI_MASK,
+    ROI_LINE
+};
+
+/**
+ * @brief Set of regions evaluated together in one pass over a frame.
+ * Every region is compiled into runs of pixels within a row when it is added. compute() walks the
+ * runs of all regions sorted by row, so regions that overlap read the same cache lines back to back
+ * and the frame is streamed through the cache once.
+ *
+ * Pixel (x, y) covers [x, x + 1) x [y, y + 1), polygons contain the pixels whose centre is inside
+ * (even-odd rule). Regions are clipped to the frame.
+ */
+class RoiEngine {
+public:
+    RoiEngine(int width, int height);
+
+    /**
+     * @return index of the new region
+     */
+    int add_rect(int x, int y, int width, int height);
+
+    /**
+     * @param xy vertices as x0, y0, x1, y1, ...
+     */
+    int add_polygon(const float *xy, size_t vertices);
+
+    /**
+     * @param mask width * height bytes, non-zero pixels belong to the region
+     */
+    int add_mask(const uint8_t *mask);
+
+    /**
+     * @brief Pixels on the line from (x0, y0) to (x1, y1), both ends included
+     */
+    int add_line(int x0, int y0, int x1, int y1);
+
+    void clear();
+
+    size_t size() const { return kinds.size(); }
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    RoiKind kind(size_t roi) const { return kinds[roi]; }
+
+    /**
+     * @brief Statistics of every region, out holds size() entries
+     */
+    void compute(const uint16_t *frame, RoiStatistics *out, TemperatureScale scale);
+
+    /**
+     * @brief Number of pixels along a line region, 0 for other regions
+     */
+    size_t profile_length(size_t roi) const { return linePixels[roi].size(); }
+
+    /**
+     * @brief Raw values along a line region in order from its start, profile_length(roi) values
+     */
+    void profile(const uint16_t *frame, size_t roi, uint16_t *out) const;
+
+private:
+    struct Span {
+        uint16_t y;
+        uint16_t x;
+        uint16_t length;
+        uint16_t roi;
+    };
+
+    struct Accumulator {
+        uint16_t min;
+        uint16_t max;
+        uint32_t minAt;
+        uint32_t maxAt;
+        uint32_t count;
+        uint64_t sum;
+        uint64_t sumSquares;
+    };
+
+    int add(RoiKind kind);
+    void add_span(int roi, int y, int x0, int x1);
+
+    int frameWidth;
+    int frameHeight;
+    std::vector<Span> spans;
+    bool sorted;
+    std::vector<RoiKind> kinds;
+    std::vector<std::vector<uint32_t>> linePixels;   // pixel offsets of line regions
+    std::vector<Accumulator> accumulators;
+};
+
+/**
+ * @brief Result record of a RoiMonitor: the frame it was computed from, followed by one RoiStatistics per region
+ */
+struct RoiResultHeader {
+    int64_t timestamp;      // acquisition time of the frame in ns since the epoch
+    uint64_t sequence;      // capture sequence number of the frame
+};
+
+/**
+ * @brief Evaluates a RoiEngine on every frame of a Capture on a native thread.
+ * Results go into a ring of their own, consumers read them with cursors like frames of a Capture.
+ */
+class RoiMonitor {
+public:
+    /**
+     * @param engine copied, later changes to it do not affect the monitor
+     * @param capacity results kept for consumers that fall behind
+     */
+    RoiMonitor(std::shared_ptr<Capture> capture, const RoiEngine &engine, TemperatureScale scale, size_t capacity);
+    ~RoiMonitor();
+
+    RoiMonitor(const RoiMonitor &) = delete;
+    RoiMonitor &operator=(const RoiMonitor &) = delete;
+
+    /**
+     * @return false if the engine does not match the frame size of the capture
+     */
+    bool start();
+
+    /**
+     * @brief Stops the thread and closes the result ring, waiting consumers are released
+     */
+    void stop();
+
+    bool running() const { return isRunning.load(std::memory_order_acquire); }
+
+    size_t rois() const { return engine.size(); }
+
+    /**
+     * @brief Bytes of one result: RoiResultHeader followed by rois() RoiStatistics
+     */
+    size_t result_size() const { return results.frame_size(); }
+
+    uint64_t frames() const { return results.head(); }
+
+    /**
+     * @brief Capture frames overwritten before the monitor got to them
+     */
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+    Capture::Cursor cursor() const;
+    bool latest(void *data);
+    Capture::WaitResult next(Capture::Cursor &cursor, void *data, int64_t timeoutNs);
+
+private:
+    void run();
+
+    std::shared_ptr<Capture> capture;
+    RoiEngine engine;
+    TemperatureScale scale;
+    FrameRing results;
+
+    std::thread thread;
+    std::atomic<bool> isRunning;
+    std::atomic<uint64_t> droppedCount;
+};
+
+}
+
+#endif
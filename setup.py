@@ -1,4 +1,5 @@
 from setuptools import setup, Extension
+import os
 import platform
 from numpy.distutils.misc_util import get_numpy_include_dirs
 
@@ -8,15 +9,49 @@ if platform.system() == 'Windows':
         optrisLib = "C:\\lib\\irDirectSDK\\sdk\\x64"
     else:
         optrisLib = "C:\\lib\\irDirectSDK\\sdk\\Win32"
+    compileArgs = [ '/std:c++17' ]
+    zlib = 'zlib'
+    linkArgs = []
+    # irDirectSDK only ships the direct binding, Camera objects need the C++ API
+    deviceSources = [ "device_unavailable.cpp" ]
 else:
     optrisInclude = "/usr/local/include"
     optrisLib = "/usr/local/lib"
+    compileArgs = [ '-std=c++17', '-pthread' ]
+    zlib = 'z'
+    linkArgs = [ '-pthread' ]
+    if platform.system() == 'Linux':
+        # shm_open lives in librt before glibc 2.34
+        linkArgs.append('-lrt')
+    deviceSources = [ "irimager_device.cpp" ]
+
+# PYOPTRIS_BACKEND=simulator builds against simulated cameras instead of the SDK, no camera or SDK needed
+backend = os.environ.get('PYOPTRIS_BACKEND', 'sdk')
+if backend == 'simulator':
+    backendSources = [ "simulator/device.cpp", "simulator/direct_binding.cpp", "simulator/simulated_camera.cpp" ]
+    includeDirs = [ "simulator", "." ]
+    libraryDirs = []
+    libraries = [ zlib ]
+elif backend == 'sdk':
+    backendSources = deviceSources
+    includeDirs = [ ".", optrisInclude ]
+    libraryDirs = [ optrisLib ]
+    libraries = [ 'libirimager', zlib ]
+else:
+    raise ValueError("PYOPTRIS_BACKEND must be 'sdk' or 'simulator'")
 
 pyoptris = Extension( "pyoptris",
-    [ "_pyoptris.cpp" ],
-    include_dirs=get_numpy_include_dirs() + [ ".", optrisInclude ],
-    library_dirs=[ optrisLib ],
-    libraries=[ 'libirimager' ],
+    [ "_pyoptris.cpp", "_pyoptris_binning.cpp", "_pyoptris_blobs.cpp", "_pyoptris_camera.cpp", "_pyoptris_capture.cpp", "_pyoptris_codec.cpp", "_pyoptris_convert.cpp",
+      "_pyoptris_correction.cpp", "_pyoptris_export.cpp", "_pyoptris_formats.cpp", "_pyoptris_frame.cpp", "_pyoptris_linescan.cpp", "_pyoptris_palette.cpp",
+      "_pyoptris_recording.cpp", "_pyoptris_roi.cpp", "_pyoptris_shared.cpp", "_pyoptris_spatial.cpp", "_pyoptris_stats.cpp", "_pyoptris_stream.cpp", "_pyoptris_temporal.cpp",
+      "binning.cpp", "blobs.cpp", "capture.cpp", "codec.cpp", "compressed_recording.cpp", "convert.cpp", "exporter.cpp", "formats.cpp", "framepool.cpp", "gate.cpp", "image.cpp",
+      "linescan.cpp", "mapped_file.cpp", "notifier.cpp", "palette.cpp", "radiometry.cpp", "recording.cpp", "roi.cpp", "ring.cpp", "shared_ring.cpp", "simd.cpp", "spatial.cpp",
+      "stats.cpp", "temporal.cpp", "workers.cpp" ] + backendSources,
+    include_dirs=get_numpy_include_dirs() + includeDirs,
+    library_dirs=libraryDirs,
+    libraries=libraries,
+    extra_compile_args=compileArgs,
+    extra_link_args=linkArgs,
     language='c++',
 )
 
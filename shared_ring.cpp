@@ -0,0 +1,530 @@
+#include "shared_ring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#else
+#include <thread>
+#endif
+#endif
+
+namespace pyoptris {
+
+static const char SHARED_MAGIC[8] = { 'P', 'Y', 'O', 'P', 'T', 'S', 'H', 'M' };
+static const uint32_t SHARED_VERSION = 1;
+
+/**
+ * @brief Start of the shared object, followed by capacity SharedSlot and the frames at slotStride
+ */
+struct SharedRingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t width;
+    uint32_t height;
+    uint64_t frameSize;
+    uint64_t slotStride;
+    int32_t temperatureDecimals;
+    int32_t publisherPid;
+    alignas(64) std::atomic<uint64_t> head;     // frames published
+    std::atomic<uint32_t> futexWord;            // bumped after every publish, subscribers sleep on it
+    std::atomic<uint32_t> closed;
+};
+
+struct alignas(64) SharedSlot {
+    std::atomic<uint64_t> stamp;    // sequence + 1 of the frame held, 0 while being written
+    int64_t timestamp;
+};
+
+// The atomics are shared between processes, which only works for lock-free ones
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "64 bit atomics must be lock-free");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "32 bit atomics must be lock-free");
+
+static uint64_t shared_size(size_t capacity, uint64_t slotStride) {
+    return sizeof(SharedRingHeader) + capacity * sizeof(SharedSlot) + capacity * slotStride;
+}
+
+/**
+ * @brief Reads the timestamp of a slot if it holds frame sequence, seqlock style
+ */
+static bool stamped(const SharedSlot &slot, uint64_t sequence, int64_t &timestamp) {
+    if (slot.stamp.load(std::memory_order_acquire) != sequence + 1) {
+        return false;
+    }
+    timestamp = slot.timestamp;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.stamp.load(std::memory_order_relaxed) == sequence + 1;
+}
+
+/**
+ * @brief Whether process pid still exists, a process of another user counts as alive
+ */
+static bool process_alive(int32_t pid) {
+#ifdef _WIN32
+    return true;
+#else
+    return kill((pid_t) pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+static std::string object_name(const std::string &name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+#if defined(__linux__)
+static void futex_wait(const std::atomic<uint32_t> *word, uint32_t expected, int64_t timeoutNs) {
+    timespec timeout;
+    timespec *timeoutPointer = nullptr;
+    if (timeoutNs >= 0) {
+        timeout.tv_sec = (time_t) (timeoutNs / 1000000000);
+        timeout.tv_nsec = (long) (timeoutNs % 1000000000);
+        timeoutPointer = &timeout;
+    }
+    // Not FUTEX_PRIVATE_FLAG, the word lives in memory shared between processes
+    syscall(SYS_futex, reinterpret_cast<const uint32_t *>(word), FUTEX_WAIT, expected, timeoutPointer, nullptr, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t> *word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+#elif !defined(_WIN32)
+// Without futexes subscribers poll at 1 ms
+static void futex_wait(const std::atomic<uint32_t> *, uint32_t, int64_t timeoutNs) {
+    int64_t sleepNs = timeoutNs < 0 ? 1000000 : std::min<int64_t>(timeoutNs, 1000000);
+    std::this_thread::sleep_for(std::chrono::nanoseconds(sleepNs));
+}
+
+static void futex_wake(std::atomic<uint32_t> *) {
+}
+#endif
+
+SharedMemory::SharedMemory() : base(nullptr), length(0), owner(false) {
+}
+
+SharedMemory::~SharedMemory() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool SharedMemory::create(const std::string &, uint64_t, std::string &error) {
+    error = "Shared memory rings need a POSIX system";
+    return false;
+}
+
+bool SharedMemory::open(const std::string &, std::string &error) {
+    error = "Shared memory rings need a POSIX system";
+    return false;
+}
+
+void SharedMemory::close() {
+}
+
+void SharedMemory::unlink(const std::string &) {
+}
+
+#else
+
+/**
+ * @brief Sizes a shared memory object with its pages reserved. tmpfs objects are sparse after ftruncate alone,
+ * so a ring larger than /dev/shm would be accepted and the publisher killed by SIGBUS on its first write to a
+ * page tmpfs cannot back. Falls back to ftruncate where the platform cannot preallocate.
+ * @return 0 on success, an errno value otherwise
+ */
+static int preallocate(int descriptor, uint64_t size) {
+#ifndef __APPLE__
+    int result = posix_fallocate(descriptor, 0, (off_t) size);
+    if (result != EOPNOTSUPP && result != EINVAL) {
+        return result;
+    }
+#endif
+    return ftruncate(descriptor, (off_t) size) == 0 ? 0 : errno;
+}
+
+bool SharedMemory::create(const std::string &name, uint64_t size, std::string &error) {
+    close();
+    objectName = object_name(name);
+    int descriptor = shm_open(objectName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (descriptor < 0) {
+        error = objectName + ": " + std::strerror(errno);
+        return false;
+    }
+    int result = preallocate(descriptor, size);
+    if (result != 0) {
+        error = objectName + ": " + std::strerror(result);
+        ::close(descriptor);
+        shm_unlink(objectName.c_str());
+        return false;
+    }
+    void *mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    ::close(descriptor);
+    if (mapped == MAP_FAILED) {
+        error = objectName + ": " + std::strerror(errno);
+        shm_unlink(objectName.c_str());
+        return false;
+    }
+    base = static_cast<unsigned char *>(mapped);
+    length = size;
+    owner = true;
+    return true;
+}
+
+bool SharedMemory::open(const std::string &name, std::string &error) {
+    close();
+    objectName = object_name(name);
+    int descriptor = shm_open(objectName.c_str(), O_RDONLY, 0);
+    if (descriptor < 0) {
+        error = objectName + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0) {
+        error = objectName + ": " + std::strerror(errno);
+        ::close(descriptor);
+        return false;
+    }
+    void *mapped = status.st_size > 0 ? mmap(nullptr, (size_t) status.st_size, PROT_READ, MAP_SHARED, descriptor, 0) : MAP_FAILED;
+    ::close(descriptor);
+    if (mapped == MAP_FAILED) {
+        error = objectName + ": " + (status.st_size > 0 ? std::strerror(errno) : "empty");
+        return false;
+    }
+    base = static_cast<unsigned char *>(mapped);
+    length = (uint64_t) status.st_size;
+    owner = false;
+    return true;
+}
+
+void SharedMemory::close() {
+    if (base != nullptr) {
+        munmap(base, length);
+        base = nullptr;
+        length = 0;
+    }
+    if (owner) {
+        shm_unlink(objectName.c_str());
+        owner = false;
+    }
+}
+
+void SharedMemory::unlink(const std::string &name) {
+    shm_unlink(object_name(name).c_str());
+}
+
+#endif
+
+SharedPublisher::SharedPublisher(const std::string &name, std::shared_ptr<Capture> capture, size_t capacity, int temperatureDecimals)
+    : ringName(object_name(name)), capture(capture), capacity(std::max<size_t>(capacity, 2)), temperatureDecimals(temperatureDecimals),
+      header(nullptr), slots(nullptr), storage(nullptr), isRunning(false), publishedCount(0), droppedCount(0) {
+}
+
+SharedPublisher::~SharedPublisher() {
+    stop();
+}
+
+/**
+ * @brief Removes a ring left under name by a publisher that stopped without cleaning up, e.g. after a crash
+ * @return false with error set if a live publisher owns name or name is not a ring, true if name is free now
+ */
+static bool remove_stale_ring(const std::string &name, std::string &error) {
+    SharedMemory existing;
+    std::string missing;
+    if (!existing.open(name, missing)) {
+        // Nothing to remove, anything else than a missing name shows up again when the ring is created
+        return true;
+    }
+    const SharedRingHeader *header = reinterpret_cast<const SharedRingHeader *>(existing.data());
+    if (existing.size() < sizeof(SharedRingHeader) || std::memcmp(header->magic, SHARED_MAGIC, sizeof(SHARED_MAGIC)) != 0) {
+        error = name + ": exists and is not a pyoptris ring";
+        return false;
+    }
+    if (header->closed.load(std::memory_order_acquire) == 0 && process_alive(header->publisherPid)) {
+        error = name + ": already published by process " + std::to_string(header->publisherPid);
+        return false;
+    }
+    SharedMemory::unlink(name);
+    return true;
+}
+
+bool SharedPublisher::start(std::string &error) {
+    if (!capture->running()) {
+        error = "Capture is not running";
+        return false;
+    }
+    uint64_t frameSize = capture->frame_size();
+    uint64_t slotStride = (frameSize + 63) / 64 * 64;
+    if (!remove_stale_ring(ringName, error) || !memory.create(ringName, shared_size(capacity, slotStride), error)) {
+        return false;
+    }
+
+    // A fresh object reads as zeros, so every stamp already marks its slot empty
+    header = new (memory.data()) SharedRingHeader();
+    slots = reinterpret_cast<SharedSlot *>(memory.data() + sizeof(SharedRingHeader));
+    storage = memory.data() + sizeof(SharedRingHeader) + capacity * sizeof(SharedSlot);
+    header->version = SHARED_VERSION;
+    header->capacity = (uint32_t) capacity;
+    header->width = (uint32_t) capture->width();
+    header->height = (uint32_t) capture->height();
+    header->frameSize = frameSize;
+    header->slotStride = slotStride;
+    header->temperatureDecimals = temperatureDecimals;
+#ifndef _WIN32
+    header->publisherPid = (int32_t) getpid();
+#endif
+    // Subscribers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, SHARED_MAGIC, sizeof(SHARED_MAGIC));
+
+    isRunning.store(true, std::memory_order_release);
+    thread = std::thread(&SharedPublisher::run, this);
+    return true;
+}
+
+void SharedPublisher::run() {
+    Capture::Cursor cursor = capture->cursor();
+    uint64_t slotStride = header->slotStride;
+
+    while (isRunning.load(std::memory_order_acquire)) {
+        if (!capture->wait_frame(cursor.next, CAPTURE_STOP_POLL_NS)) {
+            if (!capture->running()) {
+                break;
+            }
+            continue;
+        }
+        uint64_t sequence = header->head.load(std::memory_order_relaxed);
+        size_t index = sequence % capacity;
+        SharedSlot &slot = slots[index];
+
+        // The capture copies straight into the shared slot, readers of the old frame see a zero stamp.
+        // wait_frame() made a frame available, next() only misses it if the producer laps the cursor during
+        // the copy, which leaves the slot torn. Then the newer frame is read into the same slot, the slot
+        // only stays empty if the capture ends in between.
+        slot.stamp.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        FrameInfo info;
+        Capture::WaitResult wait;
+        do {
+            wait = capture->next(cursor, storage + index * slotStride, &info, CAPTURE_STOP_POLL_NS);
+        } while (wait == Capture::WAIT_TIMEOUT && isRunning.load(std::memory_order_acquire));
+        if (wait != Capture::WAIT_FRAME) {
+            continue;
+        }
+        slot.timestamp = info.timestamp;
+        slot.stamp.store(sequence + 1, std::memory_order_release);
+        // Sequentially consistent pair with SharedSubscriber::wait(), see FrameRing::publish()
+        header->head.store(sequence + 1);
+        header->futexWord.fetch_add(1);
+        futex_wake(&header->futexWord);
+        publishedCount.store(sequence + 1, std::memory_order_relaxed);
+        droppedCount.store(cursor.dropped, std::memory_order_relaxed);
+    }
+
+    isRunning.store(false, std::memory_order_release);
+}
+
+void SharedPublisher::stop() {
+    isRunning.store(false, std::memory_order_release);
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (header != nullptr) {
+        header->closed.store(1);
+        header->futexWord.fetch_add(1);
+        futex_wake(&header->futexWord);
+        header = nullptr;
+        slots = nullptr;
+        storage = nullptr;
+    }
+    memory.close();
+}
+
+SharedSubscriber::SharedSubscriber() : header(nullptr), slots(nullptr), storage(nullptr) {
+}
+
+SharedSubscriber::~SharedSubscriber() {
+}
+
+bool SharedSubscriber::open(const std::string &name, std::string &error) {
+    if (!memory.open(name, error)) {
+        return false;
+    }
+    const SharedRingHeader *mapped = reinterpret_cast<const SharedRingHeader *>(memory.data());
+    if (memory.size() < sizeof(SharedRingHeader) || std::memcmp(mapped->magic, SHARED_MAGIC, sizeof(SHARED_MAGIC)) != 0) {
+        error = name + ": not a pyoptris frame ring or not initialized yet";
+        memory.close();
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (mapped->version != SHARED_VERSION) {
+        error = name + ": unsupported version " + std::to_string(mapped->version);
+        memory.close();
+        return false;
+    }
+    if (mapped->capacity < 2 || mapped->frameSize != (uint64_t) mapped->width * mapped->height * sizeof(uint16_t)
+            || mapped->slotStride < mapped->frameSize || memory.size() < shared_size(mapped->capacity, mapped->slotStride)) {
+        error = name + ": truncated or malformed frame ring";
+        memory.close();
+        return false;
+    }
+    header = mapped;
+    slots = reinterpret_cast<const SharedSlot *>(memory.data() + sizeof(SharedRingHeader));
+    storage = memory.data() + sizeof(SharedRingHeader) + mapped->capacity * sizeof(SharedSlot);
+    return true;
+}
+
+int SharedSubscriber::width() const {
+    return (int) header->width;
+}
+
+int SharedSubscriber::height() const {
+    return (int) header->height;
+}
+
+size_t SharedSubscriber::capacity() const {
+    return header->capacity;
+}
+
+size_t SharedSubscriber::frame_size() const {
+    return (size_t) header->frameSize;
+}
+
+int SharedSubscriber::temperature_decimals() const {
+    return header->temperatureDecimals;
+}
+
+uint64_t SharedSubscriber::head() const {
+    return header->head.load(std::memory_order_acquire);
+}
+
+bool SharedSubscriber::publisher_alive() const {
+    return process_alive(header->publisherPid);
+}
+
+bool SharedSubscriber::closed() const {
+    return header->closed.load(std::memory_order_acquire) != 0 || !publisher_alive();
+}
+
+Capture::Cursor SharedSubscriber::cursor() const {
+    Capture::Cursor cursor = { head(), 0 };
+    return cursor;
+}
+
+bool SharedSubscriber::valid(uint64_t sequence) const {
+    return slots[sequence % header->capacity].stamp.load(std::memory_order_acquire) == sequence + 1;
+}
+
+bool SharedSubscriber::wait(uint64_t sequence, int64_t timeoutNs) const {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point deadline = Clock::now() + std::chrono::nanoseconds(std::max<int64_t>(timeoutNs, 0));
+    for (;;) {
+        if (sequence < head()) {
+            return true;
+        }
+        if (header->closed.load(std::memory_order_acquire) != 0) {
+            return false;
+        }
+        uint32_t word = header->futexWord.load();
+        if (sequence < head()) {
+            return true;
+        }
+        int64_t remaining = -1;
+        if (timeoutNs >= 0) {
+            remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+            if (remaining <= 0) {
+                return false;
+            }
+        }
+        futex_wait(&header->futexWord, word, remaining);
+    }
+}
+
+Capture::WaitResult SharedSubscriber::next(Capture::Cursor &cursor, const uint16_t **frame, FrameInfo *info, int64_t timeoutNs) {
+    uint64_t capacity = header->capacity;
+    for (;;) {
+        uint64_t published = head();
+        uint64_t tail = published > capacity ? published - capacity : 0;
+        if (cursor.next < tail) {
+            cursor.dropped += tail - cursor.next;
+            cursor.next = tail;
+        }
+        if (cursor.next < published) {
+            const SharedSlot &slot = slots[cursor.next % capacity];
+            int64_t timestamp;
+            if (stamped(slot, cursor.next, timestamp)) {
+                *frame = reinterpret_cast<const uint16_t *>(storage + (cursor.next % capacity) * header->slotStride);
+                if (info != nullptr) {
+                    info->sequence = cursor.next;
+                    info->timestamp = timestamp;
+                }
+                cursor.next++;
+                return Capture::WAIT_FRAME;
+            }
+            // The publisher is lapping this slot, the frame is gone
+            cursor.dropped++;
+            cursor.next++;
+            continue;
+        }
+        if (closed()) {
+            return Capture::WAIT_CLOSED;
+        }
+        if (!wait(cursor.next, timeoutNs)) {
+            return closed() ? Capture::WAIT_CLOSED : Capture::WAIT_TIMEOUT;
+        }
+    }
+}
+
+bool SharedSubscriber::latest(const uint16_t **frame, FrameInfo *info) const {
+    for (;;) {
+        uint64_t published = head();
+        if (published == 0) {
+            return false;
+        }
+        uint64_t sequence = published - 1;
+        const SharedSlot &slot = slots[sequence % header->capacity];
+        int64_t timestamp;
+        if (stamped(slot, sequence, timestamp)) {
+            *frame = reinterpret_cast<const uint16_t *>(storage + (sequence % header->capacity) * header->slotStride);
+            if (info != nullptr) {
+                info->sequence = sequence;
+                info->timestamp = timestamp;
+            }
+            return true;
+        }
+    }
+}
+
+FrameRing::ReadResult SharedSubscriber::read(uint64_t sequence, void *data, FrameInfo *info) const {
+    if (sequence >= head()) {
+        return FrameRing::READ_PENDING;
+    }
+    const SharedSlot &slot = slots[sequence % header->capacity];
+    if (slot.stamp.load(std::memory_order_acquire) != sequence + 1) {
+        return FrameRing::READ_OVERWRITTEN;
+    }
+    std::memcpy(data, storage + (sequence % header->capacity) * header->slotStride, (size_t) header->frameSize);
+    int64_t timestamp = slot.timestamp;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.stamp.load(std::memory_order_relaxed) != sequence + 1) {
+        return FrameRing::READ_OVERWRITTEN;
+    }
+    if (info != nullptr) {
+        info->sequence = sequence;
+        info->timestamp = timestamp;
+    }
+    return FrameRing::READ_OK;
+}
+
+}
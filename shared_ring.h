@@ -0,0 +1,186 @@
+#ifndef PYOPTRIS_SHARED_RING_H
+#define PYOPTRIS_SHARED_RING_H
+
+#include "capture.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace pyoptris {
+
+struct SharedRingHeader;
+struct SharedSlot;
+
+/**
+ * @brief A POSIX shared memory object mapped as a whole
+ */
+class SharedMemory {
+public:
+    SharedMemory();
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory &) = delete;
+    SharedMemory &operator=(const SharedMemory &) = delete;
+
+    /**
+     * @brief Creates the object name of size bytes and maps it writable, fails if name exists
+     * @param[out] error description of the failure
+     */
+    bool create(const std::string &name, uint64_t size, std::string &error);
+
+    /**
+     * @brief Maps an existing object read-only
+     */
+    bool open(const std::string &name, std::string &error);
+
+    /**
+     * @brief Unmaps the object, the creator also removes the name
+     */
+    void close();
+
+    /**
+     * @brief Removes the name of an object this process did not create, mappings of it stay valid
+     */
+    static void unlink(const std::string &name);
+
+    unsigned char *data() const { return base; }
+    uint64_t size() const { return length; }
+
+private:
+    std::string objectName;
+    unsigned char *base;
+    uint64_t length;
+    bool owner;
+};
+
+/**
+ * @brief Publishes the frames of a capture into a ring in POSIX shared memory, for any number of
+ * SharedSubscriber in other processes. The layout follows FrameRing: every slot carries a stamp used
+ * as a seqlock, the publisher never waits on subscribers and overwrites the oldest frame. Waiting
+ * subscribers are woken through a futex in the shared header.
+ */
+class SharedPublisher {
+public:
+    SharedPublisher(const std::string &name, std::shared_ptr<Capture> capture, size_t capacity, int temperatureDecimals);
+    ~SharedPublisher();
+
+    SharedPublisher(const SharedPublisher &) = delete;
+    SharedPublisher &operator=(const SharedPublisher &) = delete;
+
+    /**
+     * @param[out] error description of the failure
+     */
+    bool start(std::string &error);
+
+    /**
+     * @brief Stops the thread, marks the ring closed and removes its name.
+     * Subscribers that mapped it keep what they hold.
+     */
+    void stop();
+
+    bool running() const { return isRunning.load(std::memory_order_acquire); }
+
+    const std::string &name() const { return ringName; }
+
+    uint64_t frames() const { return publishedCount.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Capture frames overwritten before the publisher got to them
+     */
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    std::string ringName;
+    std::shared_ptr<Capture> capture;
+    size_t capacity;
+    int temperatureDecimals;
+    SharedMemory memory;
+    SharedRingHeader *header;
+    SharedSlot *slots;
+    unsigned char *storage;
+
+    std::thread thread;
+    std::atomic<bool> isRunning;
+    std::atomic<uint64_t> publishedCount;
+    std::atomic<uint64_t> droppedCount;
+};
+
+/**
+ * @brief Reads the ring of a SharedPublisher in another process. Frames are handed out as pointers
+ * into the shared mapping, valid(sequence) tells whether the publisher has overwritten one since.
+ */
+class SharedSubscriber {
+public:
+    SharedSubscriber();
+    ~SharedSubscriber();
+
+    SharedSubscriber(const SharedSubscriber &) = delete;
+    SharedSubscriber &operator=(const SharedSubscriber &) = delete;
+
+    /**
+     * @param[out] error description of a missing or malformed ring
+     */
+    bool open(const std::string &name, std::string &error);
+
+    int width() const;
+    int height() const;
+    size_t capacity() const;
+    size_t frame_size() const;
+    int temperature_decimals() const;
+
+    /**
+     * @brief Frames published so far
+     */
+    uint64_t head() const;
+
+    /**
+     * @brief true once the publisher stopped or its process is gone
+     */
+    bool closed() const;
+
+    /**
+     * @brief Creates a cursor positioned at the next frame to be published
+     */
+    Capture::Cursor cursor() const;
+
+    /**
+     * @brief true while frame sequence is still held by its slot
+     */
+    bool valid(uint64_t sequence) const;
+
+    /**
+     * @brief Hands out the frame at the cursor in place and advances it, skipping frames that were overwritten
+     * @param[out] frame points into the mapping, see valid()
+     * @param timeoutNs maximum time to wait for a frame in ns, negative waits forever
+     */
+    Capture::WaitResult next(Capture::Cursor &cursor, const uint16_t **frame, FrameInfo *info, int64_t timeoutNs);
+
+    /**
+     * @brief Most recent frame in place
+     * @return false if nothing has been published yet
+     */
+    bool latest(const uint16_t **frame, FrameInfo *info) const;
+
+    /**
+     * @brief Copies frame sequence out of the ring, checked against concurrent overwrites
+     */
+    FrameRing::ReadResult read(uint64_t sequence, void *data, FrameInfo *info) const;
+
+private:
+    bool wait(uint64_t sequence, int64_t timeoutNs) const;
+    bool publisher_alive() const;
+
+    SharedMemory memory;
+    const SharedRingHeader *header;
+    const SharedSlot *slots;
+    const unsigned char *storage;
+};
+
+}
+
+#endif
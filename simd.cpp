@@ -0,0 +1,60 @@
+#include "simd.h"
+
+#if defined(PYOPTRIS_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace pyoptris {
+
+#if defined(PYOPTRIS_X86) && defined(_MSC_VER)
+
+static bool os_saves_ymm() {
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    return osxsave && (_xgetbv(0) & 6) == 6;
+}
+
+bool cpu_has_avx2() {
+    static const bool supported = [] {
+        int info[4];
+        __cpuidex(info, 7, 0);
+        return os_saves_ymm() && (info[1] & (1 << 5)) != 0;
+    }();
+    return supported;
+}
+
+bool cpu_has_f16c() {
+    static const bool supported = [] {
+        int info[4];
+        __cpuid(info, 1);
+        return os_saves_ymm() && (info[2] & (1 << 29)) != 0;
+    }();
+    return supported;
+}
+
+#elif defined(PYOPTRIS_X86)
+
+bool cpu_has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+bool cpu_has_f16c() {
+    static const bool supported = __builtin_cpu_supports("f16c");
+    return supported;
+}
+
+#else
+
+bool cpu_has_avx2() {
+    return false;
+}
+
+bool cpu_has_f16c() {
+    return false;
+}
+
+#endif
+
+}
@@ -0,0 +1,42 @@
+#ifndef PYOPTRIS_SIMD_H
+#define PYOPTRIS_SIMD_H
+
+/*
+ * Instruction set plumbing shared by the native kernels.
+ * SSE2/NEON paths are selected at compile time, AVX2 and F16C are compiled with per-function target
+ * attributes and picked at run time, so the extension still loads on older CPUs.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PYOPTRIS_X86 1
+#include <immintrin.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PYOPTRIS_SSE2 1
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define PYOPTRIS_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(PYOPTRIS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PYOPTRIS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PYOPTRIS_TARGET(isa)
+#endif
+
+// Kernel bodies marked always inline are instantiated once per target and dispatched at run time
+#if defined(_MSC_VER)
+#define PYOPTRIS_ALWAYS_INLINE __forceinline
+#else
+#define PYOPTRIS_ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace pyoptris {
+
+bool cpu_has_avx2();
+
+bool cpu_has_f16c();
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "device.h"
+#include "simulated_camera.h"
+
+#include <atomic>
+
+namespace pyoptris {
+
+/**
+ * @brief Camera objects on the simulator, every device is an independent SimulatedCamera
+ */
+class SimulatedDevice : public Device {
+public:
+    explicit SimulatedDevice(const simulator::Settings &settings) : camera(settings), closed(false) {
+    }
+
+    std::string serial() override {
+        return std::to_string(camera.serial());
+    }
+
+    int thermal_size(int &width, int &height) override {
+        width = camera.width();
+        height = camera.height();
+        return 0;
+    }
+
+    int fetch_thermal(uint16_t *data, int width, int height, FrameInfo &info) override {
+        if (closed || width != camera.width() || height != camera.height()) {
+            return -1;
+        }
+        simulator::FrameState state;
+        camera.fetch_thermal(data, state);
+        info.timestamp = state.timestamp;
+        info.flag = state.flag;
+        info.chipTemperature = state.chipTemperature;
+        return 0;
+    }
+
+    int set_temperature_range(int minimum, int maximum) override {
+        if (minimum >= maximum) {
+            return -1;
+        }
+        camera.set_temperature_range(minimum, maximum);
+        return 0;
+    }
+
+    int set_radiation_parameters(float emissivity, float transmissivity, float ambientTemperature) override {
+        if (emissivity <= 0 || emissivity > 1 || transmissivity <= 0 || transmissivity > 1) {
+            return -1;
+        }
+        camera.set_radiation_parameters(emissivity, transmissivity, ambientTemperature);
+        return 0;
+    }
+
+    int set_shutter_mode(int mode) override {
+        camera.set_shutter_mode(mode);
+        return 0;
+    }
+
+    int trigger_shutter_flag() override {
+        camera.trigger_shutter_flag();
+        return 0;
+    }
+
+    int set_focus_motor_position(float position) override {
+        camera.set_focus_motor_position(position);
+        return 0;
+    }
+
+    int get_focus_motor_position(float &position) override {
+        position = camera.focus_motor_position();
+        return 0;
+    }
+
+    void close() override {
+        closed = true;
+    }
+
+private:
+    simulator::SimulatedCamera camera;
+    std::atomic<bool> closed;
+};
+
+std::shared_ptr<Device> open_device(const char *xmlConfig, const char *, const char *,
+                                    unsigned long serial, std::string &error) {
+    simulator::Settings settings;
+    if (!simulator::read_settings(xmlConfig, settings, error)) {
+        return nullptr;
+    }
+    if (serial != 0) {
+        settings.serial = serial;
+    }
+    return std::make_shared<SimulatedDevice>(settings);
+}
+
+}
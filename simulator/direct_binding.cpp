@@ -0,0 +1,223 @@
+#include "direct_binding.h"
+#include "simulated_camera.h"
+
+#include "palette.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using pyoptris::simulator::FrameState;
+using pyoptris::simulator::Settings;
+using pyoptris::simulator::SimulatedCamera;
+
+// The direct binding drives a single camera, like the SDK it is created by usb_init/tcp_init
+static std::mutex cameraMutex;
+static std::shared_ptr<SimulatedCamera> camera;
+static int paletteId = pyoptris::PALETTE_IRON;
+static int paletteScaling = pyoptris::SCALING_MIN_MAX;
+
+static std::shared_ptr<SimulatedCamera> current_camera() {
+    std::lock_guard<std::mutex> lock(cameraMutex);
+    return camera;
+}
+
+static int open_camera(const Settings &settings) {
+    std::lock_guard<std::mutex> lock(cameraMutex);
+    if (camera != nullptr) {
+        return -1;
+    }
+    camera = std::make_shared<SimulatedCamera>(settings);
+    return 0;
+}
+
+static void render(const std::shared_ptr<SimulatedCamera> &source, const unsigned short *thermal, unsigned char *rgb) {
+    int id, scaling;
+    {
+        std::lock_guard<std::mutex> lock(cameraMutex);
+        id = paletteId;
+        scaling = paletteScaling;
+    }
+    size_t n = (size_t) source->width() * source->height();
+    pyoptris::FrameStatistics stats = pyoptris::frame_statistics(thermal, n);
+    // Manual scaling spans the fixed raw range of -20..100 degrees Celsius, the default range of the PI cameras
+    pyoptris::PaletteRange manual = { 800, 2000 };
+    pyoptris::PaletteRange range = pyoptris::palette_range((pyoptris::PaletteScaling) scaling, stats, manual);
+    pyoptris::render_palette(thermal, rgb, n, pyoptris::palette_lut(id), range);
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_usb_init(const char* xml_config, const char*, const char*) {
+    Settings settings;
+    std::string error;
+    if (xml_config == nullptr || !pyoptris::simulator::read_settings(xml_config, settings, error)) {
+        return -1;
+    }
+    return open_camera(settings);
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_tcp_init(const char*, int) {
+    // Stands in for a daemon streaming the first simulated format with default settings
+    return open_camera(Settings());
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_terminate() {
+    std::lock_guard<std::mutex> lock(cameraMutex);
+    camera = nullptr;
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_get_thermal_image_size(int* w, int* h) {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr) {
+        return -1;
+    }
+    *w = source->width();
+    *h = source->height();
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_get_palette_image_size(int* w, int* h) {
+    return evo_irimager_get_thermal_image_size(w, h);
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_get_thermal_image(int* w, int* h, unsigned short* data) {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr || *w != source->width() || *h != source->height()) {
+        return -1;
+    }
+    FrameState state;
+    source->fetch_thermal(data, state);
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_get_thermal_image_metadata(int* w, int* h, unsigned short* data, struct EvoIRFrameMetadata* metadata) {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr || *w != source->width() || *h != source->height()) {
+        return -1;
+    }
+    FrameState state;
+    source->fetch_thermal(data, state);
+    metadata->counter = (unsigned int) state.frame;
+    metadata->counterHW = (unsigned int) state.frame;
+    metadata->timestamp = state.timestamp;
+    metadata->timestampMedia = metadata->timestamp;
+    metadata->flagState = (EvoIRFlagState) state.flag;
+    metadata->tempChip = state.chipTemperature;
+    metadata->tempFlag = state.chipTemperature;
+    metadata->tempBox = state.chipTemperature - 5.0f;
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_get_palette_image(int* w, int* h, unsigned char* data) {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr || *w != source->width() || *h != source->height()) {
+        return -1;
+    }
+    std::vector<unsigned short> thermal((size_t) source->width() * source->height());
+    FrameState state;
+    source->fetch_thermal(thermal.data(), state);
+    render(source, thermal.data(), data);
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_get_thermal_palette_image(int w_t, int h_t, unsigned short* data_t, int w_p, int h_p, unsigned char* data_p ) {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr || w_t != source->width() || h_t != source->height() || w_p != w_t || h_p != h_t) {
+        return -1;
+    }
+    FrameState state;
+    source->fetch_thermal(data_t, state);
+    render(source, data_t, data_p);
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_to_palette_save_png(unsigned short*, int, int, const char*, int, int) {
+    // The simulator has no image encoder
+    return -1;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_set_palette(int id) {
+    if (pyoptris::palette_lut(id) == nullptr) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(cameraMutex);
+    paletteId = id;
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_set_palette_scale(int scale) {
+    if (scale < pyoptris::SCALING_MANUAL || scale > pyoptris::SCALING_SIGMA3) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(cameraMutex);
+    paletteScaling = scale;
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_set_shutter_mode(int mode) {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr) {
+        return -1;
+    }
+    source->set_shutter_mode(mode);
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_trigger_shutter_flag() {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr) {
+        return -1;
+    }
+    source->trigger_shutter_flag();
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_set_temperature_range(int t_min, int t_max) {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr || t_min >= t_max) {
+        return -1;
+    }
+    source->set_temperature_range(t_min, t_max);
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_set_radiation_parameters(float emissivity, float transmissivity, float tAmbient) {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr || emissivity <= 0 || emissivity > 1 || transmissivity <= 0 || transmissivity > 1) {
+        return -1;
+    }
+    source->set_radiation_parameters(emissivity, transmissivity, tAmbient);
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_set_focusmotor_pos(float pos) {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr) {
+        return -1;
+    }
+    source->set_focus_motor_position(pos);
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_get_focusmotor_pos(float *posOut) {
+    std::shared_ptr<SimulatedCamera> source = current_camera();
+    if (source == nullptr) {
+        return -1;
+    }
+    *posOut = source->focus_motor_position();
+    return 0;
+}
+
+// There is no separate daemon process, tcp_init always finds the simulated one
+
+__IRDIRECTSDK_API__ int evo_irimager_daemon_launch() {
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_daemon_is_running() {
+    return 0;
+}
+
+__IRDIRECTSDK_API__ int evo_irimager_daemon_kill() {
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef PYOPTRIS_SIMULATOR_DIRECT_BINDING_H
+#define PYOPTRIS_SIMULATOR_DIRECT_BINDING_H
+
+/*
+ * The evo_irimager_* surface of the SDK's direct_binding.h, implemented by simulator/direct_binding.cpp.
+ * setup.py puts this directory in front of the SDK include path when PYOPTRIS_BACKEND=simulator.
+ */
+
+#ifdef __cplusplus
+#define __IRDIRECTSDK_API__ extern "C"
+#else
+#define __IRDIRECTSDK_API__
+#endif
+
+__IRDIRECTSDK_API__ int evo_irimager_usb_init(const char* xml_config, const char* formats_def, const char* log_file);
+
+__IRDIRECTSDK_API__ int evo_irimager_tcp_init(const char* ip, int port);
+
+__IRDIRECTSDK_API__ int evo_irimager_terminate();
+
+__IRDIRECTSDK_API__ int evo_irimager_get_thermal_image_size(int* w, int* h);
+
+__IRDIRECTSDK_API__ int evo_irimager_get_palette_image_size(int* w, int* h);
+
+__IRDIRECTSDK_API__ int evo_irimager_get_thermal_image(int* w, int* h, unsigned short* data);
+
+enum EvoIRFlagState { irFlagOpen, irFlagClose, irFlagOpening, irFlagClosing, irFlagError };
+
+struct EvoIRFrameMetadata {
+    unsigned int counter;
+    unsigned int counterHW;
+    long long timestamp;
+    long long timestampMedia;
+    enum EvoIRFlagState flagState;
+    float tempChip;
+    float tempFlag;
+    float tempBox;
+};
+
+__IRDIRECTSDK_API__ int evo_irimager_get_thermal_image_metadata(int* w, int* h, unsigned short* data, struct EvoIRFrameMetadata* metadata);
+
+__IRDIRECTSDK_API__ int evo_irimager_get_palette_image(int* w, int* h, unsigned char* data);
+
+__IRDIRECTSDK_API__ int evo_irimager_get_thermal_palette_image(int w_t, int h_t, unsigned short* data_t, int w_p, int h_p, unsigned char* data_p );
+
+__IRDIRECTSDK_API__ int evo_irimager_to_palette_save_png(unsigned short* thermal_data, int w, int h, const char* path, int palette, int palette_scale);
+
+__IRDIRECTSDK_API__ int evo_irimager_set_palette(int id);
+
+__IRDIRECTSDK_API__ int evo_irimager_set_palette_scale(int scale);
+
+__IRDIRECTSDK_API__ int evo_irimager_set_shutter_mode(int mode);
+
+__IRDIRECTSDK_API__ int evo_irimager_trigger_shutter_flag();
+
+__IRDIRECTSDK_API__ int evo_irimager_set_temperature_range(int t_min, int t_max);
+
+__IRDIRECTSDK_API__ int evo_irimager_set_radiation_parameters(float emissivity, float transmissivity, float tAmbient);
+
+__IRDIRECTSDK_API__ int evo_irimager_set_focusmotor_pos(float pos);
+
+__IRDIRECTSDK_API__ int evo_irimager_get_focusmotor_pos(float *posOut);
+
+__IRDIRECTSDK_API__ int evo_irimager_daemon_launch();
+
+__IRDIRECTSDK_API__ int evo_irimager_daemon_is_running();
+
+__IRDIRECTSDK_API__ int evo_irimager_daemon_kill();
+
+#endif
@@ -0,0 +1,340 @@
+#include "simulated_camera.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace pyoptris {
+namespace simulator {
+
+static const Format FORMATS[] = {
+    { "PI160 160x120 @ 120Hz", 160, 120, 120 },
+    { "PI400 382x288 @ 80Hz", 382, 288, 80 },
+    { "PI1M 766x480 @ 32Hz", 764, 480, 32 },
+    { "PI1M 72x56 @ 1000Hz", 72, 56, 1000 },
+    { "PI1M 764x8 @ 1000Hz flex", 764, 8, 1000 },
+};
+
+const Format *formats(size_t &count) {
+    count = sizeof(FORMATS) / sizeof(FORMATS[0]);
+    return FORMATS;
+}
+
+// A flag cycle as the PI cameras run it: the shutter swings in, the offsets are calibrated against it, it swings out
+static const int64_t FLAG_CLOSING_NS = 60000000;
+static const int64_t FLAG_CLOSED_NS = 180000000;
+static const int64_t FLAG_OPENING_NS = 60000000;
+
+static const float SHUTTER_TEMPERATURE = 34.0f;
+static const float NOISE_AMPLITUDE = 0.08f;     // about 80 mK NETD
+static const float DRIFT_PER_SECOND = 0.02f;    // offset drift between two flag cycles
+static const float RAW_OFFSET = 100.0f;
+static const float RAW_SCALE = 10.0f;
+static const int REPLAY_FRAMES = 8;
+
+static int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t system_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Content of the first <tag> element outside of comments, empty if there is none
+static std::string xml_value(const std::string &xml, const std::string &tag) {
+    std::string open = "<" + tag + ">";
+    size_t begin = xml.find(open);
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    begin += open.size();
+    size_t end = xml.find("</" + tag + ">", begin);
+    if (end == std::string::npos) {
+        return std::string();
+    }
+    return xml.substr(begin, end - begin);
+}
+
+static std::string strip_comments(const std::string &xml) {
+    std::string result;
+    size_t position = 0;
+    for (;;) {
+        size_t begin = xml.find("<!--", position);
+        result += xml.substr(position, begin == std::string::npos ? std::string::npos : begin - position);
+        if (begin == std::string::npos) {
+            return result;
+        }
+        size_t end = xml.find("-->", begin);
+        if (end == std::string::npos) {
+            return result;
+        }
+        position = end + 3;
+    }
+}
+
+bool read_settings(const char *xmlConfig, Settings &settings, std::string &error) {
+    std::ifstream file(xmlConfig);
+    if (!file) {
+        error = "Cannot read xml config";
+        return false;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string xml = strip_comments(content.str());
+
+    std::string value;
+    if (!(value = xml_value(xml, "serial")).empty()) {
+        settings.serial = std::strtoul(value.c_str(), nullptr, 10);
+    }
+    if (!(value = xml_value(xml, "videoformatindex")).empty()) {
+        settings.formatIndex = std::atoi(value.c_str());
+    }
+    if (!(value = xml_value(xml, "framerate")).empty()) {
+        settings.framerate = std::atof(value.c_str());
+    }
+    if (!(value = xml_value(xml, "pacing")).empty()) {
+        settings.paced = std::atoi(value.c_str()) != 0;
+    }
+    if (!(value = xml_value(xml, "focus")).empty()) {
+        settings.focus = (float) std::atof(value.c_str());
+    }
+    std::string autoflag = xml_value(xml, "autoflag");
+    if (!(value = xml_value(autoflag, "enable")).empty()) {
+        settings.autoFlag = std::atoi(value.c_str()) != 0;
+    }
+    if (!(value = xml_value(autoflag, "mininterval")).empty()) {
+        settings.flagMinInterval = std::atof(value.c_str());
+    }
+    std::string temperature = xml_value(xml, "temperature");
+    if (!(value = xml_value(temperature, "min")).empty()) {
+        settings.temperatureMin = std::atoi(value.c_str());
+    }
+    if (!(value = xml_value(temperature, "max")).empty()) {
+        settings.temperatureMax = std::atoi(value.c_str());
+    }
+
+    size_t count;
+    formats(count);
+    if (settings.formatIndex < 0 || (size_t) settings.formatIndex >= count) {
+        error = "Unknown videoformatindex";
+        return false;
+    }
+    return true;
+}
+
+static uint32_t xorshift(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Uniform in [-1, 1)
+static float noise(uint32_t &state) {
+    return (float) (int32_t) xorshift(state) * (1.0f / 2147483648.0f);
+}
+
+/**
+ * Warm objects moving on Lissajous paths, positions and radii relative to the frame size so every
+ * format, line scan included, sees them
+ */
+struct Blob {
+    float temperature;
+    float radius;
+    float speedX, speedY, phase;
+};
+
+static const Blob BLOBS[] = {
+    { 14.0f, 0.18f, 0.31f, 0.23f, 0.0f },   // a person at arm's length
+    { 55.0f, 0.07f, 0.53f, 0.71f, 1.3f },   // something hot and small
+    { -6.0f, 0.12f, 0.17f, 0.41f, 2.9f },   // a cold drink
+};
+
+SimulatedCamera::SimulatedCamera(const Settings &settings)
+    : serialNumber(settings.serial), paced(settings.paced), start(0), frameCounter(0), flagStart(-1),
+      noiseState(2463534242u ^ (uint32_t) settings.serial), flagRequested(false), gain(1.0f), ambient(22.0f) {
+    size_t count;
+    format = formats(count)[settings.formatIndex];
+    double rate = settings.framerate > 0 && settings.framerate < format.rate ? settings.framerate : format.rate;
+    periodNs = (int64_t) (1e9 / rate);
+    autoFlag = settings.autoFlag;
+    flagIntervalNs = (int64_t) (std::max(settings.flagMinInterval, 1.0) * 1e9);
+    focus = settings.focus;
+    temperatureMin = (float) settings.temperatureMin;
+    temperatureMax = (float) settings.temperatureMax;
+
+    // Room temperature with a vertical gradient, a warm corner and the fixed pattern noise of the detector
+    background.resize((size_t) format.width * format.height);
+    uint32_t pattern = 88172645u ^ (uint32_t) (settings.serial * 2654435761u);
+    for (int y = 0; y < format.height; y++) {
+        for (int x = 0; x < format.width; x++) {
+            float fy = (float) y / std::max(format.height - 1, 1);
+            float fx = (float) x / std::max(format.width - 1, 1);
+            float corner = std::max(0.0f, 1.0f - std::sqrt(fx * fx + fy * fy) * 2.0f);
+            background[(size_t) y * format.width + x] = 21.0f + 2.0f * fy + 6.0f * corner + 0.05f * noise(pattern);
+        }
+    }
+}
+
+FlagState SimulatedCamera::flag_state(int64_t elapsedNs, double &blend) {
+    blend = 0;
+    if (flagStart < 0) {
+        return FLAG_OPEN;
+    }
+    int64_t t = elapsedNs - flagStart;
+    if (t < FLAG_CLOSING_NS) {
+        blend = (double) t / FLAG_CLOSING_NS;
+        return FLAG_CLOSING;
+    }
+    t -= FLAG_CLOSING_NS;
+    if (t < FLAG_CLOSED_NS) {
+        blend = 1;
+        return FLAG_CLOSED;
+    }
+    t -= FLAG_CLOSED_NS;
+    if (t < FLAG_OPENING_NS) {
+        blend = 1.0 - (double) t / FLAG_OPENING_NS;
+        return FLAG_OPENING;
+    }
+    return FLAG_OPEN;
+}
+
+void SimulatedCamera::fetch_thermal(uint16_t *data, FrameState &state) {
+    std::lock_guard<std::mutex> lock(fetchMutex);
+    size_t frameSize = (size_t) format.width * format.height;
+    if (!paced) {
+        if (replay.empty()) {
+            replay.resize(frameSize * REPLAY_FRAMES);
+            for (int i = 0; i < REPLAY_FRAMES; i++) {
+                render(&replay[frameSize * i], periodNs * i, 0);
+            }
+        }
+        std::memcpy(data, &replay[frameSize * (frameCounter % REPLAY_FRAMES)], frameSize * sizeof(uint16_t));
+        frameCounter++;
+        state.timestamp = system_ns();
+        state.frame = frameCounter;
+        state.flag = FLAG_OPEN;
+        state.chipTemperature = 38.0f;
+        return;
+    }
+
+    int64_t now = steady_ns();
+    if (start == 0) {
+        start = now;
+    }
+    // The camera keeps streaming whether anybody reads or not, wait for the next frame boundary
+    uint64_t due = (uint64_t) ((now - start) / periodNs) + 1;
+    frameCounter = std::max(frameCounter + 1, due);
+    int64_t elapsed = (int64_t) frameCounter * periodNs;
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(start + elapsed)));
+
+    {
+        std::lock_guard<std::mutex> settingsLock(settingsMutex);
+        double blend;
+        bool idle = flag_state(elapsed, blend) == FLAG_OPEN;
+        if (idle && (flagRequested || (autoFlag && elapsed - std::max<int64_t>(flagStart, 0) >= flagIntervalNs))) {
+            flagStart = elapsed;
+        }
+        flagRequested = false;
+    }
+
+    double blend;
+    FlagState flag = flag_state(elapsed, blend);
+    render(data, elapsed, blend);
+
+    state.timestamp = system_ns();
+    state.frame = frameCounter;
+    state.flag = flag;
+    // The detector warms up towards its operating temperature over the first minutes
+    state.chipTemperature = 38.0f - 8.0f * (float) std::exp(-(double) elapsed / 120e9);
+}
+
+void SimulatedCamera::render(uint16_t *data, int64_t elapsedNs, double flagBlend) {
+    float low, high, objectGain, scene;
+    {
+        std::lock_guard<std::mutex> lock(settingsMutex);
+        low = temperatureMin;
+        high = temperatureMax;
+        objectGain = gain;
+        scene = ambient;
+    }
+    int w = format.width, h = format.height;
+    double seconds = (double) elapsedNs * 1e-9;
+    float drift = DRIFT_PER_SECOND * (float) (flagStart < 0 ? seconds : seconds - (double) flagStart * 1e-9);
+    float shutter = (float) flagBlend;
+
+    // Blob centres and radii in pixels, the radius follows the larger side for line scan formats
+    struct Placed { float x, y, radius, temperature; } placed[sizeof(BLOBS) / sizeof(BLOBS[0])];
+    float size = (float) std::max(std::min(w, h), std::max(w, h) / 8);
+    for (size_t b = 0; b < sizeof(BLOBS) / sizeof(BLOBS[0]); b++) {
+        const Blob &blob = BLOBS[b];
+        placed[b].x = (float) (0.5 + 0.4 * std::sin(seconds * blob.speedX + blob.phase)) * w;
+        placed[b].y = (float) (0.5 + 0.4 * std::sin(seconds * blob.speedY + blob.phase * 0.7)) * h;
+        placed[b].radius = std::max(blob.radius * size, 1.0f);
+        placed[b].temperature = blob.temperature;
+    }
+
+    for (int y = 0; y < h; y++) {
+        const float *row = &background[(size_t) y * w];
+        uint16_t *out = data + (size_t) y * w;
+        for (int x = 0; x < w; x++) {
+            float t = row[x];
+            for (const Placed &blob : placed) {
+                float dx = (x - blob.x) / blob.radius;
+                float dy = (y - blob.y) / blob.radius;
+                float d2 = dx * dx + dy * dy;
+                if (d2 < 1.0f) {
+                    // Smooth dome falling to the background at the rim
+                    float k = 1.0f - d2;
+                    t += blob.temperature * k * k;
+                }
+            }
+            // The emissivity and transmissivity correction scales contrast against the ambient temperature
+            t = scene + (t - scene) * objectGain;
+            t = t * (1.0f - shutter) + SHUTTER_TEMPERATURE * shutter + drift + NOISE_AMPLITUDE * noise(noiseState);
+            t = std::min(std::max(t, low), high);
+            out[x] = (uint16_t) ((t + RAW_OFFSET) * RAW_SCALE + 0.5f);
+        }
+    }
+}
+
+void SimulatedCamera::set_temperature_range(int minimum, int maximum) {
+    std::lock_guard<std::mutex> lock(settingsMutex);
+    temperatureMin = (float) minimum;
+    temperatureMax = (float) maximum;
+}
+
+void SimulatedCamera::set_radiation_parameters(float emissivity, float transmissivity, float ambientTemperature) {
+    std::lock_guard<std::mutex> lock(settingsMutex);
+    float product = std::max(emissivity * transmissivity, 0.01f);
+    gain = 1.0f / product;
+    ambient = ambientTemperature;
+}
+
+void SimulatedCamera::set_shutter_mode(int mode) {
+    std::lock_guard<std::mutex> lock(settingsMutex);
+    autoFlag = mode == 1;
+}
+
+void SimulatedCamera::trigger_shutter_flag() {
+    std::lock_guard<std::mutex> lock(settingsMutex);
+    flagRequested = true;
+}
+
+void SimulatedCamera::set_focus_motor_position(float position) {
+    std::lock_guard<std::mutex> lock(settingsMutex);
+    focus = std::min(std::max(position, 0.0f), 100.0f);
+}
+
+float SimulatedCamera::focus_motor_position() {
+    std::lock_guard<std::mutex> lock(settingsMutex);
+    return focus;
+}
+
+}
+}
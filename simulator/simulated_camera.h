@@ -0,0 +1,143 @@
+#ifndef PYOPTRIS_SIMULATED_CAMERA_H
+#define PYOPTRIS_SIMULATED_CAMERA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pyoptris {
+namespace simulator {
+
+/**
+ * @brief Output format of a simulated camera, taken from the Out lines of Formats.def
+ */
+struct Format {
+    const char *name;
+    int width;
+    int height;
+    int rate;
+};
+
+/**
+ * @brief Simulated formats, selected by <videoformatindex> of the xml config
+ */
+const Format *formats(size_t &count);
+
+// Same values as evo::EnumFlagState
+enum FlagState {
+    FLAG_OPEN = 0,
+    FLAG_CLOSED = 1,
+    FLAG_OPENING = 2,
+    FLAG_CLOSING = 3
+};
+
+/**
+ * @brief The parts of an imager xml config the simulator honours
+ */
+struct Settings {
+    unsigned long serial = 0;
+    int formatIndex = 0;
+    double framerate = 0;           // <= 0 or above the format rate means the full format rate
+    bool autoFlag = true;
+    double flagMinInterval = 15.0;  // seconds between automatic flag cycles
+    float focus = 50.0f;
+    int temperatureMin = -20;
+    int temperatureMax = 100;
+    bool paced = true;              // false replays a few pre-rendered frames as fast as they are fetched
+};
+
+/**
+ * @brief Reads an imager xml config such as generic.xml, missing elements keep their defaults
+ * @param[out] error description of the failure
+ */
+bool read_settings(const char *xmlConfig, Settings &settings, std::string &error);
+
+/**
+ * @brief Per-frame state reported next to the simulated thermal frame
+ */
+struct FrameState {
+    int64_t timestamp;      // system clock in nanoseconds
+    uint64_t frame;         // frame counter of the camera, counts frames nobody fetched as well
+    FlagState flag;
+    float chipTemperature;  // degrees Celsius
+};
+
+/**
+ * @brief Synthetic thermal camera. A static background with a few warm objects moving across it,
+ * sensor noise and an offset drift that is reset by every flag cycle. fetch_thermal() blocks until the
+ * next frame is due like the SDK does, frames a slow caller misses are skipped as on a real camera.
+ * Raw values use the SDK encoding with one decimal, raw = (t + 100) * 10.
+ * Unpaced cameras cost a memcpy per frame, for measuring the binding rather than the scene.
+ */
+class SimulatedCamera {
+public:
+    explicit SimulatedCamera(const Settings &settings);
+
+    int width() const {
+        return format.width;
+    }
+
+    int height() const {
+        return format.height;
+    }
+
+    int rate() const {
+        return format.rate;
+    }
+
+    unsigned long serial() const {
+        return serialNumber;
+    }
+
+    /**
+     * @brief Waits for the next frame and renders it into data, width * height values
+     */
+    void fetch_thermal(uint16_t *data, FrameState &state);
+
+    void set_temperature_range(int minimum, int maximum);
+
+    void set_radiation_parameters(float emissivity, float transmissivity, float ambientTemperature);
+
+    void set_shutter_mode(int mode);
+
+    void trigger_shutter_flag();
+
+    void set_focus_motor_position(float position);
+
+    float focus_motor_position();
+
+private:
+    void render(uint16_t *data, int64_t elapsedNs, double flagBlend);
+
+    FlagState flag_state(int64_t elapsedNs, double &blend);
+
+    Format format;
+    unsigned long serialNumber;
+    int64_t periodNs;
+    std::vector<float> background;  // degrees Celsius, fixed pattern noise included
+    bool paced;
+    std::vector<uint16_t> replay;   // frames of an unpaced camera, rendered on the first fetch
+
+    std::mutex fetchMutex;      // pacing and frame rendering
+    int64_t start;              // steady clock of the first frame
+    uint64_t frameCounter;
+    int64_t flagStart;          // elapsed time the current or last flag cycle started, negative for none
+    uint32_t noiseState;
+
+    std::mutex settingsMutex;   // everything below, changed from the Python side
+    bool autoFlag;
+    int64_t flagIntervalNs;
+    bool flagRequested;
+    float focus;
+    float temperatureMin;
+    float temperatureMax;
+    float gain;                 // 1 / (emissivity * transmissivity)
+    float ambient;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,546 @@
+#include "spatial.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace pyoptris {
+
+/*
+ * median:  Batcher's odd-even merge sort over the next power of two, comparators touching only the
+ *          padding dropped (the padding would be the largest values and never moves), then pruned
+ *          backwards to those the middle element depends on: 24 compare-exchanges for 3x3, 113 for 5x5.
+ * denoise: out = (2 * sum + count) / (2 * count), sum and count over the centre and the neighbours
+ *          within threshold. The vector paths divide in float, 2 * sum + count < 2^21 so the operands
+ *          are exact and a quotient off an integer by at least 1 / 18 truncates to the same result.
+ */
+
+#if defined(__clang__)
+#define PYOPTRIS_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define PYOPTRIS_UNROLL _Pragma("GCC unroll 128")
+#else
+#define PYOPTRIS_UNROLL
+#endif
+
+struct Comparator {
+    uint8_t low;
+    uint8_t high;
+};
+
+template <int Count>
+struct MedianNetwork {
+    Comparator comparators[256];
+    size_t size;
+};
+
+// Built at compile time so the kernels unroll it and keep the window in registers
+template <int Count>
+constexpr MedianNetwork<Count> build_median_network() {
+    MedianNetwork<Count> sorting{};
+    int padded = 1;
+    while (padded < Count) {
+        padded <<= 1;
+    }
+    for (int p = 1; p < padded; p <<= 1) {
+        for (int k = p; k >= 1; k >>= 1) {
+            for (int j = k % p; j + k < padded; j += 2 * k) {
+                for (int i = 0; i < (k < padded - j - k ? k : padded - j - k); i++) {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p) && i + j + k < Count) {
+                        sorting.comparators[sorting.size++] = { (uint8_t) (i + j), (uint8_t) (i + j + k) };
+                    }
+                }
+            }
+        }
+    }
+    bool needed[Count] = {};
+    needed[Count / 2] = true;
+    Comparator reversed[256] = {};
+    size_t kept = 0;
+    for (size_t c = sorting.size; c-- > 0;) {
+        Comparator comparator = sorting.comparators[c];
+        if (needed[comparator.low] || needed[comparator.high]) {
+            needed[comparator.low] = needed[comparator.high] = true;
+            reversed[kept++] = comparator;
+        }
+    }
+    MedianNetwork<Count> median{};
+    for (size_t c = 0; c < kept; c++) {
+        median.comparators[c] = reversed[kept - 1 - c];
+    }
+    median.size = kept;
+    return median;
+}
+
+template <int Radius>
+struct MedianWindow {
+    static constexpr int SIDE = 2 * Radius + 1;
+    static constexpr int COUNT = SIDE * SIDE;
+    static constexpr MedianNetwork<COUNT> NETWORK = build_median_network<COUNT>();
+};
+
+template <int Radius>
+constexpr MedianNetwork<MedianWindow<Radius>::COUNT> MedianWindow<Radius>::NETWORK;
+
+static inline int clamp_index(int i, int size) {
+    return i < 0 ? 0 : (i >= size ? size - 1 : i);
+}
+
+// rows[k] is the row k - Radius away from the output row, already clamped to the frame
+template <int Radius>
+static void median_scalar(const uint16_t *const *rows, int width, uint16_t *out, int from, int to) {
+    typedef MedianWindow<Radius> Window;
+    uint16_t v[Window::COUNT];
+    for (int x = from; x < to; x++) {
+        for (int dy = 0; dy < Window::SIDE; dy++) {
+            for (int dx = 0; dx < Window::SIDE; dx++) {
+                v[dy * Window::SIDE + dx] = rows[dy][clamp_index(x + dx - Radius, width)];
+            }
+        }
+        for (size_t c = 0; c < Window::NETWORK.size; c++) {
+            const Comparator &comparator = Window::NETWORK.comparators[c];
+            uint16_t a = v[comparator.low], b = v[comparator.high];
+            v[comparator.low] = std::min(a, b);
+            v[comparator.high] = std::max(a, b);
+        }
+        out[x] = v[Window::COUNT / 2];
+    }
+}
+
+static void denoise_scalar(const uint16_t *const *rows, int width, uint16_t threshold, uint16_t *out, int from, int to) {
+    for (int x = from; x < to; x++) {
+        uint32_t c = rows[1][x];
+        uint32_t sum = 0, count = 0;
+        for (int dy = 0; dy < 3; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                uint32_t n = rows[dy][clamp_index(x + dx, width)];
+                if ((n > c ? n - c : c - n) <= threshold) {
+                    sum += n;
+                    count++;
+                }
+            }
+        }
+        out[x] = (uint16_t) ((2 * sum + count) / (2 * count));
+    }
+}
+
+#ifdef PYOPTRIS_X86
+
+template <int Radius>
+PYOPTRIS_TARGET("avx2")
+static void median_avx2(const uint16_t *const *rows, int width, uint16_t *out, int from, int to) {
+    typedef MedianWindow<Radius> Window;
+    __m256i v[Window::COUNT];
+    int x = from;
+    for (; x + 16 <= to; x += 16) {
+        for (int dy = 0; dy < Window::SIDE; dy++) {
+            for (int dx = 0; dx < Window::SIDE; dx++) {
+                v[dy * Window::SIDE + dx] = _mm256_loadu_si256((const __m256i *) (rows[dy] + x + dx - Radius));
+            }
+        }
+        PYOPTRIS_UNROLL
+        for (size_t c = 0; c < Window::NETWORK.size; c++) {
+            const Comparator &comparator = Window::NETWORK.comparators[c];
+            __m256i a = v[comparator.low], b = v[comparator.high];
+            v[comparator.low] = _mm256_min_epu16(a, b);
+            v[comparator.high] = _mm256_max_epu16(a, b);
+        }
+        _mm256_storeu_si256((__m256i *) (out + x), v[Window::COUNT / 2]);
+    }
+    median_scalar<Radius>(rows, width, out, x, to);
+}
+
+// (2 * sum + count) / (2 * count) of 8 lanes of 32 bits
+PYOPTRIS_TARGET("avx2")
+static inline __m256i rounded_mean8_avx2(__m256i sum, __m256i count) {
+    __m256 numerator = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(sum, sum), count));
+    __m256 denominator = _mm256_cvtepi32_ps(_mm256_add_epi32(count, count));
+    return _mm256_cvttps_epi32(_mm256_div_ps(numerator, denominator));
+}
+
+PYOPTRIS_TARGET("avx2")
+static void denoise_avx2(const uint16_t *const *rows, int width, uint16_t threshold, uint16_t *out, int from, int to) {
+    __m256i t = _mm256_set1_epi16((short) threshold);
+    __m256i zero = _mm256_setzero_si256();
+    int x = from;
+    for (; x + 16 <= to; x += 16) {
+        __m256i c = _mm256_loadu_si256((const __m256i *) (rows[1] + x));
+        __m256i sum0 = zero, sum1 = zero, count = zero;
+        for (int dy = 0; dy < 3; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                __m256i n = _mm256_loadu_si256((const __m256i *) (rows[dy] + x + dx));
+                __m256i difference = _mm256_or_si256(_mm256_subs_epu16(n, c), _mm256_subs_epu16(c, n));
+                __m256i within = _mm256_cmpeq_epi16(_mm256_subs_epu16(difference, t), zero);
+                __m256i kept = _mm256_and_si256(n, within);
+                sum0 = _mm256_add_epi32(sum0, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(kept)));
+                sum1 = _mm256_add_epi32(sum1, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(kept, 1)));
+                count = _mm256_sub_epi16(count, within);
+            }
+        }
+        __m256i q0 = rounded_mean8_avx2(sum0, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(count)));
+        __m256i q1 = rounded_mean8_avx2(sum1, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(count, 1)));
+        _mm256_storeu_si256((__m256i *) (out + x), _mm256_permute4x64_epi64(_mm256_packus_epi32(q0, q1), 0xd8));
+    }
+    denoise_scalar(rows, width, threshold, out, x, to);
+}
+
+#endif
+
+#ifdef PYOPTRIS_SSE2
+
+// SSE2 only has signed 16 bit min/max, the window is sorted with the sign bit flipped
+template <int Radius>
+static void median_sse2(const uint16_t *const *rows, int width, uint16_t *out, int from, int to) {
+    typedef MedianWindow<Radius> Window;
+    __m128i v[Window::COUNT];
+    __m128i sign = _mm_set1_epi16((short) 0x8000);
+    int x = from;
+    for (; x + 8 <= to; x += 8) {
+        for (int dy = 0; dy < Window::SIDE; dy++) {
+            for (int dx = 0; dx < Window::SIDE; dx++) {
+                v[dy * Window::SIDE + dx] = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (rows[dy] + x + dx - Radius)), sign);
+            }
+        }
+        PYOPTRIS_UNROLL
+        for (size_t c = 0; c < Window::NETWORK.size; c++) {
+            const Comparator &comparator = Window::NETWORK.comparators[c];
+            __m128i a = v[comparator.low], b = v[comparator.high];
+            v[comparator.low] = _mm_min_epi16(a, b);
+            v[comparator.high] = _mm_max_epi16(a, b);
+        }
+        _mm_storeu_si128((__m128i *) (out + x), _mm_xor_si128(v[Window::COUNT / 2], sign));
+    }
+    median_scalar<Radius>(rows, width, out, x, to);
+}
+
+static inline __m128i rounded_mean4_sse2(__m128i sum, __m128i count) {
+    __m128 numerator = _mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(sum, sum), count));
+    __m128 denominator = _mm_cvtepi32_ps(_mm_add_epi32(count, count));
+    return _mm_cvttps_epi32(_mm_div_ps(numerator, denominator));
+}
+
+static void denoise_sse2(const uint16_t *const *rows, int width, uint16_t threshold, uint16_t *out, int from, int to) {
+    __m128i t = _mm_set1_epi16((short) threshold);
+    __m128i zero = _mm_setzero_si128();
+    __m128i offset = _mm_set1_epi32(32768);
+    int x = from;
+    for (; x + 8 <= to; x += 8) {
+        __m128i c = _mm_loadu_si128((const __m128i *) (rows[1] + x));
+        __m128i sum0 = zero, sum1 = zero, count = zero;
+        for (int dy = 0; dy < 3; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                __m128i n = _mm_loadu_si128((const __m128i *) (rows[dy] + x + dx));
+                __m128i difference = _mm_or_si128(_mm_subs_epu16(n, c), _mm_subs_epu16(c, n));
+                __m128i within = _mm_cmpeq_epi16(_mm_subs_epu16(difference, t), zero);
+                __m128i kept = _mm_and_si128(n, within);
+                sum0 = _mm_add_epi32(sum0, _mm_unpacklo_epi16(kept, zero));
+                sum1 = _mm_add_epi32(sum1, _mm_unpackhi_epi16(kept, zero));
+                count = _mm_sub_epi16(count, within);
+            }
+        }
+        __m128i q0 = rounded_mean4_sse2(sum0, _mm_unpacklo_epi16(count, zero));
+        __m128i q1 = rounded_mean4_sse2(sum1, _mm_unpackhi_epi16(count, zero));
+        // SSE2 lacks packus_epi32, shift into the signed range, pack with saturation and flip the sign bit back
+        __m128i packed = _mm_packs_epi32(_mm_sub_epi32(q0, offset), _mm_sub_epi32(q1, offset));
+        _mm_storeu_si128((__m128i *) (out + x), _mm_xor_si128(packed, _mm_set1_epi16((short) 0x8000)));
+    }
+    denoise_scalar(rows, width, threshold, out, x, to);
+}
+
+#endif
+
+#if defined(PYOPTRIS_NEON) && defined(__aarch64__)
+
+template <int Radius>
+static void median_neon(const uint16_t *const *rows, int width, uint16_t *out, int from, int to) {
+    typedef MedianWindow<Radius> Window;
+    uint16x8_t v[Window::COUNT];
+    int x = from;
+    for (; x + 8 <= to; x += 8) {
+        for (int dy = 0; dy < Window::SIDE; dy++) {
+            for (int dx = 0; dx < Window::SIDE; dx++) {
+                v[dy * Window::SIDE + dx] = vld1q_u16(rows[dy] + x + dx - Radius);
+            }
+        }
+        PYOPTRIS_UNROLL
+        for (size_t c = 0; c < Window::NETWORK.size; c++) {
+            const Comparator &comparator = Window::NETWORK.comparators[c];
+            uint16x8_t a = v[comparator.low], b = v[comparator.high];
+            v[comparator.low] = vminq_u16(a, b);
+            v[comparator.high] = vmaxq_u16(a, b);
+        }
+        vst1q_u16(out + x, v[Window::COUNT / 2]);
+    }
+    median_scalar<Radius>(rows, width, out, x, to);
+}
+
+static inline uint32x4_t rounded_mean4_neon(uint32x4_t sum, uint32x4_t count) {
+    float32x4_t numerator = vcvtq_f32_u32(vaddq_u32(vaddq_u32(sum, sum), count));
+    float32x4_t denominator = vcvtq_f32_u32(vaddq_u32(count, count));
+    return vcvtq_u32_f32(vdivq_f32(numerator, denominator));
+}
+
+static void denoise_neon(const uint16_t *const *rows, int width, uint16_t threshold, uint16_t *out, int from, int to) {
+    uint16x8_t t = vdupq_n_u16(threshold);
+    int x = from;
+    for (; x + 8 <= to; x += 8) {
+        uint16x8_t c = vld1q_u16(rows[1] + x);
+        uint32x4_t sum0 = vdupq_n_u32(0), sum1 = vdupq_n_u32(0);
+        uint16x8_t count = vdupq_n_u16(0);
+        for (int dy = 0; dy < 3; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                uint16x8_t n = vld1q_u16(rows[dy] + x + dx);
+                uint16x8_t within = vcleq_u16(vabdq_u16(n, c), t);
+                uint16x8_t kept = vandq_u16(n, within);
+                sum0 = vaddw_u16(sum0, vget_low_u16(kept));
+                sum1 = vaddw_u16(sum1, vget_high_u16(kept));
+                count = vsubq_u16(count, within);
+            }
+        }
+        uint32x4_t q0 = rounded_mean4_neon(sum0, vmovl_u16(vget_low_u16(count)));
+        uint32x4_t q1 = rounded_mean4_neon(sum1, vmovl_u16(vget_high_u16(count)));
+        vst1q_u16(out + x, vcombine_u16(vmovn_u32(q0), vmovn_u32(q1)));
+    }
+    denoise_scalar(rows, width, threshold, out, x, to);
+}
+
+#endif
+
+typedef void (*MedianKernel)(const uint16_t *const *, int, uint16_t *, int, int);
+typedef void (*DenoiseKernel)(const uint16_t *const *, int, uint16_t, uint16_t *, int, int);
+
+struct SpatialKernels {
+    MedianKernel median3;
+    MedianKernel median5;
+    DenoiseKernel denoise;
+};
+
+static SpatialKernels select_kernels() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        return { median_avx2<1>, median_avx2<2>, denoise_avx2 };
+    }
+#endif
+#if defined(PYOPTRIS_SSE2)
+    return { median_sse2<1>, median_sse2<2>, denoise_sse2 };
+#elif defined(PYOPTRIS_NEON) && defined(__aarch64__)
+    return { median_neon<1>, median_neon<2>, denoise_neon };
+#else
+    return { median_scalar<1>, median_scalar<2>, denoise_scalar };
+#endif
+}
+
+static const SpatialKernels &kernels() {
+    static const SpatialKernels selected = select_kernels();
+    return selected;
+}
+
+SpatialFilter::SpatialFilter(int width, int height, int threads)
+    : frameWidth(width), frameHeight(height), pool(new WorkerPool(std::max(1, threads) - 1)) {
+}
+
+size_t SpatialFilter::add_bad_pixels(const uint8_t *mask) {
+    static const int ring1Cross[4][2] = { { 0, -1 }, { -1, 0 }, { 1, 0 }, { 0, 1 } };
+    static const int ring1Diagonal[4][2] = { { -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 } };
+    Stage stage;
+    stage.kind = BAD_PIXELS;
+    stage.radius = 0;
+    stage.threshold = 0;
+    stage.rowStart.assign((size_t) frameHeight + 1, 0);
+    stage.firstSource.push_back(0);
+    auto good = [&](int x, int y) {
+        return x >= 0 && y >= 0 && x < frameWidth && y < frameHeight && mask[(size_t) y * frameWidth + x] == 0;
+    };
+    for (int y = 0; y < frameHeight; y++) {
+        stage.rowStart[y] = (uint32_t) stage.bad.size();
+        for (int x = 0; x < frameWidth; x++) {
+            if (mask[(size_t) y * frameWidth + x] == 0) {
+                continue;
+            }
+            size_t first = stage.sources.size();
+            auto take = [&](int dx, int dy) {
+                if (good(x + dx, y + dy)) {
+                    stage.sources.push_back(dy * frameWidth + dx);
+                }
+            };
+            for (const auto &d : ring1Cross) {
+                take(d[0], d[1]);
+            }
+            if (stage.sources.size() == first) {
+                for (const auto &d : ring1Diagonal) {
+                    take(d[0], d[1]);
+                }
+            }
+            int reach = stage.sources.size() == first ? 0 : 1;
+            if (stage.sources.size() == first) {
+                for (int dy = -2; dy <= 2; dy++) {
+                    for (int dx = -2; dx <= 2; dx++) {
+                        if (std::max(std::abs(dx), std::abs(dy)) == 2) {
+                            take(dx, dy);
+                        }
+                    }
+                }
+                reach = stage.sources.size() == first ? 0 : 2;
+            }
+            stage.radius = std::max(stage.radius, reach);
+            stage.bad.push_back((uint32_t) ((size_t) y * frameWidth + x));
+            stage.firstSource.push_back((uint32_t) stage.sources.size());
+        }
+    }
+    stage.rowStart[frameHeight] = (uint32_t) stage.bad.size();
+    size_t pixels = stage.bad.size();
+    chain.push_back(std::move(stage));
+    reserve_scratch();
+    return pixels;
+}
+
+void SpatialFilter::add_median(int size) {
+    Stage stage;
+    stage.kind = MEDIAN;
+    stage.radius = size / 2;
+    stage.threshold = 0;
+    chain.push_back(std::move(stage));
+    reserve_scratch();
+}
+
+void SpatialFilter::add_denoise(uint16_t threshold) {
+    Stage stage;
+    stage.kind = DENOISE;
+    stage.radius = 1;
+    stage.threshold = threshold;
+    chain.push_back(std::move(stage));
+    reserve_scratch();
+}
+
+void SpatialFilter::clear() {
+    chain.clear();
+    reserve_scratch();
+}
+
+uint32_t SpatialFilter::parameter(size_t stage) const {
+    const Stage &s = chain[stage];
+    switch (s.kind) {
+    case BAD_PIXELS:
+        return (uint32_t) s.bad.size();
+    case MEDIAN:
+        return (uint32_t) (2 * s.radius + 1);
+    case DENOISE:
+        return s.threshold;
+    }
+    return 0;
+}
+
+void SpatialFilter::reserve_scratch() {
+    halo.assign(chain.size(), 0);
+    for (size_t k = chain.size(); k-- > 1;) {
+        halo[k - 1] = halo[k] + chain[k].radius;
+    }
+    // The last stage writes straight into out, one stage reads from the frame only
+    size_t rows = chain.size() > 1 ? (size_t) std::min(frameHeight, BAND_ROWS + 2 * halo[0]) : 0;
+    scratch.assign((size_t) pool->size(), std::vector<uint16_t>(2 * rows * frameWidth));
+}
+
+void SpatialFilter::run_stage(const Stage &stage, const uint16_t *src, int srcFirst, uint16_t *dst, int dstFirst, int from, int to) const {
+    size_t width = (size_t) frameWidth;
+    if (stage.kind == BAD_PIXELS) {
+        std::memcpy(dst + (size_t) (from - dstFirst) * width, src + (size_t) (from - srcFirst) * width, (size_t) (to - from) * width * sizeof(uint16_t));
+        // Bad pixel indices and sources are frame offsets, shift them into the buffers
+        const uint16_t *srcBase = src - (ptrdiff_t) srcFirst * (ptrdiff_t) width;
+        uint16_t *dstBase = dst - (ptrdiff_t) dstFirst * (ptrdiff_t) width;
+        for (uint32_t b = stage.rowStart[from]; b < stage.rowStart[to]; b++) {
+            uint32_t first = stage.firstSource[b], last = stage.firstSource[b + 1];
+            if (first == last) {
+                continue;
+            }
+            const uint16_t *centre = srcBase + stage.bad[b];
+            uint32_t sum = 0;
+            for (uint32_t s = first; s < last; s++) {
+                sum += centre[stage.sources[s]];
+            }
+            uint32_t count = last - first;
+            dstBase[stage.bad[b]] = (uint16_t) ((sum + count / 2) / count);
+        }
+        return;
+    }
+    const SpatialKernels &k = kernels();
+    int r = stage.radius;
+    int inner0 = std::min(r, frameWidth), inner1 = std::max(inner0, frameWidth - r);
+    const uint16_t *rows[5];
+    for (int y = from; y < to; y++) {
+        for (int dy = -r; dy <= r; dy++) {
+            rows[dy + r] = src + (size_t) (clamp_index(y + dy, frameHeight) - srcFirst) * width;
+        }
+        uint16_t *out = dst + (size_t) (y - dstFirst) * width;
+        // The columns within radius of the border are extended in the scalar kernels only
+        if (stage.kind == MEDIAN) {
+            MedianKernel border = r == 1 ? median_scalar<1> : median_scalar<2>;
+            MedianKernel median = r == 1 ? k.median3 : k.median5;
+            border(rows, frameWidth, out, 0, inner0);
+            median(rows, frameWidth, out, inner0, inner1);
+            border(rows, frameWidth, out, inner1, frameWidth);
+        } else {
+            denoise_scalar(rows, frameWidth, stage.threshold, out, 0, inner0);
+            k.denoise(rows, frameWidth, stage.threshold, out, inner0, inner1);
+            denoise_scalar(rows, frameWidth, stage.threshold, out, inner1, frameWidth);
+        }
+    }
+}
+
+void SpatialFilter::run_band(const uint16_t *frame, uint16_t *out, int band, int worker) {
+    int first = band * BAND_ROWS, last = std::min(frameHeight, first + BAND_ROWS);
+    size_t bufferSize = scratch[worker].size() / 2;
+    uint16_t *buffers[2] = { scratch[worker].data(), scratch[worker].data() + bufferSize };
+    const uint16_t *src = frame;
+    int srcFirst = 0;
+    for (size_t k = 0; k < chain.size(); k++) {
+        bool lastStage = k + 1 == chain.size();
+        int from = std::max(0, first - halo[k]), to = std::min(frameHeight, last + halo[k]);
+        uint16_t *dst = lastStage ? out : buffers[k % 2];
+        int dstFirst = lastStage ? 0 : from;
+        run_stage(chain[k], src, srcFirst, dst, dstFirst, from, to);
+        src = dst;
+        srcFirst = dstFirst;
+    }
+}
+
+void SpatialFilter::apply(const uint16_t *frame, uint16_t *out) {
+    size_t pixels = (size_t) frameWidth * frameHeight;
+    if (chain.empty()) {
+        if (out != frame) {
+            std::memmove(out, frame, pixels * sizeof(uint16_t));
+        }
+        return;
+    }
+    // Bands read rows around them that other bands write, so an aliased frame is read from a copy
+    if (out < frame + pixels && frame < out + pixels) {
+        input.assign(frame, frame + pixels);
+        frame = input.data();
+    }
+    // Two captured pointers keep the std::function in its inline storage, no allocation per frame
+    struct {
+        const uint16_t *frame;
+        uint16_t *out;
+    } job = { frame, out };
+    int bands = (frameHeight + BAND_ROWS - 1) / BAND_ROWS;
+    pool->run((size_t) bands, [this, &job](size_t band, int worker) {
+        run_band(job.frame, job.out, (int) band, worker);
+    });
+}
+
+const char *spatial_isa() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        return "avx2";
+    }
+#endif
+#if defined(PYOPTRIS_SSE2)
+    return "sse2";
+#elif defined(PYOPTRIS_NEON) && defined(__aarch64__)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+}
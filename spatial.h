@@ -0,0 +1,104 @@
+#ifndef PYOPTRIS_SPATIAL_H
+#define PYOPTRIS_SPATIAL_H
+
+#include "workers.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace pyoptris {
+
+/**
+ * @brief Chain of spatial filters run on raw uint16 frames in one pass, all arithmetic in integers.
+ *  - bad pixels: pixels of a mask replaced by the rounded mean of the good 4-neighbours, else the good
+ *    diagonal neighbours, else the good pixels two away. The mask is compiled into a replacement list.
+ *  - median: 3x3 or 5x5 median, a sorting network pruned to the middle element across vector lanes
+ *  - denoise: edge preserving sigma filter, the rounded mean of the centre and the 3x3 neighbours
+ *    that differ from it by at most threshold counts, so edges steeper than threshold are kept
+ * Frames are cut into bands of rows that are split across a WorkerPool. Each band runs through every
+ * stage in scratch buffers of its worker, widened by the rows later stages read around it, so the
+ * intermediate results stay in cache and the result equals running the stages one after another.
+ * Frame borders are extended by replicating the edge pixels.
+ */
+class SpatialFilter {
+public:
+    enum Kind {
+        BAD_PIXELS = 0,
+        MEDIAN = 1,
+        DENOISE = 2
+    };
+
+    static const int BAND_ROWS = 32;
+    static const size_t MAX_STAGES = 16;
+
+    /**
+     * @param threads threads a frame is split across, the caller included
+     */
+    SpatialFilter(int width, int height, int threads);
+
+    /**
+     * @param mask width * height bytes, non-zero pixels are replaced
+     * @return pixels of the mask, those without good pixels within two are passed through
+     */
+    size_t add_bad_pixels(const uint8_t *mask);
+
+    /**
+     * @param size 3 or 5
+     */
+    void add_median(int size);
+
+    /**
+     * @param threshold largest difference to the centre in raw counts a neighbour is averaged with
+     */
+    void add_denoise(uint16_t threshold);
+
+    void clear();
+
+    /**
+     * @brief Runs every stage in the order added
+     * @param out receives the filtered frame, may alias frame
+     */
+    void apply(const uint16_t *frame, uint16_t *out);
+
+    size_t stages() const { return chain.size(); }
+    Kind kind(size_t stage) const { return chain[stage].kind; }
+    /** @brief Median size, denoise threshold or bad pixel count of a stage */
+    uint32_t parameter(size_t stage) const;
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    int threads() const { return pool->size(); }
+
+private:
+    struct Stage {
+        Kind kind;
+        int radius;                         // rows and columns read around an output pixel
+        uint16_t threshold;
+        std::vector<uint32_t> bad;          // bad pixel indices in row-major order
+        std::vector<uint32_t> rowStart;     // first entry of bad in every row, height + 1 entries
+        std::vector<uint32_t> firstSource;  // first entry of sources for every bad pixel, bad.size() + 1 entries
+        std::vector<int32_t> sources;       // offsets of the pixels averaged into a bad pixel
+    };
+
+    void reserve_scratch();
+    void run_band(const uint16_t *frame, uint16_t *out, int band, int worker);
+    void run_stage(const Stage &stage, const uint16_t *src, int srcFirst, uint16_t *dst, int dstFirst, int from, int to) const;
+
+    int frameWidth;
+    int frameHeight;
+    std::vector<Stage> chain;
+    std::vector<int> halo;                      // rows every stage produces around a band for the stages after it
+    std::vector<std::vector<uint16_t>> scratch; // two ping-pong buffers per worker
+    std::vector<uint16_t> input;                // copy of the frame when out aliases it
+    std::unique_ptr<WorkerPool> pool;
+};
+
+/**
+ * @brief Name of the instruction set picked for the spatial kernels, e.g. "avx2"
+ */
+const char *spatial_isa();
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace pyoptris {
+
+static unsigned highest_bit(uint64_t v) {
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return (unsigned) index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanReverse(&index, (unsigned long) (v >> 32))) {
+        return (unsigned) index + 32;
+    }
+    _BitScanReverse(&index, (unsigned long) v);
+    return (unsigned) index;
+#else
+    return 63 - (unsigned) __builtin_clzll(v);
+#endif
+}
+
+// The two bits below the highest set bit pick one of four buckets within its power of two
+static size_t bucket_of(uint64_t v) {
+    v = std::max<uint64_t>(v, 4);
+    unsigned exponent = highest_bit(v);
+    size_t bucket = (size_t) (exponent - 2) * 4 + (size_t) ((v >> (exponent - 2)) & 3);
+    return std::min(bucket, LatencyHistogram::BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::bucket_lower(size_t bucket) {
+    return (uint64_t) (4 + bucket % 4) << (bucket / 4);
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::record(int64_t ns) {
+    uint64_t value = ns > 0 ? (uint64_t) ns : 0;
+    buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+    totalNs.fetch_add(value, std::memory_order_relaxed);
+    uint64_t previous = maxNs.load(std::memory_order_relaxed);
+    while (value > previous && !maxNs.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::snapshot(Snapshot &snapshot) const {
+    snapshot.count = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        snapshot.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.totalNs = totalNs.load(std::memory_order_relaxed);
+    snapshot.maxNs = maxNs.load(std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset() {
+    for (size_t i = 0; i < BUCKETS; i++) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    totalNs.store(0, std::memory_order_relaxed);
+    maxNs.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t) std::max(1.0, q * (double) count + 0.5);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(bucket_lower(i + 1), maxNs);
+        }
+    }
+    return maxNs;
+}
+
+PipelineStatistics::PipelineStatistics() : captured(0), errors(0), delivered(0), dropped(0) {
+}
+
+void PipelineStatistics::reset() {
+    capture.reset();
+    conversion.reset();
+    delivery.reset();
+    captured.store(0, std::memory_order_relaxed);
+    errors.store(0, std::memory_order_relaxed);
+    delivered.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+}
+
+PipelineStatistics &pipeline_statistics() {
+    static PipelineStatistics statistics;
+    return statistics;
+}
+
+int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t system_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}
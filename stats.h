@@ -0,0 +1,86 @@
+#ifndef PYOPTRIS_STATS_H
+#define PYOPTRIS_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace pyoptris {
+
+/**
+ * @brief Lock-free latency histogram, log-linear with four buckets per power of two (at most 25% wide)
+ * from 4 ns up to about 73 minutes. Recording is one relaxed increment per counter, so it is always on.
+ */
+class LatencyHistogram {
+public:
+    static const size_t BUCKETS = 160;
+
+    struct Snapshot {
+        uint64_t count;
+        uint64_t totalNs;
+        uint64_t maxNs;
+        uint64_t buckets[BUCKETS];
+
+        /**
+         * @brief Upper bound of the bucket holding quantile q (0..1), capped at maxNs, 0 if empty
+         */
+        uint64_t percentile(double q) const;
+    };
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    void record(int64_t ns);
+
+    /**
+     * @brief Copies the counters, concurrent record() calls may be partially included
+     */
+    void snapshot(Snapshot &snapshot) const;
+
+    void reset();
+
+    /**
+     * @brief Smallest value that falls into bucket, bucket_lower(index + 1) is its exclusive upper bound
+     */
+    static uint64_t bucket_lower(size_t bucket);
+
+private:
+    std::atomic<uint64_t> totalNs;
+    std::atomic<uint64_t> maxNs;
+    std::atomic<uint64_t> buckets[BUCKETS];
+};
+
+/**
+ * @brief Counters and latencies of the whole module, shared by every camera and capture
+ */
+struct PipelineStatistics {
+    LatencyHistogram capture;       // time the SDK blocked for a frame, capture threads and direct accessors
+    LatencyHistogram conversion;    // raw to Celsius and palette kernels
+    LatencyHistogram delivery;      // acquisition to the frame being handed to Python, ring buffering included
+    std::atomic<uint64_t> captured;
+    std::atomic<uint64_t> errors;
+    std::atomic<uint64_t> delivered;
+    std::atomic<uint64_t> dropped;  // frames readers lost to ring overwrites
+
+    PipelineStatistics();
+
+    void reset();
+};
+
+PipelineStatistics &pipeline_statistics();
+
+/**
+ * @brief Monotonic clock for latency measurements, in ns
+ */
+int64_t steady_now_ns();
+
+/**
+ * @brief Wall clock in ns since the epoch, the clock of FrameInfo::timestamp
+ */
+int64_t system_now_ns();
+
+}
+
+#endif
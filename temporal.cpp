@@ -0,0 +1,432 @@
+#include "temporal.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace pyoptris {
+
+/*
+ * box:    sum += frame - oldest, out = (sum + count / 2) * reciprocal >> 32 with reciprocal = ceil(2^32 / count).
+ *         The product is off from sum / count by less than 1 / count as long as count < 256, so it rounds exactly.
+ *         count == 1 uses reciprocal 2^32 - 1 and a bias of 1, which is the identity.
+ * ema:    y = ((x << 15) * alpha + y * (65536 - alpha) + 2^15) >> 16, out = (y + 2^14) >> 15
+ * median: odd-even transposition sort of the history across vector lanes, mean of the middle two for even counts
+ */
+
+static void box_scalar(const uint16_t *frame, uint16_t *oldest, uint32_t *sum, uint16_t *out, size_t n, uint32_t bias, uint32_t reciprocal) {
+    for (size_t i = 0; i < n; i++) {
+        uint16_t x = frame[i];
+        uint32_t s = sum[i] - oldest[i] + x;
+        oldest[i] = x;
+        sum[i] = s;
+        out[i] = (uint16_t) (((uint64_t) (s + bias) * reciprocal) >> 32);
+    }
+}
+
+static void ema_scalar(const uint16_t *frame, uint32_t *state, uint16_t *out, size_t n, uint32_t alpha) {
+    uint32_t beta = 65536 - alpha;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t y = (uint32_t) (((uint64_t) ((uint32_t) frame[i] << 15) * alpha + (uint64_t) state[i] * beta + 32768) >> 16);
+        state[i] = y;
+        out[i] = (uint16_t) ((y + 16384) >> 15);
+    }
+}
+
+static void median_scalar(const uint16_t *history, size_t stride, int count, uint16_t *out, size_t n) {
+    uint16_t v[TemporalFilter::MAX_MEDIAN_LENGTH];
+    for (size_t i = 0; i < n; i++) {
+        for (int k = 0; k < count; k++) {
+            v[k] = history[k * stride + i];
+        }
+        std::nth_element(v, v + count / 2, v + count);
+        uint32_t upper = v[count / 2];
+        if (count % 2 == 0) {
+            uint32_t lower = *std::max_element(v, v + count / 2);
+            out[i] = (uint16_t) ((lower + upper + 1) >> 1);
+        } else {
+            out[i] = (uint16_t) upper;
+        }
+    }
+}
+
+#ifdef PYOPTRIS_X86
+
+// Unsigned 32 bit (s + bias) * reciprocal >> 32 per lane, even lanes shifted down, odd lanes already in place
+PYOPTRIS_TARGET("avx2")
+static inline __m256i divide8_avx2(__m256i s, __m256i bias, __m256i reciprocal, __m256i high) {
+    s = _mm256_add_epi32(s, bias);
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(s, reciprocal), 32);
+    __m256i odd = _mm256_and_si256(_mm256_mul_epu32(_mm256_srli_epi64(s, 32), reciprocal), high);
+    return _mm256_or_si256(even, odd);
+}
+
+// Two vectors of 32 bit lanes below 2^16 to one of uint16 in order
+PYOPTRIS_TARGET("avx2")
+static inline __m256i pack16_avx2(__m256i a, __m256i b) {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xd8);
+}
+
+PYOPTRIS_TARGET("avx2")
+static void box_avx2(const uint16_t *frame, uint16_t *oldest, uint32_t *sum, uint16_t *out, size_t n, uint32_t bias, uint32_t reciprocal) {
+    __m256i vbias = _mm256_set1_epi32((int) bias);
+    __m256i vreciprocal = _mm256_set1_epi32((int) reciprocal);
+    __m256i high = _mm256_set1_epi64x((long long) 0xffffffff00000000ull);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (frame + i));
+        __m256i o = _mm256_loadu_si256((const __m256i *) (oldest + i));
+        _mm256_storeu_si256((__m256i *) (oldest + i), x);
+        __m256i s0 = _mm256_loadu_si256((const __m256i *) (sum + i));
+        __m256i s1 = _mm256_loadu_si256((const __m256i *) (sum + i + 8));
+        s0 = _mm256_add_epi32(_mm256_sub_epi32(s0, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(o))),
+                              _mm256_cvtepu16_epi32(_mm256_castsi256_si128(x)));
+        s1 = _mm256_add_epi32(_mm256_sub_epi32(s1, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(o, 1))),
+                              _mm256_cvtepu16_epi32(_mm256_extracti128_si256(x, 1)));
+        _mm256_storeu_si256((__m256i *) (sum + i), s0);
+        _mm256_storeu_si256((__m256i *) (sum + i + 8), s1);
+        __m256i q = pack16_avx2(divide8_avx2(s0, vbias, vreciprocal, high), divide8_avx2(s1, vbias, vreciprocal, high));
+        _mm256_storeu_si256((__m256i *) (out + i), q);
+    }
+    box_scalar(frame + i, oldest + i, sum + i, out + i, n - i, bias, reciprocal);
+}
+
+PYOPTRIS_TARGET("avx2")
+static inline __m256i ema8_avx2(__m256i x, uint32_t *state, __m256i alpha, __m256i beta, __m256i round) {
+    __m256i xs = _mm256_slli_epi32(x, 15);
+    __m256i y = _mm256_loadu_si256((const __m256i *) state);
+    __m256i even = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(xs, alpha), _mm256_mul_epu32(y, beta)), round);
+    __m256i odd = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(xs, 32), alpha),
+                                                    _mm256_mul_epu32(_mm256_srli_epi64(y, 32), beta)), round);
+    y = _mm256_or_si256(_mm256_srli_epi64(even, 16), _mm256_slli_epi64(_mm256_srli_epi64(odd, 16), 32));
+    _mm256_storeu_si256((__m256i *) state, y);
+    return _mm256_srli_epi32(_mm256_add_epi32(y, _mm256_set1_epi32(16384)), 15);
+}
+
+PYOPTRIS_TARGET("avx2")
+static void ema_avx2(const uint16_t *frame, uint32_t *state, uint16_t *out, size_t n, uint32_t alpha) {
+    __m256i valpha = _mm256_set1_epi32((int) alpha);
+    __m256i vbeta = _mm256_set1_epi32((int) (65536 - alpha));
+    __m256i round = _mm256_set1_epi64x(32768);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (frame + i));
+        __m256i y0 = ema8_avx2(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(x)), state + i, valpha, vbeta, round);
+        __m256i y1 = ema8_avx2(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(x, 1)), state + i + 8, valpha, vbeta, round);
+        _mm256_storeu_si256((__m256i *) (out + i), pack16_avx2(y0, y1));
+    }
+    ema_scalar(frame + i, state + i, out + i, n - i, alpha);
+}
+
+PYOPTRIS_TARGET("avx2")
+static void median_avx2(const uint16_t *history, size_t stride, int count, uint16_t *out, size_t n) {
+    __m256i v[TemporalFilter::MAX_MEDIAN_LENGTH];
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        for (int k = 0; k < count; k++) {
+            v[k] = _mm256_loadu_si256((const __m256i *) (history + k * stride + i));
+        }
+        for (int pass = 0; pass < count; pass++) {
+            for (int k = pass & 1; k + 1 < count; k += 2) {
+                __m256i lo = _mm256_min_epu16(v[k], v[k + 1]);
+                v[k + 1] = _mm256_max_epu16(v[k], v[k + 1]);
+                v[k] = lo;
+            }
+        }
+        __m256i m = count % 2 == 0 ? _mm256_avg_epu16(v[count / 2 - 1], v[count / 2]) : v[count / 2];
+        _mm256_storeu_si256((__m256i *) (out + i), m);
+    }
+    median_scalar(history + i, stride, count, out + i, n - i);
+}
+
+#endif
+
+#ifdef PYOPTRIS_SSE2
+
+static inline __m128i divide4_sse2(__m128i s, __m128i bias, __m128i reciprocal, __m128i high) {
+    s = _mm_add_epi32(s, bias);
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(s, reciprocal), 32);
+    __m128i odd = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(s, 32), reciprocal), high);
+    return _mm_or_si128(even, odd);
+}
+
+// SSE2 lacks packus_epi32, shift into the signed range, pack with saturation and flip the sign bit back
+static inline __m128i pack16_sse2(__m128i a, __m128i b) {
+    __m128i offset = _mm_set1_epi32(32768);
+    __m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, offset), _mm_sub_epi32(b, offset));
+    return _mm_xor_si128(packed, _mm_set1_epi16((short) 0x8000));
+}
+
+static void box_sse2(const uint16_t *frame, uint16_t *oldest, uint32_t *sum, uint16_t *out, size_t n, uint32_t bias, uint32_t reciprocal) {
+    __m128i vbias = _mm_set1_epi32((int) bias);
+    __m128i vreciprocal = _mm_set1_epi32((int) reciprocal);
+    __m128i high = _mm_set1_epi64x((long long) 0xffffffff00000000ull);
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (frame + i));
+        __m128i o = _mm_loadu_si128((const __m128i *) (oldest + i));
+        _mm_storeu_si128((__m128i *) (oldest + i), x);
+        __m128i s0 = _mm_loadu_si128((const __m128i *) (sum + i));
+        __m128i s1 = _mm_loadu_si128((const __m128i *) (sum + i + 4));
+        s0 = _mm_add_epi32(_mm_sub_epi32(s0, _mm_unpacklo_epi16(o, zero)), _mm_unpacklo_epi16(x, zero));
+        s1 = _mm_add_epi32(_mm_sub_epi32(s1, _mm_unpackhi_epi16(o, zero)), _mm_unpackhi_epi16(x, zero));
+        _mm_storeu_si128((__m128i *) (sum + i), s0);
+        _mm_storeu_si128((__m128i *) (sum + i + 4), s1);
+        __m128i q = pack16_sse2(divide4_sse2(s0, vbias, vreciprocal, high), divide4_sse2(s1, vbias, vreciprocal, high));
+        _mm_storeu_si128((__m128i *) (out + i), q);
+    }
+    box_scalar(frame + i, oldest + i, sum + i, out + i, n - i, bias, reciprocal);
+}
+
+static inline __m128i ema4_sse2(__m128i x, uint32_t *state, __m128i alpha, __m128i beta, __m128i round) {
+    __m128i xs = _mm_slli_epi32(x, 15);
+    __m128i y = _mm_loadu_si128((const __m128i *) state);
+    __m128i even = _mm_add_epi64(_mm_add_epi64(_mm_mul_epu32(xs, alpha), _mm_mul_epu32(y, beta)), round);
+    __m128i odd = _mm_add_epi64(_mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(xs, 32), alpha),
+                                              _mm_mul_epu32(_mm_srli_epi64(y, 32), beta)), round);
+    y = _mm_or_si128(_mm_srli_epi64(even, 16), _mm_slli_epi64(_mm_srli_epi64(odd, 16), 32));
+    _mm_storeu_si128((__m128i *) state, y);
+    return _mm_srli_epi32(_mm_add_epi32(y, _mm_set1_epi32(16384)), 15);
+}
+
+static void ema_sse2(const uint16_t *frame, uint32_t *state, uint16_t *out, size_t n, uint32_t alpha) {
+    __m128i valpha = _mm_set1_epi32((int) alpha);
+    __m128i vbeta = _mm_set1_epi32((int) (65536 - alpha));
+    __m128i round = _mm_set1_epi64x(32768);
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (frame + i));
+        __m128i y0 = ema4_sse2(_mm_unpacklo_epi16(x, zero), state + i, valpha, vbeta, round);
+        __m128i y1 = ema4_sse2(_mm_unpackhi_epi16(x, zero), state + i + 4, valpha, vbeta, round);
+        _mm_storeu_si128((__m128i *) (out + i), pack16_sse2(y0, y1));
+    }
+    ema_scalar(frame + i, state + i, out + i, n - i, alpha);
+}
+
+// SSE2 only has signed 16 bit min/max, the history is sorted with the sign bit flipped
+static void median_sse2(const uint16_t *history, size_t stride, int count, uint16_t *out, size_t n) {
+    __m128i v[TemporalFilter::MAX_MEDIAN_LENGTH];
+    __m128i sign = _mm_set1_epi16((short) 0x8000);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (int k = 0; k < count; k++) {
+            v[k] = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (history + k * stride + i)), sign);
+        }
+        for (int pass = 0; pass < count; pass++) {
+            for (int k = pass & 1; k + 1 < count; k += 2) {
+                __m128i lo = _mm_min_epi16(v[k], v[k + 1]);
+                v[k + 1] = _mm_max_epi16(v[k], v[k + 1]);
+                v[k] = lo;
+            }
+        }
+        __m128i m;
+        if (count % 2 == 0) {
+            m = _mm_avg_epu16(_mm_xor_si128(v[count / 2 - 1], sign), _mm_xor_si128(v[count / 2], sign));
+        } else {
+            m = _mm_xor_si128(v[count / 2], sign);
+        }
+        _mm_storeu_si128((__m128i *) (out + i), m);
+    }
+    median_scalar(history + i, stride, count, out + i, n - i);
+}
+
+#endif
+
+#if defined(PYOPTRIS_NEON) && defined(__aarch64__)
+
+static inline uint32x4_t divide4_neon(uint32x4_t s, uint32x4_t bias, uint32x2_t reciprocal) {
+    s = vaddq_u32(s, bias);
+    uint32x2_t lo = vshrn_n_u64(vmull_u32(vget_low_u32(s), reciprocal), 32);
+    uint32x2_t hi = vshrn_n_u64(vmull_u32(vget_high_u32(s), reciprocal), 32);
+    return vcombine_u32(lo, hi);
+}
+
+static void box_neon(const uint16_t *frame, uint16_t *oldest, uint32_t *sum, uint16_t *out, size_t n, uint32_t bias, uint32_t reciprocal) {
+    uint32x4_t vbias = vdupq_n_u32(bias);
+    uint32x2_t vreciprocal = vdup_n_u32(reciprocal);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t x = vld1q_u16(frame + i);
+        uint16x8_t o = vld1q_u16(oldest + i);
+        vst1q_u16(oldest + i, x);
+        uint32x4_t s0 = vaddq_u32(vsubq_u32(vld1q_u32(sum + i), vmovl_u16(vget_low_u16(o))), vmovl_u16(vget_low_u16(x)));
+        uint32x4_t s1 = vaddq_u32(vsubq_u32(vld1q_u32(sum + i + 4), vmovl_u16(vget_high_u16(o))), vmovl_u16(vget_high_u16(x)));
+        vst1q_u32(sum + i, s0);
+        vst1q_u32(sum + i + 4, s1);
+        vst1q_u16(out + i, vcombine_u16(vmovn_u32(divide4_neon(s0, vbias, vreciprocal)), vmovn_u32(divide4_neon(s1, vbias, vreciprocal))));
+    }
+    box_scalar(frame + i, oldest + i, sum + i, out + i, n - i, bias, reciprocal);
+}
+
+static inline uint32x4_t ema4_neon(uint32x4_t x, uint32_t *state, uint32x2_t alpha, uint32x2_t beta, uint64x2_t round) {
+    uint32x4_t xs = vshlq_n_u32(x, 15);
+    uint32x4_t y = vld1q_u32(state);
+    uint64x2_t lo = vaddq_u64(vmlal_u32(vmull_u32(vget_low_u32(xs), alpha), vget_low_u32(y), beta), round);
+    uint64x2_t hi = vaddq_u64(vmlal_u32(vmull_u32(vget_high_u32(xs), alpha), vget_high_u32(y), beta), round);
+    y = vcombine_u32(vshrn_n_u64(lo, 16), vshrn_n_u64(hi, 16));
+    vst1q_u32(state, y);
+    return vshrq_n_u32(vaddq_u32(y, vdupq_n_u32(16384)), 15);
+}
+
+static void ema_neon(const uint16_t *frame, uint32_t *state, uint16_t *out, size_t n, uint32_t alpha) {
+    uint32x2_t valpha = vdup_n_u32(alpha);
+    uint32x2_t vbeta = vdup_n_u32(65536 - alpha);
+    uint64x2_t round = vdupq_n_u64(32768);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t x = vld1q_u16(frame + i);
+        uint32x4_t y0 = ema4_neon(vmovl_u16(vget_low_u16(x)), state + i, valpha, vbeta, round);
+        uint32x4_t y1 = ema4_neon(vmovl_u16(vget_high_u16(x)), state + i + 4, valpha, vbeta, round);
+        vst1q_u16(out + i, vcombine_u16(vmovn_u32(y0), vmovn_u32(y1)));
+    }
+    ema_scalar(frame + i, state + i, out + i, n - i, alpha);
+}
+
+static void median_neon(const uint16_t *history, size_t stride, int count, uint16_t *out, size_t n) {
+    uint16x8_t v[TemporalFilter::MAX_MEDIAN_LENGTH];
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (int k = 0; k < count; k++) {
+            v[k] = vld1q_u16(history + k * stride + i);
+        }
+        for (int pass = 0; pass < count; pass++) {
+            for (int k = pass & 1; k + 1 < count; k += 2) {
+                uint16x8_t lo = vminq_u16(v[k], v[k + 1]);
+                v[k + 1] = vmaxq_u16(v[k], v[k + 1]);
+                v[k] = lo;
+            }
+        }
+        vst1q_u16(out + i, count % 2 == 0 ? vrhaddq_u16(v[count / 2 - 1], v[count / 2]) : v[count / 2]);
+    }
+    median_scalar(history + i, stride, count, out + i, n - i);
+}
+
+#endif
+
+typedef void (*BoxKernel)(const uint16_t *, uint16_t *, uint32_t *, uint16_t *, size_t, uint32_t, uint32_t);
+typedef void (*EmaKernel)(const uint16_t *, uint32_t *, uint16_t *, size_t, uint32_t);
+typedef void (*MedianKernel)(const uint16_t *, size_t, int, uint16_t *, size_t);
+
+struct TemporalKernels {
+    BoxKernel box;
+    EmaKernel ema;
+    MedianKernel median;
+};
+
+static TemporalKernels select_kernels() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        return { box_avx2, ema_avx2, median_avx2 };
+    }
+#endif
+#if defined(PYOPTRIS_SSE2)
+    return { box_sse2, ema_sse2, median_sse2 };
+#elif defined(PYOPTRIS_NEON) && defined(__aarch64__)
+    return { box_neon, ema_neon, median_neon };
+#else
+    return { box_scalar, ema_scalar, median_scalar };
+#endif
+}
+
+static const TemporalKernels &kernels() {
+    static const TemporalKernels selected = select_kernels();
+    return selected;
+}
+
+TemporalFilter::TemporalFilter(Mode mode, size_t pixels, int length, double alpha)
+    : filterMode(mode), pixelCount(pixels), historyLength(length),
+      alphaQ16((uint32_t) std::min(65536.0, std::max(1.0, std::round(alpha * 65536.0)))), nextSlot(0), frameCount(0) {
+    if (mode != EMA) {
+        history.resize((size_t) historyLength * pixels);
+    }
+    if (mode != MEDIAN) {
+        state.resize(pixels);
+    }
+}
+
+void TemporalFilter::update(const uint16_t *frame, uint16_t *out) {
+    uint16_t *slot = history.data() + (size_t) nextSlot * pixelCount;
+    uint32_t count = (uint32_t) std::min<uint64_t>(frameCount + 1, (uint64_t) historyLength);
+    switch (filterMode) {
+    case BOX: {
+        // The history starts zeroed, so the sum is right before it filled up as well
+        uint32_t bias = count == 1 ? 1 : count / 2;
+        uint32_t reciprocal = count == 1 ? 0xffffffffu : (uint32_t) (((1ull << 32) + count - 1) / count);
+        kernels().box(frame, slot, state.data(), out, pixelCount, bias, reciprocal);
+        break;
+    }
+    case EMA:
+        if (frameCount == 0) {
+            for (size_t i = 0; i < pixelCount; i++) {
+                state[i] = (uint32_t) frame[i] << 15;
+            }
+            if (out != frame) {
+                std::memcpy(out, frame, pixelCount * sizeof(uint16_t));
+            }
+        } else {
+            kernels().ema(frame, state.data(), out, pixelCount, alphaQ16);
+        }
+        break;
+    case MEDIAN:
+        std::memcpy(slot, frame, pixelCount * sizeof(uint16_t));
+        kernels().median(history.data(), pixelCount, (int) count, out, pixelCount);
+        break;
+    }
+    if (filterMode != EMA) {
+        nextSlot = (nextSlot + 1) % historyLength;
+    }
+    frameCount++;
+}
+
+bool TemporalFilter::output(uint16_t *out) const {
+    if (frameCount == 0) {
+        return false;
+    }
+    uint32_t count = (uint32_t) std::min<uint64_t>(frameCount, (uint64_t) historyLength);
+    switch (filterMode) {
+    case BOX: {
+        uint32_t bias = count == 1 ? 1 : count / 2;
+        uint64_t reciprocal = count == 1 ? 0xffffffffu : ((1ull << 32) + count - 1) / count;
+        for (size_t i = 0; i < pixelCount; i++) {
+            out[i] = (uint16_t) (((uint64_t) (state[i] + bias) * reciprocal) >> 32);
+        }
+        break;
+    }
+    case EMA:
+        for (size_t i = 0; i < pixelCount; i++) {
+            out[i] = (uint16_t) ((state[i] + 16384) >> 15);
+        }
+        break;
+    case MEDIAN:
+        kernels().median(history.data(), pixelCount, (int) count, out, pixelCount);
+        break;
+    }
+    return true;
+}
+
+void TemporalFilter::reset() {
+    std::fill(history.begin(), history.end(), (uint16_t) 0);
+    std::fill(state.begin(), state.end(), 0u);
+    nextSlot = 0;
+    frameCount = 0;
+}
+
+const char *temporal_isa() {
+#ifdef PYOPTRIS_X86
+    if (cpu_has_avx2()) {
+        return "avx2";
+    }
+#endif
+#if defined(PYOPTRIS_SSE2)
+    return "sse2";
+#elif defined(PYOPTRIS_NEON) && defined(__aarch64__)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef PYOPTRIS_TEMPORAL_H
+#define PYOPTRIS_TEMPORAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pyoptris {
+
+/**
+ * @brief Temporal noise filter over a stream of raw uint16 frames, all arithmetic in integers.
+ *  - box: mean of the last length frames, a running uint32 sum per pixel, divided by a 32.32 fixed-point reciprocal
+ *  - ema: exponential moving average, Q15 state per pixel and alpha in Q16
+ *  - median: median of the last length frames, a sorting network across the history per group of pixels
+ * Until length frames were seen box and median use the frames available. All state is allocated up front.
+ */
+class TemporalFilter {
+public:
+    enum Mode {
+        BOX = 0,
+        EMA = 1,
+        MEDIAN = 2
+    };
+
+    static const int MAX_BOX_LENGTH = 255;      // keeps the reciprocal division exact
+    static const int MAX_MEDIAN_LENGTH = 31;
+
+    /**
+     * @param length frames averaged or taken the median of, ignored by ema
+     * @param alpha weight of a new frame in (0, 1], ema only
+     */
+    TemporalFilter(Mode mode, size_t pixels, int length, double alpha);
+
+    /**
+     * @brief Adds a frame to the filter
+     * @param out receives the filtered frame, may alias frame
+     */
+    void update(const uint16_t *frame, uint16_t *out);
+
+    /**
+     * @brief Filtered frame of the frames added so far
+     * @return false before the first frame
+     */
+    bool output(uint16_t *out) const;
+
+    /**
+     * @brief Forgets every frame
+     */
+    void reset();
+
+    Mode mode() const { return filterMode; }
+    int length() const { return historyLength; }
+    double alpha() const { return alphaQ16 / 65536.0; }
+    size_t pixels() const { return pixelCount; }
+    uint64_t frames() const { return frameCount; }
+
+private:
+    Mode filterMode;
+    size_t pixelCount;
+    int historyLength;
+    uint32_t alphaQ16;
+    std::vector<uint16_t> history;  // box and median: historyLength frames, oldest overwritten first
+    std::vector<uint32_t> state;    // box: sum of the history, ema: average in Q15
+    int nextSlot;
+    uint64_t frameCount;
+};
+
+/**
+ * @brief Name of the instruction set picked for the temporal kernels, e.g. "avx2"
+ */
+const char *temporal_isa();
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+#include "workers.h"
+
+#include <algorithm>
+
+namespace pyoptris {
+
+WorkerPool::WorkerPool(int threads)
+    : job(nullptr), jobSize(0), nextTask(0), busy(0), generation(0), stopping(false) {
+    for (int i = 0; i < threads; i++) {
+        this->threads.emplace_back(&WorkerPool::work, this, i + 1);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t, int)> &task) {
+    if (threads.empty() || count <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(i, 0);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &task;
+        jobSize = count;
+        nextTask.store(0, std::memory_order_relaxed);
+        busy = (int) threads.size();
+        generation++;
+    }
+    wake.notify_all();
+    drain(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+void WorkerPool::drain(int worker) {
+    for (size_t i = nextTask.fetch_add(1, std::memory_order_relaxed); i < jobSize; i = nextTask.fetch_add(1, std::memory_order_relaxed)) {
+        (*job)(i, worker);
+    }
+}
+
+void WorkerPool::work(int worker) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        lock.unlock();
+        drain(worker);
+        lock.lock();
+        if (--busy == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+int default_worker_threads() {
+    unsigned hardware = std::thread::hardware_concurrency();
+    return (int) std::min(8u, std::max(1u, hardware));
+}
+
+}
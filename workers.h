@@ -0,0 +1,69 @@
+#ifndef PYOPTRIS_WORKERS_H
+#define PYOPTRIS_WORKERS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pyoptris {
+
+/**
+ * @brief Fixed set of native threads splitting a job of independent tasks with the calling thread.
+ * Threads are started once and sleep between jobs, tasks are claimed from an atomic counter so uneven
+ * tasks balance themselves. One job runs at a time, run() is not reentrant.
+ */
+class WorkerPool {
+public:
+    /**
+     * @param threads threads besides the caller, 0 runs every job on the calling thread
+     */
+    explicit WorkerPool(int threads);
+
+    /**
+     * @brief Stops and joins the threads
+     */
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    /**
+     * @brief Runs task(index, worker) for every index in [0, count), returns once all of them are done
+     * @param task must not throw, worker is in [0, size()) and unique among the tasks running at the same time
+     */
+    void run(size_t count, const std::function<void(size_t, int)> &task);
+
+    /**
+     * @brief Threads a job is split across, the caller included
+     */
+    int size() const { return (int) threads.size() + 1; }
+
+private:
+    void work(int worker);
+    void drain(int worker);
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t, int)> *job;
+    size_t jobSize;
+    std::atomic<size_t> nextTask;
+    int busy;               // threads still draining the current job
+    uint64_t generation;    // bumped for every job, threads wait for it to change
+    bool stopping;
+    std::vector<std::thread> threads;
+};
+
+/**
+ * @brief Threads to split frame processing across by default, the hardware threads capped at 8
+ */
+int default_worker_threads();
+
+}
+
+#endif